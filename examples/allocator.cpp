@@ -0,0 +1,66 @@
+/**
+ * allocator.cpp - Allocation-heavy queries with and without the xsql arena
+ *
+ * Each worker thread owns a connection with a generated virtual table and
+ * repeatedly prepares and runs string-heavy queries (concatenation, sorting,
+ * GROUP BY over text), which makes SQLite allocate and free many small
+ * blocks. The same run is timed with the system malloc and then with
+ * xsql::install_allocator().
+ *
+ * Usage:
+ *   ./example_allocator [threads] [rows]
+ */
+
+#include <xsql/xsql.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+static double run(int threads, size_t rows) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([rows]() {
+            auto def = xsql::table("words")
+                .count([rows]() { return rows; })
+                .column_int64("id", [](size_t i) { return static_cast<int64_t>(i); })
+                .column_text("word", [](size_t i) { return "w" + std::to_string((i * 2654435761u) % 5003); })
+                .build();
+            xsql::Database db;
+            db.register_and_create_table(def);
+            for (int round = 0; round < 20; ++round) {
+                db.query("SELECT word, COUNT(*), group_concat(id) FROM words GROUP BY word ORDER BY 2 DESC LIMIT 5");
+                db.query("SELECT upper(word) || '-' || id AS k FROM words ORDER BY k LIMIT 10");
+                db.query("SELECT COUNT(DISTINCT substr(word, 1, 3)) FROM words WHERE word LIKE 'w1%'");
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[]) {
+    int threads = argc > 1 ? atoi(argv[1]) : 4;
+    size_t rows = argc > 2 ? static_cast<size_t>(atoll(argv[2])) : 20000;
+
+    printf("threads: %d, rows: %zu\n", threads, rows);
+    printf("  system malloc  %9.1f ms\n", run(threads, rows));
+
+    // All connections above are closed, so SQLite can be re-initialized
+    xsql::AllocatorOptions options;
+    options.shutdown_sqlite = true;
+    std::string error;
+    if (!xsql::install_allocator(options, error)) {
+        fprintf(stderr, "install_allocator: %s\n", error.c_str());
+        return 1;
+    }
+    printf("  xsql arena     %9.1f ms\n", run(threads, rows));
+
+    auto stats = xsql::allocator_stats();
+    printf("  arena reserved %9.1f KiB, %llu large blocks\n", stats.reserved_bytes / 1024.0,
+           static_cast<unsigned long long>(stats.large_allocations));
+    return 0;
+}
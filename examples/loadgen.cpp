@@ -0,0 +1,112 @@
+/**
+ * loadgen.cpp - Replay captured or synthetic load against an xsql server
+ *
+ * Demonstrates xsql::socket::replay_workload. Capture a workload by setting
+ * ServerConfig::capture_path on the server, then replay it here, or drive a
+ * weighted mix of queries.
+ *
+ * Usage:
+ *   ./xsql_loadgen --port 13337 --replay load.xwl --speed 2
+ *   ./xsql_loadgen --port 13337 --query "SELECT * FROM items":3 \
+ *                  --query "SELECT COUNT(*) FROM items" --count 10000 --concurrency 8 --rate 2000
+ */
+
+#include <xsql/socket/socket.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+void print_usage(const char* prog) {
+    printf("Usage:\n");
+    printf("  %s [options] --replay <file>        Replay a capture\n", prog);
+    printf("  %s [options] --query <sql>[:weight] ...  Run a synthetic mix\n", prog);
+    printf("\nOptions:\n");
+    printf("  --host <host>        Server host (default 127.0.0.1)\n");
+    printf("  --port <port>        Server port (default 13337)\n");
+    printf("  --token <token>      Auth token\n");
+    printf("  --concurrency <n>    Worker threads (default 4)\n");
+    printf("  --rate <qps>         Fixed arrival rate (default: unpaced)\n");
+    printf("  --speed <x>          Replay captured timing x times faster\n");
+    printf("  --count <n>          Synthetic requests (default 1000)\n");
+    printf("  --connections <n>    Synthetic client connections (default = concurrency)\n");
+}
+
+// "sql:weight" -> (sql, weight); a trailing ":<number>" is the weight
+std::pair<std::string, double> parse_mix_entry(const std::string& arg) {
+    size_t colon = arg.rfind(':');
+    if (colon != std::string::npos && colon + 1 < arg.size()) {
+        char* end = nullptr;
+        double w = strtod(arg.c_str() + colon + 1, &end);
+        if (end && *end == '\0' && w > 0) return {arg.substr(0, colon), w};
+    }
+    return {arg, 1.0};
+}
+
+int main(int argc, char* argv[]) {
+    std::string host = "127.0.0.1";
+    int port = 13337;
+    std::string replay_path;
+    std::vector<std::pair<std::string, double>> mix;
+    size_t count = 1000;
+    size_t connections = 0;
+    xsql::socket::ReplayOptions opt;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (strcmp(arg, "--host") == 0 && has_value) {
+            host = argv[++i];
+        } else if (strcmp(arg, "--port") == 0 && has_value) {
+            port = atoi(argv[++i]);
+        } else if (strcmp(arg, "--token") == 0 && has_value) {
+            opt.token = argv[++i];
+        } else if (strcmp(arg, "--replay") == 0 && has_value) {
+            replay_path = argv[++i];
+        } else if (strcmp(arg, "--query") == 0 && has_value) {
+            mix.push_back(parse_mix_entry(argv[++i]));
+        } else if (strcmp(arg, "--concurrency") == 0 && has_value) {
+            opt.concurrency = static_cast<size_t>(atoi(argv[++i]));
+        } else if (strcmp(arg, "--rate") == 0 && has_value) {
+            opt.rate_qps = atof(argv[++i]);
+        } else if (strcmp(arg, "--speed") == 0 && has_value) {
+            opt.speed = atof(argv[++i]);
+        } else if (strcmp(arg, "--count") == 0 && has_value) {
+            count = static_cast<size_t>(atoll(argv[++i]));
+        } else if (strcmp(arg, "--connections") == 0 && has_value) {
+            connections = static_cast<size_t>(atoi(argv[++i]));
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<xsql::socket::CapturedRequest> workload;
+    if (!replay_path.empty()) {
+        std::string error;
+        if (!xsql::socket::read_workload(replay_path, workload, error)) {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+    } else if (!mix.empty()) {
+        workload = xsql::socket::synthetic_workload(mix, count, connections > 0 ? connections : opt.concurrency);
+    } else {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    printf("Sending %zu requests to %s:%d with %zu workers...\n", workload.size(), host.c_str(), port,
+           opt.concurrency);
+    auto report = xsql::socket::replay_workload(host, port, workload, opt);
+
+    printf("\nRequests:   %llu (%llu failed)\n", static_cast<unsigned long long>(report.requests),
+           static_cast<unsigned long long>(report.errors));
+    if (!report.first_error.empty()) printf("First error: %s\n", report.first_error.c_str());
+    printf("Elapsed:    %.3f s\n", report.elapsed_s);
+    printf("Throughput: %.1f req/s\n", report.throughput());
+    printf("Latency:    p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms\n", report.p50_ms, report.p90_ms,
+           report.p99_ms, report.max_ms);
+    return report.errors == 0 ? 0 : 2;
+}
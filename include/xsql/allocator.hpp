@@ -0,0 +1,380 @@
+/**
+ * xsql/allocator.hpp - Per-thread arena allocator for SQLite and libxsql
+ *
+ * Part of libxsql - a generic SQLite virtual table framework.
+ *
+ * SQLite allocates and frees small blocks constantly while preparing and
+ * stepping statements, and libxsql allocates a cursor per xOpen. By default
+ * all of it goes through the global malloc. install_allocator() points
+ * SQLite at a size-class arena instead: each thread keeps free lists per
+ * size class and refills them in batches from a shared depot, which carves
+ * new blocks out of large chunks. Most allocations and frees touch only the
+ * calling thread's lists. Blocks freed on another thread simply join that
+ * thread's lists, and a thread's lists return to the depot when it exits.
+ *
+ * Chunks are never returned to the system; the arena's footprint is the
+ * high-water mark of live small blocks. Blocks above the largest size class
+ * go straight to malloc.
+ *
+ * Cursor and vtab objects of all table kinds, and the pending-row and
+ * savepoint buffers of insertable_batch tables, allocate from the same arena
+ * once it is installed. ArenaAllocator<T> puts any other container there too.
+ *
+ * Example:
+ *
+ *   int main() {
+ *       std::string error;
+ *       if (!xsql::install_allocator(xsql::AllocatorOptions(), error)) {
+ *           fprintf(stderr, "%s\n", error.c_str());
+ *       }
+ *       xsql::Database db;   // first connection: SQLite initializes with the arena
+ *       ...
+ *   }
+ */
+
+#pragma once
+
+#include <sqlite3.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace xsql {
+
+struct AllocatorOptions {
+    int lookaside_slot_size = 0;    // SQLITE_CONFIG_LOOKASIDE default per connection (0 = leave)
+    int lookaside_slots = 0;
+    size_t chunk_bytes = 1024 * 1024;   // Carved into blocks when the depot runs dry
+    // sqlite3_shutdown() first. Only safe with no connection open anywhere,
+    // including the per-thread probe connection writable tables with a
+    // change feed keep; blocks SQLite allocated earlier must all be freed.
+    bool shutdown_sqlite = false;
+};
+
+struct AllocatorStats {
+    bool installed = false;
+    uint64_t reserved_bytes = 0;    // Chunk memory taken from the system
+    uint64_t large_allocations = 0; // Blocks above the largest size class
+};
+
+namespace detail {
+
+// ============================================================================
+// Size-Class Arena
+// ============================================================================
+
+class ArenaHeap {
+public:
+    static constexpr size_t kClasses = 12;                  // Payloads 16, 32, ... 32768 bytes
+    static constexpr size_t kMinBlock = 16;
+    static constexpr size_t kMaxBlock = kMinBlock << (kClasses - 1);
+    static constexpr uint32_t kLarge = 0xfffffffe;          // malloc'd, size in header
+    static constexpr uint32_t kSystem = 0xffffffff;         // malloc'd before install
+    static constexpr size_t kBatch = 32;                    // Blocks moved per refill/flush
+    static constexpr size_t kMaxCached = 256;               // Per thread and class
+
+    // Precedes every block; 16 bytes keeps payloads 16-byte aligned
+    struct alignas(16) Header {
+        uint32_t size_class;
+        uint32_t reserved;
+        uint64_t size;          // Usable payload bytes
+    };
+    static_assert(sizeof(Header) == 16, "arena header must be 16 bytes");
+
+    static ArenaHeap& instance() {
+        static ArenaHeap* heap = new ArenaHeap();   // Never destroyed: frees may outlive statics
+        return *heap;
+    }
+
+    bool enabled() const { return enabled_.load(std::memory_order_acquire); }
+    void enable(size_t chunk_bytes) {
+        chunk_bytes_ = chunk_bytes > kMaxBlock * 4 ? chunk_bytes : kMaxBlock * 4;
+        enabled_.store(true, std::memory_order_release);
+    }
+
+    static size_t class_of(size_t n) {
+        size_t cls = 0;
+        size_t size = kMinBlock;
+        while (size < n) {
+            size <<= 1;
+            cls++;
+        }
+        return cls;
+    }
+    static size_t class_size(size_t cls) { return kMinBlock << cls; }
+
+    void* allocate(size_t n) {
+        if (n == 0) n = 1;
+        if (!enabled() || n > kMaxBlock) {
+            Header* h = static_cast<Header*>(std::malloc(sizeof(Header) + n));
+            if (!h) return nullptr;
+            h->size_class = enabled() ? kLarge : kSystem;
+            h->size = n;
+            if (h->size_class == kLarge) large_.fetch_add(1, std::memory_order_relaxed);
+            return h + 1;
+        }
+
+        size_t cls = class_of(n);
+        ThreadCache* tc = thread_cache();
+        FreeNode* node = nullptr;
+        if (tc) {
+            if (!tc->heads[cls]) refill(*tc, cls);
+            node = tc->heads[cls];
+            if (node) {
+                tc->heads[cls] = node->next;
+                tc->counts[cls]--;
+            }
+        } else {
+            node = take_one(cls);
+        }
+        if (!node) return nullptr;
+        Header* h = reinterpret_cast<Header*>(node);
+        h->size_class = static_cast<uint32_t>(cls);
+        h->size = class_size(cls);
+        return h + 1;
+    }
+
+    void deallocate(void* p) {
+        if (!p) return;
+        Header* h = static_cast<Header*>(p) - 1;
+        if (h->size_class == kLarge || h->size_class == kSystem) {
+            std::free(h);
+            return;
+        }
+        size_t cls = h->size_class;
+        FreeNode* node = reinterpret_cast<FreeNode*>(h);
+        ThreadCache* tc = thread_cache();
+        if (!tc) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            node->next = depot_[cls];
+            depot_[cls] = node;
+            return;
+        }
+        node->next = tc->heads[cls];
+        tc->heads[cls] = node;
+        if (++tc->counts[cls] > kMaxCached) flush(*tc, cls, kMaxCached / 2);
+    }
+
+    static size_t usable_size(const void* p) {
+        return p ? (static_cast<const Header*>(p) - 1)->size : 0;
+    }
+
+    void* reallocate(void* p, size_t n) {
+        if (!p) return allocate(n);
+        size_t have = usable_size(p);
+        const Header* h = static_cast<const Header*>(p) - 1;
+        // Stay in place while the block still fits and is not wastefully large
+        if (h->size_class < kClasses && n <= have && (n > have / 2 || h->size_class == 0)) return p;
+        void* q = allocate(n);
+        if (!q) return nullptr;
+        std::memcpy(q, p, have < n ? have : n);
+        deallocate(p);
+        return q;
+    }
+
+    AllocatorStats stats() const {
+        AllocatorStats s;
+        s.installed = enabled();
+        s.reserved_bytes = reserved_.load(std::memory_order_relaxed);
+        s.large_allocations = large_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+private:
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    struct ThreadCache {
+        FreeNode* heads[kClasses] = {};
+        size_t counts[kClasses] = {};
+        ~ThreadCache() {
+            state() = 2;    // Later frees on this thread go to the depot
+            for (size_t cls = 0; cls < kClasses; ++cls) instance().flush(*this, cls, 0);
+        }
+    };
+
+    std::atomic<bool> enabled_{false};
+    size_t chunk_bytes_ = 1024 * 1024;
+    std::mutex mutex_;
+    FreeNode* depot_[kClasses] = {};
+    std::atomic<uint64_t> reserved_{0};
+    std::atomic<uint64_t> large_{0};
+
+    ArenaHeap() = default;
+
+    // 0 = not created, 1 = live, 2 = destroyed (thread exiting)
+    static int& state() {
+        static thread_local int s = 0;
+        return s;
+    }
+
+    static ThreadCache* thread_cache() {
+        int& s = state();
+        if (s == 2) return nullptr;
+        static thread_local ThreadCache cache;
+        s = 1;
+        return &cache;
+    }
+
+    // Move blocks beyond keep back to the depot
+    void flush(ThreadCache& tc, size_t cls, size_t keep) {
+        if (tc.counts[cls] <= keep) return;
+        FreeNode* first = tc.heads[cls];
+        FreeNode* last = first;
+        for (size_t i = 1; i < tc.counts[cls] - keep; ++i) last = last->next;
+        tc.heads[cls] = last->next;
+        tc.counts[cls] = keep;
+        std::lock_guard<std::mutex> lock(mutex_);
+        last->next = depot_[cls];
+        depot_[cls] = first;
+    }
+
+    void refill(ThreadCache& tc, size_t cls) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < kBatch && depot_[cls]; ++i) {
+            FreeNode* n = depot_[cls];
+            depot_[cls] = n->next;
+            n->next = tc.heads[cls];
+            tc.heads[cls] = n;
+            tc.counts[cls]++;
+        }
+        if (!tc.heads[cls]) carve_locked(cls, tc.heads[cls], tc.counts[cls]);
+    }
+
+    FreeNode* take_one(size_t cls) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!depot_[cls]) {
+            size_t count = 0;
+            carve_locked(cls, depot_[cls], count);
+        }
+        FreeNode* n = depot_[cls];
+        if (n) depot_[cls] = n->next;
+        return n;
+    }
+
+    // Split a new chunk into blocks of cls, pushing them onto list
+    void carve_locked(size_t cls, FreeNode*& list, size_t& count) {
+        size_t block = sizeof(Header) + class_size(cls);
+        size_t blocks = chunk_bytes_ / block;
+        // Small classes do not need a whole chunk at a time
+        size_t want = kBatch * 8;
+        if (blocks > want) blocks = want;
+        size_t bytes = blocks * block;
+        char* chunk = static_cast<char*>(std::malloc(bytes));
+        if (!chunk) return;
+        reserved_.fetch_add(bytes, std::memory_order_relaxed);
+        for (size_t i = blocks; i-- > 0;) {
+            FreeNode* n = reinterpret_cast<FreeNode*>(chunk + i * block);
+            n->next = list;
+            list = n;
+            count++;
+        }
+    }
+};
+
+// sqlite3_mem_methods adapters
+inline void* arena_sqlite_malloc(int n) { return ArenaHeap::instance().allocate(static_cast<size_t>(n)); }
+inline void arena_sqlite_free(void* p) { ArenaHeap::instance().deallocate(p); }
+inline void* arena_sqlite_realloc(void* p, int n) {
+    return ArenaHeap::instance().reallocate(p, static_cast<size_t>(n));
+}
+inline int arena_sqlite_size(void* p) { return static_cast<int>(ArenaHeap::usable_size(p)); }
+inline int arena_sqlite_roundup(int n) {
+    size_t size = static_cast<size_t>(n);
+    if (size > ArenaHeap::kMaxBlock) return (n + 7) & ~7;
+    return static_cast<int>(ArenaHeap::class_size(ArenaHeap::class_of(size)));
+}
+inline int arena_sqlite_init(void*) { return SQLITE_OK; }
+inline void arena_sqlite_shutdown(void*) {}
+
+/**
+ * Base for framework objects allocated with new: they come from the arena
+ * once it is installed, and from malloc before that.
+ */
+struct ArenaAllocated {
+    static void* operator new(size_t n) {
+        void* p = ArenaHeap::instance().allocate(n);
+        if (!p) throw std::bad_alloc();
+        return p;
+    }
+    static void operator delete(void* p) { ArenaHeap::instance().deallocate(p); }
+};
+
+} // namespace detail
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+/**
+ * Route SQLite's allocations (and libxsql's cursors) through the arena.
+ * Must run before SQLite initializes, i.e. before the first connection is
+ * opened, unless options.shutdown_sqlite is set and no connection is open.
+ * Installing twice is a no-op.
+ */
+inline bool install_allocator(const AllocatorOptions& options, std::string& error) {
+    auto& heap = detail::ArenaHeap::instance();
+    if (heap.enabled()) return true;
+
+    if (options.shutdown_sqlite) sqlite3_shutdown();
+
+    static const sqlite3_mem_methods methods = {
+        detail::arena_sqlite_malloc, detail::arena_sqlite_free, detail::arena_sqlite_realloc,
+        detail::arena_sqlite_size, detail::arena_sqlite_roundup, detail::arena_sqlite_init,
+        detail::arena_sqlite_shutdown, nullptr};
+    int rc = sqlite3_config(SQLITE_CONFIG_MALLOC, &methods);
+    if (rc != SQLITE_OK) {
+        error = rc == SQLITE_MISUSE ? "install_allocator must run before SQLite is initialized"
+                                    : std::string("SQLITE_CONFIG_MALLOC failed: ") + sqlite3_errstr(rc);
+        return false;
+    }
+    if (options.lookaside_slot_size > 0 && options.lookaside_slots > 0) {
+        sqlite3_config(SQLITE_CONFIG_LOOKASIDE, options.lookaside_slot_size, options.lookaside_slots);
+    }
+    heap.enable(options.chunk_bytes);
+    return true;
+}
+
+inline bool install_allocator() {
+    std::string error;
+    return install_allocator(AllocatorOptions(), error);
+}
+
+inline AllocatorStats allocator_stats() { return detail::ArenaHeap::instance().stats(); }
+
+/**
+ * Standard allocator over the arena. Used by the vtab's batch insert
+ * buffers; available to callers for their own containers. Falls back to
+ * malloc until install_allocator() runs.
+ */
+template <typename T>
+struct ArenaAllocator {
+    using value_type = T;
+
+    ArenaAllocator() noexcept = default;
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        if (n > static_cast<size_t>(-1) / sizeof(T)) throw std::bad_alloc();
+        void* p = detail::ArenaHeap::instance().allocate(n * sizeof(T));
+        if (!p) throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+    void deallocate(T* p, size_t) noexcept { detail::ArenaHeap::instance().deallocate(p); }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>&) const noexcept { return false; }
+};
+
+} // namespace xsql
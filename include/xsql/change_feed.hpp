@@ -0,0 +1,186 @@
+/**
+ * xsql/change_feed.hpp - Structured change stream for writable tables
+ *
+ * Part of libxsql - a generic SQLite virtual table framework.
+ *
+ * A ChangeFeed receives one ChangeEvent per row written through a writable
+ * table's xUpdate (table, operation, rowid, old and new column values).
+ * Events go into a bounded lock-free ring: writers never block, and when the
+ * ring is full new events are dropped and counted so a consumer can fall
+ * back to a full resync. Any number of threads may publish and drain.
+ *
+ * Inserts into insertable_batch() tables are transactional: their events
+ * are published only after the batch handler accepts the commit, and rows
+ * undone by ROLLBACK or ROLLBACK TO never produce one. Every other write
+ * (plain insertable() inserts, updates and deletes) is published as soon as
+ * xUpdate succeeds, so a statement that later fails or rolls back still
+ * leaves the events of the rows it already changed.
+ *
+ * Events from primary_key() (WITHOUT ROWID) tables carry rowid -1; consumers
+ * identify those rows by the key column value instead.
+ *
+ * Example:
+ *
+ *   auto feed = std::make_shared<xsql::ChangeFeed>(8192);
+ *   auto def = xsql::table("items")
+ *       .count([&]() { return items.size(); })
+ *       .column_text_rw("name", getter, setter)
+ *       .change_feed(feed)
+ *       .build();
+ *
+ *   std::vector<xsql::ChangeEvent> batch;
+ *   while (feed->drain(batch, 256)) {
+ *       replicate(batch);
+ *       batch.clear();
+ *   }
+ */
+
+#pragma once
+
+#include "value.hpp"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace xsql {
+
+// ============================================================================
+// Change Event
+// ============================================================================
+
+enum class ChangeOp { Insert, Update, Delete };
+
+inline const char* change_op_name(ChangeOp op) {
+    switch (op) {
+        case ChangeOp::Insert: return "INSERT";
+        case ChangeOp::Update: return "UPDATE";
+        case ChangeOp::Delete: return "DELETE";
+    }
+    return "";
+}
+
+struct ChangeEvent {
+    uint64_t sequence = 0;          // Position in the feed, increasing in drain order
+    std::string table;
+    ChangeOp op = ChangeOp::Insert;
+    // -1 for INSERT when the table assigns the row, and always -1 for
+    // primary_key() tables: their row is identified by the key column in
+    // old_values/new_values[primary_key_column], not by a position
+    int64_t rowid = -1;
+    std::vector<Value> old_values;  // UPDATE/DELETE: one per column, before the change
+    std::vector<Value> new_values;  // INSERT/UPDATE: one per column, after the change
+};
+
+// ============================================================================
+// Change Feed (bounded MPMC ring)
+// ============================================================================
+
+class ChangeFeed {
+    // Each cell's turn tells producers and consumers whose move it is:
+    // turn == pos means free for the producer of pos, pos + 1 means filled.
+    struct Cell {
+        std::atomic<size_t> turn{0};
+        ChangeEvent event;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> head_{0};   // Next position to publish
+    alignas(64) std::atomic<size_t> tail_{0};   // Next position to consume
+    std::atomic<uint64_t> published_{0};
+    std::atomic<uint64_t> dropped_{0};
+
+public:
+    /// capacity is rounded up to a power of two (minimum 2)
+    explicit ChangeFeed(size_t capacity = 4096) {
+        size_t n = 2;
+        while (n < capacity) n <<= 1;
+        cells_.reset(new Cell[n]);
+        for (size_t i = 0; i < n; ++i) cells_[i].turn.store(i, std::memory_order_relaxed);
+        mask_ = n - 1;
+    }
+
+    ChangeFeed(const ChangeFeed&) = delete;
+    ChangeFeed& operator=(const ChangeFeed&) = delete;
+
+    /**
+     * Append an event. Never blocks; returns false (and counts a drop) when
+     * the ring is full.
+     */
+    bool publish(ChangeEvent event) {
+        size_t pos = head_.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells_[pos & mask_];
+            size_t turn = cell.turn.load(std::memory_order_acquire);
+            if (turn == pos) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    event.sequence = pos + 1;
+                    cell.event = std::move(event);
+                    cell.turn.store(pos + 1, std::memory_order_release);
+                    published_.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            } else if (turn < pos) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// Remove the oldest event; false if the feed is empty
+    bool try_pop(ChangeEvent& out) {
+        size_t pos = tail_.load(std::memory_order_relaxed);
+        while (true) {
+            Cell& cell = cells_[pos & mask_];
+            size_t turn = cell.turn.load(std::memory_order_acquire);
+            if (turn == pos + 1) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    out = std::move(cell.event);
+                    cell.event = ChangeEvent();
+                    cell.turn.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (turn < pos + 1) {
+                return false;
+            } else {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * Append up to max_events events to out, oldest first.
+     * @return Number of events appended
+     */
+    size_t drain(std::vector<ChangeEvent>& out, size_t max_events = static_cast<size_t>(-1)) {
+        size_t n = 0;
+        ChangeEvent event;
+        while (n < max_events && try_pop(event)) {
+            out.push_back(std::move(event));
+            ++n;
+        }
+        return n;
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+    /// Approximate number of queued events (exact when no thread is active)
+    size_t size() const {
+        size_t head = head_.load(std::memory_order_acquire);
+        size_t tail = tail_.load(std::memory_order_acquire);
+        return head > tail ? head - tail : 0;
+    }
+
+    uint64_t published() const { return published_.load(std::memory_order_relaxed); }
+
+    /// Events lost because the ring was full; consumers should resync when this moves
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+};
+
+} // namespace xsql
@@ -0,0 +1,214 @@
+/**
+ * xsql/connection_pool.hpp - Pool of Database connections for worker threads
+ *
+ * Part of libxsql - a generic SQLite virtual table framework.
+ *
+ * A Database (and its sqlite3 handle) must only be used by one thread at a
+ * time. ConnectionPool lets a fixed set of worker threads run queries in
+ * parallel by leasing each one its own connection, opened on demand by an
+ * application factory that also registers the tables and functions the
+ * workers need. Idle connections are reused most-recently-returned first,
+ * so a steady set of workers keeps hitting warm page caches.
+ *
+ * Example:
+ *
+ *   xsql::ConnectionPool pool(xsql::read_only_connections("data.db", [](xsql::Database& db) {
+ *       db.register_and_create_table(funcs_def);
+ *   }), 8);
+ *
+ *   // On any worker thread:
+ *   auto conn = pool.acquire();
+ *   if (!conn) return fail(conn.error());
+ *   auto result = conn->query(sql);   // connection returns to the pool with conn
+ */
+
+#pragma once
+
+#include "database.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace xsql {
+
+class ConnectionPool {
+public:
+    /// Opens and prepares one connection; return nullptr (or a closed Database) on failure
+    using factory_t = std::function<std::unique_ptr<Database>()>;
+
+    /**
+     * Exclusive use of one connection until destroyed. An empty lease
+     * carries the reason none was available.
+     */
+    class Lease {
+        ConnectionPool* pool_ = nullptr;
+        std::unique_ptr<Database> db_;
+        uint64_t generation_ = 0;
+        std::string error_;
+
+        friend class ConnectionPool;
+        Lease(ConnectionPool* pool, std::unique_ptr<Database> db, uint64_t generation)
+            : pool_(pool), db_(std::move(db)), generation_(generation) {}
+
+    public:
+        Lease() = default;
+        explicit Lease(std::string error) : error_(std::move(error)) {}
+        ~Lease() { release(); }
+
+        Lease(Lease&& other) noexcept
+            : pool_(other.pool_), db_(std::move(other.db_)), generation_(other.generation_),
+              error_(std::move(other.error_)) {
+            other.pool_ = nullptr;
+        }
+
+        Lease& operator=(Lease&& other) noexcept {
+            if (this != &other) {
+                release();
+                pool_ = other.pool_;
+                db_ = std::move(other.db_);
+                generation_ = other.generation_;
+                error_ = std::move(other.error_);
+                other.pool_ = nullptr;
+            }
+            return *this;
+        }
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        explicit operator bool() const { return db_ != nullptr; }
+        Database& operator*() const { return *db_; }
+        Database* operator->() const { return db_.get(); }
+        const std::string& error() const { return error_; }
+
+        void release() {
+            if (pool_ && db_) pool_->give_back(std::move(db_), generation_);
+            pool_ = nullptr;
+        }
+    };
+
+    ConnectionPool(factory_t factory, size_t max_connections)
+        : factory_(std::move(factory)), max_connections_(max_connections > 0 ? max_connections : 1) {}
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    /**
+     * Lease a connection, opening one if fewer than max_connections exist,
+     * otherwise waiting up to timeout_ms (-1 = forever) for one to be returned.
+     */
+    Lease acquire(int timeout_ms = -1) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto available = [&]() { return !idle_.empty() || open_ < max_connections_; };
+        if (timeout_ms < 0) {
+            cv_.wait(lock, available);
+        } else if (!cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), available)) {
+            return Lease("no connection available within " + std::to_string(timeout_ms) + " ms");
+        }
+
+        if (!idle_.empty()) {
+            std::unique_ptr<Database> db = std::move(idle_.back());
+            idle_.pop_back();
+            return Lease(this, std::move(db), generation_);
+        }
+
+        // Open outside the lock; the slot is reserved meanwhile
+        open_++;
+        uint64_t generation = generation_;
+        lock.unlock();
+        std::unique_ptr<Database> db;
+        std::string error;
+        try {
+            db = factory_ ? factory_() : nullptr;
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+        if (!db || !db->is_open()) {
+            if (error.empty()) error = db ? db->last_error() : "connection factory failed";
+            lock.lock();
+            open_--;
+            cv_.notify_one();
+            return Lease("failed to open connection: " + error);
+        }
+        return Lease(this, std::move(db), generation);
+    }
+
+    size_t max_connections() const { return max_connections_; }
+
+    /// Connections currently open (leased or idle)
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return open_;
+    }
+
+    size_t idle() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return idle_.size();
+    }
+
+    /// Close idle connections, e.g. after a schema change; leased ones close on return
+    void clear() {
+        std::vector<std::unique_ptr<Database>> closing;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closing.swap(idle_);
+            open_ -= closing.size();
+            generation_++;
+        }
+        cv_.notify_all();
+    }
+
+private:
+    factory_t factory_;
+    size_t max_connections_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<std::unique_ptr<Database>> idle_;   // Back = most recently returned
+    size_t open_ = 0;
+    uint64_t generation_ = 0;
+
+    void give_back(std::unique_ptr<Database> db, uint64_t generation) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (generation == generation_) {
+                idle_.push_back(std::move(db));
+            } else {
+                open_--;    // Opened before clear(); db closes below
+            }
+        }
+        cv_.notify_one();
+    }
+};
+
+/**
+ * Factory for connections to a database file opened with options; setup
+ * registers tables and functions on each new connection. A lease is only
+ * used by one thread at a time, so options may include SQLITE_OPEN_NOMUTEX.
+ */
+inline ConnectionPool::factory_t pooled_connections(std::string path, DatabaseOptions options,
+                                                    std::function<void(Database&)> setup = {}) {
+    return [path = std::move(path), options = std::move(options),
+            setup = std::move(setup)]() -> std::unique_ptr<Database> {
+        auto db = std::make_unique<Database>();
+        if (!db->open(path.c_str(), options)) return db;
+        if (setup) setup(*db);
+        return db;
+    };
+}
+
+/// Read-only, mutex-free connections to a database file
+inline ConnectionPool::factory_t read_only_connections(std::string path,
+                                                       std::function<void(Database&)> setup = {}) {
+    DatabaseOptions options;
+    options.flags = SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX;
+    return pooled_connections(std::move(path), std::move(options), std::move(setup));
+}
+
+} // namespace xsql
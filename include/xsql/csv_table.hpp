@@ -0,0 +1,555 @@
+/**
+ * xsql/csv_table.hpp - Memory-mapped CSV/TSV files as generator tables
+ *
+ * Part of libxsql - a generic SQLite virtual table framework.
+ *
+ * csv_table() exposes a delimited text file as a read-only table without
+ * loading it: the file is mapped once and every query streams rows straight
+ * out of the mapping.
+ *
+ *   - Row and field boundaries are found 16 bytes at a time (SSE2 where
+ *     available, a scalar loop elsewhere); quoted fields may contain
+ *     delimiters, doubled quotes and newlines.
+ *   - Only the columns a query references (SQLite's colUsed) are split out
+ *     of each row; SELECT COUNT(*) never looks past the newline.
+ *   - A sparse row index (one byte offset every index_stride rows) is filled
+ *     in as scans pass and is shared by every table on the same CsvFile, so
+ *     OFFSET, `rowid > ?` pages and partition starts seek instead of
+ *     re-reading the prefix. The rowid is the 0-based data row number.
+ *   - Tables can cover one partition of the rows, so N connections (e.g. a
+ *     ConnectionPool) can scan one file in parallel.
+ *
+ * Example:
+ *
+ *   xsql::CsvOptions opt;
+ *   opt.types = {xsql::ColumnType::Integer, xsql::ColumnType::Text, xsql::ColumnType::Real};
+ *   auto def = xsql::csv_table("sales", "sales.csv", opt);
+ *   db.register_and_create_generator_table(def);
+ *   db.query("SELECT region, SUM(amount) FROM sales GROUP BY region");
+ *
+ *   // Parallel: one shared file, partition k of n per worker connection
+ *   std::string error;
+ *   auto file = xsql::CsvFile::open("sales.csv", opt, error);
+ *   auto part = xsql::csv_table("sales", file, k, n);
+ *
+ * The file must not be modified while it is open. On Windows the file is
+ * read into memory instead of mapped.
+ */
+
+#pragma once
+
+#include "vtable.hpp"
+#include "mapped_file.hpp"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace xsql {
+
+struct CsvOptions {
+    char delimiter = ',';                // '\t' for TSV
+    char quote = '"';                    // '\0' disables quoting
+    bool header = true;                  // First row holds column names
+    std::vector<std::string> columns;    // Column names (default: header, else c1..cN)
+    std::vector<ColumnType> types;       // Per column, default TEXT; see csv_table()
+    size_t index_stride = 1024;          // Rows between sparse index entries
+};
+
+namespace detail {
+
+// The newline ending the row that starts at p (or end); newlines inside
+// quotes belong to the field. As in csv_split, only a quote that opens a
+// field starts a quoted section; any other quote is plain text.
+inline const char* csv_row_end(const char* p, const char* end, char delim, char quote) {
+    if (!quote) return find_either(p, end, '\n', '\n');
+    const char* row = p;
+    while (true) {
+        p = find_either(p, end, '\n', quote);
+        if (p == end || *p == '\n') return p;
+        if (p != row && p[-1] != delim) {
+            ++p;
+            continue;
+        }
+        // Skip to the closing quote; a doubled quote continues the section
+        do {
+            p = find_either(p + 1, end, quote, quote);
+            if (p == end) return end;
+            ++p;
+        } while (p < end && *p == quote);
+    }
+}
+
+using CsvSpan = std::pair<const char*, const char*>;
+
+// Append fields of [p, end) to `out` until it holds `count`; `p` resumes
+// after the last field split so far
+inline void csv_split(const char*& p, const char* end, char delim, char quote, size_t count,
+                      std::vector<CsvSpan>& out, bool& done) {
+    while (!done && out.size() < count) {
+        const char* start = p;
+        if (quote && p < end && *p == quote) {
+            const char* q = p + 1;
+            while (true) {
+                q = find_either(q, end, quote, quote);
+                if (q + 1 < end && q[1] == quote) {
+                    q += 2;
+                    continue;
+                }
+                break;
+            }
+            p = find_either(q < end ? q + 1 : end, end, delim, delim);
+        } else {
+            p = find_either(p, end, delim, delim);
+        }
+        out.emplace_back(start, p);
+        if (p >= end) {
+            done = true;
+        } else {
+            ++p;
+            // A trailing delimiter ends with one more, empty field
+            if (p == end && out.size() < count) {
+                out.emplace_back(end, end);
+                done = true;
+            }
+        }
+    }
+}
+
+// Header text as a usable column name: identifier characters only, unique
+// (case-insensitively) among `seen`
+inline std::string csv_column_name(const std::string& raw, size_t index, std::vector<std::string>& seen) {
+    std::string name;
+    for (char c : raw) {
+        name += (std::isalnum(static_cast<unsigned char>(c)) || c == '_') ? c : '_';
+    }
+    if (name.empty()) name = "c" + std::to_string(index + 1);
+    if (std::isdigit(static_cast<unsigned char>(name[0]))) name = "_" + name;
+
+    auto folded = [](std::string v) {
+        for (char& c : v) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        return v;
+    };
+    std::string unique = name;
+    for (int n = 2; std::find(seen.begin(), seen.end(), folded(unique)) != seen.end(); ++n) {
+        unique = name + "_" + std::to_string(n);
+    }
+    seen.push_back(folded(unique));
+    return unique;
+}
+
+} // namespace detail
+
+// ============================================================================
+// Mapped File and Sparse Row Index
+// ============================================================================
+
+class CsvFile {
+public:
+    /**
+     * Map `path` and read its column layout. Returns nullptr and sets
+     * `error` if the file cannot be read.
+     */
+    static std::shared_ptr<CsvFile> open(const std::string& path, const CsvOptions& options, std::string& error) {
+        std::shared_ptr<CsvFile> file(new CsvFile());
+        file->options_ = options;
+        if (file->options_.index_stride == 0) file->options_.index_stride = 1;
+        if (!file->file_.open(path, error)) return nullptr;
+        file->data_ = file->file_.data();
+        file->size_ = file->file_.size();
+        file->read_layout();
+        return file;
+    }
+
+    CsvFile(const CsvFile&) = delete;
+    CsvFile& operator=(const CsvFile&) = delete;
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    const CsvOptions& options() const { return options_; }
+    const std::vector<std::string>& column_names() const { return names_; }
+
+    // Offset just past the row starting at `offset`
+    size_t next_row(size_t offset) const {
+        const char* e = detail::csv_row_end(data_ + offset, data_ + size_, options_.delimiter, options_.quote);
+        return e == data_ + size_ ? size_ : static_cast<size_t>(e - data_) + 1;
+    }
+
+    /**
+     * Byte offset of data row `row` (0-based); false past the last row.
+     * Walks at most index_stride rows beyond the nearest index entry,
+     * extending the index as needed.
+     */
+    bool seek_row(uint64_t row, size_t& offset) {
+        const size_t stride = options_.index_stride;
+        const size_t entry = static_cast<size_t>(row / stride);
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            while (index_.size() <= entry && extend_index()) {}
+            if (index_.size() <= entry) return false;
+            offset = index_[entry];
+        }
+        for (uint64_t skip = row % stride; skip > 0; --skip) {
+            if (offset >= size_) return false;
+            offset = next_row(offset);
+        }
+        return offset < size_;
+    }
+
+    // Number of data rows; indexes the whole file the first time
+    uint64_t row_count() {
+        std::lock_guard<std::mutex> lock(mu_);
+        while (extend_index()) {}
+        return rows_;
+    }
+
+    // Exact once the file has been indexed to the end, sampled before that
+    size_t estimated_rows() {
+        std::lock_guard<std::mutex> lock(mu_);
+        return complete_ ? static_cast<size_t>(rows_) : estimate_;
+    }
+
+    // A scan reached row `row` at `offset`: record it if it is the next entry
+    void note_row(uint64_t row, size_t offset) {
+        if (row % options_.index_stride != 0) return;
+        std::lock_guard<std::mutex> lock(mu_);
+        if (!complete_ && index_.size() == row / options_.index_stride) index_.push_back(offset);
+    }
+
+    // A scan ran off the end after `rows` rows with every entry recorded
+    void note_end(uint64_t rows) {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (complete_) return;
+        uint64_t entries = std::max<uint64_t>(1, (rows + options_.index_stride - 1) / options_.index_stride);
+        if (index_.size() == entries) {
+            complete_ = true;
+            rows_ = rows;
+        }
+    }
+
+    size_t indexed_entries() {
+        std::lock_guard<std::mutex> lock(mu_);
+        return index_.size();
+    }
+
+    // Field text without surrounding quotes and with doubled quotes collapsed
+    std::string unquote(const detail::CsvSpan& span) const {
+        const char q = options_.quote;
+        if (!q || span.first == span.second || *span.first != q) return std::string(span.first, span.second);
+        std::string out;
+        const char* p = span.first + 1;
+        const char* end = span.second;
+        while (p < end) {
+            const char* next = detail::find_either(p, end, q, q);
+            out.append(p, next);
+            if (next + 1 < end && next[1] == q) {
+                out += q;
+                p = next + 2;
+            } else {
+                break;  // closing quote; anything after it is dropped
+            }
+        }
+        return out;
+    }
+
+private:
+    CsvFile() = default;
+
+    void read_layout() {
+        size_t first_row_end = size_ > 0 ? next_row(0) : 0;
+
+        // Column count and default names come from the first row
+        std::vector<detail::CsvSpan> fields;
+        if (size_ > 0) {
+            const char* p = data_;
+            const char* end = data_ + first_row_end;
+            if (end > p && end[-1] == '\n') --end;
+            if (end > p && end[-1] == '\r') --end;
+            bool done = false;
+            detail::csv_split(p, end, options_.delimiter, options_.quote, std::numeric_limits<size_t>::max(),
+                              fields, done);
+        }
+
+        std::vector<std::string> seen;
+        size_t count = options_.columns.empty() ? fields.size() : options_.columns.size();
+        for (size_t i = 0; i < count; ++i) {
+            std::string raw;
+            if (!options_.columns.empty()) {
+                raw = options_.columns[i];
+            } else if (options_.header) {
+                raw = unquote(fields[i]);
+            }
+            names_.push_back(detail::csv_column_name(raw, i, seen));
+        }
+
+        size_t start = options_.header ? first_row_end : 0;
+        index_.push_back(start);
+
+        // Sample row length for planning until the index is complete
+        size_t offset = start;
+        size_t sampled = 0;
+        while (sampled < 64 && offset < size_) {
+            offset = next_row(offset);
+            ++sampled;
+        }
+        if (offset >= size_) {
+            estimate_ = sampled;
+        } else {
+            estimate_ = (size_ - start) / std::max<size_t>(1, (offset - start) / sampled);
+        }
+    }
+
+    // Append the next index entry; false once the file is fully indexed
+    bool extend_index() {
+        if (complete_) return false;
+        const size_t stride = options_.index_stride;
+        size_t offset = index_.back();
+        for (size_t i = 0; i < stride; ++i) {
+            if (offset >= size_) {
+                complete_ = true;
+                rows_ = static_cast<uint64_t>(index_.size() - 1) * stride + i;
+                return false;
+            }
+            offset = next_row(offset);
+        }
+        if (offset >= size_) {
+            complete_ = true;
+            rows_ = static_cast<uint64_t>(index_.size()) * stride;
+            return false;
+        }
+        index_.push_back(offset);
+        return true;
+    }
+
+private:
+    CsvOptions options_;
+    detail::MappedFile file_;
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    std::vector<std::string> names_;
+
+    std::mutex mu_;
+    std::vector<size_t> index_;  // index_[k] = offset of data row k * index_stride
+    bool complete_ = false;      // index_ covers the whole file and rows_ is exact
+    uint64_t rows_ = 0;
+    size_t estimate_ = 0;
+};
+
+// ============================================================================
+// Rows and Generator
+// ============================================================================
+
+/**
+ * One row of a CsvFile, as seen by column getters. Fields are split lazily:
+ * the generator pre-splits up to the last referenced column and field()
+ * continues from there if asked for more.
+ */
+struct CsvRow {
+    const CsvFile* file = nullptr;
+    const char* begin = nullptr;  // Row bytes without the line ending
+    const char* end = nullptr;
+    int64_t row = 0;
+
+    mutable std::vector<detail::CsvSpan> fields;
+    mutable const char* split_pos = nullptr;
+    mutable bool split_done = false;
+
+    void reset(const CsvFile* f, const char* b, const char* e, int64_t r) {
+        file = f;
+        begin = b;
+        end = e;
+        row = r;
+        fields.clear();
+        split_pos = b;
+        split_done = false;
+    }
+
+    // Raw span of field `col` (quotes included); false if the row is shorter
+    bool span(size_t col, detail::CsvSpan& out) const {
+        if (col >= fields.size()) {
+            const auto& o = file->options();
+            detail::csv_split(split_pos, end, o.delimiter, o.quote, col + 1, fields, split_done);
+            if (col >= fields.size()) return false;
+        }
+        out = fields[col];
+        return true;
+    }
+
+    // Field text, unquoted ("" if the row has fewer fields)
+    std::string field(size_t col) const {
+        detail::CsvSpan s;
+        return span(col, s) ? file->unquote(s) : std::string();
+    }
+};
+
+namespace detail {
+
+// TEXT is returned as is; INTEGER/REAL parse the whole field, with empty
+// fields as NULL and anything unparsable kept as text
+inline void csv_result(sqlite3_context* ctx, const CsvRow& row, size_t col, ColumnType type) {
+    CsvSpan s;
+    if (!row.span(col, s)) {
+        sqlite3_result_null(ctx);
+        return;
+    }
+    const char q = row.file->options().quote;
+    const bool quoted = q && s.first != s.second && *s.first == q;
+    if (type == ColumnType::Integer || type == ColumnType::Real) {
+        std::string text = quoted ? row.file->unquote(s) : std::string(s.first, s.second);
+        if (text.empty()) {
+            sqlite3_result_null(ctx);
+            return;
+        }
+        if (type == ColumnType::Integer) {
+            int64_t v = 0;
+            auto res = std::from_chars(text.data(), text.data() + text.size(), v);
+            if (res.ec == std::errc() && res.ptr == text.data() + text.size()) {
+                sqlite3_result_int64(ctx, v);
+                return;
+            }
+        } else {
+            char* parsed_end = nullptr;
+            double v = std::strtod(text.c_str(), &parsed_end);
+            if (parsed_end == text.c_str() + text.size()) {
+                sqlite3_result_double(ctx, v);
+                return;
+            }
+        }
+        sqlite3_result_text(ctx, text.data(), static_cast<int>(text.size()), SQLITE_TRANSIENT);
+        return;
+    }
+    if (quoted) {
+        std::string text = row.file->unquote(s);
+        sqlite3_result_text(ctx, text.data(), static_cast<int>(text.size()), SQLITE_TRANSIENT);
+    } else {
+        sqlite3_result_text(ctx, s.first, static_cast<int>(s.second - s.first), SQLITE_TRANSIENT);
+    }
+}
+
+} // namespace detail
+
+/**
+ * Streams rows [first_row + scan.offset, end_row) of a CsvFile. Rowids are
+ * absolute data row numbers, so partitions of one file never overlap.
+ */
+class CsvGenerator : public Generator<CsvRow> {
+    std::shared_ptr<CsvFile> file_;
+    size_t presplit_ = 0;
+    uint64_t row_ = 0;
+    uint64_t end_row_ = std::numeric_limits<uint64_t>::max();
+    int64_t remaining_ = -1;
+    size_t offset_ = 0;
+    bool done_ = false;
+    CsvRow current_;
+
+public:
+    CsvGenerator(std::shared_ptr<CsvFile> file, const GeneratorScan& scan, uint64_t first_row, uint64_t end_row)
+        : file_(std::move(file)), end_row_(end_row), remaining_(scan.limit) {
+        size_t columns = file_->column_names().size();
+        for (size_t c = 0; c < columns; ++c) {
+            if (scan.uses_column(c)) presplit_ = c + 1;
+        }
+        row_ = first_row + static_cast<uint64_t>(scan.offset);
+        done_ = row_ >= end_row_ || !file_->seek_row(row_, offset_);
+    }
+
+    bool next() override {
+        if (done_ || remaining_ == 0 || row_ >= end_row_) return false;
+        if (offset_ >= file_->size()) {
+            file_->note_end(row_);
+            done_ = true;
+            return false;
+        }
+        file_->note_row(row_, offset_);
+
+        const char* base = file_->data();
+        size_t next = file_->next_row(offset_);
+        const char* b = base + offset_;
+        const char* e = base + next;
+        if (e > b && e[-1] == '\n') --e;
+        if (e > b && e[-1] == '\r') --e;
+        current_.reset(file_.get(), b, e, static_cast<int64_t>(row_));
+        if (presplit_ > 0) {
+            const auto& o = file_->options();
+            detail::csv_split(current_.split_pos, e, o.delimiter, o.quote, presplit_, current_.fields,
+                              current_.split_done);
+        }
+
+        offset_ = next;
+        ++row_;
+        if (remaining_ > 0) --remaining_;
+        return true;
+    }
+
+    const CsvRow& current() const override { return current_; }
+    sqlite3_int64 rowid() const override { return current_.row; }
+
+    // Rowids are row numbers: start at `key` through the sparse index
+    bool seek(sqlite3_int64 key) override {
+        if (key > 0 && static_cast<uint64_t>(key) > row_) {
+            row_ = static_cast<uint64_t>(key);
+            done_ = row_ >= end_row_ || !file_->seek_row(row_, offset_);
+        }
+        return true;
+    }
+};
+
+// ============================================================================
+// Table Definitions
+// ============================================================================
+
+/**
+ * Table over partition `partition` of `partitions` of an open CsvFile (rows
+ * split evenly; partitioning indexes the whole file once). Column types come
+ * from CsvOptions::types, TEXT when not given.
+ */
+inline GeneratorTableDef<CsvRow> csv_table(const char* name, std::shared_ptr<CsvFile> file,
+                                           size_t partition = 0, size_t partitions = 1) {
+    auto builder = generator_table<CsvRow>(name);
+    GeneratorTableDef<CsvRow> def = builder.build();
+    if (!file) return def;
+
+    const auto& types = file->options().types;
+    const auto& names = file->column_names();
+    for (size_t i = 0; i < names.size(); ++i) {
+        ColumnType type = i < types.size() ? types[i] : ColumnType::Text;
+        def.columns.emplace_back(names[i].c_str(), type, false,
+            [i, type](sqlite3_context* ctx, const CsvRow& row) { detail::csv_result(ctx, row, i, type); });
+    }
+
+    partitions = std::max<size_t>(partitions, 1);
+    def.seekable = true;
+    def.estimate_rows_fn = [file, partitions]() { return file->estimated_rows() / partitions; };
+    def.scan_factory_fn = [file, partition, partitions](const GeneratorScan& scan)
+            -> std::unique_ptr<Generator<CsvRow>> {
+        uint64_t first = 0;
+        uint64_t end = std::numeric_limits<uint64_t>::max();
+        if (partitions > 1) {
+            uint64_t rows = file->row_count();
+            first = rows * partition / partitions;
+            end = rows * (partition + 1) / partitions;
+        }
+        return std::make_unique<CsvGenerator>(file, scan, first, end);
+    };
+    return def;
+}
+
+/**
+ * Open `path` and define a table over all of it. If the file cannot be
+ * opened the definition has no columns and creating the table fails; use
+ * CsvFile::open() to get the reason.
+ */
+inline GeneratorTableDef<CsvRow> csv_table(const char* name, const std::string& path,
+                                           const CsvOptions& options = {}) {
+    std::string error;
+    return csv_table(name, CsvFile::open(path, options, error));
+}
+
+} // namespace xsql
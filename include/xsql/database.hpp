@@ -28,8 +28,15 @@
 
 #include "vtable.hpp"
 #include "functions.hpp"
+#include "value.hpp"
+#include "query_cache.hpp"
 #include <memory>
 #include <utility>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
 
 namespace xsql {
 
@@ -64,6 +71,113 @@ struct Result {
     auto end() const { return rows.end(); }
 };
 
+/**
+ * Caps on what one query may materialize (0 = unlimited). Bytes are the
+ * column names and value text, counted as rows are appended, so an
+ * oversized result fails as soon as it crosses the limit instead of after
+ * it is fully built.
+ */
+struct QueryLimits {
+    size_t max_result_bytes = 0;
+    size_t max_result_rows = 0;
+};
+
+/**
+ * Bytes that column names or one row's values count against
+ * QueryLimits::max_result_bytes. Live queries, cache hits and the socket
+ * handlers all count with this, so a statement gets the same verdict on
+ * every path.
+ */
+inline size_t result_limit_bytes(const std::vector<std::string>& texts) {
+    size_t bytes = 0;
+    for (const auto& t : texts) bytes += t.size();
+    return bytes;
+}
+
+// Fills the next row (one Value per column); returns false when done
+using BulkRowSource = std::function<bool(std::vector<Value>& row)>;
+
+struct BulkInsertOptions {
+    size_t batch_rows = 10000;  // rows per transaction
+    std::string on_conflict;    // "", "ROLLBACK", "ABORT", "FAIL", "IGNORE" or "REPLACE"
+};
+
+/**
+ * Outcome of Database::bulk_insert(). Batches that committed before an error
+ * stay committed and are counted in rows; the failing batch is rolled back.
+ * Inside a caller's transaction nothing is rolled back and rows counts the
+ * rows inserted before the error.
+ */
+struct BulkInsertStats {
+    size_t rows = 0;
+    size_t batches = 0;
+    double elapsed_s = 0;
+    std::string error;
+
+    bool ok() const { return error.empty(); }
+    double rows_per_second() const { return elapsed_s > 0 ? rows / elapsed_s : 0; }
+};
+
+/**
+ * Outcome of Database::materialize() / refresh_materialized(). rebuilt is
+ * false when the source generation had not moved and the copy was kept.
+ */
+struct MaterializeStats {
+    size_t rows = 0;
+    bool rebuilt = false;
+    double elapsed_s = 0;
+    std::string error;
+
+    bool ok() const { return error.empty(); }
+};
+
+/**
+ * Error text for a failed SQLite call. Allocation failures under a
+ * sqlite3_hard_heap_limit64() name the limit rather than just "out of memory".
+ */
+inline std::string sqlite_error_message(sqlite3* db, int rc) {
+    if ((rc & 0xff) == SQLITE_NOMEM) {
+        sqlite3_int64 limit = sqlite3_hard_heap_limit64(-1);
+        if (limit > 0) {
+            return "out of memory: SQLite heap limit of " + std::to_string(limit) + " bytes reached";
+        }
+    }
+    return db ? sqlite3_errmsg(db) : sqlite3_errstr(rc);
+}
+
+/**
+ * Connection settings applied by Database::open(path, options). Each field
+ * left at its default keeps SQLite's own default.
+ *
+ * SQLITE_OPEN_NOMUTEX drops SQLite's per-call connection mutex; use it when
+ * a connection is only ever used by one thread at a time (a pool lease, a
+ * worker-owned connection). journal_mode is checked after it is set, so
+ * asking for WAL on an in-memory database fails rather than silently
+ * staying in "memory" mode.
+ */
+struct DatabaseOptions {
+    int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+    std::string journal_mode;           // "WAL", "MEMORY", "OFF", ... ("" = leave)
+    std::string synchronous;            // "NORMAL", "OFF", ... ("" = leave)
+    int64_t mmap_size = -1;             // Bytes of the file to memory-map (-1 = leave, 0 = off)
+    int cache_size = 0;                 // PRAGMA cache_size: > 0 pages, < 0 KiB (0 = leave)
+    int temp_store = -1;                // 0 default, 1 file, 2 memory (-1 = leave)
+    int worker_threads = -1;            // SQLITE_LIMIT_WORKER_THREADS for the sorter (-1 = leave)
+    int lookaside_slot_size = 0;        // Lookaside allocator slot bytes (0 = leave)
+    int lookaside_slots = 0;            // Lookaside slot count (0 = leave)
+    int busy_timeout_ms = 0;            // sqlite3_busy_timeout (0 = leave)
+
+    /// Settings for a connection owned by one thread reading a file-backed database
+    static DatabaseOptions single_thread_reader() {
+        DatabaseOptions o;
+        o.flags = SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX;
+        o.mmap_size = 256ll * 1024 * 1024;
+        o.cache_size = -16 * 1024;
+        o.temp_store = 2;
+        return o;
+    }
+};
+
 // ============================================================================
 // Database Wrapper
 // ============================================================================
@@ -84,7 +198,15 @@ public:
 
     // Movable
     Database(Database&& other) noexcept
-        : db_(other.db_), last_error_(std::move(other.last_error_)) {
+        : db_(other.db_), last_error_(std::move(other.last_error_)),
+          query_cache_(std::move(other.query_cache_)),
+          module_generations_(std::move(other.module_generations_)),
+          module_row_estimates_(std::move(other.module_row_estimates_)),
+          nondeterministic_functions_(std::move(other.nondeterministic_functions_)),
+          functions_loaded_(other.functions_loaded_),
+          table_modules_(std::move(other.table_modules_)),
+          native_epoch_(other.native_epoch_), limits_(other.limits_),
+          materialized_(std::move(other.materialized_)) {
         other.db_ = nullptr;
     }
 
@@ -93,6 +215,15 @@ public:
             close();
             db_ = other.db_;
             last_error_ = std::move(other.last_error_);
+            query_cache_ = std::move(other.query_cache_);
+            module_generations_ = std::move(other.module_generations_);
+            module_row_estimates_ = std::move(other.module_row_estimates_);
+            nondeterministic_functions_ = std::move(other.nondeterministic_functions_);
+            functions_loaded_ = other.functions_loaded_;
+            table_modules_ = std::move(other.table_modules_);
+            native_epoch_ = other.native_epoch_;
+            limits_ = other.limits_;
+            materialized_ = std::move(other.materialized_);
             other.db_ = nullptr;
         }
         return *this;
@@ -103,8 +234,16 @@ public:
     // ========================================================================
 
     bool open(const char* path = ":memory:") {
+        return open(path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
+    }
+
+    /**
+     * Open with sqlite3_open_v2 flags, e.g. SQLITE_OPEN_READONLY for worker
+     * connections that must never write.
+     */
+    bool open(const char* path, int flags) {
         close();
-        int rc = sqlite3_open(path, &db_);
+        int rc = sqlite3_open_v2(path, &db_, flags, nullptr);
         if (rc != SQLITE_OK) {
             last_error_ = db_ ? sqlite3_errmsg(db_) : "Failed to allocate database";
             if (db_) {
@@ -117,11 +256,32 @@ public:
         return true;
     }
 
+    /**
+     * Open and apply options; on any failure the database is left closed and
+     * last_error() names the setting that could not be applied.
+     */
+    bool open(const char* path, const DatabaseOptions& options) {
+        if (!open(path, options.flags)) return false;
+        std::string error = apply_options(options);
+        if (!error.empty()) {
+            close();
+            last_error_ = std::move(error);
+            return false;
+        }
+        return true;
+    }
+
     void close() {
         if (db_) {
             sqlite3_close(db_);
             db_ = nullptr;
         }
+        if (query_cache_) query_cache_->clear();
+        module_generations_.clear();
+        module_row_estimates_.clear();
+        forget_functions();
+        table_modules_.clear();
+        materialized_.clear();
     }
 
     bool is_open() const { return db_ != nullptr; }
@@ -131,11 +291,7 @@ public:
     // ========================================================================
 
     bool register_table(const VTableDef& def) {
-        if (!db_) {
-            last_error_ = "Database not open";
-            return false;
-        }
-        return register_vtable(db_, def.name.c_str(), &def);
+        return register_table(def.name.c_str(), &def);
     }
 
     bool register_table(const char* module_name, const VTableDef* def) {
@@ -143,7 +299,13 @@ public:
             last_error_ = "Database not open";
             return false;
         }
-        return register_vtable(db_, module_name, def);
+        if (!register_vtable(db_, module_name, def)) return false;
+        track_module(module_name, [fn = def->generation_fn, writes = def->write_generation](uint64_t& gen) {
+            if (!fn) return false;
+            gen = fn() + writes->load();
+            return true;
+        }, def->estimate_rows);
+        return true;
     }
 
     bool create_table(const char* table_name, const char* module_name) {
@@ -151,6 +313,7 @@ public:
             last_error_ = "Database not open";
             return false;
         }
+        schema_changed();
         return xsql::create_vtable(db_, table_name, module_name);
     }
 
@@ -181,11 +344,7 @@ public:
 
     template<typename RowData>
     bool register_cached_table(const CachedTableDef<RowData>& def) {
-        if (!db_) {
-            last_error_ = "Database not open";
-            return false;
-        }
-        return register_cached_vtable(db_, def.name.c_str(), &def);
+        return register_cached_table(def.name.c_str(), &def);
     }
 
     template<typename RowData>
@@ -194,7 +353,12 @@ public:
             last_error_ = "Database not open";
             return false;
         }
-        return register_cached_vtable(db_, module_name, def);
+        if (!register_cached_vtable(db_, module_name, def)) return false;
+        track_module(module_name, [cache = def->shared_cache, fn = def->generation_fn](uint64_t& gen) {
+            gen = (cache ? cache->generation.load() : 0) + (fn ? fn() : 0);
+            return true;
+        }, def->estimate_rows_fn);
+        return true;
     }
 
     template<typename RowData>
@@ -215,11 +379,7 @@ public:
 
     template<typename RowData>
     bool register_generator_table(const GeneratorTableDef<RowData>& def) {
-        if (!db_) {
-            last_error_ = "Database not open";
-            return false;
-        }
-        return register_generator_vtable(db_, def.name.c_str(), &def);
+        return register_generator_table(def.name.c_str(), &def);
     }
 
     template<typename RowData>
@@ -228,7 +388,13 @@ public:
             last_error_ = "Database not open";
             return false;
         }
-        return register_generator_vtable(db_, module_name, def);
+        if (!register_generator_vtable(db_, module_name, def)) return false;
+        track_module(module_name, [fn = def->generation_fn](uint64_t& gen) {
+            if (!fn) return false;
+            gen = fn();
+            return true;
+        }, def->estimate_rows_fn);
+        return true;
     }
 
     template<typename RowData>
@@ -247,12 +413,20 @@ public:
     // Function Registration
     // ========================================================================
 
-    int register_function(const char* name, int argc, SqlScalarFn fn) {
+    /**
+     * Register a scalar function. flags defaults to SQLITE_UTF8 |
+     * SQLITE_DETERMINISTIC; drop SQLITE_DETERMINISTIC for functions whose
+     * result can change between calls, so the query cache, subscriptions
+     * and result_version() never reuse a result that calls them.
+     */
+    int register_function(const char* name, int argc, SqlScalarFn fn,
+                          int flags = SQLITE_UTF8 | SQLITE_DETERMINISTIC) {
         if (!db_) {
             last_error_ = "Database not open";
             return SQLITE_ERROR;
         }
-        return register_scalar_function(db_, name, argc, std::move(fn));
+        forget_functions();
+        return register_scalar_function(db_, name, argc, std::move(fn), flags);
     }
 
     // ========================================================================
@@ -260,52 +434,72 @@ public:
     // ========================================================================
 
     Result query(const char* sql) {
-        Result result;
+        return query(sql, std::vector<Value>{});
+    }
 
+    Result query(const std::string& sql) {
+        return query(sql.c_str());
+    }
+
+    /**
+     * Execute a query with bound parameters (?1..?N).
+     *
+     * When the query cache is enabled, read-only statements whose tables all
+     * expose a data generation are served from the cache while those
+     * generations are unchanged.
+     */
+    Result query(const char* sql, const std::vector<Value>& params) {
+        return query(sql, params, limits_);
+    }
+
+    Result query(const std::string& sql, const std::vector<Value>& params) {
+        return query(sql.c_str(), params);
+    }
+
+    /**
+     * Execute a query with explicit result limits instead of query_limits().
+     * A result over the limits fails with an error naming the limit.
+     */
+    Result query(const char* sql, const std::vector<Value>& params, const QueryLimits& limits) {
         if (!db_) {
+            Result result;
             result.error = "Database not open";
             return result;
         }
 
-        sqlite3_stmt* stmt = nullptr;
-        int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
-        if (rc != SQLITE_OK) {
-            result.error = sqlite3_errmsg(db_);
-            return result;
+        if (!query_cache_) {
+            return execute_query(sql, params, nullptr, limits);
         }
 
-        // Get column names
-        int col_count = sqlite3_column_count(stmt);
-        result.columns.reserve(col_count);
-        for (int i = 0; i < col_count; ++i) {
-            const char* name = sqlite3_column_name(stmt, i);
-            result.columns.push_back(name ? name : "");
-        }
-
-        // Fetch rows
-        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
-            Row row;
-            row.values.reserve(col_count);
-            for (int i = 0; i < col_count; ++i) {
-                const char* text = reinterpret_cast<const char*>(
-                    sqlite3_column_text(stmt, i));
-                row.values.push_back(text ? text : "");
+        std::string key = make_query_cache_key(sql, params);
+        auto cached = query_cache_->lookup(key, [this](const std::vector<TableGeneration>& deps) {
+            return dependencies_current(deps);
+        });
+        if (cached) {
+            // Entries may have been stored under looser limits
+            Result result;
+            if (limits.max_result_rows > 0 && cached->rows.size() > limits.max_result_rows) {
+                result.error = rows_limit_error(limits);
+            } else if (limits.max_result_bytes > 0 && text_bytes(*cached) > limits.max_result_bytes) {
+                result.error = bytes_limit_error(limits);
+            } else {
+                return *cached;
             }
-            result.rows.push_back(std::move(row));
+            return result;
         }
 
-        if (rc != SQLITE_DONE) {
-            result.error = sqlite3_errmsg(db_);
+        QueryDependencies deps = new_dependencies();
+        Result result = execute_query(sql, params, &deps, limits);
+        if (result.ok() && deps.cacheable) {
+            size_t bytes = result_bytes(result);
+            query_cache_->insert(key, std::make_shared<const Result>(result),
+                                 std::move(deps.tables), bytes);
+        } else if (result.ok()) {
+            query_cache_->note_uncacheable();
         }
-
-        sqlite3_finalize(stmt);
         return result;
     }
 
-    Result query(const std::string& sql) {
-        return query(sql.c_str());
-    }
-
     /**
      * Get single value (first column of first row)
      */
@@ -327,6 +521,7 @@ public:
             return SQLITE_ERROR;
         }
 
+        schema_changed();
         char* err = nullptr;
         int rc = sqlite3_exec(db_, sql, nullptr, nullptr, &err);
         if (err) {
@@ -353,6 +548,7 @@ public:
             return SQLITE_ERROR;
         }
 
+        schema_changed();
         char* err = nullptr;
         int rc = sqlite3_exec(db_, sql, callback, data, &err);
         if (err) {
@@ -366,6 +562,101 @@ public:
         return rc;
     }
 
+    // ========================================================================
+    // Bulk Insert
+    // ========================================================================
+
+    /**
+     * Insert rows into `table` (a table name, optionally schema-qualified as
+     * "schema.table") through one prepared statement, committing
+     * every options.batch_rows rows. Values are bound with their own types.
+     * Inside an open transaction no BEGIN/COMMIT is issued and the caller's
+     * transaction decides. Works for native tables and for insertable
+     * virtual tables (insertable_batch() receives one batch per commit).
+     * options.on_conflict must be one of ROLLBACK, ABORT, FAIL, IGNORE or
+     * REPLACE (any case), or empty.
+     */
+    BulkInsertStats bulk_insert(const std::string& table, const std::vector<std::string>& columns,
+                                const BulkRowSource& next, const BulkInsertOptions& options = {}) {
+        std::vector<Value> row;
+        return insert_batches(table, columns, [&]() -> const std::vector<Value>* {
+            row.clear();
+            return next(row) ? &row : nullptr;
+        }, options);
+    }
+
+    BulkInsertStats bulk_insert(const std::string& table, const std::vector<std::string>& columns,
+                                const std::vector<std::vector<Value>>& rows, const BulkInsertOptions& options = {}) {
+        size_t i = 0;
+        return insert_batches(table, columns, [&]() -> const std::vector<Value>* {
+            return i < rows.size() ? &rows[i++] : nullptr;
+        }, options);
+    }
+
+    // ========================================================================
+    // Materialized Tables
+    // ========================================================================
+
+    /**
+     * Snapshot `source` (usually a virtual table) into the native table
+     * `target` with one INSERT ... SELECT, then build one B-tree index per
+     * entry of `indexes` (a column list such as "name" or "grp, v DESC").
+     * Any existing `target` is replaced; the swap is atomic for readers on
+     * other connections. Queries against `target` never call the getters.
+     * A "schema.table" target (e.g. "temp.snap") is created with its
+     * indexes in that schema. Indexes are named `<table>_idx<N>`, with a
+     * suffix if another table already uses the name.
+     */
+    MaterializeStats materialize(const std::string& source, const std::string& target,
+                                 const std::vector<std::string>& indexes = {}) {
+        Materialization m;
+        m.source = source;
+        m.indexes = indexes;
+        MaterializeStats stats = build_materialization(target, m);
+        if (stats.ok()) materialized_[lower(target)] = std::move(m);
+        return stats;
+    }
+
+    /**
+     * Bring a table created by materialize() up to date. When the source
+     * exposes a generation (generation(), cached and generator tables with
+     * one) and it has not changed, nothing is copied; otherwise the snapshot
+     * is rebuilt. Native sources are always rebuilt.
+     */
+    MaterializeStats refresh_materialized(const std::string& target) {
+        auto it = materialized_.find(lower(target));
+        if (it == materialized_.end()) {
+            MaterializeStats stats;
+            stats.error = "not a materialized table: " + target;
+            last_error_ = stats.error;
+            return stats;
+        }
+        uint64_t gen = 0;
+        if (it->second.has_generation && source_generation(it->second.source, gen) &&
+            gen == it->second.generation) {
+            MaterializeStats stats;
+            last_error_.clear();
+            return stats;
+        }
+        Materialization m = it->second;
+        MaterializeStats stats = build_materialization(target, m);
+        if (stats.ok()) it->second = std::move(m);
+        return stats;
+    }
+
+    // ========================================================================
+    // Result Limits
+    // ========================================================================
+
+    /**
+     * Limits applied to query(), query_watched() and scalar(). Statements run
+     * through handle() directly are not covered. For SQLite's own memory
+     * (sorters, temp b-trees) see sqlite3_hard_heap_limit64(), which is
+     * process-wide.
+     */
+    void set_query_limits(const QueryLimits& limits) { limits_ = limits; }
+    const QueryLimits& query_limits() const { return limits_; }
+
     // ========================================================================
     // Direct Access
     // ========================================================================
@@ -373,6 +664,36 @@ public:
     sqlite3* handle() const { return db_; }
     const std::string& last_error() const { return last_error_; }
 
+    /**
+     * Row estimate of a virtual table registered through this wrapper, from
+     * its definition's estimate_rows(); < 0 for native tables, unknown names
+     * and tables without an estimate. Temp shadows main, as in SQLite. Only
+     * reads the schema, so a cost classifier may call it while another
+     * thread runs a query (e.g. CostPolicy::table_rows).
+     */
+    double estimated_rows(const std::string& table) const {
+        if (!db_) return -1.0;
+        std::string module;
+        for (const char* sql : {
+                 "SELECT sql FROM temp.sqlite_schema WHERE type = 'table' AND name = ?1 COLLATE NOCASE",
+                 "SELECT sql FROM main.sqlite_schema WHERE type = 'table' AND name = ?1 COLLATE NOCASE"}) {
+            sqlite3_stmt* stmt = nullptr;
+            if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) return -1.0;
+            sqlite3_bind_text(stmt, 1, table.c_str(), -1, SQLITE_TRANSIENT);
+            bool found = sqlite3_step(stmt) == SQLITE_ROW;
+            if (found) {
+                const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+                virtual_table_module(text ? text : "", module);
+            }
+            sqlite3_finalize(stmt);
+            if (found) break;
+        }
+        if (module.empty()) return -1.0;
+        auto it = module_row_estimates_.find(module);
+        if (it == module_row_estimates_.end() || !it->second) return -1.0;
+        return static_cast<double>(it->second());
+    }
+
     // ========================================================================
     // Utility
     // ========================================================================
@@ -385,9 +706,675 @@ public:
         return db_ ? sqlite3_changes(db_) : 0;
     }
 
+    // ========================================================================
+    // Query Result Cache
+    // ========================================================================
+
+    /**
+     * Cache results of read-only queries, bounded to max_bytes (LRU eviction).
+     *
+     * A statement is cached only if every table it reads has a data generation:
+     * cached tables always do, index-based and generator tables need
+     * .generation(fn), and native SQLite tables track this connection's
+     * writes plus the file's data version. Statements calling time or random
+     * functions, or application functions registered without
+     * SQLITE_DETERMINISTIC, are never cached.
+     *
+     * Writes and function registrations that bypass this wrapper (e.g. DDL
+     * or sqlite3_create_function through handle()) are not seen; call
+     * clear_query_cache() after them.
+     * Installs a temporary authorizer while preparing uncached statements.
+     */
+    void enable_query_cache(size_t max_bytes = 64 * 1024 * 1024) {
+        if (query_cache_) {
+            query_cache_->set_max_bytes(max_bytes);
+        } else {
+            query_cache_ = std::make_unique<QueryCache<Result>>(max_bytes);
+        }
+    }
+
+    void disable_query_cache() { query_cache_.reset(); }
+    bool query_cache_enabled() const { return query_cache_ != nullptr; }
+
+    void clear_query_cache() {
+        if (query_cache_) query_cache_->clear();
+        forget_functions();
+    }
+
+    QueryCacheStats query_cache_stats() const {
+        return query_cache_ ? query_cache_->stats() : QueryCacheStats{};
+    }
+
+    // ========================================================================
+    // Change Detection
+    // ========================================================================
+
+    /**
+     * Execute a query (bypassing the cache) and record the data generation of
+     * every table it read. While dependencies_current(deps) holds, running it
+     * again would return the same rows.
+     *
+     * watchable is false when that cannot be promised: the statement writes,
+     * calls time/random functions, or reads a table without a generation.
+     */
+    Result query_watched(const std::string& sql, std::vector<TableGeneration>& deps, bool& watchable) {
+        return query_watched(sql, deps, watchable, limits_);
+    }
+
+    Result query_watched(const std::string& sql, std::vector<TableGeneration>& deps, bool& watchable,
+                         const QueryLimits& limits) {
+        deps.clear();
+        watchable = false;
+        if (!db_) {
+            Result result;
+            result.error = "Database not open";
+            return result;
+        }
+        QueryDependencies collected = new_dependencies();
+        Result result = execute_query(sql.c_str(), {}, &collected, limits);
+        watchable = collected.cacheable;
+        deps = std::move(collected.tables);
+        return result;
+    }
+
+    /**
+     * Version of sql's result without running it: equal versions mean equal
+     * rows. Hashes the SQL text, params and the generation of every
+     * table it reads (e.g. for HTTP ETags).
+     *
+     * Returns false when no version can be given: the statement writes, calls
+     * time/random functions or non-deterministic application functions,
+     * reads a table without a generation, or reads a
+     * native SQLite table. Native generations are local to this connection,
+     * so versions taken on different connections could not be compared.
+     */
+    bool result_version(const std::string& sql, const std::vector<Value>& params, uint64_t& version) {
+        if (!db_) return false;
+        QueryDependencies deps = new_dependencies();
+        sqlite3_stmt* stmt = nullptr;
+        sqlite3_set_authorizer(db_, collect_dependencies, &deps);
+        int rc = sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr);
+        sqlite3_set_authorizer(db_, nullptr, nullptr);
+        if (rc != SQLITE_OK || !stmt) {
+            sqlite3_finalize(stmt);
+            return false;
+        }
+        bool read_only = sqlite3_stmt_readonly(stmt) != 0;
+        sqlite3_finalize(stmt);
+        if (!deps.cacheable || !read_only) return false;
+
+        // FNV-1a over the cache key and each (table, generation)
+        uint64_t hash = 14695981039346656037ull;
+        auto mix = [&hash](const void* data, size_t len) {
+            const auto* p = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < len; ++i) {
+                hash ^= p[i];
+                hash *= 1099511628211ull;
+            }
+        };
+        std::string key = make_query_cache_key(sql, params);
+        mix(key.data(), key.size());
+        for (const auto& t : deps.tables) {
+            size_t dot = t.table.find('.');
+            std::string module;
+            if (dot == std::string::npos ||
+                !resolve_table_module(t.table.substr(0, dot), t.table.substr(dot + 1), module) ||
+                module.empty()) {
+                return false;
+            }
+            uint64_t gen = 0;
+            if (!table_generation(t.table, gen)) return false;
+            mix(t.table.data(), t.table.size() + 1);
+            mix(&gen, sizeof(gen));
+        }
+        version = hash;
+        return true;
+    }
+
+    bool dependencies_current(const std::vector<TableGeneration>& deps) {
+        for (const auto& d : deps) {
+            uint64_t gen = 0;
+            if (!table_generation(d.table, gen) || gen != d.generation) return false;
+        }
+        return true;
+    }
+
 private:
+    // Returns an error message, or "" when every requested setting took effect
+    std::string apply_options(const DatabaseOptions& o) {
+        // Lookaside must be configured before the connection allocates from it
+        if (o.lookaside_slot_size > 0 && o.lookaside_slots > 0) {
+            int rc = sqlite3_db_config(db_, SQLITE_DBCONFIG_LOOKASIDE, nullptr, o.lookaside_slot_size,
+                                       o.lookaside_slots);
+            if (rc != SQLITE_OK) return "lookaside: " + sqlite_error_message(db_, rc);
+        }
+        if (o.worker_threads >= 0) sqlite3_limit(db_, SQLITE_LIMIT_WORKER_THREADS, o.worker_threads);
+        if (o.busy_timeout_ms > 0) sqlite3_busy_timeout(db_, o.busy_timeout_ms);
+
+        if (!o.journal_mode.empty()) {
+            std::string want = lower(o.journal_mode);
+            std::string got;
+            sqlite3_stmt* stmt = nullptr;
+            std::string sql = "PRAGMA journal_mode=" + want;
+            if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) == SQLITE_OK &&
+                sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_text(stmt, 0)) {
+                got = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+            }
+            sqlite3_finalize(stmt);
+            if (got != want) {
+                return "journal_mode " + o.journal_mode + " not applied (" +
+                       (got.empty() ? std::string(sqlite3_errmsg(db_)) : "mode is " + got) + ")";
+            }
+        }
+
+        std::vector<std::string> pragmas;
+        if (!o.synchronous.empty()) pragmas.push_back("PRAGMA synchronous=" + o.synchronous);
+        if (o.mmap_size >= 0) pragmas.push_back("PRAGMA mmap_size=" + std::to_string(o.mmap_size));
+        if (o.cache_size != 0) pragmas.push_back("PRAGMA cache_size=" + std::to_string(o.cache_size));
+        if (o.temp_store >= 0) pragmas.push_back("PRAGMA temp_store=" + std::to_string(o.temp_store));
+        for (const auto& sql : pragmas) {
+            char* err = nullptr;
+            int rc = sqlite3_exec(db_, sql.c_str(), nullptr, nullptr, &err);
+            if (rc != SQLITE_OK) {
+                std::string msg = sql + ": " + (err ? std::string(err) : sqlite_error_message(db_, rc));
+                sqlite3_free(err);
+                return msg;
+            }
+        }
+        return "";
+    }
+
+    using GenerationFn = std::function<bool(uint64_t&)>;
+
+    struct QueryDependencies {
+        bool cacheable = true;
+        std::vector<TableGeneration> tables;  // "schema.table" -> generation
+        const std::unordered_set<std::string>* nondeterministic = nullptr;  // Lowercase names
+    };
+
+    struct Materialization {
+        std::string source;
+        std::vector<std::string> indexes;
+        bool has_generation = false;
+        uint64_t generation = 0;  // source generation the snapshot was taken at
+    };
+
     sqlite3* db_ = nullptr;
     std::string last_error_;
+
+    std::unique_ptr<QueryCache<Result>> query_cache_;
+    std::unordered_map<std::string, GenerationFn> module_generations_;  // module -> generation
+    std::unordered_map<std::string, std::function<size_t()>> module_row_estimates_;  // module -> estimate_rows
+    std::unordered_set<std::string> nondeterministic_functions_;  // Application functions, lowercase
+    bool functions_loaded_ = false;
+    std::unordered_map<std::string, std::string> table_modules_;        // "schema.table" -> module ("" = native)
+    uint64_t native_epoch_ = 0;
+    QueryLimits limits_;
+    std::unordered_map<std::string, Materialization> materialized_;  // lower(target) -> source
+
+    // Generation of a virtual table source; false for native tables, whose
+    // generation also moves with our own writes
+    bool source_generation(const std::string& source, uint64_t& gen) {
+        size_t dot = source.find('.');
+        std::string schema = dot == std::string::npos ? "main" : source.substr(0, dot);
+        std::string table = dot == std::string::npos ? source : source.substr(dot + 1);
+        std::string module;
+        if (!resolve_table_module(schema, table, module) || module.empty()) return false;
+        auto it = module_generations_.find(module);
+        return it != module_generations_.end() && it->second && it->second(gen);
+    }
+
+    // Rebuild `target` from m.source inside a savepoint, so it also nests in
+    // a caller's transaction; records the generation the copy started at
+    MaterializeStats build_materialization(const std::string& target, Materialization& m) {
+        MaterializeStats stats;
+        auto start = std::chrono::steady_clock::now();
+        auto finish = [&](std::string error) {
+            stats.elapsed_s =
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            stats.error = std::move(error);
+            last_error_ = stats.error;
+            return stats;
+        };
+        if (!db_) return finish("Database not open");
+
+        schema_changed();
+        m.has_generation = source_generation(m.source, m.generation);
+
+        // "schema.table" targets keep the table and its indexes in that schema
+        size_t dot = target.find('.');
+        const std::string schema = dot == std::string::npos ? "main" : target.substr(0, dot);
+        const std::string table = dot == std::string::npos ? target : target.substr(dot + 1);
+        const std::string quoted = quote_identifier(schema) + "." + quote_identifier(table);
+        const std::string source = quote_qualified(m.source);
+
+        auto run = [&](const std::string& sql) {
+            char* err = nullptr;
+            int rc = sqlite3_exec(db_, sql.c_str(), nullptr, nullptr, &err);
+            if (rc == SQLITE_OK) return std::string();
+            std::string message = err ? err : sqlite_error_message(db_, rc);
+            sqlite3_free(err);
+            return message;
+        };
+
+        std::string error = run("SAVEPOINT xsql_materialize");
+        if (!error.empty()) return finish(std::move(error));
+
+        error = run("DROP TABLE IF EXISTS " + quoted);
+        // Column names and declared types come from the source
+        if (error.empty()) error = run("CREATE TABLE " + quoted + " AS SELECT * FROM " + source + " WHERE 0");
+        if (error.empty()) {
+            error = run("INSERT INTO " + quoted + " SELECT * FROM " + source);
+            stats.rows = static_cast<size_t>(sqlite3_changes64(db_));
+        }
+        // Indexes are built after the load: one sort per index instead of
+        // a B-tree update per row. The old ones went with DROP TABLE, so a
+        // taken name belongs to some other table and gets a suffix.
+        for (size_t i = 0; error.empty() && i < m.indexes.size(); ++i) {
+            std::string name = table + "_idx" + std::to_string(i);
+            for (int n = 2; index_exists(schema, name); ++n) {
+                name = table + "_idx" + std::to_string(i) + "_" + std::to_string(n);
+            }
+            error = run("CREATE INDEX " + quote_identifier(schema) + "." + quote_identifier(name) + " ON " +
+                        quote_identifier(table) + " (" + m.indexes[i] + ")");
+        }
+
+        if (!error.empty()) {
+            run("ROLLBACK TO xsql_materialize");
+            run("RELEASE xsql_materialize");
+            stats.rows = 0;
+            return finish("materialize " + target + ": " + error);
+        }
+        error = run("RELEASE xsql_materialize");
+        if (!error.empty()) {
+            run("ROLLBACK TO xsql_materialize");
+            run("RELEASE xsql_materialize");
+            stats.rows = 0;
+            return finish("materialize " + target + ": " + error);
+        }
+        schema_changed();
+        stats.rebuilt = true;
+        return finish("");
+    }
+
+    // One prepared statement; `fetch` returns nullptr when there are no more rows
+    BulkInsertStats insert_batches(const std::string& table, const std::vector<std::string>& columns,
+                                   const std::function<const std::vector<Value>*()>& fetch,
+                                   const BulkInsertOptions& options) {
+        BulkInsertStats stats;
+        auto start = std::chrono::steady_clock::now();
+        auto finish = [&](std::string error) {
+            stats.elapsed_s =
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            stats.error = std::move(error);
+            last_error_ = stats.error;
+            return stats;
+        };
+        if (!db_) return finish("Database not open");
+        if (columns.empty()) return finish("bulk_insert: no columns");
+
+        std::string conflict = options.on_conflict;
+        for (char& c : conflict) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        if (!conflict.empty() && conflict != "ROLLBACK" && conflict != "ABORT" && conflict != "FAIL" &&
+            conflict != "IGNORE" && conflict != "REPLACE") {
+            return finish("bulk_insert: invalid on_conflict '" + options.on_conflict + "'");
+        }
+
+        std::string sql = "INSERT ";
+        if (!conflict.empty()) sql += "OR " + conflict + " ";
+        sql += "INTO " + quote_qualified(table) + " (";
+        for (size_t i = 0; i < columns.size(); ++i) {
+            if (i > 0) sql += ", ";
+            sql += quote_identifier(columns[i]);
+        }
+        sql += ") VALUES (";
+        for (size_t i = 0; i < columns.size(); ++i) sql += i > 0 ? ", ?" : "?";
+        sql += ")";
+
+        sqlite3_stmt* stmt = nullptr;
+        int rc = sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr);
+        if (rc != SQLITE_OK) return finish(sqlite_error_message(db_, rc));
+
+        const bool own_transaction = sqlite3_get_autocommit(db_) != 0;
+        const size_t batch_rows = std::max<size_t>(options.batch_rows, 1);
+        size_t in_batch = 0;
+        bool batch_open = false;
+        std::string error;
+
+        // Commit (or roll back) the open batch; only committed rows are counted
+        auto end_batch = [&](bool commit) {
+            bool ok = true;
+            if (own_transaction && batch_open) {
+                int end_rc = sqlite3_exec(db_, commit ? "COMMIT" : "ROLLBACK", nullptr, nullptr, nullptr);
+                if (commit && end_rc != SQLITE_OK) {
+                    error = sqlite_error_message(db_, end_rc);
+                    sqlite3_exec(db_, "ROLLBACK", nullptr, nullptr, nullptr);
+                    ok = false;
+                }
+            }
+            if (commit && ok && in_batch > 0) {
+                stats.rows += in_batch;
+                stats.batches++;
+            }
+            batch_open = false;
+            in_batch = 0;
+            return ok;
+        };
+
+        while (true) {
+            const std::vector<Value>* row = fetch();
+            if (!row) break;
+            if (row->size() != columns.size()) {
+                error = "bulk_insert: row has " + std::to_string(row->size()) + " values, expected " +
+                        std::to_string(columns.size());
+                break;
+            }
+            if (!batch_open && own_transaction) {
+                rc = sqlite3_exec(db_, "BEGIN IMMEDIATE", nullptr, nullptr, nullptr);
+                if (rc != SQLITE_OK) {
+                    error = sqlite_error_message(db_, rc);
+                    break;
+                }
+            }
+            batch_open = true;
+            rc = bind_values(stmt, *row);
+            if (rc == SQLITE_OK) rc = sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+            if (rc != SQLITE_OK && rc != SQLITE_DONE) {
+                error = sqlite_error_message(db_, rc);
+                break;
+            }
+            in_batch++;
+            if (in_batch >= batch_rows && !end_batch(true)) break;
+        }
+        // Rows already inserted into the caller's transaction stay there
+        end_batch(error.empty() || !own_transaction);
+        sqlite3_finalize(stmt);
+        return finish(std::move(error));
+    }
+
+    static std::string quote_identifier(const std::string& name) {
+        std::string quoted = "\"";
+        for (char c : name) {
+            if (c == '"') quoted += '"';
+            quoted += c;
+        }
+        return quoted + "\"";
+    }
+
+    // "schema.table" -> "schema"."table"; a bare name is quoted whole
+    static std::string quote_qualified(const std::string& name) {
+        size_t dot = name.find('.');
+        if (dot == std::string::npos) return quote_identifier(name);
+        return quote_identifier(name.substr(0, dot)) + "." + quote_identifier(name.substr(dot + 1));
+    }
+
+    bool index_exists(const std::string& schema, const std::string& name) {
+        std::string sql = "SELECT 1 FROM " + quote_identifier(schema) +
+                          ".sqlite_master WHERE type = 'index' AND name = ?1 COLLATE NOCASE";
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db_, sql.c_str(), -1, &stmt, nullptr) != SQLITE_OK) return false;
+        sqlite3_bind_text(stmt, 1, name.c_str(), -1, SQLITE_TRANSIENT);
+        bool found = sqlite3_step(stmt) == SQLITE_ROW;
+        sqlite3_finalize(stmt);
+        return found;
+    }
+
+    static std::string lower(std::string s) {
+        std::transform(s.begin(), s.end(), s.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return s;
+    }
+
+    void track_module(const char* module_name, GenerationFn fn, std::function<size_t()> estimate_rows) {
+        module_generations_[lower(module_name)] = std::move(fn);
+        module_row_estimates_[lower(module_name)] = std::move(estimate_rows);
+        schema_changed();
+    }
+
+    // Module named by a CREATE VIRTUAL TABLE statement; "" for anything
+    // else. False if the statement is virtual but names no module.
+    static bool virtual_table_module(const std::string& create_sql, std::string& module) {
+        module.clear();
+        std::string create = lower(create_sql);
+        if (create.rfind("create virtual table", 0) != 0) return true;
+        size_t pos = create.find(" using ");
+        if (pos == std::string::npos) return false;
+        pos += 7;
+        while (pos < create.size() && create[pos] == ' ') ++pos;
+        size_t end = pos;
+        while (end < create.size() && create[end] != '(' && create[end] != ' ' && create[end] != ';') {
+            ++end;
+        }
+        module = create.substr(pos, end - pos);
+        return !module.empty();
+    }
+
+    // Any DDL or write we cannot see precisely: native tables move forward
+    // and the table -> module map must be re-resolved
+    void schema_changed() {
+        native_epoch_++;
+        table_modules_.clear();
+    }
+
+    uint64_t native_generation() const {
+        uint64_t gen = native_epoch_ + static_cast<uint64_t>(sqlite3_total_changes64(db_));
+        // Changes committed by other connections to the same file
+        unsigned int data_version = 0;
+        if (sqlite3_file_control(db_, "main", SQLITE_FCNTL_DATA_VERSION, &data_version) == SQLITE_OK) {
+            gen += static_cast<uint64_t>(data_version) << 32;
+        }
+        return gen;
+    }
+
+    // Resolve which module (if any) backs a table, via the schema table
+    bool resolve_table_module(const std::string& schema, const std::string& table, std::string& module) {
+        std::string key = schema + "." + table;
+        auto it = table_modules_.find(key);
+        if (it != table_modules_.end()) {
+            module = it->second;
+            return true;
+        }
+
+        const char* sql = (schema == "temp")
+            ? "SELECT sql FROM sqlite_temp_schema WHERE type = 'table' AND name = ?1 COLLATE NOCASE"
+            : "SELECT sql FROM main.sqlite_schema WHERE type = 'table' AND name = ?1 COLLATE NOCASE";
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) != SQLITE_OK) return false;
+        sqlite3_bind_text(stmt, 1, table.c_str(), -1, SQLITE_TRANSIENT);
+
+        module.clear();
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+            if (!virtual_table_module(text ? text : "", module)) {
+                sqlite3_finalize(stmt);
+                return false;
+            }
+        }
+        sqlite3_finalize(stmt);
+
+        table_modules_[key] = module;
+        return true;
+    }
+
+    // Current generation of "schema.table"; false if it has none
+    bool table_generation(const std::string& qualified, uint64_t& gen) {
+        size_t dot = qualified.find('.');
+        if (dot == std::string::npos) return false;
+        std::string schema = qualified.substr(0, dot);
+        std::string table = qualified.substr(dot + 1);
+        if (schema != "main" && schema != "temp") return false;
+
+        std::string module;
+        if (!resolve_table_module(schema, table, module)) return false;
+        if (module.empty()) {
+            gen = native_generation();
+            return true;
+        }
+        auto it = module_generations_.find(module);
+        if (it == module_generations_.end() || !it->second) return false;
+        return it->second(gen);
+    }
+
+    void forget_functions() {
+        nondeterministic_functions_.clear();
+        functions_loaded_ = false;
+    }
+
+    // The authorizer may not run statements itself, so the application
+    // functions lacking SQLITE_DETERMINISTIC are listed before preparing.
+    // Built-ins use is_volatile_function(): aggregates and window functions
+    // are not flagged deterministic either.
+    QueryDependencies new_dependencies() {
+        if (!functions_loaded_ && db_) {
+            functions_loaded_ = true;
+            const char* sql = "SELECT DISTINCT lower(name) FROM pragma_function_list "
+                              "WHERE builtin = 0 AND (flags & ?1) = 0";
+            sqlite3_stmt* stmt = nullptr;
+            if (sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr) == SQLITE_OK) {
+                sqlite3_bind_int(stmt, 1, SQLITE_DETERMINISTIC);
+                while (sqlite3_step(stmt) == SQLITE_ROW) {
+                    const char* name = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+                    if (name) nondeterministic_functions_.insert(name);
+                }
+            }
+            sqlite3_finalize(stmt);
+        }
+        QueryDependencies deps;
+        deps.nondeterministic = &nondeterministic_functions_;
+        return deps;
+    }
+
+    static bool is_volatile_function(const char* name) {
+        static const char* const volatile_fns[] = {
+            "random", "randomblob", "changes", "total_changes", "last_insert_rowid",
+            "date", "time", "datetime", "julianday", "unixepoch", "strftime", "timediff",
+            "current_date", "current_time", "current_timestamp", "sqlite_offset",
+            "load_extension",
+        };
+        for (const char* fn : volatile_fns) {
+            if (sqlite3_stricmp(name, fn) == 0) return true;
+        }
+        return false;
+    }
+
+    // Authorizer used while preparing: records tables read and volatile calls
+    static int collect_dependencies(void* user, int action, const char* arg1, const char* arg2,
+                                    const char* db_name, const char*) {
+        auto* deps = static_cast<QueryDependencies*>(user);
+        if (action == SQLITE_READ && arg1) {
+            std::string key = lower(std::string(db_name ? db_name : "main") + "." + arg1);
+            bool seen = false;
+            for (const auto& t : deps->tables) {
+                if (t.table == key) { seen = true; break; }
+            }
+            if (!seen) deps->tables.push_back({key, 0});
+        } else if (action == SQLITE_FUNCTION && arg2 &&
+                   (is_volatile_function(arg2) ||
+                    (deps->nondeterministic && deps->nondeterministic->count(lower(arg2)) > 0))) {
+            deps->cacheable = false;
+        } else if (action == SQLITE_PRAGMA) {
+            deps->cacheable = false;
+        }
+        return SQLITE_OK;
+    }
+
+    static size_t result_bytes(const Result& result) {
+        size_t bytes = sizeof(Result);
+        for (const auto& c : result.columns) bytes += sizeof(std::string) + c.size();
+        for (const auto& row : result.rows) {
+            for (const auto& v : row.values) bytes += sizeof(std::string) + v.size();
+        }
+        return bytes;
+    }
+
+    static size_t text_bytes(const Result& result) {
+        size_t bytes = result_limit_bytes(result.columns);
+        for (const auto& row : result.rows) bytes += result_limit_bytes(row.values);
+        return bytes;
+    }
+
+    static std::string bytes_limit_error(const QueryLimits& limits) {
+        return "result too large: exceeds max_result_bytes (" + std::to_string(limits.max_result_bytes) + ")";
+    }
+
+    static std::string rows_limit_error(const QueryLimits& limits) {
+        return "result too large: exceeds max_result_rows (" + std::to_string(limits.max_result_rows) + ")";
+    }
+
+    Result execute_query(const char* sql, const std::vector<Value>& params, QueryDependencies* deps,
+                         const QueryLimits& limits) {
+        Result result;
+
+        sqlite3_stmt* stmt = nullptr;
+        if (deps) sqlite3_set_authorizer(db_, collect_dependencies, deps);
+        int rc = sqlite3_prepare_v2(db_, sql, -1, &stmt, nullptr);
+        if (deps) sqlite3_set_authorizer(db_, nullptr, nullptr);
+        if (rc != SQLITE_OK) {
+            result.error = sqlite_error_message(db_, rc);
+            return result;
+        }
+
+        if (!params.empty()) {
+            rc = bind_values(stmt, params);
+            if (rc != SQLITE_OK) {
+                result.error = sqlite3_errmsg(db_);
+                sqlite3_finalize(stmt);
+                return result;
+            }
+        }
+
+        bool read_only = sqlite3_stmt_readonly(stmt) != 0;
+        if (deps) {
+            // Snapshot generations before reading so concurrent changes make the entry stale
+            deps->cacheable = deps->cacheable && read_only && stmt != nullptr;
+            for (auto& t : deps->tables) {
+                if (!deps->cacheable) break;
+                if (!table_generation(t.table, t.generation)) deps->cacheable = false;
+            }
+        }
+
+        // Get column names
+        int col_count = sqlite3_column_count(stmt);
+        result.columns.reserve(col_count);
+        for (int i = 0; i < col_count; ++i) {
+            const char* name = sqlite3_column_name(stmt, i);
+            result.columns.push_back(name ? name : "");
+        }
+
+        // Fetch rows, counting bytes the same way text_bytes() does
+        size_t bytes = result_limit_bytes(result.columns);
+        while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+            if (limits.max_result_rows > 0 && result.rows.size() >= limits.max_result_rows) {
+                result.error = rows_limit_error(limits);
+                break;
+            }
+            Row row;
+            row.values.reserve(col_count);
+            for (int i = 0; i < col_count; ++i) {
+                const char* text = reinterpret_cast<const char*>(
+                    sqlite3_column_text(stmt, i));
+                row.values.push_back(text ? text : "");
+            }
+            bytes += result_limit_bytes(row.values);
+            if (limits.max_result_bytes > 0 && bytes > limits.max_result_bytes) {
+                result.error = bytes_limit_error(limits);
+                break;
+            }
+            result.rows.push_back(std::move(row));
+        }
+
+        if (!result.error.empty()) {
+            result.rows.clear();
+            result.rows.shrink_to_fit();
+        } else if (rc != SQLITE_DONE) {
+            result.error = sqlite_error_message(db_, rc);
+        }
+
+        sqlite3_finalize(stmt);
+        if (!read_only) schema_changed();
+        return result;
+    }
 };
 
 } // namespace xsql
@@ -0,0 +1,668 @@
+/**
+ * xsql/jsonl_table.hpp - Memory-mapped JSON Lines files as generator tables
+ *
+ * Part of libxsql - a generic SQLite virtual table framework.
+ *
+ * jsonl_table() exposes a file with one JSON document per line as a
+ * read-only table whose columns are paths into each document:
+ *
+ *   - The file is mapped once; lines are found 16 bytes at a time (SSE2
+ *     where available, a scalar loop elsewhere). Blank lines are skipped.
+ *   - No DOM is built. Each line is parsed with xsql::json's SAX interface,
+ *     only when a query first reads one of its columns, and only for the
+ *     columns the query references (SQLite's colUsed). Parsing stops as
+ *     soon as every requested path has been seen.
+ *   - The start offset of every line is recorded as scans pass and shared
+ *     by every table on the same JsonlFile, so OFFSET and `rowid > ?`
+ *     pages seek directly on repeat queries. The rowid is the 0-based line
+ *     number.
+ *
+ * Paths are dotted keys with optional array indices and an optional "$."
+ * prefix: "id", "$.user.name", "tags[0]", "$" (the whole line). Scalars
+ * map to SQLite values (true/false as 1/0); objects and arrays are
+ * returned as JSON text; missing paths read as NULL. A line with a syntax
+ * error reads as NULL in every column, even where a value was parsed before
+ * the error. Parsing stops at the last requested value, so an error after
+ * it goes unnoticed.
+ *
+ * Example:
+ *
+ *   auto def = xsql::jsonl_table("events", "events.jsonl", {
+ *       {"id", "$.id", xsql::ColumnType::Integer},
+ *       {"user", "$.user.name"},
+ *       {"first_tag", "$.tags[0]"},
+ *   });
+ *   db.register_and_create_generator_table(def);
+ *   db.query("SELECT user, COUNT(*) FROM events GROUP BY user");
+ *
+ * The file must not be modified while it is open. On Windows the file is
+ * read into memory instead of mapped.
+ */
+
+#pragma once
+
+#include "vtable.hpp"
+#include "json.hpp"
+#include "mapped_file.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace xsql {
+
+/**
+ * One table column: SQL name, path into each line's document, and the
+ * declared SQL type (values keep their JSON type).
+ */
+struct JsonlColumn {
+    std::string name;
+    std::string path;
+    ColumnType type = ColumnType::Text;
+};
+
+namespace detail {
+
+struct JsonlStep {
+    bool is_index = false;
+    std::string key;
+    size_t index = 0;
+};
+
+// "$.a.b[2]" -> a, b, [2]; "$" and "" -> no steps (the whole document)
+inline std::vector<JsonlStep> jsonl_parse_path(const std::string& path) {
+    std::vector<JsonlStep> steps;
+    size_t i = 0;
+    if (!path.empty() && path[0] == '$') i = 1;
+    while (i < path.size()) {
+        JsonlStep step;
+        if (path[i] == '[') {
+            size_t close = path.find(']', i);
+            if (close == std::string::npos) close = path.size();
+            std::string inner = path.substr(i + 1, close - i - 1);
+            bool digits = !inner.empty() && std::all_of(inner.begin(), inner.end(),
+                [](char c) { return c >= '0' && c <= '9'; });
+            if (digits) {
+                step.is_index = true;
+                step.index = static_cast<size_t>(std::stoull(inner));
+            } else {
+                if (inner.size() >= 2 && (inner.front() == '"' || inner.front() == '\'') && inner.back() == inner.front()) {
+                    inner = inner.substr(1, inner.size() - 2);
+                }
+                step.key = inner;
+            }
+            i = close + 1;
+        } else {
+            if (path[i] == '.') ++i;
+            size_t stop = path.find_first_of(".[", i);
+            if (stop == std::string::npos) stop = path.size();
+            step.key = path.substr(i, stop - i);
+            i = stop;
+        }
+        steps.push_back(std::move(step));
+    }
+    return steps;
+}
+
+struct JsonlValue {
+    enum Kind { Null, Integer, Real, Text };
+    Kind kind = Null;
+    int64_t i = 0;
+    double d = 0;
+    std::string s;
+};
+
+/**
+ * The requested paths of one scan as a trie. Node 0 is the document root;
+ * nodes with columns are targets.
+ */
+struct JsonlPlan {
+    struct Node {
+        std::vector<std::pair<std::string, int>> keys;
+        std::vector<std::pair<size_t, int>> indices;
+        std::vector<size_t> columns;
+    };
+    std::vector<Node> nodes;
+    size_t column_count = 0;
+    size_t targets = 0;
+
+    JsonlPlan(const std::vector<std::vector<JsonlStep>>& paths, const GeneratorScan& scan)
+        : nodes(1), column_count(paths.size()) {
+        for (size_t c = 0; c < paths.size(); ++c) {
+            if (!scan.uses_column(c)) continue;
+            int node = 0;
+            for (const auto& step : paths[c]) node = step.is_index ? child(node, step.index) : child(node, step.key);
+            if (nodes[node].columns.empty()) ++targets;
+            nodes[node].columns.push_back(c);
+        }
+    }
+
+    int find(int node, const std::string& key) const {
+        for (const auto& k : nodes[node].keys) {
+            if (k.first == key) return k.second;
+        }
+        return -1;
+    }
+
+    int find(int node, size_t index) const {
+        for (const auto& k : nodes[node].indices) {
+            if (k.first == index) return k.second;
+        }
+        return -1;
+    }
+
+private:
+    int add() {
+        nodes.emplace_back();
+        return static_cast<int>(nodes.size() - 1);
+    }
+
+    int child(int node, const std::string& key) {
+        int found = find(node, key);
+        if (found >= 0) return found;
+        int created = add();
+        nodes[node].keys.emplace_back(key, created);
+        return created;
+    }
+
+    int child(int node, size_t index) {
+        int found = find(node, index);
+        if (found >= 0) return found;
+        int created = add();
+        nodes[node].indices.emplace_back(index, created);
+        return created;
+    }
+};
+
+/**
+ * SAX handler filling one row's values. Tracks the trie node of every open
+ * container; containers that are targets are rebuilt (only they) and
+ * dumped as JSON text when they close. Returns false to stop the parser
+ * once every target has a value; failed() tells a syntax error apart.
+ */
+class JsonlExtractor : public nlohmann::json_sax<json> {
+public:
+    JsonlExtractor(const JsonlPlan& plan, std::vector<JsonlValue>& values)
+        : plan_(plan), values_(values), found_(plan.nodes.size(), false) {}
+
+    bool null() override {
+        JsonlValue v;
+        return scalar(json(nullptr), v);
+    }
+
+    bool boolean(bool val) override {
+        JsonlValue v;
+        v.kind = JsonlValue::Integer;
+        v.i = val ? 1 : 0;
+        return scalar(json(val), v);
+    }
+
+    bool number_integer(number_integer_t val) override {
+        JsonlValue v;
+        v.kind = JsonlValue::Integer;
+        v.i = val;
+        return scalar(json(val), v);
+    }
+
+    bool number_unsigned(number_unsigned_t val) override {
+        JsonlValue v;
+        if (val <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+            v.kind = JsonlValue::Integer;
+            v.i = static_cast<int64_t>(val);
+        } else {
+            v.kind = JsonlValue::Real;
+            v.d = static_cast<double>(val);
+        }
+        return scalar(json(val), v);
+    }
+
+    bool number_float(number_float_t val, const string_t&) override {
+        JsonlValue v;
+        v.kind = JsonlValue::Real;
+        v.d = val;
+        return scalar(json(val), v);
+    }
+
+    bool string(string_t& val) override {
+        JsonlValue v;
+        v.kind = JsonlValue::Text;
+        if (!captures_.empty()) {
+            v.s = val;
+            return scalar(json(std::move(val)), v);
+        }
+        v.s = std::move(val);
+        return scalar(json(), v);
+    }
+
+    bool binary(binary_t&) override { return false; }
+
+    bool start_object(std::size_t) override { return open(json::object(), false); }
+    bool start_array(std::size_t) override { return open(json::array(), true); }
+    bool end_object() override { return close(); }
+    bool end_array() override { return close(); }
+
+    bool key(string_t& val) override {
+        Frame& f = frames_.back();
+        f.value_node = f.node < 0 ? -1 : plan_.find(f.node, val);
+        for (auto& c : captures_) c->key = val;
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) override {
+        failed_ = true;
+        return false;
+    }
+
+    bool failed() const { return failed_; }
+
+private:
+    struct Frame {
+        int node;
+        bool is_array;
+        size_t index = 0;
+        int value_node = -1;
+    };
+
+    struct Capture {
+        int node;
+        json root;
+        std::vector<json*> stack;
+        std::string key;
+    };
+
+    // Trie node of the value that is starting (-1 if no path goes there)
+    int enter() {
+        if (frames_.empty()) return 0;
+        Frame& f = frames_.back();
+        if (f.node < 0) return -1;
+        if (f.is_array) return plan_.find(f.node, f.index++);
+        return f.value_node;
+    }
+
+    bool wanted(int node) const {
+        return node >= 0 && !plan_.nodes[node].columns.empty() && !found_[node];
+    }
+
+    // Add `v` to every open capture, descending into it if it is a container
+    void capture_add(json v, bool container) {
+        for (auto& c : captures_) {
+            json* parent = c->stack.back();
+            json* slot;
+            if (parent->is_array()) {
+                parent->push_back(v);
+                slot = &parent->back();
+            } else {
+                slot = &(*parent)[c->key];
+                *slot = v;
+            }
+            if (container) c->stack.push_back(slot);
+        }
+    }
+
+    void assign(int node, const JsonlValue& v) {
+        found_[node] = true;
+        for (size_t col : plan_.nodes[node].columns) values_[col] = v;
+        ++done_;
+    }
+
+    bool more() const { return done_ < plan_.targets || !captures_.empty(); }
+
+    bool scalar(json j, JsonlValue& v) {
+        int node = enter();
+        if (!captures_.empty()) capture_add(std::move(j), false);
+        if (wanted(node)) assign(node, v);
+        return more();
+    }
+
+    bool open(json container, bool is_array) {
+        int node = enter();
+        if (!captures_.empty()) capture_add(container, true);
+        if (wanted(node)) {
+            auto c = std::make_unique<Capture>();
+            c->node = node;
+            c->root = std::move(container);
+            c->stack.push_back(&c->root);
+            captures_.push_back(std::move(c));
+        }
+        frames_.push_back(Frame{node, is_array});
+        return true;
+    }
+
+    bool close() {
+        frames_.pop_back();
+        for (size_t i = 0; i < captures_.size();) {
+            auto& c = *captures_[i];
+            c.stack.pop_back();
+            if (!c.stack.empty()) {
+                ++i;
+                continue;
+            }
+            JsonlValue v;
+            v.kind = JsonlValue::Text;
+            v.s = c.root.dump();
+            assign(c.node, v);
+            captures_.erase(captures_.begin() + static_cast<std::ptrdiff_t>(i));
+        }
+        return more();
+    }
+
+    const JsonlPlan& plan_;
+    std::vector<JsonlValue>& values_;
+    std::vector<bool> found_;
+    std::vector<Frame> frames_;
+    std::vector<std::unique_ptr<Capture>> captures_;  // Open target containers, outermost first
+    size_t done_ = 0;
+    bool failed_ = false;
+};
+
+inline bool jsonl_blank(const char* b, const char* e) {
+    for (; b < e; ++b) {
+        if (*b != ' ' && *b != '\t' && *b != '\r') return false;
+    }
+    return true;
+}
+
+} // namespace detail
+
+// ============================================================================
+// Mapped File and Line Index
+// ============================================================================
+
+class JsonlFile {
+public:
+    /**
+     * Map `path`. Returns nullptr and sets `error` if the file cannot be
+     * read.
+     */
+    static std::shared_ptr<JsonlFile> open(const std::string& path, std::string& error) {
+        std::shared_ptr<JsonlFile> file(new JsonlFile());
+        if (!file->file_.open(path, error)) return nullptr;
+        file->data_ = file->file_.data();
+        file->size_ = file->file_.size();
+        file->sample();
+        return file;
+    }
+
+    JsonlFile(const JsonlFile&) = delete;
+    JsonlFile& operator=(const JsonlFile&) = delete;
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    /**
+     * The first non-blank line at or after `offset`, without its line
+     * ending; advances `offset` past it. False at end of file.
+     */
+    bool read_line(size_t& offset, const char*& begin, const char*& end) const {
+        const char* limit = data_ + size_;
+        while (offset < size_) {
+            const char* b = data_ + offset;
+            const char* nl = detail::find_either(b, limit, '\n', '\n');
+            offset = nl == limit ? size_ : static_cast<size_t>(nl - data_) + 1;
+            if (!detail::jsonl_blank(b, nl)) {
+                begin = b;
+                end = nl;
+                if (end > begin && end[-1] == '\r') --end;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Byte offset of line `line` (0-based, blank lines not counted); false
+    // past the last line. Indexes up to `line` the first time.
+    bool seek_line(uint64_t line, size_t& offset) {
+        std::lock_guard<std::mutex> lock(mu_);
+        extend(line + 1);
+        if (line >= lines_.size()) return false;
+        offset = lines_[static_cast<size_t>(line)];
+        return true;
+    }
+
+    // Number of lines; indexes the whole file the first time
+    uint64_t line_count() {
+        std::lock_guard<std::mutex> lock(mu_);
+        extend(std::numeric_limits<uint64_t>::max());
+        return lines_.size();
+    }
+
+    // Exact once the file has been indexed to the end, sampled before that
+    size_t estimated_rows() {
+        std::lock_guard<std::mutex> lock(mu_);
+        return complete_ ? lines_.size() : estimate_;
+    }
+
+    /**
+     * A scan read lines [first, first + offsets.size()) at `offsets`:
+     * append the ones not yet indexed. `at_end` means the scan then ran
+     * off the end of the file.
+     */
+    void record(uint64_t first, const std::vector<size_t>& offsets, bool at_end) {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (complete_ || first > lines_.size()) return;
+        size_t skip = static_cast<size_t>(lines_.size() - first);
+        if (skip < offsets.size()) lines_.insert(lines_.end(), offsets.begin() + static_cast<std::ptrdiff_t>(skip), offsets.end());
+        if (at_end && lines_.size() == first + offsets.size()) complete_ = true;
+    }
+
+    size_t indexed_lines() {
+        std::lock_guard<std::mutex> lock(mu_);
+        return lines_.size();
+    }
+
+private:
+    JsonlFile() = default;
+
+    // Index until `count` lines are known or the file ends; mu_ held
+    void extend(uint64_t count) {
+        if (complete_) return;
+        size_t offset = 0;
+        const char* b;
+        const char* e;
+        if (!lines_.empty()) {
+            offset = lines_.back();
+            read_line(offset, b, e);
+        }
+        while (lines_.size() < count) {
+            if (!read_line(offset, b, e)) {
+                complete_ = true;
+                return;
+            }
+            lines_.push_back(static_cast<size_t>(b - data_));
+        }
+    }
+
+    // Row estimate from the length of the first lines
+    void sample() {
+        size_t offset = 0;
+        size_t sampled = 0;
+        const char* b;
+        const char* e;
+        while (sampled < 64 && read_line(offset, b, e)) ++sampled;
+        if (offset >= size_) {
+            estimate_ = sampled;
+        } else {
+            estimate_ = size_ / std::max<size_t>(1, offset / sampled);
+        }
+    }
+
+    detail::MappedFile file_;
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+
+    std::mutex mu_;
+    std::vector<size_t> lines_;  // lines_[k] = offset of line k
+    bool complete_ = false;      // lines_ covers the whole file
+    size_t estimate_ = 0;
+};
+
+// ============================================================================
+// Rows and Generator
+// ============================================================================
+
+/**
+ * One line of a JsonlFile, as seen by column getters. The line is parsed
+ * the first time a getter asks for a value.
+ */
+struct JsonlRow {
+    const char* begin = nullptr;  // Line bytes without the line ending
+    const char* end = nullptr;
+    int64_t line = 0;
+    const detail::JsonlPlan* plan = nullptr;
+
+    mutable std::vector<detail::JsonlValue> values;
+    mutable bool extracted = false;
+
+    void reset(const char* b, const char* e, int64_t l, const detail::JsonlPlan* p) {
+        begin = b;
+        end = e;
+        line = l;
+        plan = p;
+        extracted = false;
+    }
+
+    const detail::JsonlValue& value(size_t col) const {
+        if (!extracted) extract();
+        return values[col];
+    }
+
+private:
+    void extract() const {
+        extracted = true;
+        values.assign(plan->column_count, detail::JsonlValue());
+        if (plan->targets == 0) return;
+        detail::JsonlExtractor handler(*plan, values);
+        json::sax_parse(begin, end, &handler, json::input_format_t::json, false);
+        // No half rows: drop whatever was read before the error
+        if (handler.failed()) values.assign(plan->column_count, detail::JsonlValue());
+    }
+};
+
+namespace detail {
+
+inline void jsonl_result(sqlite3_context* ctx, const JsonlRow& row, size_t col) {
+    const JsonlValue& v = row.value(col);
+    switch (v.kind) {
+        case JsonlValue::Integer: sqlite3_result_int64(ctx, v.i); break;
+        case JsonlValue::Real: sqlite3_result_double(ctx, v.d); break;
+        case JsonlValue::Text:
+            sqlite3_result_text(ctx, v.s.data(), static_cast<int>(v.s.size()), SQLITE_TRANSIENT);
+            break;
+        default: sqlite3_result_null(ctx); break;
+    }
+}
+
+} // namespace detail
+
+/**
+ * Streams lines of a JsonlFile from scan.offset, recording line offsets in
+ * batches for later seeks.
+ */
+class JsonlGenerator : public Generator<JsonlRow> {
+    static constexpr size_t kRecordBatch = 4096;
+
+    std::shared_ptr<JsonlFile> file_;
+    detail::JsonlPlan plan_;
+    uint64_t line_ = 0;
+    int64_t remaining_ = -1;
+    size_t offset_ = 0;
+    bool done_ = false;
+    JsonlRow current_;
+
+    uint64_t pending_first_ = 0;
+    std::vector<size_t> pending_;
+
+    void flush(bool at_end) {
+        if (!pending_.empty() || at_end) file_->record(pending_first_, pending_, at_end);
+        pending_first_ += pending_.size();
+        pending_.clear();
+    }
+
+public:
+    JsonlGenerator(std::shared_ptr<JsonlFile> file, const std::vector<std::vector<detail::JsonlStep>>& paths,
+                   const GeneratorScan& scan)
+        : file_(std::move(file)), plan_(paths, scan), remaining_(scan.limit) {
+        line_ = static_cast<uint64_t>(scan.offset);
+        pending_first_ = line_;
+        done_ = !file_->seek_line(line_, offset_);
+    }
+
+    ~JsonlGenerator() override { flush(false); }
+
+    bool next() override {
+        if (done_ || remaining_ == 0) return false;
+        const char* b;
+        const char* e;
+        if (!file_->read_line(offset_, b, e)) {
+            flush(true);
+            done_ = true;
+            return false;
+        }
+        pending_.push_back(static_cast<size_t>(b - file_->data()));
+        if (pending_.size() >= kRecordBatch) flush(false);
+
+        current_.reset(b, e, static_cast<int64_t>(line_), &plan_);
+        ++line_;
+        if (remaining_ > 0) --remaining_;
+        return true;
+    }
+
+    const JsonlRow& current() const override { return current_; }
+    sqlite3_int64 rowid() const override { return current_.line; }
+
+    // Rowids are line numbers: start at line `key` through the line index
+    bool seek(sqlite3_int64 key) override {
+        if (key > 0 && static_cast<uint64_t>(key) > line_) {
+            flush(false);
+            line_ = static_cast<uint64_t>(key);
+            pending_first_ = line_;
+            done_ = !file_->seek_line(line_, offset_);
+        }
+        return true;
+    }
+};
+
+// ============================================================================
+// Table Definitions
+// ============================================================================
+
+/**
+ * Table over an open JsonlFile, one column per entry of `columns`.
+ */
+inline GeneratorTableDef<JsonlRow> jsonl_table(const char* name, std::shared_ptr<JsonlFile> file,
+                                               const std::vector<JsonlColumn>& columns) {
+    auto builder = generator_table<JsonlRow>(name);
+    GeneratorTableDef<JsonlRow> def = builder.build();
+    if (!file) return def;
+
+    auto paths = std::make_shared<std::vector<std::vector<detail::JsonlStep>>>();
+    for (size_t i = 0; i < columns.size(); ++i) {
+        paths->push_back(detail::jsonl_parse_path(columns[i].path));
+        def.columns.emplace_back(columns[i].name.c_str(), columns[i].type, false,
+            [i](sqlite3_context* ctx, const JsonlRow& row) { detail::jsonl_result(ctx, row, i); });
+    }
+
+    def.seekable = true;
+    def.estimate_rows_fn = [file]() { return file->estimated_rows(); };
+    def.scan_factory_fn = [file, paths](const GeneratorScan& scan) -> std::unique_ptr<Generator<JsonlRow>> {
+        return std::make_unique<JsonlGenerator>(file, *paths, scan);
+    };
+    return def;
+}
+
+/**
+ * Open `path` and define a table over it. If the file cannot be opened the
+ * definition has no columns and creating the table fails; use
+ * JsonlFile::open() to get the reason.
+ */
+inline GeneratorTableDef<JsonlRow> jsonl_table(const char* name, const std::string& path,
+                                               const std::vector<JsonlColumn>& columns) {
+    std::string error;
+    return jsonl_table(name, JsonlFile::open(path, error), columns);
+}
+
+} // namespace xsql
@@ -0,0 +1,150 @@
+/**
+ * xsql/mapped_file.hpp - Read-only file mapping and byte scanning for file tables
+ *
+ * Part of libxsql - a generic SQLite virtual table framework.
+ *
+ * Shared by csv_table.hpp and jsonl_table.hpp:
+ *
+ *   - detail::MappedFile maps a whole file read-only (POSIX mmap; on Windows
+ *     the file is read into memory instead).
+ *   - detail::find_either() finds the first of two byte values, 16 bytes per
+ *     step with SSE2 where available and a scalar loop elsewhere.
+ */
+
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define XSQL_HAS_SSE2 1
+#endif
+
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
+#ifndef _WIN32
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+namespace xsql {
+namespace detail {
+
+inline unsigned lowest_bit(unsigned mask) {
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+// First byte in [p, end) equal to a or b, or end
+inline const char* find_either(const char* p, const char* end, char a, char b) {
+#ifdef XSQL_HAS_SSE2
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb)));
+        if (mask) return p + lowest_bit(static_cast<unsigned>(mask));
+        p += 16;
+    }
+#endif
+    for (; p < end; ++p) {
+        if (*p == a || *p == b) return p;
+    }
+    return end;
+}
+
+/**
+ * A whole file, mapped read-only. The file must not be modified or
+ * truncated while it is mapped.
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { unmap(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path, std::string& error) {
+        unmap();
+#ifdef _WIN32
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            error = "cannot open " + path;
+            return false;
+        }
+        std::ostringstream ss;
+        ss << in.rdbuf();
+        buffer_ = ss.str();
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+        return true;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            error = "cannot open " + path + ": " + std::strerror(errno);
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            error = "cannot stat " + path + ": " + std::strerror(errno);
+            ::close(fd);
+            return false;
+        }
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ > 0) {
+            void* base = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (base == MAP_FAILED) {
+                error = "cannot map " + path + ": " + std::strerror(errno);
+                size_ = 0;
+                ::close(fd);
+                return false;
+            }
+            madvise(base, size_, MADV_SEQUENTIAL);
+            data_ = static_cast<const char*>(base);
+            mapped_ = true;
+        }
+        ::close(fd);
+        return true;
+#endif
+    }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    void unmap() {
+#ifndef _WIN32
+        if (mapped_) munmap(const_cast<char*>(data_), size_);
+#else
+        buffer_.clear();
+#endif
+        data_ = nullptr;
+        size_ = 0;
+        mapped_ = false;
+    }
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+#ifdef _WIN32
+    std::string buffer_;
+#endif
+};
+
+} // namespace detail
+} // namespace xsql
@@ -0,0 +1,220 @@
+/**
+ * xsql/query_cache.hpp - Size-bounded LRU cache for query results
+ *
+ * Part of libxsql - a generic SQLite virtual table framework.
+ *
+ * Entries are keyed on the SQL text plus bound parameters and remember the
+ * data generation of every table the statement read when it was filled. A
+ * lookup only hits if all of those generations are unchanged, so a table
+ * bumping its generation invalidates exactly the results that depend on it.
+ *
+ * The cache itself knows nothing about SQLite; Database (database.hpp)
+ * computes keys and dependencies and decides what is cacheable.
+ *
+ * Example:
+ *
+ *   xsql::Database db;
+ *   db.enable_query_cache(16 * 1024 * 1024);
+ *   db.query("SELECT COUNT(*) FROM funcs");   // miss, executes
+ *   db.query("SELECT COUNT(*) FROM funcs;");  // hit
+ *   auto stats = db.query_cache_stats();
+ */
+
+#pragma once
+
+#include "value.hpp"
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <cctype>
+#include <cstdint>
+
+namespace xsql {
+
+// ============================================================================
+// Statistics
+// ============================================================================
+
+struct QueryCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t uncacheable = 0;   // Statements that could not be cached at all
+    uint64_t stale = 0;         // Lookups that found an entry with old generations
+    uint64_t evictions = 0;     // Entries dropped to stay under max_bytes
+    size_t entries = 0;
+    size_t bytes = 0;
+    size_t max_bytes = 0;
+
+    double hit_rate() const {
+        uint64_t lookups = hits + misses;
+        return lookups ? static_cast<double>(hits) / static_cast<double>(lookups) : 0.0;
+    }
+};
+
+// ============================================================================
+// Dependencies
+// ============================================================================
+
+/// A table read by a statement and its data generation at execution time
+struct TableGeneration {
+    std::string table;
+    uint64_t generation = 0;
+
+    bool operator==(const TableGeneration& other) const {
+        return generation == other.generation && table == other.table;
+    }
+};
+
+// ============================================================================
+// Key Normalization
+// ============================================================================
+
+/**
+ * Normalize SQL for cache keys: drop surrounding whitespace and trailing
+ * semicolons. The statement itself is kept verbatim, because result column
+ * names come from its text ("SELECT Name" and "select name" return
+ * differently named columns), so only identical spellings share a key.
+ */
+inline std::string normalize_sql(const std::string& sql) {
+    size_t begin = 0;
+    size_t end = sql.size();
+    while (begin < end && std::isspace(static_cast<unsigned char>(sql[begin]))) ++begin;
+    while (end > begin && (sql[end - 1] == ';' || std::isspace(static_cast<unsigned char>(sql[end - 1])))) --end;
+    return sql.substr(begin, end - begin);
+}
+
+/**
+ * Build a cache key from SQL and bound parameters.
+ */
+inline std::string make_query_cache_key(const std::string& sql, const std::vector<Value>& params) {
+    std::string key = normalize_sql(sql);
+    for (const auto& p : params) {
+        // Type tag + length prefix keeps distinct parameter lists distinct
+        key.push_back('\0');
+        key.push_back(static_cast<char>('0' + static_cast<int>(p.type)));
+        std::string v = p.to_string();
+        if (p.type == Value::Type::Real) {
+            // Full precision so nearby doubles do not share a key
+            char buf[32];
+            sqlite3_snprintf(sizeof(buf), buf, "%!.17g", p.d);
+            v = buf;
+        }
+        key += std::to_string(v.size());
+        key.push_back(':');
+        key += v;
+    }
+    return key;
+}
+
+// ============================================================================
+// LRU Cache
+// ============================================================================
+
+template<typename ResultT>
+class QueryCache {
+    struct Entry {
+        std::string key;
+        std::shared_ptr<const ResultT> result;
+        std::vector<TableGeneration> dependencies;
+        size_t bytes = 0;
+    };
+
+    using List = std::list<Entry>;
+
+    size_t max_bytes_;
+    size_t bytes_ = 0;
+    List lru_;  // Front = most recently used
+    std::unordered_map<std::string, typename List::iterator> index_;
+    QueryCacheStats stats_;
+    mutable std::mutex mutex_;
+
+public:
+    explicit QueryCache(size_t max_bytes) : max_bytes_(max_bytes) {}
+
+    /**
+     * Look up a result. `is_current` is called with the stored dependencies and
+     * must return true if they still match the live generations.
+     */
+    template<typename CurrentFn>
+    std::shared_ptr<const ResultT> lookup(const std::string& key, CurrentFn&& is_current) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            stats_.misses++;
+            return nullptr;
+        }
+        if (!is_current(it->second->dependencies)) {
+            stats_.misses++;
+            stats_.stale++;
+            erase_locked(it->second);
+            return nullptr;
+        }
+        lru_.splice(lru_.begin(), lru_, it->second);
+        stats_.hits++;
+        return it->second->result;
+    }
+
+    void insert(const std::string& key, std::shared_ptr<const ResultT> result,
+                std::vector<TableGeneration> dependencies, size_t result_bytes) {
+        size_t bytes = result_bytes + key.size() + sizeof(Entry);
+        for (const auto& d : dependencies) bytes += d.table.size() + sizeof(TableGeneration);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (bytes > max_bytes_) return;  // Would evict everything else
+
+        auto existing = index_.find(key);
+        if (existing != index_.end()) erase_locked(existing->second);
+
+        while (bytes_ + bytes > max_bytes_ && !lru_.empty()) {
+            erase_locked(std::prev(lru_.end()));
+            stats_.evictions++;
+        }
+
+        lru_.push_front(Entry{key, std::move(result), std::move(dependencies), bytes});
+        index_[key] = lru_.begin();
+        bytes_ += bytes;
+    }
+
+    void note_uncacheable() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.uncacheable++;
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        lru_.clear();
+        index_.clear();
+        bytes_ = 0;
+    }
+
+    void set_max_bytes(size_t max_bytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        max_bytes_ = max_bytes;
+        while (bytes_ > max_bytes_ && !lru_.empty()) {
+            erase_locked(std::prev(lru_.end()));
+            stats_.evictions++;
+        }
+    }
+
+    QueryCacheStats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        QueryCacheStats s = stats_;
+        s.entries = lru_.size();
+        s.bytes = bytes_;
+        s.max_bytes = max_bytes_;
+        return s;
+    }
+
+private:
+    void erase_locked(typename List::iterator it) {
+        bytes_ -= it->bytes;
+        index_.erase(it->key);
+        lru_.erase(it);
+    }
+};
+
+} // namespace xsql
@@ -0,0 +1,388 @@
+/**
+ * xsql/scheduler.hpp - Admission control and priority lanes for query servers
+ *
+ * Part of libxsql - a generic SQLite virtual table framework.
+ *
+ * Servers run each query under a QueryScheduler ticket. Queries are
+ * classified into an interactive or a background lane; each lane has its own
+ * slot count, a global cap bounds everything running at once, and when a
+ * slot frees up waiting interactive queries go first. Per-client limits keep
+ * one caller from filling the queue, and queries that wait too long are
+ * rejected instead of piling up.
+ *
+ * classify_query_cost() estimates cost from EXPLAIN QUERY PLAN so long
+ * exports land in the background lane without callers tagging them.
+ *
+ * Example:
+ *
+ *   xsql::SchedulerConfig config;
+ *   config.max_running = 4;
+ *   config.background_slots = 1;
+ *   xsql::QueryScheduler scheduler(config);
+ *
+ *   auto lane = xsql::classify_query_cost(db.handle(), sql);
+ *   auto ticket = scheduler.admit(lane, client_address);
+ *   if (!ticket) return reply_busy(ticket.error());
+ *   run(sql);   // slot released when ticket goes out of scope
+ */
+
+#pragma once
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace xsql {
+
+// ============================================================================
+// Configuration
+// ============================================================================
+
+enum class QueryLane { Interactive = 0, Background = 1 };
+
+inline const char* query_lane_name(QueryLane lane) {
+    return lane == QueryLane::Interactive ? "interactive" : "background";
+}
+
+struct SchedulerConfig {
+    size_t max_running = 1;         // Queries executing at once across lanes (1 = serialized)
+    size_t interactive_slots = 1;   // Cap for the interactive lane
+    size_t background_slots = 1;    // Cap for the background lane
+    size_t max_per_client = 0;      // Running + queued queries per client (0 = unlimited)
+    size_t max_queued = 256;        // Waiting queries across lanes before rejecting
+    int max_wait_ms = 30000;        // Reject queries queued longer than this (<= 0 = forever)
+};
+
+struct SchedulerStats {
+    uint64_t interactive_admitted = 0;
+    uint64_t background_admitted = 0;
+    uint64_t rejected = 0;
+    uint64_t timed_out = 0;
+    size_t interactive_running = 0;
+    size_t background_running = 0;
+    size_t queued = 0;
+};
+
+// ============================================================================
+// Query Scheduler
+// ============================================================================
+
+class QueryScheduler {
+public:
+    /**
+     * A running slot. Released on destruction; an empty ticket carries the
+     * reason admission was refused.
+     */
+    class Ticket {
+        QueryScheduler* owner_ = nullptr;
+        QueryLane lane_ = QueryLane::Interactive;
+        std::string client_;
+        std::string error_;
+
+        friend class QueryScheduler;
+        Ticket(QueryScheduler* owner, QueryLane lane, std::string client)
+            : owner_(owner), lane_(lane), client_(std::move(client)) {}
+
+    public:
+        Ticket() = default;
+        explicit Ticket(std::string error) : error_(std::move(error)) {}
+        ~Ticket() { release(); }
+
+        Ticket(Ticket&& other) noexcept
+            : owner_(other.owner_), lane_(other.lane_), client_(std::move(other.client_)),
+              error_(std::move(other.error_)) {
+            other.owner_ = nullptr;
+        }
+
+        Ticket& operator=(Ticket&& other) noexcept {
+            if (this != &other) {
+                release();
+                owner_ = other.owner_;
+                lane_ = other.lane_;
+                client_ = std::move(other.client_);
+                error_ = std::move(other.error_);
+                other.owner_ = nullptr;
+            }
+            return *this;
+        }
+
+        Ticket(const Ticket&) = delete;
+        Ticket& operator=(const Ticket&) = delete;
+
+        explicit operator bool() const { return owner_ != nullptr; }
+        QueryLane lane() const { return lane_; }
+        const std::string& error() const { return error_; }
+
+        void release() {
+            if (owner_) {
+                owner_->release(lane_, client_);
+                owner_ = nullptr;
+            }
+        }
+    };
+
+    explicit QueryScheduler(const SchedulerConfig& config = SchedulerConfig()) : config_(config) {}
+
+    QueryScheduler(const QueryScheduler&) = delete;
+    QueryScheduler& operator=(const QueryScheduler&) = delete;
+
+    /// Takes effect for admissions after the call
+    void set_config(const SchedulerConfig& config) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        config_ = config;
+        cv_.notify_all();
+    }
+
+    SchedulerConfig config() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return config_;
+    }
+
+    /**
+     * Wait for a slot in lane. client identifies the caller for
+     * max_per_client (e.g. its address); pass "" to skip that limit.
+     */
+    Ticket admit(QueryLane lane, const std::string& client = "") {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (closed_) return reject("server is shutting down");
+
+        size_t queued = queues_[0].size() + queues_[1].size();
+        if (queued >= config_.max_queued) return reject("server busy: too many queued queries");
+        if (!client.empty() && config_.max_per_client > 0 && per_client_[client] >= config_.max_per_client) {
+            return reject("too many concurrent queries from this client");
+        }
+
+        int idx = static_cast<int>(lane);
+        uint64_t id = next_waiter_++;
+        queues_[idx].push_back(id);
+        if (!client.empty()) per_client_[client]++;
+
+        auto ready = [&]() { return closed_ || can_run(lane, id); };
+        bool admitted;
+        if (config_.max_wait_ms > 0) {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(config_.max_wait_ms);
+            admitted = cv_.wait_until(lock, deadline, ready);
+        } else {
+            cv_.wait(lock, ready);
+            admitted = true;
+        }
+
+        auto& queue = queues_[idx];
+        queue.erase(std::find(queue.begin(), queue.end(), id));
+        if (!admitted || closed_) {
+            if (!client.empty()) drop_client(client);
+            cv_.notify_all();
+            if (!admitted) {
+                stats_.timed_out++;
+                return reject("query waited too long in the " + std::string(query_lane_name(lane)) + " lane");
+            }
+            return reject("server is shutting down");
+        }
+
+        running_[idx]++;
+        if (lane == QueryLane::Interactive) {
+            stats_.interactive_admitted++;
+        } else {
+            stats_.background_admitted++;
+        }
+        cv_.notify_all();  // The next waiter in this lane may fit too
+        return Ticket(this, lane, client);
+    }
+
+    /**
+     * Wait for an interactive slot without queue, per-client or wait limits,
+     * even after close(). For work that must not be refused but must not run
+     * beside a query either, such as finalizing a client's statements on a
+     * shared connection. Not counted in stats.
+     */
+    Ticket admit_cleanup() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        uint64_t id = next_waiter_++;
+        queues_[0].push_back(id);
+        cv_.wait(lock, [&]() { return can_run(QueryLane::Interactive, id); });
+        queues_[0].pop_front();
+        running_[0]++;
+        cv_.notify_all();
+        return Ticket(this, QueryLane::Interactive, "");
+    }
+
+    /// Refuse new admissions and wake all waiters (they are rejected)
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        cv_.notify_all();
+    }
+
+    void reopen() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = false;
+    }
+
+    SchedulerStats stats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        SchedulerStats out = stats_;
+        out.interactive_running = running_[0];
+        out.background_running = running_[1];
+        out.queued = queues_[0].size() + queues_[1].size();
+        return out;
+    }
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    SchedulerConfig config_;
+    bool closed_ = false;
+    size_t running_[2] = {0, 0};
+    std::deque<uint64_t> queues_[2];    // Waiter ids, FIFO per lane
+    uint64_t next_waiter_ = 1;
+    std::unordered_map<std::string, size_t> per_client_;
+    SchedulerStats stats_;
+
+    size_t lane_slots(QueryLane lane) const {
+        return lane == QueryLane::Interactive ? config_.interactive_slots : config_.background_slots;
+    }
+
+    bool lane_has_room(QueryLane lane) const {
+        return running_[static_cast<int>(lane)] < (std::max)(lane_slots(lane), size_t(1));
+    }
+
+    bool can_run(QueryLane lane, uint64_t id) const {
+        const auto& queue = queues_[static_cast<int>(lane)];
+        if (queue.empty() || queue.front() != id) return false;
+        if (running_[0] + running_[1] >= (std::max)(config_.max_running, size_t(1))) return false;
+        if (!lane_has_room(lane)) return false;
+        // Background yields to interactive waiters that could take the slot
+        if (lane == QueryLane::Background && !queues_[0].empty() && lane_has_room(QueryLane::Interactive)) {
+            return false;
+        }
+        return true;
+    }
+
+    void drop_client(const std::string& client) {
+        auto it = per_client_.find(client);
+        if (it != per_client_.end() && --it->second == 0) per_client_.erase(it);
+    }
+
+    Ticket reject(std::string error) {
+        stats_.rejected++;
+        return Ticket(std::move(error));
+    }
+
+    void release(QueryLane lane, const std::string& client) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_[static_cast<int>(lane)]--;
+        if (!client.empty()) drop_client(client);
+        cv_.notify_all();
+    }
+};
+
+// ============================================================================
+// Cost Classification
+// ============================================================================
+
+struct CostPolicy {
+    // Estimated rows touched at or above which a query is background work
+    double background_threshold = 100000.0;
+
+    // Rows assumed for a full scan when the table size is unknown
+    double default_scan_rows = 1000000.0;
+
+    // Rows assumed for an index/rowid lookup or a constrained vtable call
+    double search_rows = 10.0;
+
+    // Optional row count per table (e.g. Database::estimated_rows, which
+    // the socket and HTTP servers use by default); return < 0 when
+    // unknown. Consulted before sqlite_stat1.
+    std::function<double(const std::string& table)> table_rows;
+};
+
+namespace detail {
+
+// Row count from ANALYZE statistics, < 0 if none
+inline double stat1_rows(sqlite3* db, const std::string& table) {
+    sqlite3_stmt* stmt = nullptr;
+    const char* sql = "SELECT stat FROM main.sqlite_stat1 WHERE tbl = ?1 COLLATE NOCASE LIMIT 1";
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, nullptr) != SQLITE_OK) return -1.0;
+    sqlite3_bind_text(stmt, 1, table.c_str(), -1, SQLITE_TRANSIENT);
+    double rows = -1.0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* stat = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
+        if (stat) rows = std::strtod(stat, nullptr);
+    }
+    sqlite3_finalize(stmt);
+    return rows;
+}
+
+// Table name following "SCAN " / "SEARCH " (alias forms like "t AS x" keep the table)
+inline std::string plan_table(const std::string& detail, size_t start) {
+    size_t end = detail.find(' ', start);
+    return detail.substr(start, end == std::string::npos ? std::string::npos : end - start);
+}
+
+} // namespace detail
+
+/**
+ * Estimate the rows a statement touches from its query plan: each full scan
+ * contributes the table size, each lookup search_rows, and nested loops
+ * multiply. Virtual tables scanned with idxNum 0 count as full scans (no
+ * constraint was pushed into xBestIndex). Returns < 0 if sql does not prepare.
+ */
+inline double estimate_query_cost(sqlite3* db, const std::string& sql, const CostPolicy& policy = CostPolicy()) {
+    std::string eqp = "EXPLAIN QUERY PLAN " + sql;
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, eqp.c_str(), -1, &stmt, nullptr) != SQLITE_OK) return -1.0;
+
+    double cost = 1.0;
+    bool any = false;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+        std::string detail = text ? text : "";
+        double factor = 0.0;
+
+        if (detail.rfind("SEARCH ", 0) == 0) {
+            factor = policy.search_rows;
+        } else if (detail.rfind("SCAN CONSTANT ROW", 0) == 0) {
+            continue;
+        } else if (detail.rfind("SCAN ", 0) == 0) {
+            size_t vt = detail.find(" VIRTUAL TABLE INDEX ");
+            if (vt != std::string::npos && std::atoi(detail.c_str() + vt + 21) != 0) {
+                factor = policy.search_rows;
+            } else {
+                std::string table = detail::plan_table(detail, 5);
+                double rows = policy.table_rows ? policy.table_rows(table) : -1.0;
+                if (rows < 0) rows = detail::stat1_rows(db, table);
+                factor = rows < 0 ? policy.default_scan_rows : (std::max)(rows, 1.0);
+            }
+        } else if (detail.find("USE TEMP B-TREE") != std::string::npos) {
+            cost *= 2.0;  // Sorting or grouping the whole input
+            continue;
+        } else {
+            continue;
+        }
+        cost *= factor;
+        any = true;
+    }
+    sqlite3_finalize(stmt);
+    return any ? cost : 1.0;
+}
+
+/**
+ * Lane for sql under policy. Statements that fail to prepare are
+ * interactive: they fail fast.
+ */
+inline QueryLane classify_query_cost(sqlite3* db, const std::string& sql, const CostPolicy& policy = CostPolicy()) {
+    double cost = estimate_query_cost(db, sql, policy);
+    return cost >= policy.background_threshold ? QueryLane::Background : QueryLane::Interactive;
+}
+
+} // namespace xsql
@@ -0,0 +1,362 @@
+/**
+ * xsql/shm_cache.hpp - Cross-process shared memory segments for cached tables
+ *
+ * Part of libxsql - a generic SQLite virtual table framework.
+ *
+ * A cached table whose RowData is trivially copyable can publish its cache
+ * into a named POSIX shared memory segment. Other processes building the same
+ * table map the segment read-only instead of running cache_builder again, so
+ * N server processes share one physical copy of the rows.
+ *
+ * Segment layout:
+ *
+ *   [ShmSegmentHeader][padding to row alignment][RowData x row_count]
+ *
+ * The header is versioned (format_version), records sizeof/alignof(RowData),
+ * a caller-supplied layout_version and a source_key identifying the data the
+ * rows were built from, and is only trusted once its state field reads
+ * SHM_STATE_READY. A mismatch on any field makes the segment stale: readers
+ * ignore it and the next builder replaces it. Without a source_key, the
+ * rows of an earlier run are served as current after the source changes,
+ * so supply one unless the source never changes under a given name.
+ *
+ * Segments are not removed when processes exit: they stay in /dev/shm
+ * until invalidate_cache(), ShmSegment::unlink() or a reboot. Remove the
+ * names an application used when it is uninstalled or its data is reset.
+ *
+ * Rows are copied byte for byte, so RowData must not hold pointers, which
+ * mean nothing in another process. shared_memory() rejects aggregates with
+ * pointer fields at compile time (see shm_pointer_free_v); pointers hidden
+ * inside non-aggregate members cannot be detected.
+ *
+ * A publisher that dies mid-publish leaves a segment that never becomes
+ * ready. The header records the builder's PID; once that process is gone,
+ * or the segment has not become ready within SHM_BUILD_TIMEOUT_SECONDS, it
+ * counts as stale too, so sharing recovers without a manual shm_unlink.
+ *
+ * Example:
+ *
+ *   struct XrefRow { uint64_t from; uint64_t to; };
+ *
+ *   auto def = xsql::cached_table<XrefRow>("xrefs")
+ *       .cache_builder([](std::vector<XrefRow>& c) { ... })
+ *       .shared_memory("/myapp_xrefs", 1,   // bump 1 when XrefRow changes
+ *                      [&]() { return input_fingerprint(db_path); })
+ *       .column_int64("from_ea", [](const XrefRow& r) { return r.from; })
+ *       .build();
+ *
+ * Not available on Windows; there the option is ignored and each process
+ * builds a private cache as usual.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#ifndef _WIN32
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <signal.h>
+    #include <time.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <errno.h>
+#endif
+
+namespace xsql {
+
+// ============================================================================
+// Pointer-free RowData
+// ============================================================================
+
+namespace detail {
+
+// Converts to any field type that is not an aggregate, so brace
+// initialization flattens nested structs and arrays into their leaves
+struct ShmAnyField {
+    template <typename T, std::enable_if_t<!std::is_aggregate_v<T>, int> = 0>
+    operator T() const;
+};
+
+// Same, but refuses pointer and pointer-to-member leaves
+struct ShmPlainField {
+    template <typename T, std::enable_if_t<!std::is_aggregate_v<T> && !std::is_pointer_v<T> &&
+                                           !std::is_member_pointer_v<T>, int> = 0>
+    operator T() const;
+};
+
+template <typename T, typename Field, typename Seq, typename = void>
+struct shm_brace_init : std::false_type {};
+
+template <typename T, typename Field, size_t... I>
+struct shm_brace_init<T, Field, std::index_sequence<I...>, std::void_t<decltype(T{(void(I), Field{})...})>>
+    : std::true_type {};
+
+// Number of leaf fields of aggregate T, found by binary search (capped at Hi)
+template <typename T, size_t Lo, size_t Hi>
+constexpr size_t shm_leaf_count() {
+    if constexpr (Lo == Hi) {
+        return Lo;
+    } else {
+        constexpr size_t mid = (Lo + Hi + 1) / 2;
+        if constexpr (shm_brace_init<T, ShmAnyField, std::make_index_sequence<mid>>::value) {
+            return shm_leaf_count<T, mid, Hi>();
+        } else {
+            return shm_leaf_count<T, Lo, mid - 1>();
+        }
+    }
+}
+
+template <typename T>
+constexpr bool shm_pointer_free() {
+    if constexpr (std::is_pointer_v<T> || std::is_member_pointer_v<T>) {
+        return false;
+    } else if constexpr (std::is_aggregate_v<T> && !std::is_array_v<T>) {
+        constexpr size_t leaves = shm_leaf_count<T, 0, 1024>();
+        return shm_brace_init<T, ShmPlainField, std::make_index_sequence<leaves>>::value;
+    } else {
+        return true;  // Scalars; other classes are opaque
+    }
+}
+
+} // namespace detail
+
+/**
+ * False when T is a pointer or an aggregate with a pointer among its
+ * (flattened) fields. Members of non-aggregate class type, and fields past
+ * the first 1024 leaves, are not inspected.
+ */
+template <typename T>
+constexpr bool shm_pointer_free_v = detail::shm_pointer_free<T>();
+
+// ============================================================================
+// Segment Header
+// ============================================================================
+
+constexpr uint64_t SHM_MAGIC = 0x314D485351535821ull;  // "!XSQSHM1"
+constexpr uint32_t SHM_FORMAT_VERSION = 2;
+
+constexpr uint32_t SHM_STATE_BUILDING = 0;
+constexpr uint32_t SHM_STATE_READY = 1;
+
+// Publishing only copies rows that are already built, so a segment still
+// building after this long belongs to a publisher that will never finish
+constexpr int SHM_BUILD_TIMEOUT_SECONDS = 60;
+
+struct ShmSegmentHeader {
+    uint64_t magic;
+    uint32_t format_version;
+    uint32_t row_size;              // sizeof(RowData) of the writer
+    uint32_t row_align;             // alignof(RowData) of the writer
+    uint32_t builder_pid;           // Process publishing the segment
+    uint64_t layout_version;        // Caller-supplied RowData layout version
+    uint64_t source_key;            // Caller-supplied identity of the source data
+    uint64_t row_count;
+    uint64_t data_offset;           // Offset of the first row from segment start
+    std::atomic<uint32_t> state;    // SHM_STATE_BUILDING until fully written
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "shared memory header requires lock-free 32-bit atomics");
+
+// ============================================================================
+// Mapped Segment (read-only view)
+// ============================================================================
+
+class ShmSegment {
+    void* base_ = nullptr;
+    size_t size_ = 0;
+
+    ShmSegment(void* base, size_t size) : base_(base), size_(size) {}
+
+public:
+    ~ShmSegment() {
+#ifndef _WIN32
+        if (base_) munmap(base_, size_);
+#endif
+    }
+
+    ShmSegment(const ShmSegment&) = delete;
+    ShmSegment& operator=(const ShmSegment&) = delete;
+
+    const ShmSegmentHeader* header() const {
+        return static_cast<const ShmSegmentHeader*>(base_);
+    }
+
+    const void* rows() const {
+        return static_cast<const char*>(base_) + header()->data_offset;
+    }
+
+    size_t row_count() const { return static_cast<size_t>(header()->row_count); }
+    size_t mapped_bytes() const { return size_; }
+
+    static size_t data_offset(size_t row_align) {
+        size_t off = sizeof(ShmSegmentHeader);
+        if (row_align > 1) off = (off + row_align - 1) / row_align * row_align;
+        return off;
+    }
+
+    /**
+     * Map an existing, fully published segment read-only.
+     * Returns nullptr if it does not exist, does not match the expected
+     * layout, or was built from another source.
+     */
+    static std::shared_ptr<ShmSegment> open(const std::string& name, size_t row_size,
+                                            size_t row_align, uint64_t layout_version,
+                                            uint64_t source_key = 0) {
+#ifdef _WIN32
+        (void)name; (void)row_size; (void)row_align; (void)layout_version; (void)source_key;
+        return nullptr;
+#else
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) return nullptr;
+
+        struct stat st {};
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(ShmSegmentHeader)) {
+            close(fd);
+            return nullptr;
+        }
+
+        size_t size = static_cast<size_t>(st.st_size);
+        void* base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED) return nullptr;
+
+        std::shared_ptr<ShmSegment> seg(new ShmSegment(base, size));
+        const ShmSegmentHeader* h = seg->header();
+        if (h->magic != SHM_MAGIC ||
+            h->format_version != SHM_FORMAT_VERSION ||
+            h->state.load(std::memory_order_acquire) != SHM_STATE_READY ||
+            h->row_size != row_size ||
+            h->row_align != row_align ||
+            h->layout_version != layout_version ||
+            h->source_key != source_key ||
+            h->data_offset != data_offset(row_align) ||
+            h->row_count > (size - h->data_offset) / (row_size ? row_size : 1)) {
+            return nullptr;
+        }
+        return seg;
+#endif
+    }
+
+    /**
+     * Publish rows into a new segment.
+     *
+     * Fails (returns false) if a segment with this name already exists and is
+     * valid or still being built by a live process. A stale segment (ready but
+     * with a different layout or source, or abandoned while building) is
+     * replaced.
+     */
+    static bool publish(const std::string& name, const void* rows, size_t row_count,
+                        size_t row_size, size_t row_align, uint64_t layout_version,
+                        uint64_t source_key = 0) {
+#ifdef _WIN32
+        (void)name; (void)rows; (void)row_count; (void)row_size; (void)row_align; (void)layout_version;
+        (void)source_key;
+        return false;
+#else
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0 && errno == EEXIST && is_stale(name, row_size, row_align, layout_version, source_key)) {
+            shm_unlink(name.c_str());
+            fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        }
+        if (fd < 0) return false;
+
+        size_t offset = data_offset(row_align);
+        size_t size = offset + row_count * row_size;
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            close(fd);
+            shm_unlink(name.c_str());
+            return false;
+        }
+
+        void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED) {
+            shm_unlink(name.c_str());
+            return false;
+        }
+
+        // ftruncate zero-fills, so state already reads SHM_STATE_BUILDING
+        auto* h = static_cast<ShmSegmentHeader*>(base);
+        h->builder_pid = static_cast<uint32_t>(getpid());
+        h->magic = SHM_MAGIC;
+        h->format_version = SHM_FORMAT_VERSION;
+        h->row_size = static_cast<uint32_t>(row_size);
+        h->row_align = static_cast<uint32_t>(row_align);
+        h->layout_version = layout_version;
+        h->source_key = source_key;
+        h->row_count = row_count;
+        h->data_offset = offset;
+        if (row_count > 0) {
+            memcpy(static_cast<char*>(base) + offset, rows, row_count * row_size);
+        }
+        h->state.store(SHM_STATE_READY, std::memory_order_release);
+
+        munmap(base, size);
+        return true;
+#endif
+    }
+
+    /**
+     * Remove a segment name. Processes that already mapped it keep their view.
+     */
+    static void unlink(const std::string& name) {
+#ifndef _WIN32
+        shm_unlink(name.c_str());
+#else
+        (void)name;
+#endif
+    }
+
+private:
+#ifndef _WIN32
+    // A ready segment that does not match the expected layout or source, or
+    // one whose publisher died (or stalled past the timeout) before marking
+    // it ready
+    static bool is_stale(const std::string& name, size_t row_size,
+                         size_t row_align, uint64_t layout_version, uint64_t source_key) {
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) return false;
+
+        struct stat st {};
+        bool stale = false;
+        if (fstat(fd, &st) == 0) {
+            bool expired = time(nullptr) - st.st_mtime > SHM_BUILD_TIMEOUT_SECONDS;
+            if (static_cast<size_t>(st.st_size) < sizeof(ShmSegmentHeader)) {
+                // Publisher died before ftruncate
+                stale = expired;
+            } else {
+                void* base = mmap(nullptr, sizeof(ShmSegmentHeader), PROT_READ, MAP_SHARED, fd, 0);
+                if (base != MAP_FAILED) {
+                    const auto* h = static_cast<const ShmSegmentHeader*>(base);
+                    if (h->state.load(std::memory_order_acquire) == SHM_STATE_READY) {
+                        stale = h->magic != SHM_MAGIC ||
+                                h->format_version != SHM_FORMAT_VERSION ||
+                                h->row_size != row_size ||
+                                h->row_align != row_align ||
+                                h->layout_version != layout_version ||
+                                h->source_key != source_key;
+                    } else {
+                        pid_t pid = static_cast<pid_t>(h->builder_pid);
+                        bool builder_gone = pid > 0 && kill(pid, 0) != 0 && errno == ESRCH;
+                        stale = builder_gone || expired;
+                    }
+                    munmap(base, sizeof(ShmSegmentHeader));
+                }
+            }
+        }
+        close(fd);
+        return stale;
+    }
+#endif
+};
+
+} // namespace xsql
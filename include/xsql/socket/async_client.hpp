@@ -0,0 +1,659 @@
+/**
+ * @file async_client.hpp
+ * @brief Event-loop socket client for many concurrent queries
+ *
+ * AsyncClient drives any number of server connections from one event-loop
+ * thread (epoll on Linux, poll elsewhere). query_async() returns a future or
+ * invokes a callback on the loop thread; callers never block on a socket.
+ * Requests refused up front (unknown server, client closed) complete before
+ * query_async() returns, on the caller's thread.
+ * Requests to the same server are pipelined on one connection and answered
+ * in order, since the server handles a connection's requests sequentially.
+ *
+ * Connections open lazily with a connect timeout, every request has its own
+ * deadline, and a dropped connection is re-established with backoff. Only
+ * requests that had not been fully sent are retried; a request the server
+ * may already have run fails with "connection lost" instead of being
+ * replayed.
+ *
+ * Usage:
+ *   xsql::socket::AsyncClient client;
+ *   size_t a = client.add_server("10.0.0.1", 13337);
+ *   size_t b = client.add_server("10.0.0.2", 13337);
+ *
+ *   auto fa = client.query_async(a, "SELECT COUNT(*) FROM funcs");
+ *   client.query_async(b, "SELECT COUNT(*) FROM funcs", [](xsql::socket::RemoteResult r) {
+ *       // Runs on the loop thread
+ *   });
+ *   auto ra = fa.get();
+ */
+
+#pragma once
+
+#include "client.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cerrno>
+
+#ifdef _WIN32
+    #ifndef XSQL_POLL
+        #define XSQL_POLL WSAPoll
+    #endif
+#else
+    #include <poll.h>
+    #include <fcntl.h>
+    #ifndef XSQL_POLL
+        #define XSQL_POLL ::poll
+    #endif
+    #ifdef __linux__
+        #include <sys/epoll.h>
+    #endif
+#endif
+
+namespace xsql::socket {
+
+struct AsyncClientConfig {
+    int connect_timeout_ms = 5000;
+    int request_timeout_ms = 30000;     // From submission to response
+    int reconnect_attempts = 3;         // Consecutive failures before pending requests fail
+    int reconnect_backoff_ms = 100;     // Grows linearly with each failure
+    size_t max_message_bytes = 10 * 1024 * 1024;
+};
+
+namespace detail {
+
+//=============================================================================
+// Readiness Poller (epoll on Linux, poll elsewhere)
+//=============================================================================
+
+class EventPoller {
+public:
+    struct Event {
+        socket_t fd;
+        bool readable;
+        bool writable;
+        bool error;
+    };
+
+#if defined(__linux__)
+    EventPoller() : epfd_(epoll_create1(EPOLL_CLOEXEC)) {}
+    ~EventPoller() {
+        if (epfd_ >= 0) ::close(epfd_);
+    }
+
+    bool ok() const { return epfd_ >= 0; }
+
+    /// Add fd or change its interest set (read is always watched)
+    void watch(socket_t fd, bool want_write) {
+        epoll_event ev{};
+        ev.events = EPOLLIN | (want_write ? EPOLLOUT : 0u);
+        ev.data.fd = fd;
+        if (epoll_ctl(epfd_, EPOLL_CTL_MOD, fd, &ev) != 0 && errno == ENOENT) {
+            epoll_ctl(epfd_, EPOLL_CTL_ADD, fd, &ev);
+        }
+    }
+
+    void unwatch(socket_t fd) { epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr); }
+
+    int wait(int timeout_ms, std::vector<Event>& out) {
+        out.clear();
+        epoll_event events[64];
+        int n = epoll_wait(epfd_, events, 64, timeout_ms);
+        if (n < 0) return errno == EINTR ? 0 : -1;
+        for (int i = 0; i < n; ++i) {
+            out.push_back(Event{events[i].data.fd, (events[i].events & EPOLLIN) != 0,
+                                (events[i].events & EPOLLOUT) != 0,
+                                (events[i].events & (EPOLLERR | EPOLLHUP)) != 0});
+        }
+        return n;
+    }
+
+private:
+    int epfd_;
+#else
+    bool ok() const { return true; }
+
+    void watch(socket_t fd, bool want_write) {
+        short events = static_cast<short>(POLLIN | (want_write ? POLLOUT : 0));
+        for (auto& p : fds_) {
+            if (p.fd == fd) {
+                p.events = events;
+                return;
+            }
+        }
+        pollfd p{};
+        p.fd = fd;
+        p.events = events;
+        fds_.push_back(p);
+    }
+
+    void unwatch(socket_t fd) {
+        for (size_t i = 0; i < fds_.size(); ++i) {
+            if (fds_[i].fd == fd) {
+                fds_.erase(fds_.begin() + static_cast<std::ptrdiff_t>(i));
+                return;
+            }
+        }
+    }
+
+    int wait(int timeout_ms, std::vector<Event>& out) {
+        out.clear();
+        if (fds_.empty()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms));
+            return 0;
+        }
+        for (auto& p : fds_) p.revents = 0;
+        int n = XSQL_POLL(fds_.data(), static_cast<decltype(fds_.size())>(fds_.size()), timeout_ms);
+        if (n < 0) {
+#ifndef _WIN32
+            if (errno == EINTR) return 0;
+#endif
+            return -1;
+        }
+        for (const auto& p : fds_) {
+            if (p.revents == 0) continue;
+            out.push_back(Event{p.fd, (p.revents & POLLIN) != 0, (p.revents & POLLOUT) != 0,
+                                (p.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0});
+        }
+        return static_cast<int>(out.size());
+    }
+
+private:
+    std::vector<pollfd> fds_;
+#endif
+};
+
+}  // namespace detail
+
+//=============================================================================
+// Async Client
+//=============================================================================
+
+class AsyncClient {
+public:
+    using callback_t = std::function<void(RemoteResult)>;
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct Endpoint {
+        std::string host;
+        int port = 0;
+        std::string token;
+    };
+
+    struct Request {
+        size_t server = 0;
+        std::string frame;          // Length-prefixed request
+        callback_t done;
+        clock::time_point deadline;
+    };
+
+    enum class State { Idle, Connecting, Connected };
+
+    // Loop-thread state for one server
+    struct Conn {
+        Endpoint endpoint;
+        socket_t sock = SOCKET_INVALID;
+        State state = State::Idle;
+        clock::time_point connect_deadline;
+        clock::time_point retry_at;
+        int failures = 0;
+        std::deque<Request> pending;    // Submission order; the first `sent` are on the wire
+        size_t sent = 0;
+        size_t write_pos = 0;           // Bytes of pending[sent] already written
+        std::string inbuf;
+    };
+
+    AsyncClientConfig config_;
+    std::mutex mutex_;                  // Guards endpoints_, submissions_, stopping_
+    std::vector<Endpoint> endpoints_;
+    std::vector<Request> submissions_;
+    bool stopping_ = false;
+    std::atomic<size_t> outstanding_{0};
+    std::thread loop_;
+    bool wsa_init_ = false;
+#ifndef _WIN32
+    int wake_fds_[2] = {-1, -1};
+#endif
+
+public:
+    explicit AsyncClient(const AsyncClientConfig& config = AsyncClientConfig()) : config_(config) {
+#ifdef _WIN32
+        WSADATA wsa;
+        wsa_init_ = (WSAStartup(MAKEWORD(2, 2), &wsa) == 0);
+#else
+        if (pipe(wake_fds_) == 0) {
+            set_nonblocking(wake_fds_[0]);
+            set_nonblocking(wake_fds_[1]);
+        }
+#endif
+        loop_ = std::thread([this] { run_loop(); });
+    }
+
+    /// Fails every request still pending with "client closed"
+    ~AsyncClient() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake();
+        if (loop_.joinable()) loop_.join();
+#ifdef _WIN32
+        if (wsa_init_) WSACleanup();
+#else
+        for (int fd : wake_fds_) {
+            if (fd >= 0) ::close(fd);
+        }
+#endif
+    }
+
+    AsyncClient(const AsyncClient&) = delete;
+    AsyncClient& operator=(const AsyncClient&) = delete;
+
+    /**
+     * Register a server; returns the id to pass to query_async. The
+     * connection opens on the first request.
+     */
+    size_t add_server(const std::string& host, int port, const std::string& token = "") {
+        std::lock_guard<std::mutex> lock(mutex_);
+        endpoints_.push_back(Endpoint{host, port, token});
+        return endpoints_.size() - 1;
+    }
+
+    /**
+     * Send sql to server; done runs on the loop thread with the result (or
+     * an error for timeouts and connection failures). For an unknown server
+     * or a closed client, done runs on the calling thread before this returns.
+     */
+    void query_async(size_t server, const std::string& sql, callback_t done) {
+        Request req;
+        req.server = server;
+        req.done = std::move(done);
+        req.deadline = clock::now() + std::chrono::milliseconds(config_.request_timeout_ms);
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            std::string error;
+            if (stopping_) {
+                error = "client closed";
+            } else if (server >= endpoints_.size()) {
+                error = "unknown server";
+            }
+            if (!error.empty()) {
+                lock.unlock();
+                RemoteResult r;
+                r.error = error;
+                if (req.done) req.done(std::move(r));
+                return;
+            }
+            std::string payload = make_query_request(sql, endpoints_[server].token);
+            uint32_t len_net = htonl(static_cast<uint32_t>(payload.size()));
+            req.frame.assign(reinterpret_cast<const char*>(&len_net), sizeof(len_net));
+            req.frame += payload;
+            outstanding_++;
+            submissions_.push_back(std::move(req));
+        }
+        wake();
+    }
+
+    std::future<RemoteResult> query_async(size_t server, const std::string& sql) {
+        auto promise = std::make_shared<std::promise<RemoteResult>>();
+        auto future = promise->get_future();
+        query_async(server, sql, [promise](RemoteResult r) { promise->set_value(std::move(r)); });
+        return future;
+    }
+
+    /// Requests submitted whose callbacks have not run yet
+    size_t outstanding() const { return outstanding_.load(); }
+
+    size_t server_count() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return endpoints_.size();
+    }
+
+private:
+    //-------------------------------------------------------------------------
+    // Socket helpers
+    //-------------------------------------------------------------------------
+
+    static bool set_nonblocking(socket_t s) {
+#ifdef _WIN32
+        u_long mode = 1;
+        return ioctlsocket(s, FIONBIO, &mode) == 0;
+#else
+        int flags = fcntl(s, F_GETFL, 0);
+        return flags >= 0 && fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+    }
+
+    static bool in_progress() {
+#ifdef _WIN32
+        return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+        return errno == EINPROGRESS || errno == EWOULDBLOCK || errno == EAGAIN;
+#endif
+    }
+
+    void wake() {
+#ifndef _WIN32
+        if (wake_fds_[1] >= 0) {
+            char b = 1;
+            (void)!::write(wake_fds_[1], &b, 1);
+        }
+#endif
+    }
+
+    static int ms_until(clock::time_point t, clock::time_point now) {
+        if (t <= now) return 0;
+        return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(t - now).count()) + 1;
+    }
+
+    //-------------------------------------------------------------------------
+    // Event loop
+    //-------------------------------------------------------------------------
+
+    // Callbacks collected during one iteration and run without touching loop state
+    using Completions = std::vector<std::pair<callback_t, RemoteResult>>;
+
+    static void fail(Completions& done, Request& req, const std::string& error) {
+        RemoteResult r;
+        r.error = error;
+        done.emplace_back(std::move(req.done), std::move(r));
+    }
+
+    void run_loop() {
+        detail::EventPoller poller;
+        std::vector<std::unique_ptr<Conn>> conns;
+        std::vector<detail::EventPoller::Event> events;
+        Completions done;
+
+#ifndef _WIN32
+        if (wake_fds_[0] >= 0) poller.watch(wake_fds_[0], false);
+#endif
+
+        while (true) {
+            bool stopping;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping = stopping_;
+                while (conns.size() < endpoints_.size()) {
+                    auto c = std::make_unique<Conn>();
+                    c->endpoint = endpoints_[conns.size()];
+                    conns.push_back(std::move(c));
+                }
+                for (auto& req : submissions_) {
+                    size_t server = req.server;
+                    conns[server]->pending.push_back(std::move(req));
+                }
+                submissions_.clear();
+            }
+            if (stopping || !poller.ok()) {
+                for (auto& c : conns) {
+                    close_conn(poller, *c);
+                    for (auto& req : c->pending) fail(done, req, stopping ? "client closed" : "poller failed");
+                    c->pending.clear();
+                }
+                deliver(done);
+                return;
+            }
+
+            // Connect, expire and set interest; find the next deadline
+            auto now = clock::now();
+            int wait_ms = 1000;
+            for (auto& cp : conns) {
+                Conn& c = *cp;
+                expire_requests(poller, c, now, done);
+                if (c.state == State::Idle && !c.pending.empty() && now >= c.retry_at) {
+                    start_connect(poller, c, now, done);
+                }
+                if (c.state == State::Connecting && now >= c.connect_deadline) {
+                    connection_failed(poller, c, "connect timeout", now, done);
+                }
+
+                if (c.state == State::Connecting) {
+                    poller.watch(c.sock, true);
+                    wait_ms = (std::min)(wait_ms, ms_until(c.connect_deadline, now));
+                } else if (c.state == State::Connected) {
+                    poller.watch(c.sock, c.sent < c.pending.size());
+                } else if (!c.pending.empty()) {
+                    wait_ms = (std::min)(wait_ms, ms_until(c.retry_at, now));
+                }
+                if (!c.pending.empty()) wait_ms = (std::min)(wait_ms, ms_until(c.pending.front().deadline, now));
+            }
+            deliver(done);
+#ifdef _WIN32
+            wait_ms = (std::min)(wait_ms, 10);     // No wake pipe; pick up submissions promptly
+#endif
+
+            if (poller.wait(wait_ms, events) < 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+
+            now = clock::now();
+            for (const auto& ev : events) {
+#ifndef _WIN32
+                if (ev.fd == wake_fds_[0]) {
+                    char buf[64];
+                    while (::read(wake_fds_[0], buf, sizeof(buf)) > 0) {}
+                    continue;
+                }
+#endif
+                for (auto& cp : conns) {
+                    if (cp->sock == ev.fd && cp->state != State::Idle) {
+                        handle_event(poller, *cp, ev, now, done);
+                        break;
+                    }
+                }
+            }
+            deliver(done);
+        }
+    }
+
+    void deliver(Completions& done) {
+        for (auto& item : done) {
+            outstanding_--;
+            if (!item.first) continue;
+            try {
+                item.first(std::move(item.second));
+            } catch (...) {
+                // A throwing callback must not take down the loop
+            }
+        }
+        done.clear();
+    }
+
+    void close_conn(detail::EventPoller& poller, Conn& c) {
+        if (c.sock != SOCKET_INVALID) {
+            poller.unwatch(c.sock);
+            CLOSE_SOCKET(c.sock);
+            c.sock = SOCKET_INVALID;
+        }
+        c.state = State::Idle;
+        c.inbuf.clear();
+        c.write_pos = 0;
+    }
+
+    /**
+     * Requests already sent have unknown outcome and fail; the rest wait
+     * for a reconnect, or fail too once reconnect_attempts is exhausted.
+     */
+    void connection_failed(detail::EventPoller& poller, Conn& c, const std::string& error,
+                           clock::time_point now, Completions& done) {
+        close_conn(poller, c);
+        for (size_t i = 0; i < c.sent; ++i) {
+            fail(done, c.pending.front(), "connection lost: " + error);
+            c.pending.pop_front();
+        }
+        c.sent = 0;
+
+        c.failures++;
+        if (c.failures > config_.reconnect_attempts) {
+            for (auto& req : c.pending) fail(done, req, error);
+            c.pending.clear();
+            c.failures = 0;
+            c.retry_at = now;
+        } else {
+            c.retry_at = now + std::chrono::milliseconds(config_.reconnect_backoff_ms * c.failures);
+        }
+    }
+
+    void expire_requests(detail::EventPoller& poller, Conn& c, clock::time_point now, Completions& done) {
+        if (c.pending.empty()) return;
+        // Responses arrive in order, so a late request on the wire blocks the
+        // ones behind it: drop the connection and let them be resent
+        if (c.sent > 0 && c.pending.front().deadline <= now) {
+            fail(done, c.pending.front(), "timeout");
+            c.pending.pop_front();
+            c.sent--;
+            close_conn(poller, c);
+            for (size_t i = 0; i < c.sent; ++i) {
+                fail(done, c.pending.front(), "connection lost: timeout of an earlier request");
+                c.pending.pop_front();
+            }
+            c.sent = 0;
+        }
+        // Unsent requests can simply be removed
+        for (size_t i = c.sent; i < c.pending.size();) {
+            bool partially_written = (i == c.sent && c.write_pos > 0);
+            if (c.pending[i].deadline <= now && !partially_written) {
+                fail(done, c.pending[i], "timeout");
+                c.pending.erase(c.pending.begin() + static_cast<std::ptrdiff_t>(i));
+            } else {
+                ++i;
+            }
+        }
+    }
+
+    void start_connect(detail::EventPoller& poller, Conn& c, clock::time_point now, Completions& done) {
+        struct addrinfo hints{}, *res = nullptr;
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        std::string port_str = std::to_string(c.endpoint.port);
+        if (getaddrinfo(c.endpoint.host.c_str(), port_str.c_str(), &hints, &res) != 0 || !res) {
+            connection_failed(poller, c, "failed to resolve host: " + c.endpoint.host, now, done);
+            return;
+        }
+
+        c.sock = ::socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+        if (c.sock == SOCKET_INVALID || !set_nonblocking(c.sock)) {
+            freeaddrinfo(res);
+            connection_failed(poller, c, "socket() failed", now, done);
+            return;
+        }
+        int nodelay = 1;
+        setsockopt(c.sock, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<char*>(&nodelay), sizeof(nodelay));
+
+        int rc = ::connect(c.sock, res->ai_addr, static_cast<int>(res->ai_addrlen));
+        freeaddrinfo(res);
+        if (rc < 0 && !in_progress()) {
+            connection_failed(poller, c, "connect() failed", now, done);
+            return;
+        }
+        c.state = State::Connecting;
+        c.connect_deadline = now + std::chrono::milliseconds(config_.connect_timeout_ms);
+    }
+
+    void handle_event(detail::EventPoller& poller, Conn& c, const detail::EventPoller::Event& ev,
+                      clock::time_point now, Completions& done) {
+        if (c.state == State::Connecting) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            getsockopt(c.sock, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&err), &len);
+            if (err != 0 || (ev.error && !ev.writable)) {
+                connection_failed(poller, c, "connect() failed", now, done);
+                return;
+            }
+            if (!ev.writable) return;
+            c.state = State::Connected;
+        }
+
+        if (ev.writable && !flush(c)) {
+            // A server that refused the connection left its reason before closing
+            std::string error;
+            if (read_responses(c, done, error)) error = "send failed";
+            connection_failed(poller, c, error, now, done);
+            return;
+        }
+        if (ev.readable || ev.error) {
+            std::string error;
+            if (!read_responses(c, done, error)) connection_failed(poller, c, error, now, done);
+        }
+    }
+
+    // Write queued requests until the socket would block
+    static bool flush(Conn& c) {
+        while (c.sent < c.pending.size()) {
+            const std::string& frame = c.pending[c.sent].frame;
+            while (c.write_pos < frame.size()) {
+                int n = send(c.sock, frame.data() + c.write_pos, static_cast<int>(frame.size() - c.write_pos),
+                             XSQL_SEND_FLAGS);
+                if (n < 0 && in_progress()) return true;
+                if (n <= 0) return false;
+                c.write_pos += static_cast<size_t>(n);
+            }
+            c.sent++;
+            c.write_pos = 0;
+        }
+        return true;
+    }
+
+    // Complete requests from buffered frames; false (with error) once the connection is unusable
+    bool read_responses(Conn& c, Completions& done, std::string& error) {
+        char buf[16384];
+        std::string closed;     // Reported after the frames that arrived before it
+        while (true) {
+            int n = recv(c.sock, buf, static_cast<int>(sizeof(buf)), 0);
+            if (n < 0 && in_progress()) break;
+            if (n <= 0) {
+                closed = n == 0 ? "server closed connection" : "recv failed";
+                break;
+            }
+            c.inbuf.append(buf, static_cast<size_t>(n));
+        }
+
+        size_t pos = 0;
+        while (c.inbuf.size() - pos >= sizeof(uint32_t)) {
+            uint32_t len_net = 0;
+            memcpy(&len_net, c.inbuf.data() + pos, sizeof(len_net));
+            size_t len = ntohl(len_net);
+            if (len > config_.max_message_bytes) {
+                error = "response too large";
+                return false;
+            }
+            if (c.inbuf.size() - pos - sizeof(uint32_t) < len) break;
+            std::string payload = c.inbuf.substr(pos + sizeof(uint32_t), len);
+            pos += sizeof(uint32_t) + len;
+
+            if (is_push_message(payload)) continue;     // Subscriptions are not used here
+            if (c.sent == 0) {
+                // An error before any request was sent, e.g. "Too many connections"
+                RemoteResult r = parse_response(payload);
+                error = r.success || r.error.empty() ? "unexpected response" : r.error;
+                return false;
+            }
+            done.emplace_back(std::move(c.pending.front().done), parse_response(payload));
+            c.pending.pop_front();
+            c.sent--;
+            c.failures = 0;
+        }
+        c.inbuf.erase(0, pos);
+        if (!closed.empty()) {
+            error = closed;
+            return false;
+        }
+        return true;
+    }
+};
+
+}  // namespace xsql::socket
@@ -16,7 +16,9 @@
 
 #include "protocol.hpp"
 
+#include <deque>
 #include <string>
+#include <vector>
 #include <cstdint>
 #include <cstddef>
 #include <limits>
@@ -33,6 +35,8 @@
     #include <netinet/in.h>
     #include <arpa/inet.h>
     #include <netdb.h>
+    #include <netinet/tcp.h>
+    #include <poll.h>
     #include <unistd.h>
     typedef int socket_t;
     #define SOCKET_INVALID -1
@@ -51,6 +55,7 @@ class Client {
     bool wsa_init_ = false;
     size_t max_message_bytes_ = 10 * 1024 * 1024;
     std::string auth_token_;
+    std::deque<RemoteDelta> pending_deltas_;    // Pushes that arrived while awaiting a response
 
 public:
     Client() {
@@ -106,6 +111,10 @@ public:
         }
 
         freeaddrinfo(result);
+
+        // Requests are sent as length prefix + payload; avoid Nagle delays between them
+        int nodelay = 1;
+        setsockopt(sock_, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<char*>(&nodelay), sizeof(nodelay));
         return true;
     }
 
@@ -117,8 +126,14 @@ public:
             CLOSE_SOCKET(sock_);
             sock_ = SOCKET_INVALID;
         }
+        pending_deltas_.clear();
     }
 
+    /**
+     * False before connect(), after disconnect(), and after a send or
+     * receive fails: the stream cannot be resynchronized, so a transport
+     * failure closes the socket. Reconnect to continue.
+     */
     bool is_connected() const { return sock_ != SOCKET_INVALID; }
     const std::string& error() const { return error_; }
 
@@ -135,38 +150,192 @@ public:
      */
     RemoteResult query(const std::string& sql) {
         RemoteResult result;
+        std::string response;
+        if (!round_trip(make_query_request(sql, auth_token_), response, result.error)) return result;
+        return parse_response(response);
+    }
 
-        if (!is_connected()) {
-            result.error = "not connected";
+    /**
+     * Execute several statements in one round trip.
+     * @param statements SQL statements, run in order
+     * @param transaction Wrap in BEGIN/COMMIT; the first failure rolls back
+     * @return One result per executed statement
+     */
+    RemoteBatchResult query_batch(const std::vector<std::string>& statements, bool transaction = false) {
+        RemoteBatchResult result;
+        std::string response;
+        if (!round_trip(make_batch_request(statements, transaction, auth_token_), response, result.error)) {
             return result;
         }
+        return parse_batch_response(response);
+    }
 
-        // Build JSON request
-        std::string request = "{\"sql\":\"";
-        request += json_escape(sql);
-        request += "\"";
-        if (!auth_token_.empty()) {
-            request += ",\"token\":\"";
-            request += json_escape(auth_token_);
-            request += "\"";
-        }
-        request += "}";
+    /**
+     * Prepare a statement on the server for repeated execution.
+     * The returned id is valid until close_statement() or disconnect.
+     */
+    RemotePrepared prepare(const std::string& sql) {
+        RemotePrepared result;
+        std::string response;
+        if (!round_trip(make_prepare_request(sql, auth_token_), response, result.error)) return result;
+        return parse_prepare_response(response);
+    }
 
-        if (!send_message(request)) {
-            result.error = "send failed";
+    /**
+     * Execute a prepared statement with positional parameters.
+     */
+    RemoteResult execute(uint64_t statement, const std::vector<Param>& params = {}) {
+        RemoteResult result;
+        std::string response;
+        if (!round_trip(make_execute_request(statement, params, auth_token_), response, result.error)) {
             return result;
         }
+        return parse_response(response);
+    }
 
+    /**
+     * Release a prepared statement on the server.
+     */
+    bool close_statement(uint64_t statement) {
         std::string response;
-        if (!recv_message(response)) {
-            result.error = "recv failed";
-            return result;
+        if (!round_trip(make_close_request(statement, auth_token_), response, error_)) return false;
+        RemoteResult r = parse_response(response);
+        if (!r.success) error_ = r.error;
+        return r.success;
+    }
+
+    /**
+     * Open a server-side cursor and return its first page of at most
+     * fetch_rows rows. Keep calling fetch() until a page reports done;
+     * the server holds the remaining rows until then.
+     */
+    RemoteCursorPage open_cursor(const std::string& sql, const std::vector<Param>& params = {},
+                                 size_t fetch_rows = 1000) {
+        RemoteCursorPage page;
+        std::string response;
+        if (!round_trip(make_cursor_open_request(sql, params, fetch_rows, auth_token_), response, page.error)) {
+            return page;
         }
+        return parse_cursor_response(response);
+    }
 
-        return parse_response(response);
+    /**
+     * Fetch the next page of an open cursor.
+     */
+    RemoteCursorPage fetch(uint64_t cursor, size_t rows = 1000) {
+        RemoteCursorPage page;
+        std::string response;
+        if (!round_trip(make_cursor_fetch_request(cursor, rows, auth_token_), response, page.error)) {
+            return page;
+        }
+        return parse_cursor_response(response);
+    }
+
+    /**
+     * Abandon a cursor before it is done, releasing the server's statement.
+     */
+    bool close_cursor(uint64_t cursor) {
+        std::string response;
+        if (!round_trip(make_cursor_close_request(cursor, auth_token_), response, error_)) return false;
+        RemoteResult r = parse_response(response);
+        if (!r.success) error_ = r.error;
+        return r.success;
+    }
+
+    /**
+     * Register a live query. The result holds the current rows; afterwards
+     * the server pushes a delta whenever they change, read via next_delta().
+     */
+    RemoteDelta subscribe(const std::string& sql) {
+        RemoteDelta result;
+        std::string response;
+        if (!round_trip(make_subscribe_request(sql, auth_token_), response, result.error)) return result;
+        return parse_delta(response);
+    }
+
+    bool unsubscribe(uint64_t subscription) {
+        std::string response;
+        if (!round_trip(make_unsubscribe_request(subscription, auth_token_), response, error_)) return false;
+        RemoteResult r = parse_response(response);
+        if (!r.success) error_ = r.error;
+        // Drop pushes already queued for it
+        for (auto it = pending_deltas_.begin(); it != pending_deltas_.end();) {
+            it = it->subscription == subscription ? pending_deltas_.erase(it) : it + 1;
+        }
+        return r.success;
+    }
+
+    /**
+     * Wait up to timeout_ms (-1 = forever) for the next subscription push.
+     * A delta with success == false means the server ended that subscription.
+     */
+    bool next_delta(RemoteDelta& out, int timeout_ms = -1) {
+        if (pending_deltas_.empty()) {
+            if (!is_connected()) {
+                error_ = "not connected";
+                return false;
+            }
+            if (!wait_readable(timeout_ms)) return false;
+
+            std::string message;
+            if (!recv_message(message)) {
+                drop_connection();
+                error_ = "recv failed";
+                return false;
+            }
+            if (!is_push_message(message)) {
+                error_ = "unexpected response";
+                return false;
+            }
+            out = parse_delta(message);
+            return true;
+        }
+        out = std::move(pending_deltas_.front());
+        pending_deltas_.pop_front();
+        return true;
     }
 
+    size_t pending_deltas() const { return pending_deltas_.size(); }
+
 private:
+    bool round_trip(const std::string& request, std::string& response, std::string& error) {
+        if (!is_connected()) {
+            error = "not connected";
+            return false;
+        }
+        // Refused before anything is written; the connection stays usable
+        if (request.size() > max_message_bytes_ ||
+            request.size() > static_cast<size_t>((std::numeric_limits<uint32_t>::max)())) {
+            error = "request too large";
+            return false;
+        }
+        if (!send_message(request)) {
+            // A server that refused the connection left its reason before closing
+            bool refused = wait_readable(0) && recv_message(response) && !is_push_message(response);
+            drop_connection();
+            if (refused) return true;
+            error = "send failed";
+            return false;
+        }
+        while (true) {
+            if (!recv_message(response)) {
+                drop_connection();
+                error = "recv failed";
+                return false;
+            }
+            if (!is_push_message(response)) return true;
+            pending_deltas_.push_back(parse_delta(response));
+        }
+    }
+
+    // Close after a transport failure; queued pushes stay readable
+    void drop_connection() {
+        if (sock_ != SOCKET_INVALID) {
+            CLOSE_SOCKET(sock_);
+            sock_ = SOCKET_INVALID;
+        }
+    }
+
     bool send_message(const std::string& payload) {
         if (payload.size() > max_message_bytes_) return false;
         if (payload.size() > static_cast<size_t>((std::numeric_limits<uint32_t>::max)())) return false;
@@ -174,7 +343,7 @@ private:
         auto send_all = [&](const char* data, size_t len) -> bool {
             size_t total = 0;
             while (total < len) {
-                int n = send(sock_, data + total, static_cast<int>(len - total), 0);
+                int n = send(sock_, data + total, static_cast<int>(len - total), XSQL_SEND_FLAGS);
                 if (n <= 0) return false;
                 total += static_cast<size_t>(n);
             }
@@ -188,6 +357,18 @@ private:
         return send_all(payload.data(), payload.size());
     }
 
+    bool wait_readable(int timeout_ms) {
+        pollfd p{};
+        p.fd = sock_;
+        p.events = POLLIN;
+#ifdef _WIN32
+        int ready = WSAPoll(&p, 1, timeout_ms);
+#else
+        int ready = ::poll(&p, 1, timeout_ms);
+#endif
+        return ready > 0;
+    }
+
     bool recv_message(std::string& payload) {
         auto recv_all = [&](char* data, size_t len) -> bool {
             size_t total = 0;
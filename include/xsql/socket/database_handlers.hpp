@@ -0,0 +1,282 @@
+/**
+ * @file database_handlers.hpp
+ * @brief Serve an xsql::Database over the socket protocol
+ *
+ * Provides the query handler most servers write by hand, plus a prepare
+ * handler that keeps one sqlite3_stmt per prepared statement so repeated
+ * executions skip parsing and planning. The same statements back server-side
+ * cursors, which step the sqlite3_stmt one page per fetch.
+ *
+ * Handlers created with a Server apply its max_result_bytes/max_result_rows
+ * while rows are read, so an oversized result fails early instead of after
+ * it is fully built. Cursor pages are bounded separately.
+ *
+ * Usage:
+ *   xsql::Database db;
+ *   xsql::socket::Server server;
+ *   xsql::socket::serve_database(server, db);   // db must outlive server
+ *   server.run(13337);
+ */
+
+#pragma once
+
+#include "server.hpp"
+#include "../database.hpp"
+
+#include <sqlite3.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <cctype>
+
+namespace xsql::socket {
+
+//=============================================================================
+// Result Conversion
+//=============================================================================
+
+inline QueryResult to_query_result(const xsql::Result& result) {
+    if (!result.ok()) return QueryResult::fail(result.error);
+    QueryResult out = QueryResult::ok();
+    out.columns = result.columns;
+    out.rows.reserve(result.rows.size());
+    for (const auto& row : result.rows) out.rows.push_back(row.values);
+    return out;
+}
+
+/// Result limits from a server's configuration
+inline xsql::QueryLimits query_limits(const ServerConfig& config) {
+    xsql::QueryLimits limits;
+    limits.max_result_bytes = config.result_byte_limit();
+    limits.max_result_rows = config.max_result_rows;
+    return limits;
+}
+
+/**
+ * Query handler for db. With a server, its current result limits replace
+ * db.query_limits().
+ */
+inline Server::query_handler_t database_query_handler(xsql::Database& db, const Server* server = nullptr) {
+    return [&db, server](const std::string& sql) {
+        if (!server) return to_query_result(db.query(sql));
+        return to_query_result(db.query(sql.c_str(), {}, query_limits(server->config())));
+    };
+}
+
+/**
+ * Route statements whose EXPLAIN QUERY PLAN estimate exceeds
+ * policy.background_threshold rows to the background lane. Unless the
+ * policy supplies table_rows, scans of registered virtual tables count
+ * their estimate_rows() (see Database::estimated_rows).
+ */
+inline Server::classifier_t database_cost_classifier(xsql::Database& db, CostPolicy policy = CostPolicy()) {
+    if (!policy.table_rows) {
+        policy.table_rows = [&db](const std::string& table) { return db.estimated_rows(table); };
+    }
+    return [&db, policy = std::move(policy)](const std::string& sql) {
+        return classify_query_cost(db.handle(), sql, policy);
+    };
+}
+
+//=============================================================================
+// Prepared Statements
+//=============================================================================
+
+class SqlitePreparedStatement : public PreparedStatement {
+    sqlite3* db_;
+    sqlite3_stmt* stmt_;
+    xsql::QueryLimits limits_;      // Applied to execute(); cursors page instead
+
+public:
+    SqlitePreparedStatement(sqlite3* db, sqlite3_stmt* stmt, const xsql::QueryLimits& limits = {})
+        : db_(db), stmt_(stmt), limits_(limits) {}
+    ~SqlitePreparedStatement() override { sqlite3_finalize(stmt_); }
+
+    SqlitePreparedStatement(const SqlitePreparedStatement&) = delete;
+    SqlitePreparedStatement& operator=(const SqlitePreparedStatement&) = delete;
+
+    int param_count() const override { return sqlite3_bind_parameter_count(stmt_); }
+
+    QueryResult execute(const std::vector<Param>& params) override {
+        std::string error;
+        if (!begin(params, error)) return QueryResult::fail(error);
+        bool done = false;
+        return read_rows(static_cast<size_t>(-1), static_cast<size_t>(-1), done, &limits_);
+    }
+
+    bool begin(const std::vector<Param>& params, std::string& error) override {
+        sqlite3_reset(stmt_);
+        sqlite3_clear_bindings(stmt_);
+
+        if (static_cast<int>(params.size()) != param_count()) {
+            error = "expected " + std::to_string(param_count()) +
+                    " parameters, got " + std::to_string(params.size());
+            return false;
+        }
+        for (size_t i = 0; i < params.size(); ++i) {
+            if (bind(static_cast<int>(i + 1), params[i]) != SQLITE_OK) {
+                error = sqlite3_errmsg(db_);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Steps the live statement, so a cursor only materializes one page at a time
+    QueryResult fetch(size_t max_rows, size_t max_bytes, bool& done) override {
+        return read_rows(max_rows, max_bytes, done, nullptr);
+    }
+
+private:
+    QueryResult read_rows(size_t max_rows, size_t max_bytes, bool& done, const xsql::QueryLimits* limits) {
+        QueryResult result = QueryResult::ok();
+        int cols = sqlite3_column_count(stmt_);
+        result.columns.reserve(cols);
+        for (int i = 0; i < cols; ++i) {
+            const char* name = sqlite3_column_name(stmt_, i);
+            result.columns.push_back(name ? name : "");
+        }
+
+        done = false;
+        size_t bytes = 0;
+        size_t text_bytes = xsql::result_limit_bytes(result.columns);
+        while (result.rows.size() < max_rows && bytes < max_bytes) {
+            int rc = sqlite3_step(stmt_);
+            if (rc == SQLITE_DONE) {
+                done = true;
+                break;
+            }
+            if (rc != SQLITE_ROW) {
+                result = QueryResult::fail(xsql::sqlite_error_message(db_, rc));
+                done = true;
+                break;
+            }
+            if (limits && limits->max_result_rows > 0 && result.rows.size() >= limits->max_result_rows) {
+                result = QueryResult::fail("result too large: exceeds max_result_rows (" +
+                                           std::to_string(limits->max_result_rows) + ")");
+                done = true;
+                break;
+            }
+            std::vector<std::string> row;
+            row.reserve(cols);
+            for (int i = 0; i < cols; ++i) {
+                const char* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt_, i));
+                size_t len = static_cast<size_t>(sqlite3_column_bytes(stmt_, i));
+                row.push_back(text ? std::string(text, len) : std::string());
+                bytes += len + 4;
+            }
+            text_bytes += xsql::result_limit_bytes(row);
+            if (limits && limits->max_result_bytes > 0 && text_bytes > limits->max_result_bytes) {
+                result = QueryResult::fail("result too large: exceeds max_result_bytes (" +
+                                           std::to_string(limits->max_result_bytes) + ")");
+                done = true;
+                break;
+            }
+            result.rows.push_back(std::move(row));
+        }
+
+        // Release read locks and bound values once the statement is finished
+        if (done) {
+            sqlite3_reset(stmt_);
+            sqlite3_clear_bindings(stmt_);
+        }
+        return result;
+    }
+
+    int bind(int index, const Param& p) {
+        switch (p.type) {
+            case Param::Type::Null:    return sqlite3_bind_null(stmt_, index);
+            case Param::Type::Integer: return sqlite3_bind_int64(stmt_, index, p.i);
+            case Param::Type::Real:    return sqlite3_bind_double(stmt_, index, p.d);
+            case Param::Type::Text:
+                return sqlite3_bind_text(stmt_, index, p.s.data(), static_cast<int>(p.s.size()), SQLITE_TRANSIENT);
+            case Param::Type::Blob:
+                return sqlite3_bind_blob(stmt_, index, p.s.data(), static_cast<int>(p.s.size()), SQLITE_TRANSIENT);
+        }
+        return SQLITE_MISUSE;
+    }
+};
+
+/**
+ * Prepare handler for db. With a server, executions enforce its result
+ * limits as they were when the statement was prepared.
+ */
+inline Server::prepare_handler_t database_prepare_handler(xsql::Database& db, const Server* server = nullptr) {
+    return [&db, server](const std::string& sql, std::string& error) -> std::unique_ptr<PreparedStatement> {
+        sqlite3_stmt* stmt = nullptr;
+        const char* tail = nullptr;
+        int rc = sqlite3_prepare_v3(db.handle(), sql.c_str(), static_cast<int>(sql.size()),
+                                    SQLITE_PREPARE_PERSISTENT, &stmt, &tail);
+        if (rc != SQLITE_OK) {
+            error = sqlite3_errmsg(db.handle());
+            return nullptr;
+        }
+        if (!stmt) {
+            error = "empty statement";
+            return nullptr;
+        }
+        while (tail && *tail && std::isspace(static_cast<unsigned char>(*tail))) ++tail;
+        if (tail && *tail) {
+            sqlite3_finalize(stmt);
+            error = "only one statement can be prepared";
+            return nullptr;
+        }
+        xsql::QueryLimits limits = server ? query_limits(server->config()) : db.query_limits();
+        return std::make_unique<SqlitePreparedStatement>(db.handle(), stmt, limits);
+    };
+}
+
+//=============================================================================
+// Subscriptions
+//=============================================================================
+
+/**
+ * Live query over a Database: re-evaluated only when the data generation of
+ * a table it read has moved (see Database::query_watched).
+ */
+class DatabaseSubscription : public Subscription {
+    xsql::Database& db_;
+    std::string sql_;
+    std::vector<TableGeneration> deps_;
+    xsql::QueryLimits limits_;
+
+public:
+    DatabaseSubscription(xsql::Database& db, std::string sql, const xsql::QueryLimits& limits = {})
+        : db_(db), sql_(std::move(sql)), limits_(limits) {}
+
+    bool changed() override { return !db_.dependencies_current(deps_); }
+
+    QueryResult evaluate() override {
+        bool watchable = false;
+        auto result = db_.query_watched(sql_, deps_, watchable, limits_);
+        if (result.ok() && !watchable) {
+            return QueryResult::fail("query cannot be watched: it must be read-only, avoid time/random "
+                                     "functions, and read only tables with a data generation");
+        }
+        return to_query_result(result);
+    }
+};
+
+inline Server::subscribe_handler_t database_subscribe_handler(xsql::Database& db, const Server* server = nullptr) {
+    return [&db, server](const std::string& sql, std::string&) -> std::unique_ptr<Subscription> {
+        xsql::QueryLimits limits = server ? query_limits(server->config()) : db.query_limits();
+        return std::make_unique<DatabaseSubscription>(db, sql, limits);
+    };
+}
+
+/**
+ * Install the query, prepare and subscribe handlers and the cost classifier
+ * for db on server, enforcing the server's result limits. All clients share
+ * db's connection, so a transaction probe keeps one client's transaction
+ * from enclosing the others' statements (see Server).
+ */
+inline void serve_database(Server& server, xsql::Database& db) {
+    server.set_query_handler(database_query_handler(db, &server));
+    server.set_prepare_handler(database_prepare_handler(db, &server));
+    server.set_subscribe_handler(database_subscribe_handler(db, &server));
+    server.set_cost_classifier(database_cost_classifier(db));
+    server.set_transaction_probe([&db]() { return sqlite3_get_autocommit(db.handle()) == 0; });
+}
+
+}  // namespace xsql::socket
@@ -0,0 +1,623 @@
+/**
+ * @file fanout.hpp
+ * @brief Scatter-gather queries across several xsql socket servers
+ *
+ * FanoutClient sends the same SQL to every shard at once over non-blocking
+ * sockets and merges the responses as they arrive. Without merge options
+ * rows are concatenated in arrival order. With order_by, per-shard results
+ * (each already sorted by the shard) are k-way merged. With aggregates,
+ * per-shard partial aggregates are combined per group_by key.
+ *
+ * Usage:
+ *   xsql::socket::FanoutClient fanout;
+ *   fanout.add_shard("10.0.0.1", 13337);
+ *   fanout.add_shard("10.0.0.2", 13337);
+ *
+ *   xsql::socket::FanoutOptions opt;
+ *   opt.group_by = {"module"};
+ *   opt.aggregates = {{"n", xsql::socket::FanoutAggregate::Count},
+ *                     {"bytes", xsql::socket::FanoutAggregate::Sum}};
+ *   auto r = fanout.query("SELECT module, COUNT(*) AS n, SUM(size) AS bytes "
+ *                         "FROM funcs GROUP BY module", opt);
+ *   for (const auto& s : r.shards) printf("%s:%d %.1f ms\n", s.host.c_str(), s.port, s.latency_ms);
+ *
+ * Only SUM, COUNT, MIN and MAX combine correctly from partials; for AVG
+ * select SUM and COUNT and divide after merging.
+ */
+
+#pragma once
+
+#include "client.hpp"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <limits>
+#include <queue>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#ifdef _WIN32
+    #define XSQL_POLL WSAPoll
+#else
+    #include <poll.h>
+    #include <fcntl.h>
+    #define XSQL_POLL ::poll
+#endif
+
+namespace xsql::socket {
+
+//=============================================================================
+// Options and Results
+//=============================================================================
+
+enum class FanoutAggregate { Sum, Count, Min, Max };
+
+struct FanoutOrder {
+    std::string column;
+    bool descending = false;
+};
+
+struct FanoutAggregateColumn {
+    std::string column;
+    FanoutAggregate kind = FanoutAggregate::Sum;
+};
+
+struct FanoutOptions {
+    std::vector<FanoutOrder> order_by;                  // Shards must return rows in this order
+    std::vector<std::string> group_by;                  // Keys for combining aggregates
+    std::vector<FanoutAggregateColumn> aggregates;      // Partial aggregates to combine
+    size_t limit = 0;                                   // 0 = no limit, applied after merging
+    int timeout_ms = 30000;                             // Whole fan-out, including connect
+    bool allow_partial = false;                         // Merge successful shards if others fail
+};
+
+struct ShardResult {
+    std::string host;
+    int port = 0;
+    RemoteResult result;
+    double latency_ms = 0.0;    // Connect to last response byte
+};
+
+struct FanoutResult {
+    RemoteResult merged;
+    std::vector<ShardResult> shards;    // Same order as add_shard()
+    double total_ms = 0.0;
+};
+
+namespace detail {
+
+inline bool parse_int64_exact(const std::string& s, int64_t& out) {
+    if (s.empty()) return false;
+    char* end = nullptr;
+    errno = 0;
+    long long v = std::strtoll(s.c_str(), &end, 10);
+    if (errno != 0 || !end || *end != '\0') return false;
+    out = static_cast<int64_t>(v);
+    return true;
+}
+
+inline bool parse_double_exact(const std::string& s, double& out) {
+    if (s.empty()) return false;
+    char* end = nullptr;
+    out = std::strtod(s.c_str(), &end);
+    return end && *end == '\0';
+}
+
+/**
+ * Compare two wire values the way SQLite orders them: NULL (empty) first,
+ * then numbers numerically, then text bytewise.
+ */
+inline int compare_wire_values(const std::string& a, const std::string& b) {
+    if (a.empty() || b.empty()) return a.empty() ? (b.empty() ? 0 : -1) : 1;
+
+    int64_t ia = 0, ib = 0;
+    if (parse_int64_exact(a, ia) && parse_int64_exact(b, ib)) {
+        return ia < ib ? -1 : (ia > ib ? 1 : 0);
+    }
+    double da = 0, db = 0;
+    bool na = parse_double_exact(a, da);
+    bool nb = parse_double_exact(b, db);
+    if (na && nb) return da < db ? -1 : (da > db ? 1 : 0);
+    if (na != nb) return na ? -1 : 1;
+    int c = a.compare(b);
+    return c < 0 ? -1 : (c > 0 ? 1 : 0);
+}
+
+inline std::string format_double(double d) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.15g", d);
+    std::string s = buf;
+    if (s.find_first_of(".eEn") == std::string::npos) s += ".0";
+    return s;
+}
+
+/**
+ * Fold one partial aggregate value into an accumulated one.
+ */
+inline void combine_partial(std::string& acc, const std::string& v, FanoutAggregate kind) {
+    if (v.empty()) return;  // NULL partial contributes nothing
+    if (acc.empty()) {
+        acc = v;
+        return;
+    }
+    switch (kind) {
+        case FanoutAggregate::Sum:
+        case FanoutAggregate::Count: {
+            int64_t ia = 0, ib = 0;
+            if (parse_int64_exact(acc, ia) && parse_int64_exact(v, ib)) {
+                bool overflow = (ib > 0 && ia > (std::numeric_limits<int64_t>::max)() - ib) ||
+                                (ib < 0 && ia < (std::numeric_limits<int64_t>::min)() - ib);
+                if (!overflow) {
+                    acc = std::to_string(ia + ib);
+                    break;
+                }
+            }
+            double da = 0, db = 0;
+            parse_double_exact(acc, da);
+            parse_double_exact(v, db);
+            acc = format_double(da + db);
+            break;
+        }
+        case FanoutAggregate::Min:
+            if (compare_wire_values(v, acc) < 0) acc = v;
+            break;
+        case FanoutAggregate::Max:
+            if (compare_wire_values(v, acc) > 0) acc = v;
+            break;
+    }
+}
+
+}  // namespace detail
+
+//=============================================================================
+// Result Merger
+//=============================================================================
+
+/**
+ * Incrementally merges shard results. Usable on its own, e.g. for results
+ * collected by other means.
+ */
+class FanoutMerger {
+    FanoutOptions opt_;
+    bool have_columns_ = false;
+    std::string error_;
+    std::vector<std::string> columns_;
+
+    std::vector<std::pair<size_t, bool>> order_;        // Column index, descending
+    std::vector<size_t> group_cols_;
+    std::vector<std::pair<size_t, FanoutAggregate>> agg_cols_;
+
+    std::vector<std::vector<RemoteRow>> sorted_runs_;   // order_by without aggregates
+    std::vector<RemoteRow> rows_;                       // Concatenated rows or aggregate groups
+    std::map<std::vector<std::string>, size_t> groups_;
+
+public:
+    explicit FanoutMerger(FanoutOptions opt) : opt_(std::move(opt)) {}
+
+    bool aggregating() const { return !opt_.aggregates.empty(); }
+
+    /**
+     * Add one shard's successful result. Returns false on a schema mismatch.
+     */
+    bool add(RemoteResult&& r) {
+        if (!error_.empty()) return false;
+        if (!have_columns_ && !resolve_columns(r.columns)) return false;
+        if (r.columns != columns_) {
+            error_ = "shard returned different columns";
+            return false;
+        }
+
+        if (aggregating()) {
+            for (auto& row : r.rows) fold_group(std::move(row));
+        } else if (!order_.empty()) {
+            sorted_runs_.push_back(std::move(r.rows));
+        } else {
+            for (auto& row : r.rows) rows_.push_back(std::move(row));
+        }
+        return true;
+    }
+
+    const std::string& error() const { return error_; }
+
+    RemoteResult finish() {
+        RemoteResult out;
+        if (!error_.empty()) {
+            out.error = error_;
+            return out;
+        }
+        out.success = true;
+        out.columns = columns_;
+
+        if (!aggregating() && !order_.empty()) {
+            out.rows = merge_runs();
+        } else {
+            out.rows = std::move(rows_);
+            if (!order_.empty()) {
+                std::stable_sort(out.rows.begin(), out.rows.end(),
+                                 [this](const RemoteRow& a, const RemoteRow& b) { return less(a, b); });
+            }
+        }
+        if (opt_.limit > 0 && out.rows.size() > opt_.limit) out.rows.resize(opt_.limit);
+        return out;
+    }
+
+private:
+    bool resolve_columns(const std::vector<std::string>& cols) {
+        auto find = [&](const std::string& name, size_t& idx) {
+            for (size_t i = 0; i < cols.size(); ++i) {
+                if (cols[i] == name) { idx = i; return true; }
+            }
+            error_ = "merge column not in result: " + name;
+            return false;
+        };
+
+        size_t idx = 0;
+        for (const auto& o : opt_.order_by) {
+            if (!find(o.column, idx)) return false;
+            order_.emplace_back(idx, o.descending);
+        }
+        for (const auto& g : opt_.group_by) {
+            if (!find(g, idx)) return false;
+            group_cols_.push_back(idx);
+        }
+        for (const auto& a : opt_.aggregates) {
+            if (!find(a.column, idx)) return false;
+            agg_cols_.emplace_back(idx, a.kind);
+        }
+        columns_ = cols;
+        have_columns_ = true;
+        return true;
+    }
+
+    bool less(const RemoteRow& a, const RemoteRow& b) const {
+        for (const auto& [col, desc] : order_) {
+            int c = detail::compare_wire_values(a.values[col], b.values[col]);
+            if (c != 0) return desc ? c > 0 : c < 0;
+        }
+        return false;
+    }
+
+    void fold_group(RemoteRow&& row) {
+        if (row.values.size() != columns_.size()) return;
+        std::vector<std::string> key;
+        key.reserve(group_cols_.size());
+        for (size_t c : group_cols_) key.push_back(row.values[c]);
+
+        auto it = groups_.find(key);
+        if (it == groups_.end()) {
+            groups_.emplace(std::move(key), rows_.size());
+            rows_.push_back(std::move(row));
+            return;
+        }
+        RemoteRow& acc = rows_[it->second];
+        for (const auto& [col, kind] : agg_cols_) {
+            detail::combine_partial(acc.values[col], row.values[col], kind);
+        }
+    }
+
+    // K-way merge of per-shard runs that are each sorted by order_by
+    std::vector<RemoteRow> merge_runs() {
+        struct Head { size_t run; size_t pos; };
+        auto cmp = [this](const Head& a, const Head& b) {
+            const auto& ra = sorted_runs_[a.run][a.pos];
+            const auto& rb = sorted_runs_[b.run][b.pos];
+            if (less(rb, ra)) return true;
+            if (less(ra, rb)) return false;
+            return a.run > b.run;  // Stable across shards
+        };
+        std::priority_queue<Head, std::vector<Head>, decltype(cmp)> heap(cmp);
+
+        size_t total = 0;
+        for (size_t i = 0; i < sorted_runs_.size(); ++i) {
+            total += sorted_runs_[i].size();
+            if (!sorted_runs_[i].empty()) heap.push(Head{i, 0});
+        }
+        size_t want = opt_.limit > 0 ? std::min(total, opt_.limit) : total;
+
+        std::vector<RemoteRow> out;
+        out.reserve(want);
+        while (!heap.empty() && out.size() < want) {
+            Head h = heap.top();
+            heap.pop();
+            out.push_back(std::move(sorted_runs_[h.run][h.pos]));
+            if (++h.pos < sorted_runs_[h.run].size()) heap.push(h);
+        }
+        return out;
+    }
+};
+
+//=============================================================================
+// Fan-out Client
+//=============================================================================
+
+class FanoutClient {
+public:
+    using shard_callback_t = std::function<void(const ShardResult&)>;
+
+private:
+    struct Endpoint {
+        std::string host;
+        int port = 0;
+        std::string token;
+    };
+
+    std::vector<Endpoint> shards_;
+    size_t max_message_bytes_ = 10 * 1024 * 1024;
+    shard_callback_t on_shard_;
+    bool wsa_init_ = false;
+
+public:
+    FanoutClient() {
+#ifdef _WIN32
+        WSADATA wsa;
+        wsa_init_ = (WSAStartup(MAKEWORD(2, 2), &wsa) == 0);
+#endif
+    }
+
+    ~FanoutClient() {
+#ifdef _WIN32
+        if (wsa_init_) WSACleanup();
+#endif
+    }
+
+    FanoutClient(const FanoutClient&) = delete;
+    FanoutClient& operator=(const FanoutClient&) = delete;
+
+    void add_shard(const std::string& host, int port, const std::string& token = "") {
+        shards_.push_back(Endpoint{host, port, token});
+    }
+
+    size_t shard_count() const { return shards_.size(); }
+    void set_max_message_bytes(size_t bytes) { max_message_bytes_ = bytes; }
+
+    /// Called once per shard as soon as its response (or failure) is known
+    void set_shard_callback(shard_callback_t fn) { on_shard_ = std::move(fn); }
+
+    /**
+     * Send sql to all shards concurrently and merge the results.
+     */
+    FanoutResult query(const std::string& sql, const FanoutOptions& options = {}) {
+        using clock = std::chrono::steady_clock;
+        auto started = clock::now();
+        auto deadline = started + std::chrono::milliseconds(options.timeout_ms);
+
+        FanoutResult out;
+        out.shards.resize(shards_.size());
+        std::vector<Conn> conns(shards_.size());
+
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            out.shards[i].host = shards_[i].host;
+            out.shards[i].port = shards_[i].port;
+            conns[i].request = frame(make_query_request(sql, shards_[i].token));
+            conns[i].started = clock::now();
+            if (!start_connect(shards_[i], conns[i])) {
+                finish(out.shards[i], conns[i], "connect() failed");
+            }
+        }
+
+        FanoutMerger merger(options);
+        size_t merged_count = 0;
+        auto deliver = [&](size_t i) {
+            auto& shard = out.shards[i];
+            shard.latency_ms = ms_since(conns[i].started);
+            if (on_shard_) on_shard_(shard);
+            if (shard.result.success) {
+                // Merge a copy so callers still see each shard's own rows
+                RemoteResult copy = shard.result;
+                if (merger.add(std::move(copy))) merged_count++;
+            }
+        };
+        for (size_t i = 0; i < conns.size(); ++i) {
+            if (conns[i].phase == Phase::Done) deliver(i);
+        }
+
+        std::vector<pollfd> fds;
+        std::vector<size_t> owners;
+        while (true) {
+            fds.clear();
+            owners.clear();
+            for (size_t i = 0; i < conns.size(); ++i) {
+                const Conn& c = conns[i];
+                if (c.phase == Phase::Done) continue;
+                pollfd p{};
+                p.fd = c.sock;
+                p.events = (c.phase == Phase::Receiving) ? POLLIN : POLLOUT;
+                fds.push_back(p);
+                owners.push_back(i);
+            }
+            if (fds.empty()) break;
+
+            auto now = clock::now();
+            if (now >= deadline) {
+                for (size_t i : owners) {
+                    finish(out.shards[i], conns[i], "timeout");
+                    deliver(i);
+                }
+                break;
+            }
+            int wait_ms = static_cast<int>(
+                std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count()) + 1;
+
+            int n = XSQL_POLL(fds.data(), static_cast<decltype(fds.size())>(fds.size()), wait_ms);
+            if (n < 0) {
+#ifndef _WIN32
+                if (errno == EINTR) continue;
+#endif
+                for (size_t i : owners) {
+                    finish(out.shards[i], conns[i], "poll() failed");
+                    deliver(i);
+                }
+                break;
+            }
+
+            for (size_t k = 0; k < fds.size(); ++k) {
+                if (fds[k].revents == 0) continue;
+                size_t i = owners[k];
+                if (step(conns[i], fds[k].revents, out.shards[i])) deliver(i);
+            }
+        }
+
+        out.total_ms = ms_since(started);
+
+        size_t failed = 0;
+        std::string first_error;
+        for (const auto& s : out.shards) {
+            if (!s.result.success) {
+                if (failed++ == 0) {
+                    first_error = s.host + ":" + std::to_string(s.port) + ": " + s.result.error;
+                }
+            }
+        }
+
+        if (!merger.error().empty()) {
+            out.merged.error = merger.error();
+        } else if (shards_.empty()) {
+            out.merged.error = "no shards";
+        } else if (failed > 0 && (!options.allow_partial || merged_count == 0)) {
+            out.merged.error = first_error;
+        } else {
+            out.merged = merger.finish();
+        }
+        return out;
+    }
+
+private:
+    enum class Phase { Connecting, Sending, Receiving, Done };
+
+    struct Conn {
+        socket_t sock = SOCKET_INVALID;
+        Phase phase = Phase::Done;
+        std::string request;
+        size_t sent = 0;
+        std::string response;
+        uint32_t expected = 0;
+        bool have_length = false;
+        std::chrono::steady_clock::time_point started;
+    };
+
+    static double ms_since(std::chrono::steady_clock::time_point t) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t).count();
+    }
+
+    static std::string frame(const std::string& payload) {
+        uint32_t len_net = htonl(static_cast<uint32_t>(payload.size()));
+        std::string out(reinterpret_cast<const char*>(&len_net), sizeof(len_net));
+        out += payload;
+        return out;
+    }
+
+    static bool set_nonblocking(socket_t s) {
+#ifdef _WIN32
+        u_long mode = 1;
+        return ioctlsocket(s, FIONBIO, &mode) == 0;
+#else
+        int flags = fcntl(s, F_GETFL, 0);
+        return flags >= 0 && fcntl(s, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+    }
+
+    static bool in_progress() {
+#ifdef _WIN32
+        return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+        return errno == EINPROGRESS || errno == EWOULDBLOCK || errno == EAGAIN;
+#endif
+    }
+
+    static bool start_connect(const Endpoint& ep, Conn& c) {
+        struct addrinfo hints{}, *res = nullptr;
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        std::string port_str = std::to_string(ep.port);
+        if (getaddrinfo(ep.host.c_str(), port_str.c_str(), &hints, &res) != 0 || !res) return false;
+
+        c.sock = ::socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+        if (c.sock == SOCKET_INVALID || !set_nonblocking(c.sock)) {
+            freeaddrinfo(res);
+            return false;
+        }
+
+        int rc = ::connect(c.sock, res->ai_addr, static_cast<int>(res->ai_addrlen));
+        freeaddrinfo(res);
+        if (rc < 0 && !in_progress()) return false;
+        c.phase = (rc == 0) ? Phase::Sending : Phase::Connecting;
+        return true;
+    }
+
+    static void finish(ShardResult& shard, Conn& c, const std::string& error) {
+        if (c.sock != SOCKET_INVALID) {
+            CLOSE_SOCKET(c.sock);
+            c.sock = SOCKET_INVALID;
+        }
+        c.phase = Phase::Done;
+        if (!error.empty()) {
+            shard.result = RemoteResult();
+            shard.result.error = error;
+        }
+    }
+
+    // Advance one connection; returns true once it is done
+    bool step(Conn& c, short revents, ShardResult& shard) {
+        if (c.phase == Phase::Connecting) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            getsockopt(c.sock, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&err), &len);
+            if (err != 0 || (revents & (POLLERR | POLLHUP))) {
+                finish(shard, c, "connect() failed");
+                return true;
+            }
+            c.phase = Phase::Sending;
+        }
+
+        if (c.phase == Phase::Sending) {
+            while (c.sent < c.request.size()) {
+                int n = send(c.sock, c.request.data() + c.sent,
+                             static_cast<int>(c.request.size() - c.sent), XSQL_SEND_FLAGS);
+                if (n < 0 && in_progress()) return false;
+                if (n <= 0) {
+                    finish(shard, c, "send failed");
+                    return true;
+                }
+                c.sent += static_cast<size_t>(n);
+            }
+            c.phase = Phase::Receiving;
+            return false;
+        }
+
+        // Receiving
+        char buf[16384];
+        while (true) {
+            int n = recv(c.sock, buf, static_cast<int>(sizeof(buf)), 0);
+            if (n < 0 && in_progress()) return false;
+            if (n <= 0) {
+                finish(shard, c, "recv failed");
+                return true;
+            }
+            c.response.append(buf, static_cast<size_t>(n));
+
+            if (!c.have_length && c.response.size() >= sizeof(uint32_t)) {
+                uint32_t len_net = 0;
+                memcpy(&len_net, c.response.data(), sizeof(len_net));
+                c.expected = ntohl(len_net);
+                c.have_length = true;
+                if (static_cast<size_t>(c.expected) > max_message_bytes_) {
+                    finish(shard, c, "response too large");
+                    return true;
+                }
+            }
+            if (c.have_length && c.response.size() >= sizeof(uint32_t) + c.expected) {
+                shard.result = parse_response(c.response.substr(sizeof(uint32_t), c.expected));
+                finish(shard, c, "");
+                return true;
+            }
+        }
+    }
+};
+
+}  // namespace xsql::socket
@@ -8,6 +8,32 @@
  * Request:  {"sql": "SELECT ..."}
  * Response: {"success": true, "columns": [...], "rows": [[...], ...], "row_count": N}
  *           {"success": false, "error": "message"}
+ *
+ * Batch:    {"type": "batch", "statements": ["...", ...], "transaction": true}
+ * Response: {"success": true, "results": [<response>, ...]}
+ *
+ * Prepared statements (per connection):
+ *   {"type": "prepare", "sql": "SELECT ... WHERE a = ?"}
+ *     -> {"success": true, "statement": 1, "param_count": 1}
+ *   {"type": "execute", "statement": 1, "params": [42, 1.5, "text", null, {"blob": "00ff"}]}
+ *     -> <response>
+ *   {"type": "close", "statement": 1} -> {"success": true}
+ *
+ * Cursors (per connection, pull-based paging of one query):
+ *   {"type": "cursor_open", "sql": "SELECT ...", "params": [...], "fetch": 1000}
+ *     -> {"success": true, "columns": [...], "rows": [...], "cursor": 1, "done": false}
+ *   {"type": "cursor_fetch", "cursor": 1, "fetch": 1000} -> next page, same shape
+ *   {"type": "cursor_close", "cursor": 1} -> {"success": true}
+ *   A cursor closes itself once a page reports "done": true.
+ *
+ * Subscriptions (per connection, server pushes row diffs when data changes):
+ *   {"type": "subscribe", "sql": "SELECT ..."}
+ *     -> {"success": true, "columns": [...], "rows": [...], "subscription": 1}
+ *   push: {"type": "push", "subscription": 1, "success": true, "columns": [...],
+ *          "rows": [<added>], "removed": [<removed>]}
+ *   {"type": "unsubscribe", "subscription": 1} -> {"success": true}
+ *   Pushes arrive between responses; a failed re-evaluation pushes
+ *   "success": false and ends the subscription.
  */
 
 #pragma once
@@ -17,6 +43,23 @@
 #include <sstream>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <cmath>
+
+#ifndef _WIN32
+    #include <sys/socket.h>
+#endif
+
+// Writes to a peer that has gone away must fail, not raise SIGPIPE.
+// Every sender in this module passes these flags to send().
+#ifndef XSQL_SEND_FLAGS
+    #ifdef MSG_NOSIGNAL
+        #define XSQL_SEND_FLAGS MSG_NOSIGNAL
+    #else
+        #define XSQL_SEND_FLAGS 0
+    #endif
+#endif
 
 namespace xsql::socket {
 
@@ -244,6 +287,20 @@ public:
         return pos_ > start;
     }
 
+    // Parse a number and return its source text
+    bool parse_number(std::string& text) {
+        skip_ws();
+        size_t start = pos_;
+        if (!parse_number()) return false;
+        text = s_.substr(start, pos_ - start);
+        return true;
+    }
+
+    bool peek(char c) {
+        skip_ws();
+        return pos_ < s_.size() && s_[pos_] == c;
+    }
+
     bool skip_value() {
         skip_ws();
         if (pos_ >= s_.size()) return false;
@@ -302,6 +359,20 @@ private:
     }
 };
 
+inline bool parse_string_array(JsonReader& r, std::vector<std::string>& out) {
+    if (!r.begin_array()) return false;
+    r.skip_ws();
+    if (r.consume(']')) return true;
+    while (true) {
+        std::string v;
+        if (!r.parse_string(v)) return false;
+        out.push_back(std::move(v));
+        r.skip_ws();
+        if (r.consume(']')) return true;
+        if (!r.expect(',')) return false;
+    }
+}
+
 inline bool extract_top_level_string_field(const std::string& json, const char* field, std::string& out) {
     out.clear();
     if (!field || !*field) return false;
@@ -400,6 +471,51 @@ inline std::string result_to_json(const QueryResult& result) {
     return json.str();
 }
 
+struct BatchResult {
+    bool success = false;
+    std::string error;
+    std::vector<QueryResult> results;   // One per executed statement
+};
+
+inline std::string batch_result_to_json(const BatchResult& batch) {
+    std::string json = "{\"success\":";
+    json += batch.success ? "true" : "false";
+    if (!batch.error.empty()) {
+        json += ",\"error\":\"" + json_escape(batch.error) + "\"";
+    }
+    json += ",\"results\":[";
+    for (size_t i = 0; i < batch.results.size(); ++i) {
+        if (i > 0) json += ",";
+        json += result_to_json(batch.results[i]);
+    }
+    json += "]}";
+    return json;
+}
+
+/**
+ * Push message for a subscription. added carries the columns and the new
+ * rows (or the error that ended the subscription).
+ */
+inline std::string delta_to_json(uint64_t subscription, const QueryResult& added,
+                                 const std::vector<std::vector<std::string>>& removed) {
+    std::string json = "{\"type\":\"push\",\"subscription\":" + std::to_string(subscription) + ",";
+    json += result_to_json(added).substr(1);
+    if (!added.success) return json;
+    json.pop_back();
+    json += ",\"removed\":[";
+    for (size_t r = 0; r < removed.size(); ++r) {
+        if (r > 0) json += ",";
+        json += "[";
+        for (size_t c = 0; c < removed[r].size(); ++c) {
+            if (c > 0) json += ",";
+            json += "\"" + json_escape(removed[r][c]) + "\"";
+        }
+        json += "]";
+    }
+    json += "]}";
+    return json;
+}
+
 inline std::string extract_string_field(const std::string& json, const char* field) {
     if (!field || !*field) return "";
     std::string value;
@@ -415,6 +531,347 @@ inline std::string extract_token_from_request(const std::string& json) {
     return extract_string_field(json, "token");
 }
 
+//=============================================================================
+// Statement Parameters
+//=============================================================================
+
+struct Param {
+    enum class Type { Null, Integer, Real, Text, Blob };
+
+    Type type = Type::Null;
+    int64_t i = 0;
+    double d = 0.0;
+    std::string s;      // Text, or raw bytes for Blob
+
+    static Param null() { return Param(); }
+
+    static Param integer(int64_t v) {
+        Param p;
+        p.type = Type::Integer;
+        p.i = v;
+        return p;
+    }
+
+    static Param real(double v) {
+        Param p;
+        p.type = Type::Real;
+        p.d = v;
+        return p;
+    }
+
+    static Param text(std::string v) {
+        Param p;
+        p.type = Type::Text;
+        p.s = std::move(v);
+        return p;
+    }
+
+    static Param blob(std::string bytes) {
+        Param p;
+        p.type = Type::Blob;
+        p.s = std::move(bytes);
+        return p;
+    }
+};
+
+/**
+ * JSON form of a parameter: null, integer, real (always with '.' or 'e'),
+ * string, or {"blob":"<hex>"}. Non-finite reals have no JSON form and are
+ * sent as null.
+ */
+inline std::string param_to_json(const Param& p) {
+    switch (p.type) {
+        case Param::Type::Null:
+            return "null";
+        case Param::Type::Integer:
+            return std::to_string(p.i);
+        case Param::Type::Real: {
+            if (!std::isfinite(p.d)) return "null";
+            char buf[32];
+            snprintf(buf, sizeof(buf), "%.17g", p.d);
+            std::string out = buf;
+            if (out.find_first_of(".eE") == std::string::npos) out += ".0";
+            return out;
+        }
+        case Param::Type::Text:
+            return "\"" + json_escape(p.s) + "\"";
+        case Param::Type::Blob: {
+            static const char* hex = "0123456789abcdef";
+            std::string out = "{\"blob\":\"";
+            for (unsigned char c : p.s) {
+                out.push_back(hex[c >> 4]);
+                out.push_back(hex[c & 0x0F]);
+            }
+            out += "\"}";
+            return out;
+        }
+    }
+    return "null";
+}
+
+namespace detail {
+
+inline bool parse_param(JsonReader& r, Param& out) {
+    out = Param();
+    if (r.peek('"')) {
+        out.type = Param::Type::Text;
+        return r.parse_string(out.s);
+    }
+    if (r.peek('n')) return r.parse_null();
+    if (r.peek('t') || r.peek('f')) {
+        bool b = false;
+        if (!r.parse_bool(b)) return false;
+        out = Param::integer(b ? 1 : 0);
+        return true;
+    }
+    if (r.peek('{')) {
+        std::string key, hex;
+        if (!r.begin_object() || !r.parse_string(key) || key != "blob" ||
+            !r.expect(':') || !r.parse_string(hex) || !r.consume('}')) {
+            return false;
+        }
+        if (hex.size() % 2 != 0) return false;
+        out.type = Param::Type::Blob;
+        out.s.reserve(hex.size() / 2);
+        for (size_t i = 0; i < hex.size(); i += 2) {
+            if (!is_hex(hex[i]) || !is_hex(hex[i + 1])) return false;
+            out.s.push_back(static_cast<char>((hex_value(hex[i]) << 4) | hex_value(hex[i + 1])));
+        }
+        return true;
+    }
+
+    std::string num;
+    if (!r.parse_number(num)) return false;
+    if (num.find_first_of(".eE") == std::string::npos) {
+        errno = 0;
+        char* end = nullptr;
+        long long v = std::strtoll(num.c_str(), &end, 10);
+        if (errno == 0 && end && *end == '\0') {
+            out = Param::integer(static_cast<int64_t>(v));
+            return true;
+        }
+    }
+    out = Param::real(std::strtod(num.c_str(), nullptr));
+    return true;
+}
+
+inline bool parse_param_array(JsonReader& r, std::vector<Param>& out) {
+    if (!r.begin_array()) return false;
+    r.skip_ws();
+    if (r.consume(']')) return true;
+    while (true) {
+        Param p;
+        if (!parse_param(r, p)) return false;
+        out.push_back(std::move(p));
+        r.skip_ws();
+        if (r.consume(']')) return true;
+        if (!r.expect(',')) return false;
+    }
+}
+
+inline bool parse_uint64(JsonReader& r, uint64_t& out) {
+    std::string num;
+    if (!r.parse_number(num) || num.empty() || num[0] == '-' ||
+        num.find_first_of(".eE") != std::string::npos) {
+        return false;
+    }
+    errno = 0;
+    char* end = nullptr;
+    unsigned long long v = std::strtoull(num.c_str(), &end, 10);
+    if (errno != 0 || !end || *end != '\0') return false;
+    out = static_cast<uint64_t>(v);
+    return true;
+}
+
+}  // namespace detail
+
+//=============================================================================
+// Request Parsing (for server-side dispatch)
+//=============================================================================
+
+struct Request {
+    std::string type = "query";             // "query", "batch", "prepare", "execute", "close",
+                                            // "cursor_open", "cursor_fetch", "cursor_close",
+                                            // "subscribe", "unsubscribe"
+    std::string sql;
+    std::string token;
+    std::vector<std::string> statements;    // batch
+    bool transaction = false;               // batch: run inside BEGIN/COMMIT
+    uint64_t statement = 0;                 // execute/close: prepared statement id
+    std::vector<Param> params;              // execute, cursor_open
+    uint64_t cursor = 0;                    // cursor_fetch/cursor_close
+    uint64_t fetch = 0;                     // cursor_open/cursor_fetch: rows per page (0 = default)
+    uint64_t subscription = 0;              // unsubscribe
+};
+
+/**
+ * Parse a request object. Unknown keys are ignored so newer clients can add
+ * fields without breaking older servers.
+ */
+inline bool parse_request(const std::string& json, Request& out) {
+    out = Request();
+    detail::JsonReader r(json);
+    if (!r.begin_object()) return false;
+
+    r.skip_ws();
+    if (r.consume('}')) return r.at_end();
+
+    while (true) {
+        std::string key;
+        if (!r.parse_string(key) || !r.expect(':')) return false;
+
+        bool ok = true;
+        if (key == "type") {
+            ok = r.parse_string(out.type);
+        } else if (key == "sql") {
+            ok = r.parse_string(out.sql);
+        } else if (key == "token") {
+            ok = r.parse_string(out.token);
+        } else if (key == "statements") {
+            ok = detail::parse_string_array(r, out.statements);
+        } else if (key == "transaction") {
+            ok = r.parse_bool(out.transaction);
+        } else if (key == "statement") {
+            ok = detail::parse_uint64(r, out.statement);
+        } else if (key == "params") {
+            ok = detail::parse_param_array(r, out.params);
+        } else if (key == "cursor") {
+            ok = detail::parse_uint64(r, out.cursor);
+        } else if (key == "fetch") {
+            ok = detail::parse_uint64(r, out.fetch);
+        } else if (key == "subscription") {
+            ok = detail::parse_uint64(r, out.subscription);
+        } else {
+            ok = r.skip_value();
+        }
+        if (!ok) return false;
+
+        r.skip_ws();
+        if (r.consume('}')) break;
+        if (!r.expect(',')) return false;
+    }
+    return r.at_end();
+}
+
+//=============================================================================
+// Request Serialization
+//=============================================================================
+
+inline std::string make_query_request(const std::string& sql, const std::string& token = "") {
+    std::string request = "{\"sql\":\"";
+    request += json_escape(sql);
+    request += "\"";
+    if (!token.empty()) {
+        request += ",\"token\":\"";
+        request += json_escape(token);
+        request += "\"";
+    }
+    request += "}";
+    return request;
+}
+
+inline std::string make_batch_request(const std::vector<std::string>& statements, bool transaction,
+                                      const std::string& token = "") {
+    std::string request = "{\"type\":\"batch\",\"statements\":[";
+    for (size_t i = 0; i < statements.size(); ++i) {
+        if (i > 0) request += ",";
+        request += "\"" + json_escape(statements[i]) + "\"";
+    }
+    request += "],\"transaction\":";
+    request += transaction ? "true" : "false";
+    if (!token.empty()) {
+        request += ",\"token\":\"" + json_escape(token) + "\"";
+    }
+    request += "}";
+    return request;
+}
+
+inline std::string make_prepare_request(const std::string& sql, const std::string& token = "") {
+    std::string request = "{\"type\":\"prepare\",\"sql\":\"" + json_escape(sql) + "\"";
+    if (!token.empty()) request += ",\"token\":\"" + json_escape(token) + "\"";
+    request += "}";
+    return request;
+}
+
+inline std::string make_execute_request(uint64_t statement, const std::vector<Param>& params,
+                                        const std::string& token = "") {
+    std::string request = "{\"type\":\"execute\",\"statement\":" + std::to_string(statement) +
+                          ",\"params\":[";
+    for (size_t i = 0; i < params.size(); ++i) {
+        if (i > 0) request += ",";
+        request += param_to_json(params[i]);
+    }
+    request += "]";
+    if (!token.empty()) request += ",\"token\":\"" + json_escape(token) + "\"";
+    request += "}";
+    return request;
+}
+
+inline std::string make_close_request(uint64_t statement, const std::string& token = "") {
+    std::string request = "{\"type\":\"close\",\"statement\":" + std::to_string(statement);
+    if (!token.empty()) request += ",\"token\":\"" + json_escape(token) + "\"";
+    request += "}";
+    return request;
+}
+
+inline std::string make_cursor_open_request(const std::string& sql, const std::vector<Param>& params,
+                                            size_t fetch, const std::string& token = "") {
+    std::string request = "{\"type\":\"cursor_open\",\"sql\":\"" + json_escape(sql) + "\",\"params\":[";
+    for (size_t i = 0; i < params.size(); ++i) {
+        if (i > 0) request += ",";
+        request += param_to_json(params[i]);
+    }
+    request += "],\"fetch\":" + std::to_string(fetch);
+    if (!token.empty()) request += ",\"token\":\"" + json_escape(token) + "\"";
+    request += "}";
+    return request;
+}
+
+inline std::string make_cursor_fetch_request(uint64_t cursor, size_t fetch, const std::string& token = "") {
+    std::string request = "{\"type\":\"cursor_fetch\",\"cursor\":" + std::to_string(cursor) +
+                          ",\"fetch\":" + std::to_string(fetch);
+    if (!token.empty()) request += ",\"token\":\"" + json_escape(token) + "\"";
+    request += "}";
+    return request;
+}
+
+inline std::string make_subscribe_request(const std::string& sql, const std::string& token = "") {
+    std::string request = "{\"type\":\"subscribe\",\"sql\":\"" + json_escape(sql) + "\"";
+    if (!token.empty()) request += ",\"token\":\"" + json_escape(token) + "\"";
+    request += "}";
+    return request;
+}
+
+inline std::string make_unsubscribe_request(uint64_t subscription, const std::string& token = "") {
+    std::string request = "{\"type\":\"unsubscribe\",\"subscription\":" + std::to_string(subscription);
+    if (!token.empty()) request += ",\"token\":\"" + json_escape(token) + "\"";
+    request += "}";
+    return request;
+}
+
+inline std::string make_cursor_close_request(uint64_t cursor, const std::string& token = "") {
+    std::string request = "{\"type\":\"cursor_close\",\"cursor\":" + std::to_string(cursor);
+    if (!token.empty()) request += ",\"token\":\"" + json_escape(token) + "\"";
+    request += "}";
+    return request;
+}
+
+/// Serialize a parsed request again, e.g. with a different token
+inline std::string make_request(const Request& req, const std::string& token = "") {
+    if (req.type == "batch") return make_batch_request(req.statements, req.transaction, token);
+    if (req.type == "prepare") return make_prepare_request(req.sql, token);
+    if (req.type == "execute") return make_execute_request(req.statement, req.params, token);
+    if (req.type == "close") return make_close_request(req.statement, token);
+    if (req.type == "cursor_open") {
+        return make_cursor_open_request(req.sql, req.params, static_cast<size_t>(req.fetch), token);
+    }
+    if (req.type == "cursor_fetch") return make_cursor_fetch_request(req.cursor, static_cast<size_t>(req.fetch), token);
+    if (req.type == "cursor_close") return make_cursor_close_request(req.cursor, token);
+    if (req.type == "subscribe") return make_subscribe_request(req.sql, token);
+    if (req.type == "unsubscribe") return make_unsubscribe_request(req.subscription, token);
+    return make_query_request(req.sql, token);
+}
+
 //=============================================================================
 // Remote Result (for client-side parsing)
 //=============================================================================
@@ -436,6 +893,31 @@ struct RemoteResult {
     bool empty() const { return rows.empty(); }
 };
 
+struct RemoteBatchResult {
+    bool success = false;
+    std::string error;
+    std::vector<RemoteResult> results;
+};
+
+struct RemotePrepared {
+    bool success = false;
+    std::string error;
+    uint64_t statement = 0;     // Id for execute/close, valid for this connection
+    int param_count = 0;
+};
+
+struct RemoteCursorPage : RemoteResult {
+    uint64_t cursor = 0;        // Id for cursor_fetch/cursor_close
+    bool done = true;           // Server already closed the cursor
+};
+
+// Subscription snapshot or push: rows holds the added rows, removed the
+// rows that left the result (compare whole rows; order is not meaningful)
+struct RemoteDelta : RemoteResult {
+    uint64_t subscription = 0;
+    std::vector<RemoteRow> removed;
+};
+
 #if 0
 inline RemoteResult parse_response(const std::string& json) {
     RemoteResult result;
@@ -492,150 +974,223 @@ inline RemoteResult parse_response(const std::string& json) {
 }
 #endif
 
-inline RemoteResult parse_response(const std::string& json) {
-    RemoteResult result;
+namespace detail {
 
-    detail::JsonReader r(json);
-    if (!r.begin_object()) {
-        result.success = false;
-        result.error = "Invalid JSON response";
-        return result;
-    }
+struct SkipExtraKeys {
+    bool operator()(const std::string&, JsonReader& r) const { return r.skip_value(); }
+};
 
-    bool have_success = false;
+/**
+ * Parse one result object ({"success":...,"columns":...,"rows":...}) at the
+ * reader position. Other keys go to extra(key, reader), which must consume
+ * the value; by default they are skipped.
+ */
+template <typename Extra = SkipExtraKeys>
+inline bool parse_result_object(JsonReader& r, RemoteResult& result, bool& have_success,
+                                Extra extra = Extra()) {
+    if (!r.begin_object()) return false;
 
     r.skip_ws();
-    if (r.consume('}')) {
-        result.success = false;
-        result.error = "Invalid JSON response";
-        return result;
-    }
+    if (r.consume('}')) return true;
 
     while (true) {
         std::string key;
-        if (!r.parse_string(key) || !r.expect(':')) {
-            result.success = false;
-            result.error = "Invalid JSON response";
-            return result;
-        }
+        if (!r.parse_string(key) || !r.expect(':')) return false;
 
         if (key == "success") {
-            if (!r.parse_bool(result.success)) {
-                result.success = false;
-                result.error = "Invalid JSON response";
-                return result;
-            }
+            if (!r.parse_bool(result.success)) return false;
             have_success = true;
         } else if (key == "error") {
-            if (!r.parse_string(result.error)) {
-                result.success = false;
-                result.error = "Invalid JSON response";
-                return result;
-            }
+            if (!r.parse_string(result.error)) return false;
         } else if (key == "columns") {
-            if (!r.begin_array()) {
-                result.success = false;
-                result.error = "Invalid JSON response";
-                return result;
-            }
-
-            r.skip_ws();
-            if (!r.consume(']')) {
-                while (true) {
-                    std::string col;
-                    if (!r.parse_string(col)) {
-                        result.success = false;
-                        result.error = "Invalid JSON response";
-                        return result;
-                    }
-                    result.columns.push_back(std::move(col));
-
-                    r.skip_ws();
-                    if (r.consume(']')) break;
-                    if (!r.expect(',')) {
-                        result.success = false;
-                        result.error = "Invalid JSON response";
-                        return result;
-                    }
-                }
-            }
+            if (!parse_string_array(r, result.columns)) return false;
         } else if (key == "rows") {
-            if (!r.begin_array()) {
-                result.success = false;
-                result.error = "Invalid JSON response";
-                return result;
-            }
-
+            if (!r.begin_array()) return false;
             r.skip_ws();
             if (!r.consume(']')) {
                 while (true) {
-                    if (!r.begin_array()) {
-                        result.success = false;
-                        result.error = "Invalid JSON response";
-                        return result;
-                    }
-
                     RemoteRow row;
-                    r.skip_ws();
-                    if (!r.consume(']')) {
-                        while (true) {
-                            std::string v;
-                            if (!r.parse_string(v)) {
-                                result.success = false;
-                                result.error = "Invalid JSON response";
-                                return result;
-                            }
-                            row.values.push_back(std::move(v));
-
-                            r.skip_ws();
-                            if (r.consume(']')) break;
-                            if (!r.expect(',')) {
-                                result.success = false;
-                                result.error = "Invalid JSON response";
-                                return result;
-                            }
-                        }
-                    }
-
+                    if (!parse_string_array(r, row.values)) return false;
                     result.rows.push_back(std::move(row));
-
                     r.skip_ws();
                     if (r.consume(']')) break;
-                    if (!r.expect(',')) {
-                        result.success = false;
-                        result.error = "Invalid JSON response";
-                        return result;
-                    }
+                    if (!r.expect(',')) return false;
                 }
             }
         } else {
-            if (!r.skip_value()) {
-                result.success = false;
-                result.error = "Invalid JSON response";
-                return result;
-            }
+            if (!extra(key, r)) return false;
         }
 
         r.skip_ws();
-        if (r.consume('}')) break;
-        if (!r.expect(',')) {
-            result.success = false;
-            result.error = "Invalid JSON response";
-            return result;
-        }
+        if (r.consume('}')) return true;
+        if (!r.expect(',')) return false;
     }
+}
 
-    if (!have_success || !r.at_end()) {
+inline bool finish_result(RemoteResult& result, bool ok, bool have_success) {
+    if (!ok || !have_success) {
         result.success = false;
-        if (result.error.empty()) result.error = "Invalid JSON response";
-        return result;
+        if (!ok || result.error.empty()) result.error = "Invalid JSON response";
+        return false;
     }
-
     if (!result.success && result.error.empty()) {
         result.error = "Unknown error";
     }
+    return true;
+}
+
+}  // namespace detail
 
+inline RemoteResult parse_response(const std::string& json) {
+    RemoteResult result;
+    detail::JsonReader r(json);
+    bool have_success = false;
+    bool ok = detail::parse_result_object(r, result, have_success) && r.at_end();
+    detail::finish_result(result, ok, have_success);
     return result;
 }
 
+inline RemoteBatchResult parse_batch_response(const std::string& json) {
+    RemoteBatchResult batch;
+    auto invalid = [&batch]() {
+        batch.success = false;
+        batch.error = "Invalid JSON response";
+        return batch;
+    };
+
+    detail::JsonReader r(json);
+    if (!r.begin_object()) return invalid();
+
+    bool have_success = false;
+    r.skip_ws();
+    if (!r.consume('}')) {
+        while (true) {
+            std::string key;
+            if (!r.parse_string(key) || !r.expect(':')) return invalid();
+
+            if (key == "success") {
+                if (!r.parse_bool(batch.success)) return invalid();
+                have_success = true;
+            } else if (key == "error") {
+                if (!r.parse_string(batch.error)) return invalid();
+            } else if (key == "results") {
+                if (!r.begin_array()) return invalid();
+                r.skip_ws();
+                if (!r.consume(']')) {
+                    while (true) {
+                        RemoteResult item;
+                        bool item_success = false;
+                        if (!detail::parse_result_object(r, item, item_success)) return invalid();
+                        detail::finish_result(item, true, item_success);
+                        batch.results.push_back(std::move(item));
+                        r.skip_ws();
+                        if (r.consume(']')) break;
+                        if (!r.expect(',')) return invalid();
+                    }
+                }
+            } else if (!r.skip_value()) {
+                return invalid();
+            }
+
+            r.skip_ws();
+            if (r.consume('}')) break;
+            if (!r.expect(',')) return invalid();
+        }
+    }
+
+    if (!have_success || !r.at_end()) return invalid();
+    if (!batch.success && batch.error.empty()) batch.error = "Unknown error";
+    return batch;
+}
+
+inline RemoteCursorPage parse_cursor_response(const std::string& json) {
+    RemoteCursorPage page;
+    detail::JsonReader r(json);
+    bool have_success = false;
+    auto extra = [&page](const std::string& key, detail::JsonReader& reader) {
+        if (key == "cursor") return detail::parse_uint64(reader, page.cursor);
+        if (key == "done") return reader.parse_bool(page.done);
+        return reader.skip_value();
+    };
+    bool ok = detail::parse_result_object(r, page, have_success, extra) && r.at_end();
+    if (!detail::finish_result(page, ok, have_success) || !page.success) page.done = true;
+    return page;
+}
+
+// Pushes are the only messages with a leading "type" key
+inline bool is_push_message(const std::string& json) {
+    static const char prefix[] = "{\"type\":\"push\"";
+    return json.compare(0, sizeof(prefix) - 1, prefix) == 0;
+}
+
+inline RemoteDelta parse_delta(const std::string& json) {
+    RemoteDelta delta;
+    detail::JsonReader r(json);
+    bool have_success = false;
+    auto extra = [&delta](const std::string& key, detail::JsonReader& reader) {
+        if (key == "subscription") return detail::parse_uint64(reader, delta.subscription);
+        if (key != "removed") return reader.skip_value();
+        if (!reader.begin_array()) return false;
+        reader.skip_ws();
+        if (reader.consume(']')) return true;
+        while (true) {
+            RemoteRow row;
+            if (!detail::parse_string_array(reader, row.values)) return false;
+            delta.removed.push_back(std::move(row));
+            reader.skip_ws();
+            if (reader.consume(']')) return true;
+            if (!reader.expect(',')) return false;
+        }
+    };
+    bool ok = detail::parse_result_object(r, delta, have_success, extra) && r.at_end();
+    detail::finish_result(delta, ok, have_success);
+    return delta;
+}
+
+inline RemotePrepared parse_prepare_response(const std::string& json) {
+    RemotePrepared out;
+    auto invalid = [&out]() {
+        out = RemotePrepared();
+        out.error = "Invalid JSON response";
+        return out;
+    };
+
+    detail::JsonReader r(json);
+    if (!r.begin_object()) return invalid();
+
+    bool have_success = false;
+    r.skip_ws();
+    if (!r.consume('}')) {
+        while (true) {
+            std::string key;
+            if (!r.parse_string(key) || !r.expect(':')) return invalid();
+
+            bool ok = true;
+            if (key == "success") {
+                ok = r.parse_bool(out.success);
+                have_success = ok;
+            } else if (key == "error") {
+                ok = r.parse_string(out.error);
+            } else if (key == "statement") {
+                ok = detail::parse_uint64(r, out.statement);
+            } else if (key == "param_count") {
+                uint64_t n = 0;
+                ok = detail::parse_uint64(r, n);
+                out.param_count = static_cast<int>(n);
+            } else {
+                ok = r.skip_value();
+            }
+            if (!ok) return invalid();
+
+            r.skip_ws();
+            if (r.consume('}')) break;
+            if (!r.expect(',')) return invalid();
+        }
+    }
+
+    if (!have_success || !r.at_end()) return invalid();
+    if (!out.success && out.error.empty()) out.error = "Unknown error";
+    return out;
+}
+
 }  // namespace xsql::socket
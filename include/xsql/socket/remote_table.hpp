@@ -0,0 +1,623 @@
+/**
+ * @file remote_table.hpp
+ * @brief Virtual table backed by a table on another xsql socket server
+ *
+ * Lets a local database join against data served by a remote
+ * xsql::socket::Server. The planner pushes WHERE constraints, ORDER BY,
+ * LIMIT/OFFSET and the set of referenced columns into the SELECT that is
+ * sent to the remote side, so only matching rows and needed columns cross
+ * the wire.
+ *
+ * Usage:
+ *   xsql::socket::register_remote_table_module(db.handle());
+ *   db.exec("CREATE VIRTUAL TABLE remote_funcs USING "
+ *           "remote_table('127.0.0.1', 13337, 'funcs')");
+ *   db.query("SELECT l.name, r.size FROM local l JOIN remote_funcs r ON r.addr = l.addr");
+ *
+ * Module arguments: host, port, remote table name and an optional auth token.
+ * The local schema is taken from PRAGMA table_info on the remote table.
+ * Each table keeps one connection open while it exists (it counts against
+ * the server's max_connections) and reconnects once if the server dropped it.
+ *
+ * Scans stream through a server-side cursor, fetch_rows rows per round trip,
+ * so a result larger than the server's max_message_bytes still arrives and
+ * only one page per scan is held locally. Each open scan uses one of the
+ * server's max_cursors, and a scan left idle past its cursor_idle_timeout_ms
+ * fails. Servers without cursor support return the whole result at once.
+ *
+ * Values travel as text, so NULL arrives as NULL only in columns whose
+ * declared type has INTEGER, REAL or NUMERIC affinity; TEXT columns receive
+ * an empty string. The table is read-only.
+ */
+
+#pragma once
+
+#include "client.hpp"
+
+#include <sqlite3.h>
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <cmath>
+#include <cerrno>
+#include <cctype>
+
+namespace xsql::socket {
+
+//=============================================================================
+// Column Metadata
+//=============================================================================
+
+enum class RemoteAffinity { Text, Integer, Real, Numeric, Blob };
+
+struct RemoteColumn {
+    std::string name;
+    std::string type;
+    RemoteAffinity affinity = RemoteAffinity::Blob;
+};
+
+namespace detail {
+
+// SQLite's column affinity rules (https://sqlite.org/datatype3.html 3.1)
+inline RemoteAffinity affinity_of(const std::string& declared_type) {
+    std::string t;
+    t.reserve(declared_type.size());
+    for (char c : declared_type) t.push_back(static_cast<char>(std::toupper(static_cast<unsigned char>(c))));
+    if (t.find("INT") != std::string::npos) return RemoteAffinity::Integer;
+    if (t.find("CHAR") != std::string::npos || t.find("CLOB") != std::string::npos ||
+        t.find("TEXT") != std::string::npos) return RemoteAffinity::Text;
+    if (t.empty() || t.find("BLOB") != std::string::npos) return RemoteAffinity::Blob;
+    if (t.find("REAL") != std::string::npos || t.find("FLOA") != std::string::npos ||
+        t.find("DOUB") != std::string::npos) return RemoteAffinity::Real;
+    return RemoteAffinity::Numeric;
+}
+
+inline std::string quote_identifier(const std::string& name) {
+    std::string out = "\"";
+    for (char c : name) {
+        if (c == '"') out.push_back('"');
+        out.push_back(c);
+    }
+    out.push_back('"');
+    return out;
+}
+
+// Strip surrounding whitespace and one level of SQL quoting from a module argument
+inline std::string unquote_module_arg(const char* arg) {
+    std::string s = arg ? arg : "";
+    size_t b = 0, e = s.size();
+    while (b < e && std::isspace(static_cast<unsigned char>(s[b]))) ++b;
+    while (e > b && std::isspace(static_cast<unsigned char>(s[e - 1]))) --e;
+    s = s.substr(b, e - b);
+    if (s.size() >= 2) {
+        char q = s.front();
+        char close = (q == '[') ? ']' : q;
+        if ((q == '\'' || q == '"' || q == '`' || q == '[') && s.back() == close) {
+            std::string out;
+            for (size_t i = 1; i + 1 < s.size(); ++i) {
+                out.push_back(s[i]);
+                if (s[i] == close && close != ']' && i + 2 < s.size() && s[i + 1] == close) ++i;
+            }
+            return out;
+        }
+    }
+    return s;
+}
+
+// Render a bound value as an SQL literal for the remote statement
+inline std::string sql_literal(sqlite3_value* v) {
+    switch (sqlite3_value_type(v)) {
+        case SQLITE_INTEGER:
+            return std::to_string(sqlite3_value_int64(v));
+        case SQLITE_FLOAT: {
+            double d = sqlite3_value_double(v);
+            if (std::isnan(d)) return "NULL";
+            if (std::isinf(d)) return d > 0 ? "9e999" : "-9e999";
+            char buf[40];
+            sqlite3_snprintf(sizeof(buf), buf, "%!.17g", d);
+            return buf;
+        }
+        case SQLITE_TEXT: {
+            char* q = sqlite3_mprintf("%Q", reinterpret_cast<const char*>(sqlite3_value_text(v)));
+            std::string out = q ? q : "NULL";
+            sqlite3_free(q);
+            return out;
+        }
+        case SQLITE_BLOB: {
+            static const char* hex = "0123456789ABCDEF";
+            const auto* p = static_cast<const unsigned char*>(sqlite3_value_blob(v));
+            int n = sqlite3_value_bytes(v);
+            std::string out = "X'";
+            out.reserve(static_cast<size_t>(n) * 2 + 3);
+            for (int i = 0; i < n; ++i) {
+                out.push_back(hex[p[i] >> 4]);
+                out.push_back(hex[p[i] & 0x0F]);
+            }
+            out.push_back('\'');
+            return out;
+        }
+        default:
+            return "NULL";
+    }
+}
+
+// Replace each unquoted '?' in a planned statement with the next argument literal
+inline std::string bind_literals(const char* planned, int argc, sqlite3_value** argv) {
+    std::string out;
+    int next = 0;
+    char quote = 0;
+    for (const char* p = planned; *p; ++p) {
+        char c = *p;
+        if (quote) {
+            if (c == quote) quote = 0;
+            out.push_back(c);
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+            out.push_back(c);
+        } else if (c == '?') {
+            out += next < argc ? sql_literal(argv[next]) : std::string("NULL");
+            ++next;
+        } else {
+            out.push_back(c);
+        }
+    }
+    return out;
+}
+
+inline const char* remote_operator(unsigned char op) {
+    switch (op) {
+        case SQLITE_INDEX_CONSTRAINT_EQ:        return "=";
+        case SQLITE_INDEX_CONSTRAINT_GT:        return ">";
+        case SQLITE_INDEX_CONSTRAINT_LE:        return "<=";
+        case SQLITE_INDEX_CONSTRAINT_LT:        return "<";
+        case SQLITE_INDEX_CONSTRAINT_GE:        return ">=";
+        case SQLITE_INDEX_CONSTRAINT_NE:        return "<>";
+        case SQLITE_INDEX_CONSTRAINT_IS:        return "IS";
+        case SQLITE_INDEX_CONSTRAINT_ISNOT:     return "IS NOT";
+        case SQLITE_INDEX_CONSTRAINT_ISNULL:    return "IS NULL";
+        case SQLITE_INDEX_CONSTRAINT_ISNOTNULL: return "IS NOT NULL";
+        case SQLITE_INDEX_CONSTRAINT_LIKE:      return "LIKE";
+        case SQLITE_INDEX_CONSTRAINT_GLOB:      return "GLOB";
+        default:                                return nullptr;
+    }
+}
+
+// Convert a wire value back to a typed result according to column affinity
+inline void result_remote_value(sqlite3_context* ctx, const std::string& s, RemoteAffinity affinity) {
+    if (affinity == RemoteAffinity::Text || affinity == RemoteAffinity::Blob) {
+        sqlite3_result_text(ctx, s.data(), static_cast<int>(s.size()), SQLITE_TRANSIENT);
+        return;
+    }
+    if (s.empty()) {
+        sqlite3_result_null(ctx);
+        return;
+    }
+
+    const char* begin = s.c_str();
+    char* end = nullptr;
+    if (affinity != RemoteAffinity::Real) {
+        errno = 0;
+        long long i = std::strtoll(begin, &end, 10);
+        if (errno == 0 && end && *end == '\0') {
+            sqlite3_result_int64(ctx, static_cast<sqlite3_int64>(i));
+            return;
+        }
+    }
+    double d = std::strtod(begin, &end);
+    if (end && *end == '\0') {
+        sqlite3_result_double(ctx, d);
+        return;
+    }
+    sqlite3_result_text(ctx, s.data(), static_cast<int>(s.size()), SQLITE_TRANSIENT);
+}
+
+}  // namespace detail
+
+//=============================================================================
+// Virtual Table Implementation
+//=============================================================================
+
+struct RemoteVtab {
+    sqlite3_vtab base;
+    std::string host;
+    int port = 0;
+    std::string remote_table;
+    std::string token;
+    std::vector<RemoteColumn> columns;
+    Client client;          // Kept open across statements; the server serves connections concurrently
+    size_t fetch_rows = 1000;   // Rows per cursor page
+    bool cursors = true;        // Cleared if the server has no cursor support
+
+    bool ensure_connected() {
+        if (client.is_connected()) return true;
+        if (!client.connect(host, port)) return false;
+        client.set_auth_token(token);
+        return true;
+    }
+
+    // Issue a request, reconnecting once if the server dropped the idle
+    // connection (the client closes it on any transport failure)
+    template <typename Call>
+    auto with_reconnect(Call call) -> decltype(call()) {
+        decltype(call()) r;
+        if (!ensure_connected()) {
+            r.error = client.error();
+            return r;
+        }
+        r = call();
+        if (!r.success && !client.is_connected() && ensure_connected()) r = call();
+        return r;
+    }
+
+    RemoteResult run(const std::string& sql) {
+        return with_reconnect([&]() { return client.query(sql); });
+    }
+
+    // First page of sql; the whole result (done) when cursors are unsupported
+    RemoteCursorPage open(const std::string& sql) {
+        if (cursors) {
+            RemoteCursorPage page = with_reconnect([&]() { return client.open_cursor(sql, {}, fetch_rows); });
+            if (page.success || page.error != "Cursors not supported") return page;
+            cursors = false;
+        }
+        RemoteCursorPage page;
+        static_cast<RemoteResult&>(page) = run(sql);
+        page.done = true;
+        return page;
+    }
+};
+
+struct RemoteCursor {
+    sqlite3_vtab_cursor base;
+    RemoteCursorPage page;      // Rows of the current page
+    size_t idx = 0;             // Position in page.rows
+    sqlite3_int64 rowid = 0;    // Rows passed in this scan
+    bool remote_open = false;   // page.cursor still holds rows on the server
+};
+
+inline void remote_set_error(sqlite3_vtab* vtab, const std::string& msg) {
+    sqlite3_free(vtab->zErrMsg);
+    vtab->zErrMsg = sqlite3_mprintf("%s", msg.c_str());
+}
+
+// xCreate/xConnect: argv[3..] = host, port, remote table [, token]
+inline int remote_connect(sqlite3* db, void*, int argc, const char* const* argv,
+                          sqlite3_vtab** ppVtab, char** pzErr) {
+    if (argc < 6 || argc > 7) {
+        *pzErr = sqlite3_mprintf("remote_table: expected (host, port, table [, token])");
+        return SQLITE_ERROR;
+    }
+
+    auto vtab = std::make_unique<RemoteVtab>();
+    memset(&vtab->base, 0, sizeof(vtab->base));
+    vtab->host = detail::unquote_module_arg(argv[3]);
+    vtab->port = std::atoi(detail::unquote_module_arg(argv[4]).c_str());
+    vtab->remote_table = detail::unquote_module_arg(argv[5]);
+    if (argc == 7) vtab->token = detail::unquote_module_arg(argv[6]);
+
+    if (vtab->host.empty() || vtab->port <= 0 || vtab->port > 65535 || vtab->remote_table.empty()) {
+        *pzErr = sqlite3_mprintf("remote_table: invalid host, port or table");
+        return SQLITE_ERROR;
+    }
+
+    // Schema from the remote table; fall back to bare column names if PRAGMA is refused
+    std::string quoted = detail::quote_identifier(vtab->remote_table);
+    RemoteResult info = vtab->run("PRAGMA table_info(" + quoted + ")");
+    if (info.success && !info.rows.empty() && info.column_count() >= 3) {
+        for (const auto& row : info.rows) {
+            RemoteColumn col;
+            col.name = row.values[1];
+            col.type = row.values[2];
+            col.affinity = detail::affinity_of(col.type);
+            vtab->columns.push_back(std::move(col));
+        }
+    } else {
+        RemoteResult probe = vtab->run("SELECT * FROM " + quoted + " LIMIT 0");
+        if (!probe.success || probe.columns.empty()) {
+            std::string err = !probe.error.empty() ? probe.error : "no columns";
+            *pzErr = sqlite3_mprintf("remote_table: %s:%d %s: %s", vtab->host.c_str(),
+                                     vtab->port, vtab->remote_table.c_str(), err.c_str());
+            return SQLITE_ERROR;
+        }
+        for (const auto& name : probe.columns) {
+            RemoteColumn col;
+            col.name = name;
+            vtab->columns.push_back(std::move(col));
+        }
+    }
+    std::string schema = "CREATE TABLE x(";
+    for (size_t i = 0; i < vtab->columns.size(); ++i) {
+        if (i > 0) schema += ", ";
+        schema += detail::quote_identifier(vtab->columns[i].name);
+        if (!vtab->columns[i].type.empty()) schema += " " + vtab->columns[i].type;
+    }
+    schema += ")";
+
+    int rc = sqlite3_declare_vtab(db, schema.c_str());
+    if (rc != SQLITE_OK) {
+        *pzErr = sqlite3_mprintf("remote_table: %s", sqlite3_errmsg(db));
+        return rc;
+    }
+
+    *ppVtab = &vtab.release()->base;
+    return SQLITE_OK;
+}
+
+inline int remote_disconnect(sqlite3_vtab* pVtab) {
+    delete reinterpret_cast<RemoteVtab*>(pVtab);
+    return SQLITE_OK;
+}
+
+/**
+ * xBestIndex - plan the remote statement.
+ *
+ * The SELECT sent to the server is built here and handed to xFilter via
+ * idxStr, with '?' standing for constraint values passed in argv. Columns the
+ * query does not reference are selected as NULL. LIMIT/OFFSET are pushed only
+ * when every other term is evaluated remotely, so the remote row count equals
+ * the local one.
+ */
+inline int remote_best_index(sqlite3_vtab* pVtab, sqlite3_index_info* pInfo) {
+    auto* vtab = reinterpret_cast<RemoteVtab*>(pVtab);
+    const auto& cols = vtab->columns;
+
+    std::string where;
+    int argv_index = 0;
+    bool all_pushed = true;
+    double rows = 1000000.0;
+    int limit_idx = -1;
+    int offset_idx = -1;
+
+    for (int i = 0; i < pInfo->nConstraint; ++i) {
+        const auto& c = pInfo->aConstraint[i];
+        if (c.op == SQLITE_INDEX_CONSTRAINT_LIMIT) { if (c.usable) limit_idx = i; continue; }
+        if (c.op == SQLITE_INDEX_CONSTRAINT_OFFSET) { if (c.usable) offset_idx = i; continue; }
+
+        const char* op = detail::remote_operator(c.op);
+        if (!c.usable || !op || c.iColumn < 0 || static_cast<size_t>(c.iColumn) >= cols.size()) {
+            all_pushed = false;
+            continue;
+        }
+
+        // Only collations every server has; others are checked locally
+        std::string collate;
+        const char* coll = sqlite3_vtab_collation(pInfo, i);
+        if (coll && sqlite3_stricmp(coll, "BINARY") != 0) {
+            if (sqlite3_stricmp(coll, "NOCASE") != 0 && sqlite3_stricmp(coll, "RTRIM") != 0) {
+                all_pushed = false;
+                continue;
+            }
+            collate = std::string(" COLLATE ") + coll;
+        }
+
+        where += where.empty() ? " WHERE " : " AND ";
+        where += detail::quote_identifier(cols[c.iColumn].name);
+        where += collate;
+        where += " ";
+        where += op;
+        if (c.op != SQLITE_INDEX_CONSTRAINT_ISNULL && c.op != SQLITE_INDEX_CONSTRAINT_ISNOTNULL) {
+            where += " ?";
+            pInfo->aConstraintUsage[i].argvIndex = ++argv_index;
+        }
+        pInfo->aConstraintUsage[i].omit = 1;
+
+        switch (c.op) {
+            case SQLITE_INDEX_CONSTRAINT_EQ:
+            case SQLITE_INDEX_CONSTRAINT_IS:   rows /= 100.0; break;
+            case SQLITE_INDEX_CONSTRAINT_LIKE:
+            case SQLITE_INDEX_CONSTRAINT_GLOB: rows /= 10.0; break;
+            default:                           rows /= 4.0; break;
+        }
+    }
+
+    std::string order_by;
+    bool order_consumed = pInfo->nOrderBy > 0;
+    for (int i = 0; i < pInfo->nOrderBy; ++i) {
+        const auto& o = pInfo->aOrderBy[i];
+        if (o.iColumn < 0 || static_cast<size_t>(o.iColumn) >= cols.size()) {
+            order_consumed = false;
+            break;
+        }
+        order_by += order_by.empty() ? " ORDER BY " : ", ";
+        order_by += detail::quote_identifier(cols[o.iColumn].name) + " COLLATE BINARY";
+        if (o.desc) order_by += " DESC";
+    }
+    if (!order_consumed) order_by.clear();
+
+    std::string limit;
+    if (all_pushed && (pInfo->nOrderBy == 0 || order_consumed) && limit_idx >= 0) {
+        limit = " LIMIT ?";
+        pInfo->aConstraintUsage[limit_idx].argvIndex = ++argv_index;
+        pInfo->aConstraintUsage[limit_idx].omit = 1;
+
+        sqlite3_value* v = nullptr;
+        if (sqlite3_vtab_rhs_value(pInfo, limit_idx, &v) == SQLITE_OK && v) {
+            double n = static_cast<double>(sqlite3_value_int64(v));
+            if (n >= 0 && n < rows) rows = n;
+        }
+        if (offset_idx >= 0) {
+            limit += " OFFSET ?";
+            pInfo->aConstraintUsage[offset_idx].argvIndex = ++argv_index;
+            pInfo->aConstraintUsage[offset_idx].omit = 1;
+        }
+    }
+
+    std::string select;
+    for (size_t i = 0; i < cols.size(); ++i) {
+        if (i > 0) select += ", ";
+        bool used = i >= 63 ? (pInfo->colUsed & (sqlite3_uint64(1) << 63)) != 0
+                            : (pInfo->colUsed & (sqlite3_uint64(1) << i)) != 0;
+        select += used ? detail::quote_identifier(cols[i].name) : std::string("NULL");
+    }
+    if (cols.empty()) select = "NULL";
+
+    std::string sql = "SELECT " + select + " FROM " + detail::quote_identifier(vtab->remote_table) +
+                      where + order_by + limit;
+
+    pInfo->idxStr = sqlite3_mprintf("%s", sql.c_str());
+    pInfo->needToFreeIdxStr = 1;
+    pInfo->orderByConsumed = order_consumed ? 1 : 0;
+    // One round trip dominates small results; more rows cost transfer time
+    pInfo->estimatedCost = 1000.0 + rows;
+    pInfo->estimatedRows = static_cast<sqlite3_int64>(rows < 1.0 ? 1.0 : rows);
+    return SQLITE_OK;
+}
+
+inline int remote_open(sqlite3_vtab*, sqlite3_vtab_cursor** ppCursor) {
+    auto* cursor = new RemoteCursor();
+    memset(&cursor->base, 0, sizeof(cursor->base));
+    *ppCursor = &cursor->base;
+    return SQLITE_OK;
+}
+
+namespace detail {
+
+// Release the server's cursor of a scan that stopped early
+inline void remote_abandon(RemoteCursor* cursor, RemoteVtab* vtab) {
+    if (cursor->remote_open && vtab->client.is_connected()) vtab->client.close_cursor(cursor->page.cursor);
+    cursor->remote_open = false;
+}
+
+// Fetch pages until one has a row at idx or the server has no more
+inline int remote_fill(RemoteCursor* cursor, RemoteVtab* vtab) {
+    while (cursor->idx >= cursor->page.rows.size() && cursor->remote_open) {
+        uint64_t id = cursor->page.cursor;
+        cursor->page = vtab->client.fetch(id, vtab->fetch_rows);
+        cursor->idx = 0;
+        if (!cursor->page.success) {
+            cursor->remote_open = false;
+            remote_set_error(&vtab->base, "remote_table: " + cursor->page.error);
+            cursor->page = RemoteCursorPage();
+            return SQLITE_ERROR;
+        }
+        cursor->remote_open = !cursor->page.done;
+    }
+    return SQLITE_OK;
+}
+
+}  // namespace detail
+
+inline int remote_close(sqlite3_vtab_cursor* pCursor) {
+    auto* cursor = reinterpret_cast<RemoteCursor*>(pCursor);
+    detail::remote_abandon(cursor, reinterpret_cast<RemoteVtab*>(pCursor->pVtab));
+    delete cursor;
+    return SQLITE_OK;
+}
+
+inline int remote_filter(sqlite3_vtab_cursor* pCursor, int, const char* idxStr,
+                         int argc, sqlite3_value** argv) {
+    auto* cursor = reinterpret_cast<RemoteCursor*>(pCursor);
+    auto* vtab = reinterpret_cast<RemoteVtab*>(pCursor->pVtab);
+
+    detail::remote_abandon(cursor, vtab);
+    cursor->page = RemoteCursorPage();
+    cursor->idx = 0;
+    cursor->rowid = 0;
+    if (!idxStr) return SQLITE_ERROR;
+
+    cursor->page = vtab->open(detail::bind_literals(idxStr, argc, argv));
+    if (!cursor->page.success) {
+        remote_set_error(pCursor->pVtab, "remote_table: " + cursor->page.error);
+        cursor->page = RemoteCursorPage();
+        return SQLITE_ERROR;
+    }
+    cursor->remote_open = !cursor->page.done;
+    return detail::remote_fill(cursor, vtab);
+}
+
+inline int remote_next(sqlite3_vtab_cursor* pCursor) {
+    auto* cursor = reinterpret_cast<RemoteCursor*>(pCursor);
+    cursor->idx++;
+    cursor->rowid++;
+    return detail::remote_fill(cursor, reinterpret_cast<RemoteVtab*>(pCursor->pVtab));
+}
+
+inline int remote_eof(sqlite3_vtab_cursor* pCursor) {
+    auto* cursor = reinterpret_cast<RemoteCursor*>(pCursor);
+    return cursor->idx >= cursor->page.rows.size() ? 1 : 0;
+}
+
+inline int remote_column(sqlite3_vtab_cursor* pCursor, sqlite3_context* ctx, int col) {
+    auto* cursor = reinterpret_cast<RemoteCursor*>(pCursor);
+    auto* vtab = reinterpret_cast<RemoteVtab*>(pCursor->pVtab);
+    if (cursor->idx >= cursor->page.rows.size() || col < 0 ||
+        static_cast<size_t>(col) >= vtab->columns.size()) {
+        sqlite3_result_null(ctx);
+        return SQLITE_OK;
+    }
+    const auto& row = cursor->page.rows[cursor->idx];
+    if (static_cast<size_t>(col) >= row.size()) {
+        sqlite3_result_null(ctx);
+        return SQLITE_OK;
+    }
+    detail::result_remote_value(ctx, row[col], vtab->columns[col].affinity);
+    return SQLITE_OK;
+}
+
+inline int remote_rowid(sqlite3_vtab_cursor* pCursor, sqlite3_int64* pRowid) {
+    *pRowid = reinterpret_cast<RemoteCursor*>(pCursor)->rowid;
+    return SQLITE_OK;
+}
+
+inline sqlite3_module& get_remote_module() {
+    static sqlite3_module mod = [] {
+        sqlite3_module m = {};
+        m.iVersion = 0;
+        m.xCreate = remote_connect;
+        m.xConnect = remote_connect;
+        m.xBestIndex = remote_best_index;
+        m.xDisconnect = remote_disconnect;
+        m.xDestroy = remote_disconnect;
+        m.xOpen = remote_open;
+        m.xClose = remote_close;
+        m.xFilter = remote_filter;
+        m.xNext = remote_next;
+        m.xEof = remote_eof;
+        m.xColumn = remote_column;
+        m.xRowid = remote_rowid;
+        return m;
+    }();
+    return mod;
+}
+
+//=============================================================================
+// Registration
+//=============================================================================
+
+inline bool register_remote_table_module(sqlite3* db, const char* module_name = "remote_table") {
+    if (!db || !module_name) return false;
+    return sqlite3_create_module_v2(db, module_name, &get_remote_module(), nullptr, nullptr) == SQLITE_OK;
+}
+
+/**
+ * Create a local virtual table mirroring `remote_table` on host:port.
+ * Registers the module if needed. Returns false (with the reason in *error)
+ * if the remote table cannot be described.
+ */
+inline bool create_remote_table(sqlite3* db, const std::string& table_name,
+                                const std::string& host, int port,
+                                const std::string& remote_table,
+                                const std::string& token = "",
+                                std::string* error = nullptr) {
+    if (!register_remote_table_module(db)) return false;
+
+    char* sql = token.empty()
+        ? sqlite3_mprintf("CREATE VIRTUAL TABLE \"%w\" USING remote_table(%Q, %d, %Q)",
+                          table_name.c_str(), host.c_str(), port, remote_table.c_str())
+        : sqlite3_mprintf("CREATE VIRTUAL TABLE \"%w\" USING remote_table(%Q, %d, %Q, %Q)",
+                          table_name.c_str(), host.c_str(), port, remote_table.c_str(), token.c_str());
+    char* err = nullptr;
+    int rc = sqlite3_exec(db, sql, nullptr, nullptr, &err);
+    sqlite3_free(sql);
+    if (err) {
+        if (error) *error = err;
+        sqlite3_free(err);
+    }
+    return rc == SQLITE_OK;
+}
+
+}  // namespace xsql::socket
@@ -0,0 +1,194 @@
+/**
+ * @file replay.hpp
+ * @brief Replay a captured or synthetic workload against a server
+ *
+ * Each captured connection is replayed in order on its own client
+ * connection, so prepared statement and cursor ids line up with the
+ * capture. Connections are spread over `concurrency` worker threads.
+ *
+ * Pacing: with rate_qps the i-th request is due at i / rate_qps seconds;
+ * otherwise with speed > 0 it is due at its captured offset / speed;
+ * otherwise requests go out as fast as responses come back. When paced,
+ * latency is measured from the due time rather than the send time, so a
+ * server that falls behind shows up in the percentiles instead of silently
+ * lowering the offered load.
+ *
+ * Usage:
+ *   xsql::socket::ReplayOptions opt;
+ *   opt.concurrency = 8;
+ *   opt.rate_qps = 500;
+ *   auto report = xsql::socket::replay_workload("127.0.0.1", 13337, log, opt);
+ *   printf("%.0f req/s, p99 %.2f ms\n", report.throughput(), report.p99_ms);
+ */
+
+#pragma once
+
+#include "client.hpp"
+#include "workload.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace xsql::socket {
+
+struct ReplayOptions {
+    size_t concurrency = 4;     // Worker threads
+    double rate_qps = 0;        // Fixed arrival rate across all workers (0 = off)
+    double speed = 0;           // Multiplier on captured timing when rate_qps is 0 (0 = unpaced)
+    std::string token;          // Sent with every request
+};
+
+struct ReplayReport {
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+    std::string first_error;
+    double elapsed_s = 0;
+    double p50_ms = 0;
+    double p90_ms = 0;
+    double p99_ms = 0;
+    double max_ms = 0;
+
+    double throughput() const { return elapsed_s > 0 ? requests / elapsed_s : 0; }
+};
+
+namespace detail {
+
+// Send one captured request through the matching typed client call
+inline RemoteResult replay_request(Client& client, const std::string& payload) {
+    Request req;
+    if (!parse_request(payload, req)) {
+        RemoteResult r;
+        r.error = "unparseable request in workload";
+        return r;
+    }
+    if (req.type == "batch") {
+        RemoteBatchResult b = client.query_batch(req.statements, req.transaction);
+        RemoteResult r;
+        r.success = b.success;
+        r.error = b.error;
+        return r;
+    }
+    if (req.type == "prepare") {
+        RemotePrepared p = client.prepare(req.sql);
+        RemoteResult r;
+        r.success = p.success;
+        r.error = p.error;
+        return r;
+    }
+    if (req.type == "execute") return client.execute(req.statement, req.params);
+    if (req.type == "cursor_open") return client.open_cursor(req.sql, req.params, static_cast<size_t>(req.fetch));
+    if (req.type == "cursor_fetch") return client.fetch(req.cursor, static_cast<size_t>(req.fetch));
+    if (req.type == "subscribe") return client.subscribe(req.sql);
+
+    RemoteResult r;
+    if (req.type == "close" || req.type == "cursor_close" || req.type == "unsubscribe") {
+        bool ok = req.type == "close" ? client.close_statement(req.statement)
+                  : req.type == "cursor_close" ? client.close_cursor(req.cursor)
+                                               : client.unsubscribe(req.subscription);
+        r.success = ok;
+        if (!ok) r.error = client.error();
+        return r;
+    }
+    return client.query(req.sql);
+}
+
+inline double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t i = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[(std::min)(i, sorted.size() - 1)];
+}
+
+}  // namespace detail
+
+inline ReplayReport replay_workload(const std::string& host, int port,
+                                    const std::vector<CapturedRequest>& workload,
+                                    const ReplayOptions& options = ReplayOptions()) {
+    using clock = std::chrono::steady_clock;
+    size_t workers = (std::max)(options.concurrency, size_t(1));
+
+    // Request indexes per worker, keeping each captured connection on one worker
+    std::map<uint64_t, size_t> worker_of;
+    std::vector<std::vector<size_t>> assigned(workers);
+    for (size_t i = 0; i < workload.size(); ++i) {
+        auto it = worker_of.find(workload[i].connection);
+        if (it == worker_of.end()) it = worker_of.emplace(workload[i].connection, worker_of.size() % workers).first;
+        assigned[it->second].push_back(i);
+    }
+
+    auto due_offset = [&](size_t i) -> std::chrono::microseconds {
+        if (options.rate_qps > 0) return std::chrono::microseconds(static_cast<int64_t>(i * 1e6 / options.rate_qps));
+        if (options.speed > 0) {
+            return std::chrono::microseconds(static_cast<int64_t>(workload[i].offset_us / options.speed));
+        }
+        return std::chrono::microseconds(-1);
+    };
+
+    ReplayReport report;
+    std::mutex mutex;
+    std::vector<double> latencies;
+    latencies.reserve(workload.size());
+
+    auto start = clock::now();
+    std::vector<std::thread> threads;
+    for (size_t w = 0; w < workers; ++w) {
+        if (assigned[w].empty()) continue;
+        threads.emplace_back([&, w] {
+            std::map<uint64_t, std::unique_ptr<Client>> clients;
+            std::vector<double> local;
+            uint64_t errors = 0;
+            std::string first_error;
+
+            for (size_t i : assigned[w]) {
+                const CapturedRequest& cap = workload[i];
+                auto due = due_offset(i);
+                auto sent = clock::now();
+                if (due.count() >= 0) {
+                    std::this_thread::sleep_until(start + due);
+                    sent = start + due;
+                }
+
+                auto& client = clients[cap.connection];
+                RemoteResult r;
+                if (!client) {
+                    client = std::make_unique<Client>();
+                    client->set_auth_token(options.token);
+                    if (!client->connect(host, port)) r.error = client->error();
+                }
+                if (client->is_connected()) {
+                    r = detail::replay_request(*client, cap.payload);
+                } else if (r.error.empty()) {
+                    r.error = "not connected";  // Lost on an earlier request
+                }
+
+                local.push_back(std::chrono::duration<double, std::milli>(clock::now() - sent).count());
+                if (!r.success) {
+                    if (errors++ == 0) first_error = r.error;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            latencies.insert(latencies.end(), local.begin(), local.end());
+            report.errors += errors;
+            if (report.first_error.empty()) report.first_error = first_error;
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    report.elapsed_s = std::chrono::duration<double>(clock::now() - start).count();
+    report.requests = latencies.size();
+    std::sort(latencies.begin(), latencies.end());
+    report.p50_ms = detail::percentile(latencies, 0.50);
+    report.p90_ms = detail::percentile(latencies, 0.90);
+    report.p99_ms = detail::percentile(latencies, 0.99);
+    report.max_ms = latencies.empty() ? 0 : latencies.back();
+    return report;
+}
+
+}  // namespace xsql::socket
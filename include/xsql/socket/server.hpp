@@ -2,8 +2,23 @@
  * @file server.hpp
  * @brief Generic TCP socket server for xsql tools
  *
- * Provides a simple single-threaded server that accepts JSON queries
- * and returns JSON responses.
+ * Provides a simple TCP server that accepts JSON queries and returns JSON
+ * responses. Each connection is served by its own thread, and every handler
+ * call runs under a QueryScheduler ticket. With the default scheduling
+ * (max_running = 1) handlers never run concurrently, so they may share one
+ * non-thread-safe database. Raise max_running only for thread-safe handlers;
+ * a cost classifier then routes heavy queries to the background lane.
+ * Closing statements, cursors and subscriptions, and tearing down a
+ * connection, also take a slot, since they finalize statements on the
+ * handlers' connection.
+ *
+ * Clients that share one database connection also share its transaction.
+ * With a transaction probe (serve_database installs one), requests run one
+ * at a time through a gate, and a client that leaves a transaction open
+ * keeps the gate until it commits or rolls back; other clients wait up to
+ * scheduling.max_wait_ms and then fail. A client that disconnects inside a
+ * transaction is rolled back. Without a probe, BEGIN from one client would
+ * enclose every other client's statements.
  *
  * Usage:
  *   xsql::socket::Server server;
@@ -11,15 +26,32 @@
  *       return execute_sql(sql);  // Returns QueryResult
  *   });
  *   server.run(13337);  // Blocking
+ *
+ * Prepared statements need a prepare handler; database_handlers.hpp provides
+ * one backed by sqlite3_stmt for an xsql::Database.
  */
 
 #pragma once
 
 #include "protocol.hpp"
+#include "workload.hpp"
+#include "../scheduler.hpp"
 
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <condition_variable>
 #include <functional>
+#include <iterator>
+#include <list>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 #include <atomic>
 #include <thread>
+#include <chrono>
 #include <string>
 #include <cstdint>
 #include <cstddef>
@@ -40,6 +72,8 @@
     #include <netinet/in.h>
     #include <unistd.h>
     #include <arpa/inet.h>
+    #include <netinet/tcp.h>
+    #include <poll.h>
     #include <errno.h>
     typedef int socket_t;
     #define SOCKET_INVALID -1
@@ -60,6 +94,86 @@ struct ServerConfig {
     size_t max_message_bytes = 10 * 1024 * 1024;
     std::string auth_token;
     bool allow_insecure_no_auth = false;
+    size_t max_prepared_statements = 256;   // Per connection
+    size_t max_cursors = 16;                // Open cursors per connection
+    int cursor_idle_timeout_ms = 60000;     // Cursors untouched this long are closed
+    size_t max_subscriptions = 64;          // Live queries per connection
+    int subscription_poll_ms = 50;          // How often subscriptions check for changes
+    size_t max_connections = 16;            // Clients served at once; extras are refused
+    SchedulerConfig scheduling;             // Lanes and admission for handler calls
+    size_t max_result_bytes = 0;            // Per result, counted while it is built (0 = max_message_bytes)
+    size_t max_result_rows = 0;             // Per result (0 = unlimited)
+    int64_t sqlite_heap_limit = 0;          // sqlite3_hard_heap_limit64 while running; process-wide (0 = leave)
+    std::string capture_path;               // Record accepted requests here while running (see workload.hpp)
+
+    /// Byte limit handlers should stop materializing at
+    size_t result_byte_limit() const { return max_result_bytes > 0 ? max_result_bytes : max_message_bytes; }
+};
+
+//=============================================================================
+// Prepared Statements
+//=============================================================================
+
+/**
+ * A statement prepared once and executed with different parameters.
+ * Instances belong to one client connection and are destroyed when it closes.
+ */
+class PreparedStatement {
+    QueryResult buffered_;
+    size_t buffered_pos_ = 0;
+
+public:
+    virtual ~PreparedStatement() = default;
+    virtual int param_count() const = 0;
+    virtual QueryResult execute(const std::vector<Param>& params) = 0;
+
+    /**
+     * Start incremental execution for a cursor. The default runs execute()
+     * and pages through the buffered result; implementations that can step
+     * lazily should override begin() and fetch().
+     */
+    virtual bool begin(const std::vector<Param>& params, std::string& error) {
+        buffered_ = execute(params);
+        buffered_pos_ = 0;
+        if (!buffered_.success) {
+            error = buffered_.error;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Return up to max_rows rows (stopping early once max_bytes of values
+     * were produced). Sets done when the statement has no more rows.
+     */
+    virtual QueryResult fetch(size_t max_rows, size_t max_bytes, bool& done) {
+        QueryResult page = QueryResult::ok();
+        page.columns = buffered_.columns;
+        size_t bytes = 0;
+        while (buffered_pos_ < buffered_.rows.size() && page.rows.size() < max_rows && bytes < max_bytes) {
+            for (const auto& v : buffered_.rows[buffered_pos_]) bytes += v.size() + 4;
+            page.rows.push_back(std::move(buffered_.rows[buffered_pos_++]));
+        }
+        done = buffered_pos_ >= buffered_.rows.size();
+        if (done) buffered_ = QueryResult();
+        return page;
+    }
+};
+
+//=============================================================================
+// Subscriptions
+//=============================================================================
+
+/**
+ * A live query. The server calls changed() while the connection is idle and
+ * re-runs evaluate() only when it returns true, pushing the row diff.
+ */
+class Subscription {
+public:
+    virtual ~Subscription() = default;
+    /// Cheap check: may the result differ from the last evaluate()?
+    virtual bool changed() = 0;
+    virtual QueryResult evaluate() = 0;
 };
 
 //=============================================================================
@@ -69,18 +183,77 @@ struct ServerConfig {
 class Server {
 public:
     using query_handler_t = std::function<QueryResult(const std::string& sql)>;
+    /// Returns nullptr and sets error if sql cannot be prepared
+    using prepare_handler_t = std::function<std::unique_ptr<PreparedStatement>(const std::string& sql,
+                                                                               std::string& error)>;
+    /// Returns nullptr and sets error if sql cannot be watched
+    using subscribe_handler_t = std::function<std::unique_ptr<Subscription>(const std::string& sql,
+                                                                           std::string& error)>;
+    /// Picks the lane for a statement (e.g. database_cost_classifier)
+    using classifier_t = std::function<QueryLane(const std::string& sql)>;
+    /// True while the handlers' connection has a transaction open
+    using transaction_probe_t = std::function<bool()>;
     using log_func_t = std::function<void(const std::string& msg)>;
 
 private:
+    // Per-connection state
+    struct SessionStatement {
+        std::unique_ptr<PreparedStatement> stmt;
+        QueryLane lane = QueryLane::Interactive;
+    };
+
+    struct OpenCursor {
+        std::unique_ptr<PreparedStatement> stmt;
+        std::chrono::steady_clock::time_point last_used;
+        QueryLane lane = QueryLane::Interactive;
+    };
+
+    struct LiveQuery {
+        std::unique_ptr<Subscription> sub;
+        std::vector<std::vector<std::string>> rows;     // Last result, sorted for diffing
+        QueryLane lane = QueryLane::Interactive;
+    };
+
+    struct Session {
+        std::string client;                             // Peer address, for per-client limits
+        uint64_t id = 0;                                // Connection number in captures
+        std::unordered_map<uint64_t, SessionStatement> statements;
+        uint64_t next_statement = 1;
+        std::unordered_map<uint64_t, OpenCursor> cursors;
+        uint64_t next_cursor = 1;
+        std::map<uint64_t, LiveQuery> subscriptions;
+        uint64_t next_subscription = 1;
+    };
+
     ServerConfig config_;
     query_handler_t query_handler_;
+    prepare_handler_t prepare_handler_;
+    subscribe_handler_t subscribe_handler_;
+    classifier_t classifier_;
+    transaction_probe_t transaction_probe_;
     log_func_t log_func_;
+    std::mutex log_mutex_;
     std::atomic<bool> running_{false};
     socket_t listen_sock_ = SOCKET_INVALID;
-    std::atomic<socket_t> active_client_{SOCKET_INVALID};
     std::thread server_thread_;
     bool wsa_init_ = false;
 
+    struct Connection {
+        std::thread thread;
+        socket_t sock = SOCKET_INVALID;
+        std::atomic<bool> done{false};
+    };
+    std::mutex connections_mutex_;
+    std::list<std::unique_ptr<Connection>> connections_;
+    QueryScheduler scheduler_;
+    WorkloadRecorder recorder_;
+    std::atomic<uint64_t> next_session_{1};
+
+    // Session running a request, or holding an open transaction (0 = none)
+    std::mutex gate_mutex_;
+    std::condition_variable gate_cv_;
+    uint64_t gate_owner_ = 0;
+
 public:
     Server() = default;
 
@@ -95,11 +268,19 @@ public:
     Server& operator=(const Server&) = delete;
 
     void set_config(const ServerConfig& config) { config_ = config; }
+    const ServerConfig& config() const { return config_; }
     void set_query_handler(query_handler_t handler) { query_handler_ = std::move(handler); }
+    void set_prepare_handler(prepare_handler_t handler) { prepare_handler_ = std::move(handler); }
+    void set_subscribe_handler(subscribe_handler_t handler) { subscribe_handler_ = std::move(handler); }
+    void set_cost_classifier(classifier_t classifier) { classifier_ = std::move(classifier); }
+    void set_transaction_probe(transaction_probe_t probe) { transaction_probe_ = std::move(probe); }
     void set_log_func(log_func_t func) { log_func_ = std::move(func); }
 
     bool is_running() const { return running_; }
     int port() const { return config_.port; }
+    SchedulerStats scheduler_stats() const { return scheduler_.stats(); }
+    /// Requests written to capture_path since the server started
+    uint64_t captured_requests() { return recorder_.records(); }
 
     /**
      * Run server (blocking).
@@ -136,13 +317,21 @@ public:
             listen_sock_ = SOCKET_INVALID;
         }
 
-        socket_t client = active_client_.exchange(SOCKET_INVALID);
-        if (client != SOCKET_INVALID) {
+        // Wake queued queries and blocked reads; run_server joins the threads
+        scheduler_.close();
+        {
+            std::lock_guard<std::mutex> lock(gate_mutex_);
+            gate_cv_.notify_all();
+        }
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            for (auto& conn : connections_) {
 #ifdef _WIN32
-            ::shutdown(client, SD_BOTH);
+                ::shutdown(conn->sock, SD_BOTH);
 #else
-            ::shutdown(client, SHUT_RDWR);
+                ::shutdown(conn->sock, SHUT_RDWR);
 #endif
+            }
         }
 
         if (server_thread_.joinable()) {
@@ -152,6 +341,7 @@ public:
 
 private:
     void log(const std::string& msg) {
+        std::lock_guard<std::mutex> lock(log_mutex_);
         if (log_func_) {
             log_func_(msg);
         } else if (config_.verbose) {
@@ -189,7 +379,7 @@ private:
         auto send_all = [&](const char* data, size_t len) -> bool {
             size_t total = 0;
             while (total < len) {
-                int n = send(sock, data + total, static_cast<int>(len - total), 0);
+                int n = send(sock, data + total, static_cast<int>(len - total), XSQL_SEND_FLAGS);
                 if (n <= 0) return false;
                 total += static_cast<size_t>(n);
             }
@@ -224,39 +414,559 @@ private:
         return recv_all(payload.data(), payload.size());
     }
 
-    void handle_client(socket_t client) {
-        active_client_.store(client);
-        std::string request;
-        while (running_ && recv_message(client, request)) {
-            std::string sql = extract_sql_from_request(request);
-            if (sql.empty()) {
-                send_message(client, "{\"success\":false,\"error\":\"Invalid request: missing sql field\"}");
+    // Lane for sql; the classifier itself may touch the database, so it runs
+    // under an interactive ticket
+    QueryLane classify(const std::string& sql, const Session& session) {
+        if (!classifier_) return QueryLane::Interactive;
+        auto ticket = scheduler_.admit(QueryLane::Interactive, session.client);
+        if (!ticket) return QueryLane::Interactive;
+        try {
+            return classifier_(sql);
+        } catch (const std::exception&) {
+            return QueryLane::Interactive;
+        }
+    }
+
+    QueryScheduler::Ticket admit(QueryLane lane, const Session& session) {
+        return scheduler_.admit(lane, session.client);
+    }
+
+    QueryResult run_query(const std::string& sql) {
+        if (!query_handler_) return QueryResult::fail("No query handler configured");
+        try {
+            return check_result_rows(query_handler_(sql));
+        } catch (const std::exception& e) {
+            return QueryResult::fail(e.what());
+        }
+    }
+
+    // Backstop for handlers that do not enforce max_result_rows themselves
+    QueryResult check_result_rows(QueryResult result) const {
+        if (config_.max_result_rows > 0 && result.rows.size() > config_.max_result_rows) {
+            return QueryResult::fail("result too large: exceeds max_result_rows (" +
+                                     std::to_string(config_.max_result_rows) + ")");
+        }
+        return result;
+    }
+
+    /**
+     * Run each statement in order. With a transaction, the first failure
+     * rolls back and stops; otherwise every statement runs and reports its
+     * own result.
+     */
+    BatchResult run_batch(const Request& req) {
+        BatchResult batch;
+        if (req.transaction) {
+            QueryResult begin = run_query("BEGIN");
+            if (!begin.success) {
+                batch.error = "BEGIN failed: " + begin.error;
+                return batch;
+            }
+        }
+
+        batch.results.reserve(req.statements.size());
+        for (size_t i = 0; i < req.statements.size(); ++i) {
+            batch.results.push_back(run_query(req.statements[i]));
+            if (req.transaction && !batch.results.back().success) {
+                run_query("ROLLBACK");
+                batch.error = "statement " + std::to_string(i) + ": " + batch.results.back().error;
+                return batch;
+            }
+        }
+
+        if (req.transaction) {
+            QueryResult commit = run_query("COMMIT");
+            if (!commit.success) {
+                run_query("ROLLBACK");
+                batch.error = "COMMIT failed: " + commit.error;
+                return batch;
+            }
+        }
+        batch.success = true;
+        return batch;
+    }
+
+    /**
+     * Take the gate for session. Without a transaction probe there is no
+     * gate. With wait false, fail at once if another session holds it.
+     */
+    bool enter_gate(const Session& session, bool wait) {
+        if (!transaction_probe_) return true;
+        std::unique_lock<std::mutex> lock(gate_mutex_);
+        auto free = [&]() { return gate_owner_ == 0 || gate_owner_ == session.id; };
+        if (!wait) {
+            if (!free()) return false;
+        } else {
+            auto ready = [&]() { return free() || !running_; };
+            int max_wait_ms = config_.scheduling.max_wait_ms;
+            if (max_wait_ms > 0) {
+                if (!gate_cv_.wait_for(lock, std::chrono::milliseconds(max_wait_ms), ready)) return false;
+            } else {
+                gate_cv_.wait(lock, ready);
+            }
+            if (!free()) return false;
+        }
+        gate_owner_ = session.id;
+        return true;
+    }
+
+    // Release the gate unless session left a transaction open
+    void leave_gate(const Session& session) {
+        if (!transaction_probe_) return;
+        bool open;
+        {
+            auto ticket = scheduler_.admit_cleanup();
+            open = transaction_probe_();
+        }
+        std::lock_guard<std::mutex> lock(gate_mutex_);
+        if (gate_owner_ != session.id || open) return;
+        gate_owner_ = 0;
+        gate_cv_.notify_all();
+    }
+
+    // On disconnect: roll back a transaction the session left open and release the gate
+    void abandon_gate(const Session& session) {
+        if (!transaction_probe_) return;
+        {
+            std::lock_guard<std::mutex> lock(gate_mutex_);
+            if (gate_owner_ != session.id) return;
+        }
+        {
+            auto ticket = scheduler_.admit_cleanup();
+            if (transaction_probe_()) {
+                run_query("ROLLBACK");
+                log("Rolled back transaction left open by a disconnected client");
+            }
+        }
+        std::lock_guard<std::mutex> lock(gate_mutex_);
+        gate_owner_ = 0;
+        gate_cv_.notify_all();
+    }
+
+    static bool uses_database(const std::string& type) {
+        return type == "query" || type == "batch" || type == "prepare" || type == "execute" ||
+               type == "cursor_open" || type == "cursor_fetch" || type == "subscribe";
+    }
+
+    std::string handle_query(const Request& req, const Session& session) {
+        auto ticket = admit(classify(req.sql, session), session);
+        if (!ticket) return error_json(ticket.error());
+        return result_to_json(run_query(req.sql));
+    }
+
+    // The whole batch holds one ticket, in the lane of its heaviest statement
+    std::string handle_batch(const Request& req, const Session& session) {
+        QueryLane lane = QueryLane::Interactive;
+        for (const auto& sql : req.statements) {
+            if (lane == QueryLane::Background) break;
+            lane = classify(sql, session);
+        }
+        auto ticket = admit(lane, session);
+        if (!ticket) return error_json(ticket.error());
+        return batch_result_to_json(run_batch(req));
+    }
+
+    std::string handle_prepare(const Request& req, Session& session) {
+        if (!prepare_handler_) return "{\"success\":false,\"error\":\"Prepared statements not supported\"}";
+        if (req.sql.empty()) return "{\"success\":false,\"error\":\"Invalid request: missing sql field\"}";
+        if (session.statements.size() >= config_.max_prepared_statements) {
+            return "{\"success\":false,\"error\":\"Too many prepared statements\"}";
+        }
+
+        // Executions run in the lane of the statement; preparing is cheap
+        QueryLane lane = classify(req.sql, session);
+        auto ticket = admit(QueryLane::Interactive, session);
+        if (!ticket) return error_json(ticket.error());
+
+        std::string error;
+        std::unique_ptr<PreparedStatement> stmt;
+        try {
+            stmt = prepare_handler_(req.sql, error);
+        } catch (const std::exception& e) {
+            error = e.what();
+        }
+        if (!stmt) {
+            return "{\"success\":false,\"error\":\"" + json_escape(error.empty() ? "prepare failed" : error) + "\"}";
+        }
+
+        uint64_t id = session.next_statement++;
+        int params = stmt->param_count();
+        session.statements[id] = SessionStatement{std::move(stmt), lane};
+        return "{\"success\":true,\"statement\":" + std::to_string(id) +
+               ",\"param_count\":" + std::to_string(params) + "}";
+    }
+
+    std::string handle_execute(const Request& req, Session& session) {
+        auto it = session.statements.find(req.statement);
+        if (it == session.statements.end()) {
+            return "{\"success\":false,\"error\":\"Unknown statement\"}";
+        }
+        auto ticket = admit(it->second.lane, session);
+        if (!ticket) return error_json(ticket.error());
+        QueryResult result;
+        try {
+            result = check_result_rows(it->second.stmt->execute(req.params));
+        } catch (const std::exception& e) {
+            result = QueryResult::fail(e.what());
+        }
+        return result_to_json(result);
+    }
+
+    // Rows per page when the client does not say, and the hard cap
+    static constexpr size_t kDefaultFetchRows = 1000;
+    static constexpr size_t kMaxFetchRows = 100000;
+
+    static std::string error_json(const std::string& msg) {
+        return "{\"success\":false,\"error\":\"" + json_escape(msg) + "\"}";
+    }
+
+    std::string cursor_page(Session& session, uint64_t id, size_t rows) {
+        auto it = session.cursors.find(id);
+        if (it == session.cursors.end()) return error_json("Unknown cursor");
+
+        if (rows == 0) rows = kDefaultFetchRows;
+        if (rows > kMaxFetchRows) rows = kMaxFetchRows;
+
+        auto ticket = admit(it->second.lane, session);
+        if (!ticket) return error_json(ticket.error());
+
+        bool done = false;
+        QueryResult page;
+        try {
+            // Leave headroom in the frame for JSON escaping and framing
+            page = it->second.stmt->fetch(rows, config_.max_message_bytes / 2, done);
+        } catch (const std::exception& e) {
+            page = QueryResult::fail(e.what());
+        }
+        if (!page.success || done) {
+            session.cursors.erase(it);
+            done = true;
+        } else {
+            it->second.last_used = std::chrono::steady_clock::now();
+        }
+
+        std::string json = result_to_json(page);
+        if (!page.success) return json;
+        json.pop_back();
+        json += ",\"cursor\":" + std::to_string(id) + ",\"done\":" + (done ? "true" : "false") + "}";
+        return json;
+    }
+
+    std::string handle_cursor_open(const Request& req, Session& session) {
+        if (!prepare_handler_) return error_json("Cursors not supported");
+        if (req.sql.empty()) return error_json("Invalid request: missing sql field");
+        if (session.cursors.size() >= config_.max_cursors) return error_json("Too many open cursors");
+
+        QueryLane lane = classify(req.sql, session);
+        std::string error;
+        std::unique_ptr<PreparedStatement> stmt;
+        {
+            auto ticket = admit(lane, session);
+            if (!ticket) return error_json(ticket.error());
+            try {
+                stmt = prepare_handler_(req.sql, error);
+                if (stmt && !stmt->begin(req.params, error)) stmt.reset();
+            } catch (const std::exception& e) {
+                stmt.reset();
+                error = e.what();
+            }
+        }
+        if (!stmt) return error_json(error.empty() ? "prepare failed" : error);
+
+        uint64_t id = session.next_cursor++;
+        session.cursors[id] = OpenCursor{std::move(stmt), std::chrono::steady_clock::now(), lane};
+        return cursor_page(session, id, static_cast<size_t>(req.fetch));
+    }
+
+    // Close cursors idle past the timeout; returns ms until the next one expires (-1 if none)
+    int expire_cursors(Session& session) {
+        if (session.cursors.empty() || config_.cursor_idle_timeout_ms <= 0) return -1;
+        auto now = std::chrono::steady_clock::now();
+        auto timeout = std::chrono::milliseconds(config_.cursor_idle_timeout_ms);
+        long long next = -1;
+        for (auto it = session.cursors.begin(); it != session.cursors.end();) {
+            auto idle = now - it->second.last_used;
+            if (idle >= timeout) {
+                auto ticket = scheduler_.admit_cleanup();
+                it = session.cursors.erase(it);
                 continue;
             }
+            long long left = std::chrono::duration_cast<std::chrono::milliseconds>(timeout - idle).count() + 1;
+            if (next < 0 || left < next) next = left;
+            ++it;
+        }
+        return static_cast<int>(next);
+    }
 
-            if (!config_.auth_token.empty()) {
-                std::string token = extract_token_from_request(request);
-                if (token != config_.auth_token) {
-                    send_message(client, "{\"success\":false,\"error\":\"Unauthorized\"}");
-                    continue;
-                }
+    std::string handle_subscribe(const Request& req, Session& session) {
+        if (!subscribe_handler_) return error_json("Subscriptions not supported");
+        if (req.sql.empty()) return error_json("Invalid request: missing sql field");
+        if (session.subscriptions.size() >= config_.max_subscriptions) return error_json("Too many subscriptions");
+
+        QueryLane lane = classify(req.sql, session);
+        std::string error;
+        std::unique_ptr<Subscription> sub;
+        QueryResult result;
+        {
+            auto ticket = admit(lane, session);
+            if (!ticket) return error_json(ticket.error());
+            try {
+                sub = subscribe_handler_(req.sql, error);
+                if (sub) result = sub->evaluate();
+            } catch (const std::exception& e) {
+                sub.reset();
+                error = e.what();
             }
+            if (sub && !result.success) {
+                sub.reset();
+                return result_to_json(result);
+            }
+        }
+        if (!sub) return error_json(error.empty() ? "subscribe failed" : error);
+
+        uint64_t id = session.next_subscription++;
+        LiveQuery& live = session.subscriptions[id];
+        live.sub = std::move(sub);
+        live.lane = lane;
+        live.rows = result.rows;
+        std::sort(live.rows.begin(), live.rows.end());
+
+        std::string json = result_to_json(result);
+        json.pop_back();
+        json += ",\"subscription\":" + std::to_string(id) + "}";
+        return json;
+    }
+
+    // Re-run subscriptions whose inputs changed and push their diffs; false if the client is gone
+    bool notify_subscriptions(socket_t client, Session& session) {
+        // Another client's open transaction holds the gate; retry on the next poll
+        if (!enter_gate(session, false)) return true;
+        bool alive = push_subscription_deltas(client, session);
+        leave_gate(session);
+        return alive;
+    }
 
+    bool push_subscription_deltas(socket_t client, Session& session) {
+        for (auto it = session.subscriptions.begin(); it != session.subscriptions.end();) {
+            LiveQuery& live = it->second;
             QueryResult result;
-            if (query_handler_) {
+            {
+                auto ticket = admit(live.lane, session);
+                if (!ticket) {
+                    ++it;   // Busy or stopping; retry on the next poll
+                    continue;
+                }
                 try {
-                    result = query_handler_(sql);
+                    if (!live.sub->changed()) {
+                        ++it;
+                        continue;
+                    }
+                    result = live.sub->evaluate();
                 } catch (const std::exception& e) {
                     result = QueryResult::fail(e.what());
                 }
+            }
+
+            if (!result.success) {
+                bool sent = send_message(client, delta_to_json(it->first, result, {}));
+                auto ticket = scheduler_.admit_cleanup();
+                it = session.subscriptions.erase(it);
+                if (!sent) return false;
+                continue;
+            }
+
+            std::sort(result.rows.begin(), result.rows.end());
+            QueryResult added = QueryResult::ok();
+            added.columns = std::move(result.columns);
+            std::vector<std::vector<std::string>> removed;
+            std::set_difference(result.rows.begin(), result.rows.end(), live.rows.begin(), live.rows.end(),
+                                std::back_inserter(added.rows));
+            std::set_difference(live.rows.begin(), live.rows.end(), result.rows.begin(), result.rows.end(),
+                                std::back_inserter(removed));
+            live.rows = std::move(result.rows);
+
+            if ((!added.rows.empty() || !removed.empty()) &&
+                !send_message(client, delta_to_json(it->first, added, removed))) {
+                return false;
+            }
+            ++it;
+        }
+        return true;
+    }
+
+    // 1 = readable, 0 = timed out, -1 = error
+    static int wait_readable(socket_t sock, int timeout_ms) {
+        pollfd p{};
+        p.fd = sock;
+        p.events = POLLIN;
+#ifdef _WIN32
+        int n = WSAPoll(&p, 1, timeout_ms);
+#else
+        int n = ::poll(&p, 1, timeout_ms);
+        if (n < 0 && errno == EINTR) return 0;
+#endif
+        if (n < 0) return -1;
+        return n > 0 ? 1 : 0;
+    }
+
+    static std::string peer_address(socket_t sock) {
+        sockaddr_in addr{};
+        socklen_t len = sizeof(addr);
+        if (getpeername(sock, reinterpret_cast<sockaddr*>(&addr), &len) != 0) return "";
+        char buf[INET_ADDRSTRLEN] = {};
+        if (!inet_ntop(AF_INET, &addr.sin_addr, buf, sizeof(buf))) return "";
+        return buf;
+    }
+
+    void handle_client(socket_t client) {
+        Session session;
+        session.client = peer_address(client);
+        session.id = next_session_++;
+        std::string message;
+        while (running_) {
+            // While cursors or subscriptions are open, wake up to expire and re-check them
+            int wait_ms = expire_cursors(session);
+            if (!session.subscriptions.empty()) {
+                if (!notify_subscriptions(client, session)) break;
+                int poll_ms = (std::max)(config_.subscription_poll_ms, 1);
+                wait_ms = wait_ms < 0 ? poll_ms : (std::min)(wait_ms, poll_ms);
+            }
+            if (wait_ms >= 0) {
+                int ready = wait_readable(client, wait_ms);
+                if (ready < 0) break;
+                if (ready == 0) continue;
+            }
+            if (!recv_message(client, message)) break;
+
+            Request req;
+            bool parsed = parse_request(message, req);
+            if (!parsed || (req.type == "query" && req.sql.empty())) {
+                send_message(client, "{\"success\":false,\"error\":\"Invalid request: missing sql field\"}");
+                continue;
+            }
+
+            if (!config_.auth_token.empty() && req.token != config_.auth_token) {
+                send_message(client, "{\"success\":false,\"error\":\"Unauthorized\"}");
+                continue;
+            }
+            if (!config_.capture_path.empty()) recorder_.record(session.id, req);
+
+            bool gated = uses_database(req.type);
+            if (gated && !enter_gate(session, true)) {
+                std::string reason = running_ ? "database busy: another connection has a transaction open"
+                                              : "server is shutting down";
+                if (!send_message(client, error_json(reason))) break;
+                continue;
+            }
+
+            std::string response;
+            if (req.type == "query") {
+                response = handle_query(req, session);
+            } else if (req.type == "batch") {
+                response = handle_batch(req, session);
+            } else if (req.type == "prepare") {
+                response = handle_prepare(req, session);
+            } else if (req.type == "execute") {
+                response = handle_execute(req, session);
+            } else if (req.type == "close") {
+                auto ticket = scheduler_.admit_cleanup();
+                bool found = session.statements.erase(req.statement) > 0;
+                response = found ? "{\"success\":true}" : error_json("Unknown statement");
+            } else if (req.type == "cursor_open") {
+                response = handle_cursor_open(req, session);
+            } else if (req.type == "cursor_fetch") {
+                response = cursor_page(session, req.cursor, static_cast<size_t>(req.fetch));
+            } else if (req.type == "cursor_close") {
+                auto ticket = scheduler_.admit_cleanup();
+                bool found = session.cursors.erase(req.cursor) > 0;
+                response = found ? "{\"success\":true}" : error_json("Unknown cursor");
+            } else if (req.type == "subscribe") {
+                response = handle_subscribe(req, session);
+            } else if (req.type == "unsubscribe") {
+                auto ticket = scheduler_.admit_cleanup();
+                bool found = session.subscriptions.erase(req.subscription) > 0;
+                response = found ? "{\"success\":true}" : error_json("Unknown subscription");
             } else {
-                result = QueryResult::fail("No query handler configured");
+                response = "{\"success\":false,\"error\":\"Invalid request: unknown type\"}";
             }
+            if (gated) leave_gate(session);
 
-            if (!send_message(client, result_to_json(result))) break;
+            if (response.size() > config_.max_message_bytes) {
+                response = error_json("response of " + std::to_string(response.size()) +
+                                      " bytes exceeds max_message_bytes (" +
+                                      std::to_string(config_.max_message_bytes) + ")");
+            }
+            if (!send_message(client, response)) break;
         }
-        active_client_.compare_exchange_strong(client, SOCKET_INVALID);
-        CLOSE_SOCKET(client);
+
+        abandon_gate(session);
+        auto ticket = scheduler_.admit_cleanup();
+        session.statements.clear();
+        session.cursors.clear();
+        session.subscriptions.clear();
+    }
+
+    // Join connection threads that finished; with wait_all, shut down and join all
+    void reap_connections(bool wait_all) {
+        std::list<std::unique_ptr<Connection>> finished;
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex_);
+            for (auto it = connections_.begin(); it != connections_.end();) {
+                if (wait_all || (*it)->done) {
+                    if (wait_all) {
+#ifdef _WIN32
+                        ::shutdown((*it)->sock, SD_BOTH);
+#else
+                        ::shutdown((*it)->sock, SHUT_RDWR);
+#endif
+                    }
+                    finished.splice(finished.end(), connections_, it++);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        for (auto& conn : finished) {
+            if (conn->thread.joinable()) conn->thread.join();
+            CLOSE_SOCKET(conn->sock);
+        }
+    }
+
+    void accept_client(socket_t client) {
+        reap_connections(false);
+
+        // Length prefix and payload go out as separate sends; don't let Nagle hold the second
+        int nodelay = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<char*>(&nodelay), sizeof(nodelay));
+
+        // Accepted sockets inherit the listener's accept timeout; a client may idle
+        // between requests (e.g. inside a transaction) without being dropped
+#ifdef _WIN32
+        DWORD no_timeout = 0;
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<char*>(&no_timeout), sizeof(no_timeout));
+#else
+        struct timeval no_timeout = {0, 0};
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &no_timeout, sizeof(no_timeout));
+#endif
+
+        std::lock_guard<std::mutex> lock(connections_mutex_);
+        if (connections_.size() >= (std::max)(config_.max_connections, size_t(1))) {
+            send_message(client, error_json("Too many connections"));
+            CLOSE_SOCKET(client);
+            log("Client refused: too many connections");
+            return;
+        }
+
+        auto conn = std::make_unique<Connection>();
+        Connection* raw = conn.get();
+        raw->sock = client;
+        connections_.push_back(std::move(conn));
+        raw->thread = std::thread([this, raw] {
+            log("Client connected");
+            handle_client(raw->sock);
+            log("Client disconnected");
+            raw->done = true;
+        });
     }
 
     bool run_server() {
@@ -313,7 +1023,7 @@ private:
             }
         }
 
-        if (listen(listen_sock_, 1) < 0) {
+        if (listen(listen_sock_, SOMAXCONN) < 0) {
             log("listen() failed");
             CLOSE_SOCKET(listen_sock_);
             listen_sock_ = SOCKET_INVALID;
@@ -321,6 +1031,22 @@ private:
             return false;
         }
 
+        if (!config_.capture_path.empty()) {
+            std::string error;
+            if (!recorder_.open(config_.capture_path, error)) {
+                log(error);
+                CLOSE_SOCKET(listen_sock_);
+                listen_sock_ = SOCKET_INVALID;
+                cleanup_winsock();
+                return false;
+            }
+        }
+        scheduler_.set_config(config_.scheduling);
+        scheduler_.reopen();
+        sqlite3_int64 previous_heap_limit = -1;
+        if (config_.sqlite_heap_limit > 0) {
+            previous_heap_limit = sqlite3_hard_heap_limit64(config_.sqlite_heap_limit);
+        }
         running_ = true;
         log("Server listening on " + config_.bind_address + ":" + std::to_string(config_.port));
 
@@ -340,10 +1066,11 @@ private:
                 continue;  // Timeout or error, check running_ and retry
             }
 
-            log("Client connected");
-            handle_client(client);
-            log("Client disconnected");
+            accept_client(client);
         }
+        reap_connections(true);
+        recorder_.close();
+        if (previous_heap_limit >= 0) sqlite3_hard_heap_limit64(previous_heap_limit);
 
         if (listen_sock_ != SOCKET_INVALID) {
             CLOSE_SOCKET(listen_sock_);
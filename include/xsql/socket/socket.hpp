@@ -11,3 +11,9 @@
 #include <xsql/socket/protocol.hpp>
 #include <xsql/socket/server.hpp>
 #include <xsql/socket/client.hpp>
+#include <xsql/socket/remote_table.hpp>
+#include <xsql/socket/fanout.hpp>
+#include <xsql/socket/async_client.hpp>
+#include <xsql/socket/workload.hpp>
+#include <xsql/socket/replay.hpp>
+#include <xsql/socket/database_handlers.hpp>
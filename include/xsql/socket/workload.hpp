@@ -0,0 +1,221 @@
+/**
+ * @file workload.hpp
+ * @brief Compact request log for capturing and replaying server load
+ *
+ * WorkloadRecorder appends each request a server accepts, with the time it
+ * arrived and the connection it came on, to a binary log. Tokens are
+ * stripped before writing. read_workload() loads such a log, and
+ * synthetic_workload() builds one from a weighted query mix; replay.hpp
+ * sends either against a server.
+ *
+ * Log format: the 8-byte magic "XSQLWKL1", then one record per request:
+ *   varint  microseconds since the previous record
+ *   varint  connection number (stable within one capture)
+ *   varint  payload length
+ *   bytes   request JSON, as produced by make_request()
+ *
+ * Usage:
+ *   xsql::socket::ServerConfig config;
+ *   config.capture_path = "load.xwl";     // Server records while running
+ *
+ *   std::vector<xsql::socket::CapturedRequest> log;
+ *   std::string error;
+ *   if (!xsql::socket::read_workload("load.xwl", log, error)) { ... }
+ */
+
+#pragma once
+
+#include "protocol.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace xsql::socket {
+
+struct CapturedRequest {
+    uint64_t offset_us = 0;     // Since the capture started
+    uint64_t connection = 0;
+    std::string payload;        // Request JSON without a token
+};
+
+namespace detail {
+
+inline constexpr char kWorkloadMagic[] = "XSQLWKL1";
+inline constexpr size_t kWorkloadMagicSize = 8;
+
+inline void put_varint(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+inline bool get_varint(const std::string& in, size_t& pos, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64 && pos < in.size(); shift += 7) {
+        uint8_t b = static_cast<uint8_t>(in[pos++]);
+        v |= static_cast<uint64_t>(b & 0x7f) << shift;
+        if ((b & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+}  // namespace detail
+
+//=============================================================================
+// Recorder
+//=============================================================================
+
+/**
+ * Thread-safe append-only writer. Records are buffered and written in
+ * blocks so capture adds little to request latency.
+ */
+class WorkloadRecorder {
+    std::mutex mutex_;
+    FILE* file_ = nullptr;
+    std::string buffer_;
+    std::chrono::steady_clock::time_point start_;
+    uint64_t last_us_ = 0;
+    uint64_t records_ = 0;
+
+    static constexpr size_t kFlushBytes = 64 * 1024;
+
+public:
+    WorkloadRecorder() = default;
+    ~WorkloadRecorder() { close(); }
+
+    WorkloadRecorder(const WorkloadRecorder&) = delete;
+    WorkloadRecorder& operator=(const WorkloadRecorder&) = delete;
+
+    /// Start a new log at path, replacing any existing file
+    bool open(const std::string& path, std::string& error) {
+        close();
+        std::lock_guard<std::mutex> lock(mutex_);
+        file_ = std::fopen(path.c_str(), "wb");
+        if (!file_) {
+            error = "cannot open capture file: " + path;
+            return false;
+        }
+        buffer_.assign(detail::kWorkloadMagic, detail::kWorkloadMagicSize);
+        start_ = std::chrono::steady_clock::now();
+        last_us_ = 0;
+        records_ = 0;
+        return true;
+    }
+
+    bool is_open() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return file_ != nullptr;
+    }
+
+    void record(uint64_t connection, const Request& req) {
+        std::string payload = make_request(req);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!file_) return;
+        // Taken under the lock so offsets never go backwards
+        uint64_t now_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                                    std::chrono::steady_clock::now() - start_).count());
+        if (now_us < last_us_) now_us = last_us_;
+        detail::put_varint(buffer_, now_us - last_us_);
+        detail::put_varint(buffer_, connection);
+        detail::put_varint(buffer_, payload.size());
+        buffer_ += payload;
+        last_us_ = now_us;
+        records_++;
+        if (buffer_.size() >= kFlushBytes) flush_locked();
+    }
+
+    uint64_t records() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return records_;
+    }
+
+    void flush() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        flush_locked();
+        if (file_) std::fflush(file_);
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!file_) return;
+        flush_locked();
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+
+private:
+    void flush_locked() {
+        if (file_ && !buffer_.empty()) std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+        buffer_.clear();
+    }
+};
+
+//=============================================================================
+// Reading and Synthesis
+//=============================================================================
+
+/// Load a capture; fails on a bad header or a truncated record
+inline bool read_workload(const std::string& path, std::vector<CapturedRequest>& out, std::string& error) {
+    out.clear();
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        error = "cannot open workload: " + path;
+        return false;
+    }
+    std::string data;
+    char buf[65536];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) data.append(buf, n);
+    std::fclose(f);
+
+    if (data.compare(0, detail::kWorkloadMagicSize, detail::kWorkloadMagic) != 0) {
+        error = "not a workload capture: " + path;
+        return false;
+    }
+    size_t pos = detail::kWorkloadMagicSize;
+    uint64_t offset = 0;
+    while (pos < data.size()) {
+        uint64_t delta = 0, connection = 0, len = 0;
+        if (!detail::get_varint(data, pos, delta) || !detail::get_varint(data, pos, connection) ||
+            !detail::get_varint(data, pos, len) || len > data.size() - pos) {
+            error = "truncated workload record " + std::to_string(out.size());
+            return false;
+        }
+        offset += delta;
+        out.push_back(CapturedRequest{offset, connection, data.substr(pos, static_cast<size_t>(len))});
+        pos += static_cast<size_t>(len);
+    }
+    return true;
+}
+
+/**
+ * count queries drawn from mix (sql, relative weight), spread round-robin
+ * over connections. Offsets are zero: replay them with a rate, not timing.
+ */
+inline std::vector<CapturedRequest> synthetic_workload(const std::vector<std::pair<std::string, double>>& mix,
+                                                       size_t count, size_t connections = 1,
+                                                       uint64_t seed = 1) {
+    std::vector<CapturedRequest> out;
+    if (mix.empty()) return out;
+    std::vector<double> weights;
+    for (const auto& m : mix) weights.push_back(m.second);
+    std::mt19937_64 rng(seed);
+    std::discrete_distribution<size_t> pick(weights.begin(), weights.end());
+    if (connections == 0) connections = 1;
+
+    out.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        out.push_back(CapturedRequest{0, i % connections, make_query_request(mix[pick(rng)].first)});
+    }
+    return out;
+}
+
+}  // namespace xsql::socket
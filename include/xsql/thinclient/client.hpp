@@ -5,6 +5,8 @@
  * @brief HTTP client wrapper for *sql tools
  *
  * Connects to a running *sql server and executes queries.
+ * Query bodies that came with an ETag are cached per SQL and revalidated
+ * with If-None-Match, so unchanged results cost only headers.
  * Uses cpp-httplib.
  * Enable with XSQL_WITH_THINCLIENT CMake option.
  */
@@ -12,8 +14,10 @@
 #ifdef XSQL_HAS_THINCLIENT
 
 #include <httplib.h>
+#include <list>
 #include <string>
 #include <stdexcept>
+#include <unordered_map>
 
 namespace xsql::thinclient {
 
@@ -25,6 +29,7 @@ struct client_config {
     std::string host = "127.0.0.1";
     int port = 5555;
     int timeout_sec = 30;
+    size_t etag_cache_entries = 64;     // Results kept for revalidation (0 = off)
 };
 
 // ============================================================================
@@ -49,16 +54,36 @@ public:
      * @throws std::runtime_error on connection or query error
      */
     std::string query(const std::string& sql) {
-        auto res = cli_.Post("/query", sql, "text/plain");
+        httplib::Headers headers;
+        auto cached = etag_cache_.find(sql);
+        if (cached != etag_cache_.end()) headers.emplace("If-None-Match", cached->second.etag);
+
+        auto res = cli_.Post("/query", headers, sql, "text/plain");
         check_response(res, "query");
 
+        if (res->status == 304 && cached != etag_cache_.end()) {
+            not_modified_++;
+            lru_.splice(lru_.begin(), lru_, cached->second.lru);
+            return cached->second.body;
+        }
+
         if (res->status != 200) {
             throw std::runtime_error("Query error: " + res->body);
         }
 
+        std::string etag = res->get_header_value("ETag");
+        if (!etag.empty() && config_.etag_cache_entries > 0) {
+            remember(sql, etag, res->body);
+        } else if (cached != etag_cache_.end()) {
+            lru_.erase(cached->second.lru);
+            etag_cache_.erase(cached);
+        }
         return res->body;
     }
 
+    /// Queries answered 304 Not Modified from the ETag cache
+    size_t not_modified_count() const { return not_modified_; }
+
     /**
      * Get server status.
      * @return JSON status string
@@ -86,8 +111,33 @@ public:
     }
 
 private:
+    struct cached_body {
+        std::string etag;
+        std::string body;
+        std::list<std::string>::iterator lru;
+    };
+
     client_config config_;
     httplib::Client cli_;
+    std::unordered_map<std::string, cached_body> etag_cache_;    // SQL -> last body
+    std::list<std::string> lru_;                                // Front = most recently used
+    size_t not_modified_ = 0;
+
+    void remember(const std::string& sql, const std::string& etag, const std::string& body) {
+        auto it = etag_cache_.find(sql);
+        if (it != etag_cache_.end()) {
+            it->second.etag = etag;
+            it->second.body = body;
+            lru_.splice(lru_.begin(), lru_, it->second.lru);
+            return;
+        }
+        if (etag_cache_.size() >= config_.etag_cache_entries) {
+            etag_cache_.erase(lru_.back());
+            lru_.pop_back();
+        }
+        lru_.push_front(sql);
+        etag_cache_[sql] = cached_body{etag, body, lru_.begin()};
+    }
 
     void check_response(const httplib::Result& res, const char* operation) {
         if (!res) {
@@ -109,6 +159,7 @@ struct client_config {
     std::string host = "127.0.0.1";
     int port = 5555;
     int timeout_sec = 30;
+    size_t etag_cache_entries = 64;
 };
 
 class client {
@@ -120,6 +171,7 @@ public:
     std::string status() { return {}; }
     void shutdown() {}
     bool ping() { return false; }
+    size_t not_modified_count() const { return 0; }
 };
 
 }  // namespace xsql::thinclient
@@ -6,6 +6,14 @@
  *
  * Provides HTTP endpoints for SQL queries. Uses cpp-httplib.
  * Enable with XSQL_WITH_THINCLIENT CMake option.
+ *
+ * Requests are served by worker_threads httplib workers. Setting
+ * open_connection also installs POST /query (body = SQL, JSON response),
+ * which runs each query on a connection leased from a pool of at most one
+ * per worker, so queries execute in parallel without an application mutex.
+ * Results of queries over versioned tables carry an ETag (see
+ * Database::result_version); a matching If-None-Match gets 304 without
+ * running the query.
  */
 
 #ifdef XSQL_HAS_THINCLIENT
@@ -21,11 +29,17 @@
 #endif
 
 #include <httplib.h>
+#include "../scheduler.hpp"
+#include "../connection_pool.hpp"
+#include "json_helpers.hpp"
 #include <string>
 #include <functional>
 #include <atomic>
 #include <thread>
 #include <mutex>
+#include <memory>
+#include <optional>
+#include <vector>
 #include <iostream>
 
 namespace xsql::thinclient {
@@ -47,8 +61,33 @@ struct server_config {
     std::string auth_token;
     bool allow_insecure_no_auth = false;
 
-    // Required: callback to set up your routes on the httplib::Server
+    // httplib worker threads serving requests
+    size_t worker_threads = 8;
+
+    // Optional: opens one read connection (tables registered) for the
+    // built-in POST /query route, e.g. xsql::read_only_connections(path, setup).
+    // At most max_connections are open (0 = worker_threads).
+    ConnectionPool::factory_t open_connection;
+    size_t max_connections = 0;
+
+    // Admission control for /query and routes that call admit(); httplib's
+    // worker threads queue here instead of all hitting the database at once.
+    // Unset, it is default_scheduling(worker_threads), so every worker can
+    // run an interactive query.
+    std::optional<SchedulerConfig> scheduling;
+
+    // Callback to set up your routes on the httplib::Server; required unless
+    // open_connection provides /query. Routes registered here take precedence.
     route_setup_t setup_routes;
+
+    /// Scheduling that admits up to workers queries, at most half of them background
+    static SchedulerConfig default_scheduling(size_t workers) {
+        SchedulerConfig config;
+        config.max_running = workers;
+        config.interactive_slots = workers;
+        config.background_slots = workers > 1 ? workers / 2 : 1;
+        return config;
+    }
 };
 
 // ============================================================================
@@ -58,7 +97,14 @@ struct server_config {
 class server {
 public:
     explicit server(const server_config& config)
-        : config_(config), running_(false) {}
+        : config_(config), running_(false),
+          scheduler_(config.scheduling ? *config.scheduling
+                                       : server_config::default_scheduling(config.worker_threads > 0 ? config.worker_threads : 1)) {
+        if (config_.open_connection) {
+            size_t connections = config_.max_connections > 0 ? config_.max_connections : config_.worker_threads;
+            pool_ = std::make_unique<ConnectionPool>(config_.open_connection, connections);
+        }
+    }
 
     ~server() {
         stop();
@@ -69,10 +115,18 @@ public:
      * Returns when server is stopped.
      */
     void run() {
+        size_t workers = config_.worker_threads > 0 ? config_.worker_threads : 1;
+        svr_.new_task_queue = [workers] { return new httplib::ThreadPool(workers); };
+
         // Let the application set up its routes
         if (config_.setup_routes) {
             config_.setup_routes(svr_);
         }
+        if (pool_) {
+            svr_.Post("/query", [this](const httplib::Request& req, httplib::Response& res) {
+                handle_query(req, res);
+            });
+        }
 
         auto is_loopback_bind_address = [](const std::string& addr) -> bool {
             return addr == "localhost" || addr == "127.0.0.1" || addr == "::1" || addr.rfind("127.", 0) == 0;
@@ -84,6 +138,7 @@ public:
             return;
         }
 
+        scheduler_.reopen();
         running_ = true;
         svr_.listen(config_.bind_address.c_str(), config_.port);
         running_ = false;
@@ -104,6 +159,7 @@ public:
      * Stop server gracefully.
      */
     void stop() {
+        scheduler_.close();
         if (svr_.is_running()) {
             svr_.stop();
         }
@@ -148,6 +204,28 @@ public:
         return false;
     }
 
+    /**
+     * Wait for a slot in lane, keyed on the caller's address for per-client
+     * limits. When refused, the returned ticket is empty and res is set to
+     * 503 with the reason. Hold the ticket while running the query:
+     *
+     *   auto ticket = srv.admit(xsql::classify_query_cost(db, sql), req, res);
+     *   if (!ticket) return;
+     */
+    QueryScheduler::Ticket admit(QueryLane lane, const httplib::Request& req, httplib::Response& res) {
+        auto ticket = scheduler_.admit(lane, req.remote_addr);
+        if (!ticket) {
+            res.status = 503;
+            res.set_content(make_error_json(ticket.error()), "application/json");
+        }
+        return ticket;
+    }
+
+    QueryScheduler& scheduler() { return scheduler_; }
+
+    /// Connections behind /query; nullptr unless open_connection was set
+    ConnectionPool* connection_pool() { return pool_.get(); }
+
     /**
      * Schedule a graceful shutdown after the current response.
      * Applications can call this from their shutdown endpoint.
@@ -164,6 +242,87 @@ private:
     httplib::Server svr_;
     std::thread server_thread_;
     std::atomic<bool> running_;
+    QueryScheduler scheduler_;
+    std::unique_ptr<ConnectionPool> pool_;
+
+    // Shape expected by result_to_json
+    struct json_result {
+        bool success = false;
+        std::string error;
+        std::vector<std::string> columns;
+        std::vector<Row> rows;
+    };
+
+    static std::string make_etag(uint64_t version) {
+        static const char digits[] = "0123456789abcdef";
+        std::string etag = "\"";
+        for (int shift = 60; shift >= 0; shift -= 4) etag += digits[(version >> shift) & 0xf];
+        etag += '"';
+        return etag;
+    }
+
+    // If-None-Match holds "*" or a comma-separated list of (possibly weak) tags
+    static bool etag_matches(const std::string& header, const std::string& etag) {
+        size_t pos = 0;
+        while (pos < header.size()) {
+            size_t end = header.find(',', pos);
+            if (end == std::string::npos) end = header.size();
+            std::string tag = header.substr(pos, end - pos);
+            size_t first = tag.find_first_not_of(" \t");
+            size_t last = tag.find_last_not_of(" \t");
+            tag = first == std::string::npos ? "" : tag.substr(first, last - first + 1);
+            if (tag.rfind("W/", 0) == 0) tag = tag.substr(2);
+            if (tag == "*" || tag == etag) return true;
+            pos = end + 1;
+        }
+        return false;
+    }
+
+    void handle_query(const httplib::Request& req, httplib::Response& res) {
+        if (!authorize(req, res)) return;
+        if (req.body.empty()) {
+            res.status = 400;
+            res.set_content(make_error_json("missing SQL in request body"), "application/json");
+            return;
+        }
+
+        auto conn = pool_->acquire();
+        if (!conn) {
+            res.status = 503;
+            res.set_content(make_error_json(conn.error()), "application/json");
+            return;
+        }
+
+        uint64_t version = 0;
+        std::string etag;
+        if (conn->result_version(req.body, {}, version)) {
+            etag = make_etag(version);
+            if (etag_matches(req.get_header_value("If-None-Match"), etag)) {
+                res.status = 304;
+                res.set_header("ETag", etag);
+                res.set_header("Cache-Control", "no-cache");
+                return;
+            }
+        }
+
+        CostPolicy policy;
+        policy.table_rows = [&conn](const std::string& table) { return conn->estimated_rows(table); };
+        auto ticket = admit(classify_query_cost(conn->handle(), req.body, policy), req, res);
+        if (!ticket) return;
+
+        Result result = conn->query(req.body);
+        json_result out;
+        out.success = result.ok();
+        out.error = std::move(result.error);
+        out.columns = std::move(result.columns);
+        out.rows = std::move(result.rows);
+        res.status = out.success ? 200 : 400;
+        if (out.success && !etag.empty()) {
+            res.set_header("ETag", etag);
+            res.set_header("Cache-Control", "no-cache");
+        }
+        res.set_content(result_to_json(out), "application/json");
+    }
 };
 
 }  // namespace xsql::thinclient
@@ -0,0 +1,168 @@
+/**
+ * xsql/value.hpp - Typed SQL values for parameter binding
+ *
+ * Part of libxsql - a generic SQLite virtual table framework.
+ *
+ * Value holds one SQLite value (NULL, INTEGER, REAL, TEXT or BLOB) and is
+ * used wherever the framework binds parameters or passes row values around
+ * outside of an sqlite3_context.
+ *
+ * Example:
+ *
+ *   auto result = db.query("SELECT * FROM funcs WHERE ea = ? AND name LIKE ?",
+ *                          {xsql::Value::integer(0x401000), xsql::Value::text("sub_%")});
+ */
+
+#pragma once
+
+#include <sqlite3.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace xsql {
+
+// ============================================================================
+// Value
+// ============================================================================
+
+struct Value {
+    enum class Type { Null, Integer, Real, Text, Blob };
+
+    Type type = Type::Null;
+    int64_t i = 0;
+    double d = 0.0;
+    std::string s;      // Text, or raw bytes for Blob
+
+    static Value null() { return Value(); }
+
+    static Value integer(int64_t v) {
+        Value out;
+        out.type = Type::Integer;
+        out.i = v;
+        return out;
+    }
+
+    static Value real(double v) {
+        Value out;
+        out.type = Type::Real;
+        out.d = v;
+        return out;
+    }
+
+    static Value text(std::string v) {
+        Value out;
+        out.type = Type::Text;
+        out.s = std::move(v);
+        return out;
+    }
+
+    static Value blob(const void* data, size_t size) {
+        Value out;
+        out.type = Type::Blob;
+        out.s.assign(static_cast<const char*>(data), size);
+        return out;
+    }
+
+    static Value blob(const std::vector<uint8_t>& bytes) {
+        return blob(bytes.data(), bytes.size());
+    }
+
+    bool is_null() const { return type == Type::Null; }
+
+    bool operator==(const Value& other) const {
+        if (type != other.type) return false;
+        switch (type) {
+            case Type::Null:    return true;
+            case Type::Integer: return i == other.i;
+            case Type::Real:    return d == other.d;
+            case Type::Text:
+            case Type::Blob:    return s == other.s;
+        }
+        return false;
+    }
+
+    bool operator!=(const Value& other) const { return !(*this == other); }
+
+    // Text rendering matching sqlite3_column_text() for scalar types
+    std::string to_string() const {
+        switch (type) {
+            case Type::Null:    return "";
+            case Type::Integer: return std::to_string(i);
+            case Type::Real: {
+                char buf[32];
+                sqlite3_snprintf(sizeof(buf), buf, "%!.15g", d);
+                return buf;
+            }
+            case Type::Text:
+            case Type::Blob:    return s;
+        }
+        return "";
+    }
+};
+
+// ============================================================================
+// SQLite Conversions
+// ============================================================================
+
+inline Value value_from_sqlite(sqlite3_value* v) {
+    switch (sqlite3_value_type(v)) {
+        case SQLITE_INTEGER: return Value::integer(sqlite3_value_int64(v));
+        case SQLITE_FLOAT:   return Value::real(sqlite3_value_double(v));
+        case SQLITE_TEXT: {
+            const char* text = reinterpret_cast<const char*>(sqlite3_value_text(v));
+            return Value::text(std::string(text ? text : "", static_cast<size_t>(sqlite3_value_bytes(v))));
+        }
+        case SQLITE_BLOB:
+            return Value::blob(sqlite3_value_blob(v), static_cast<size_t>(sqlite3_value_bytes(v)));
+        default:
+            return Value::null();
+    }
+}
+
+inline Value column_value(sqlite3_stmt* stmt, int col) {
+    return value_from_sqlite(sqlite3_column_value(stmt, col));
+}
+
+inline void result_value(sqlite3_context* ctx, const Value& v) {
+    switch (v.type) {
+        case Value::Type::Null:    sqlite3_result_null(ctx); break;
+        case Value::Type::Integer: sqlite3_result_int64(ctx, v.i); break;
+        case Value::Type::Real:    sqlite3_result_double(ctx, v.d); break;
+        case Value::Type::Text:
+            sqlite3_result_text(ctx, v.s.data(), static_cast<int>(v.s.size()), SQLITE_TRANSIENT);
+            break;
+        case Value::Type::Blob:
+            sqlite3_result_blob(ctx, v.s.data(), static_cast<int>(v.s.size()), SQLITE_TRANSIENT);
+            break;
+    }
+}
+
+/**
+ * Bind a value to a 1-based statement parameter.
+ */
+inline int bind_value(sqlite3_stmt* stmt, int index, const Value& v) {
+    switch (v.type) {
+        case Value::Type::Null:    return sqlite3_bind_null(stmt, index);
+        case Value::Type::Integer: return sqlite3_bind_int64(stmt, index, v.i);
+        case Value::Type::Real:    return sqlite3_bind_double(stmt, index, v.d);
+        case Value::Type::Text:
+            return sqlite3_bind_text(stmt, index, v.s.data(), static_cast<int>(v.s.size()), SQLITE_TRANSIENT);
+        case Value::Type::Blob:
+            return sqlite3_bind_blob(stmt, index, v.s.data(), static_cast<int>(v.s.size()), SQLITE_TRANSIENT);
+    }
+    return SQLITE_MISUSE;
+}
+
+/**
+ * Bind values to parameters 1..N. Returns the first non-OK code.
+ */
+inline int bind_values(sqlite3_stmt* stmt, const std::vector<Value>& values) {
+    for (size_t i = 0; i < values.size(); ++i) {
+        int rc = bind_value(stmt, static_cast<int>(i + 1), values[i]);
+        if (rc != SQLITE_OK) return rc;
+    }
+    return SQLITE_OK;
+}
+
+} // namespace xsql
@@ -8,6 +8,7 @@
  *   - Live data access (fresh on every query)
  *   - Optional UPDATE/DELETE support via column setters
  *   - before_modify hook for undo/transaction integration
+ *   - change_feed() for structured row-level change capture
  *   - Fluent builder API
  *   - Constraint pushdown via filter_eq() for O(1) lookups
  *
@@ -41,16 +42,35 @@
 #pragma once
 
 #include <sqlite3.h>
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <functional>
+#include <iterator>
+#include <limits>
 #include <sstream>
+#include <cstdio>
 #include <cstring>
 #include <cctype>
 #include <memory>
 #include <new>
+#include <exception>
 #include <unordered_map>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#if __has_include(<memory_resource>)
+    #include <memory_resource>
+    #define XSQL_HAS_PMR 1
+#endif
+
+#include "allocator.hpp"
+#include "shm_cache.hpp"
+#include "change_feed.hpp"
 
 namespace xsql {
 
@@ -146,6 +166,15 @@ constexpr int FILTER_NONE = 0;
 // Index IDs start at INDEX_BASE (indexes are auto-generated filters)
 constexpr int INDEX_BASE = 1000;
 
+// Equality on the declared primary key, resolved by VTableDef::locate_row
+constexpr int FILTER_PRIMARY_KEY = -1;
+
+// Lower bound on a generator table's seek key, resolved by Generator::seek
+constexpr int FILTER_SEEK = -2;
+
+// Same, for a strict bound (key > ?)
+constexpr int FILTER_SEEK_AFTER = -3;
+
 /**
  * Defines a filter for a specific column constraint.
  *
@@ -188,6 +217,12 @@ struct VTableDef {
     // Filters for constraint pushdown (optional)
     std::vector<FilterDef> filters;
 
+    // Declared PRIMARY KEY column (-1 = rowid table). With a key the schema is
+    // WITHOUT ROWID, xUpdate receives key values instead of row indexes, and
+    // locate_row maps a key to its current row index (false if absent).
+    int primary_key_column = -1;
+    std::function<bool(sqlite3_value* key, size_t& row)> locate_row;
+
     // DELETE handler: Delete row at index, returns success
     std::function<bool(size_t)> delete_row;
     bool supports_delete = false;
@@ -197,17 +232,43 @@ struct VTableDef {
     std::function<bool(int argc, sqlite3_value** argv)> insert_row;
     bool supports_insert = false;
 
+    // Batched INSERT handler (optional, takes precedence over insert_row).
+    // Inserted rows are buffered per connection and handed over in one call
+    // when the transaction commits (xSync), so they are not visible to reads
+    // until then. Rows rolled back, including by ROLLBACK TO, never arrive;
+    // returning false fails the commit.
+    std::function<bool(const std::vector<std::vector<Value>>& rows)> insert_rows;
+
     // Hook called before any modification (INSERT/UPDATE/DELETE)
     std::function<void(const std::string&)> before_modify;
 
+    // Receives a ChangeEvent for every row changed through xUpdate (optional)
+    std::shared_ptr<ChangeFeed> change_feed;
+
+    // Data generation (optional). Must change whenever the source data changes;
+    // result caches only trust tables that provide one.
+    std::function<uint64_t()> generation_fn;
+
+    // Bumped by xUpdate on every INSERT/UPDATE/DELETE (shared by all copies)
+    std::shared_ptr<std::atomic<uint64_t>> write_generation =
+        std::make_shared<std::atomic<uint64_t>>(0);
+
+    bool has_generation() const { return static_cast<bool>(generation_fn); }
+
+    uint64_t generation() const {
+        return (generation_fn ? generation_fn() : 0) + write_generation->load();
+    }
+
     std::string schema() const {
         std::ostringstream ss;
         ss << "CREATE TABLE " << name << "(";
         for (size_t i = 0; i < columns.size(); ++i) {
             if (i > 0) ss << ", ";
             ss << columns[i].name << " " << column_type_sql(columns[i].type);
+            if (static_cast<int>(i) == primary_key_column) ss << " PRIMARY KEY";
         }
         ss << ")";
+        if (primary_key_column >= 0) ss << " WITHOUT ROWID";
         return ss.str();
     }
 
@@ -232,12 +293,21 @@ struct VTableDef {
 // SQLite Virtual Table Implementation
 // ============================================================================
 
-struct Vtab {
+// Vtab and cursor objects of every table kind, and the batch buffers below,
+// come from the arena once install_allocator() has run (see allocator.hpp)
+
+struct Vtab : detail::ArenaAllocated {
     sqlite3_vtab base;
     const VTableDef* def;
+
+    // Rows waiting for def->insert_rows (flushed by xSync)
+    std::vector<std::vector<Value>, ArenaAllocator<std::vector<Value>>> pending_inserts;
+
+    // pending_inserts.size() when savepoint i was opened
+    std::vector<size_t, ArenaAllocator<size_t>> savepoint_marks;
 };
 
-struct Cursor {
+struct Cursor : detail::ArenaAllocated {
     sqlite3_vtab_cursor base;
     const VTableDef* def;
 
@@ -362,6 +432,16 @@ inline int vtab_filter(sqlite3_vtab_cursor* pCursor, int idxNum, const char*,
     cursor->idx = 0;
     cursor->total = 0;
 
+    // Primary key lookup: iterate the single located row by index
+    if (idxNum == FILTER_PRIMARY_KEY && argc > 0) {
+        size_t row = 0;
+        if (sqlite3_value_type(argv[0]) != SQLITE_NULL && cursor->def->locate_row(argv[0], row)) {
+            cursor->idx = row;
+            cursor->total = row + 1;
+        }
+        return SQLITE_OK;
+    }
+
     // Check if a filter was selected by xBestIndex
     if (idxNum != FILTER_NONE && argc > 0) {
         // Find the filter with this ID
@@ -393,6 +473,7 @@ inline int vtab_best_index(sqlite3_vtab* pVtab, sqlite3_index_info* pInfo) {
     // This avoids expensive cache rebuilds when a filter will be used
     const FilterDef* best_filter = nullptr;
     int best_constraint_idx = -1;
+    int key_constraint_idx = -1;
 
     for (int i = 0; i < pInfo->nConstraint; i++) {
         const auto& constraint = pInfo->aConstraint[i];
@@ -401,6 +482,10 @@ inline int vtab_best_index(sqlite3_vtab* pVtab, sqlite3_index_info* pInfo) {
         if (!constraint.usable) continue;
         if (constraint.op != SQLITE_INDEX_CONSTRAINT_EQ) continue;
 
+        if (constraint.iColumn == def->primary_key_column && def->locate_row) {
+            key_constraint_idx = i;
+        }
+
         // Check if we have a filter for this column
         const FilterDef* filter = def->find_filter(constraint.iColumn);
         if (filter) {
@@ -412,7 +497,14 @@ inline int vtab_best_index(sqlite3_vtab* pVtab, sqlite3_index_info* pInfo) {
         }
     }
 
-    if (best_filter && best_constraint_idx >= 0) {
+    if (key_constraint_idx >= 0 && (!best_filter || best_filter->estimated_cost > 1.0)) {
+        // At most one row; SQLite re-checks the key so type coercion stays exact
+        pInfo->aConstraintUsage[key_constraint_idx].argvIndex = 1;
+        pInfo->idxNum = FILTER_PRIMARY_KEY;
+        pInfo->estimatedCost = 1.0;
+        pInfo->estimatedRows = 1;
+        pInfo->idxFlags |= SQLITE_INDEX_SCAN_UNIQUE;
+    } else if (best_filter && best_constraint_idx >= 0) {
         // Tell SQLite we'll handle this constraint
         pInfo->aConstraintUsage[best_constraint_idx].argvIndex = 1;  // First arg
         pInfo->aConstraintUsage[best_constraint_idx].omit = 1;       // Don't recheck
@@ -434,10 +526,103 @@ inline int vtab_best_index(sqlite3_vtab* pVtab, sqlite3_index_info* pInfo) {
     return SQLITE_OK;
 }
 
+namespace detail {
+
+// Runs column getters against a real sqlite3_context so their values can be
+// captured outside a query. Uses a private in-memory connection per thread.
+class ColumnProbe {
+    sqlite3* db_ = nullptr;
+    sqlite3_stmt* stmt_ = nullptr;
+    const ColumnDef* column_ = nullptr;
+    size_t row_ = 0;
+
+    static void probe_fn(sqlite3_context* ctx, int, sqlite3_value**) {
+        auto* self = static_cast<ColumnProbe*>(sqlite3_user_data(ctx));
+        self->column_->get(ctx, self->row_);
+    }
+
+public:
+    ColumnProbe() {
+        if (sqlite3_open(":memory:", &db_) != SQLITE_OK) return;
+        sqlite3_create_function(db_, "xsql_probe", 0, SQLITE_UTF8, this, probe_fn, nullptr, nullptr);
+        sqlite3_prepare_v2(db_, "SELECT xsql_probe()", -1, &stmt_, nullptr);
+    }
+
+    ~ColumnProbe() {
+        sqlite3_finalize(stmt_);
+        sqlite3_close(db_);
+    }
+
+    ColumnProbe(const ColumnProbe&) = delete;
+    ColumnProbe& operator=(const ColumnProbe&) = delete;
+
+    Value read(const ColumnDef& col, size_t row) {
+        if (!stmt_ || !col.get) return Value::null();
+        column_ = &col;
+        row_ = row;
+        Value v = sqlite3_step(stmt_) == SQLITE_ROW ? column_value(stmt_, 0) : Value::null();
+        sqlite3_reset(stmt_);
+        return v;
+    }
+
+    static ColumnProbe& local() {
+        thread_local ColumnProbe probe;
+        return probe;
+    }
+};
+
+inline std::vector<Value> read_row_values(const VTableDef& def, size_t row) {
+    std::vector<Value> values;
+    values.reserve(def.columns.size());
+    auto& probe = ColumnProbe::local();
+    for (const auto& col : def.columns) values.push_back(probe.read(col, row));
+    return values;
+}
+
+inline void publish_change(const VTableDef& def, ChangeOp op, int64_t rowid,
+                           std::vector<Value> old_values, std::vector<Value> new_values) {
+    ChangeEvent event;
+    event.table = def.name;
+    event.op = op;
+    // A WITHOUT ROWID table's row index shifts as rows come and go; its key is in the values
+    event.rowid = def.primary_key_column >= 0 ? -1 : rowid;
+    event.old_values = std::move(old_values);
+    event.new_values = std::move(new_values);
+    def.change_feed->publish(std::move(event));
+}
+
+// Row addressed by xUpdate's argv[0]: a row index, or a key for WITHOUT ROWID tables
+inline bool row_for_update(const VTableDef& def, sqlite3_value* key, size_t& row) {
+    if (def.primary_key_column < 0) {
+        row = static_cast<size_t>(sqlite3_value_int64(key));
+        return true;
+    }
+    return def.locate_row && def.locate_row(key, row);
+}
+
+// Hand buffered rows to insert_rows; nothing is published or counted as a
+// write unless the handler accepts the batch
+inline int flush_pending_inserts(Vtab* vtab) {
+    if (vtab->pending_inserts.empty()) return SQLITE_OK;
+    const VTableDef* def = vtab->def;
+    std::vector<std::vector<Value>> rows(std::make_move_iterator(vtab->pending_inserts.begin()),
+                                         std::make_move_iterator(vtab->pending_inserts.end()));
+    vtab->pending_inserts.clear();
+    if (!def->insert_rows(rows)) return SQLITE_ERROR;
+    def->write_generation->fetch_add(1);
+    if (def->change_feed) {
+        for (auto& row : rows) publish_change(*def, ChangeOp::Insert, -1, {}, std::move(row));
+    }
+    return SQLITE_OK;
+}
+
+} // namespace detail
+
 // xUpdate - handles INSERT, UPDATE, DELETE
 inline int vtab_update(sqlite3_vtab* pVtab, int argc, sqlite3_value** argv, sqlite3_int64*) {
     auto* vtab = reinterpret_cast<Vtab*>(pVtab);
     const VTableDef* def = vtab->def;
+    const bool capture = def->change_feed != nullptr;
 
     // argc == 1: DELETE
     if (argc == 1 && sqlite3_value_type(argv[0]) != SQLITE_NULL) {
@@ -445,26 +630,37 @@ inline int vtab_update(sqlite3_vtab* pVtab, int argc, sqlite3_value** argv, sqli
             return SQLITE_READONLY;
         }
 
-        size_t rowid = static_cast<size_t>(sqlite3_value_int64(argv[0]));
+        size_t rowid = 0;
+        if (!detail::row_for_update(*def, argv[0], rowid)) return SQLITE_ERROR;
 
         if (def->before_modify) {
             def->before_modify("DELETE FROM " + def->name);
         }
+        def->write_generation->fetch_add(1);
 
+        std::vector<Value> old_values;
+        if (capture) old_values = detail::read_row_values(*def, rowid);
         if (!def->delete_row(rowid)) {
             return SQLITE_ERROR;
         }
+        if (capture) {
+            detail::publish_change(*def, ChangeOp::Delete, static_cast<int64_t>(rowid), std::move(old_values), {});
+        }
         return SQLITE_OK;
     }
 
     // argc > 1, argv[0] != NULL: UPDATE
     if (argc > 1 && sqlite3_value_type(argv[0]) != SQLITE_NULL) {
-        size_t old_rowid = static_cast<size_t>(sqlite3_value_int64(argv[0]));
+        size_t old_rowid = 0;
+        if (!detail::row_for_update(*def, argv[0], old_rowid)) return SQLITE_ERROR;
 
         if (def->before_modify) {
             def->before_modify("UPDATE " + def->name);
         }
+        def->write_generation->fetch_add(1);
 
+        std::vector<Value> old_values;
+        if (capture) old_values = detail::read_row_values(*def, old_rowid);
         for (size_t i = 2; i < static_cast<size_t>(argc) && (i - 2) < def->columns.size(); ++i) {
             size_t col_idx = i - 2;
             const auto& col = def->columns[col_idx];
@@ -474,12 +670,17 @@ inline int vtab_update(sqlite3_vtab* pVtab, int argc, sqlite3_value** argv, sqli
                 }
             }
         }
+        // New values are read back so they reflect what the setters stored
+        if (capture) {
+            detail::publish_change(*def, ChangeOp::Update, static_cast<int64_t>(old_rowid), std::move(old_values),
+                                   detail::read_row_values(*def, old_rowid));
+        }
         return SQLITE_OK;
     }
 
     // argc > 1, argv[0] == NULL: INSERT
     if (argc > 1 && sqlite3_value_type(argv[0]) == SQLITE_NULL) {
-        if (!def->supports_insert || !def->insert_row) {
+        if (!def->supports_insert || (!def->insert_row && !def->insert_rows)) {
             return SQLITE_READONLY;
         }
 
@@ -487,20 +688,89 @@ inline int vtab_update(sqlite3_vtab* pVtab, int argc, sqlite3_value** argv, sqli
             def->before_modify("INSERT INTO " + def->name);
         }
 
+        // Buffered until commit; the write is counted when it is flushed
+        if (def->insert_rows) {
+            std::vector<Value> row;
+            row.reserve(static_cast<size_t>(argc - 2));
+            for (int i = 2; i < argc; ++i) row.push_back(value_from_sqlite(argv[i]));
+            vtab->pending_inserts.push_back(std::move(row));
+            return SQLITE_OK;
+        }
+        def->write_generation->fetch_add(1);
+
         // Pass column values starting at argv[2] (argv[0]=NULL, argv[1]=rowid)
         if (!def->insert_row(argc - 2, &argv[2])) {
             return SQLITE_ERROR;
         }
+        if (capture) {
+            std::vector<Value> new_values;
+            new_values.reserve(static_cast<size_t>(argc - 2));
+            for (int i = 2; i < argc; ++i) new_values.push_back(value_from_sqlite(argv[i]));
+            int64_t rowid = sqlite3_value_type(argv[1]) == SQLITE_NULL ? -1 : sqlite3_value_int64(argv[1]);
+            detail::publish_change(*def, ChangeOp::Insert, rowid, {}, std::move(new_values));
+        }
         return SQLITE_OK;
     }
 
     return SQLITE_READONLY;
 }
 
+// Transaction hooks: only used to flush or discard batched inserts
+inline int vtab_begin(sqlite3_vtab* pVtab) {
+    auto* vtab = reinterpret_cast<Vtab*>(pVtab);
+    vtab->pending_inserts.clear();
+    vtab->savepoint_marks.clear();
+    return SQLITE_OK;
+}
+
+inline int vtab_sync(sqlite3_vtab* pVtab) {
+    return detail::flush_pending_inserts(reinterpret_cast<Vtab*>(pVtab));
+}
+
+inline int vtab_commit(sqlite3_vtab*) {
+    return SQLITE_OK;
+}
+
+inline int vtab_rollback(sqlite3_vtab* pVtab) {
+    auto* vtab = reinterpret_cast<Vtab*>(pVtab);
+    vtab->pending_inserts.clear();
+    vtab->savepoint_marks.clear();
+    return SQLITE_OK;
+}
+
+// Savepoints (including SQLite's statement savepoints) only need to know
+// how many rows were buffered when they opened. A table that joins the
+// transaction late is told only about the newest savepoint, so older ones
+// get the current count, which predates all of its rows.
+inline int vtab_savepoint(sqlite3_vtab* pVtab, int i) {
+    auto* vtab = reinterpret_cast<Vtab*>(pVtab);
+    size_t n = static_cast<size_t>(i);
+    vtab->savepoint_marks.resize(n, vtab->pending_inserts.size());
+    vtab->savepoint_marks.push_back(vtab->pending_inserts.size());
+    return SQLITE_OK;
+}
+
+inline int vtab_release(sqlite3_vtab* pVtab, int i) {
+    auto* vtab = reinterpret_cast<Vtab*>(pVtab);
+    size_t n = static_cast<size_t>(i);
+    if (n < vtab->savepoint_marks.size()) vtab->savepoint_marks.resize(n);
+    return SQLITE_OK;
+}
+
+inline int vtab_rollback_to(sqlite3_vtab* pVtab, int i) {
+    auto* vtab = reinterpret_cast<Vtab*>(pVtab);
+    size_t n = static_cast<size_t>(i);
+    if (n < vtab->savepoint_marks.size()) {
+        vtab->pending_inserts.resize(vtab->savepoint_marks[n]);
+        vtab->savepoint_marks.resize(n + 1);  // savepoint i stays open
+    }
+    return SQLITE_OK;
+}
+
 // Create module with xUpdate support
 inline sqlite3_module create_module() {
     sqlite3_module mod = {};
-    mod.iVersion = 0;
+    mod.iVersion = 2;
     mod.xCreate = vtab_connect;
     mod.xConnect = vtab_connect;
     mod.xBestIndex = vtab_best_index;
@@ -514,6 +784,13 @@ inline sqlite3_module create_module() {
     mod.xColumn = vtab_column;
     mod.xRowid = vtab_rowid;
     mod.xUpdate = vtab_update;
+    mod.xBegin = vtab_begin;
+    mod.xSync = vtab_sync;
+    mod.xCommit = vtab_commit;
+    mod.xRollback = vtab_rollback;
+    mod.xSavepoint = vtab_savepoint;
+    mod.xRelease = vtab_release;
+    mod.xRollbackTo = vtab_rollback_to;
     return mod;
 }
 
@@ -592,6 +869,18 @@ public:
         return *this;
     }
 
+    // Data generation counter; enables result caching for this table
+    VTableBuilder& generation(std::function<uint64_t()> fn) {
+        def_.generation_fn = std::move(fn);
+        return *this;
+    }
+
+    // Publish a ChangeEvent for every row changed by INSERT/UPDATE/DELETE
+    VTableBuilder& change_feed(std::shared_ptr<ChangeFeed> feed) {
+        def_.change_feed = std::move(feed);
+        return *this;
+    }
+
     // Read-only integer column (int64)
     VTableBuilder& column_int64(const char* name, std::function<int64_t(size_t)> getter) {
         def_.columns.emplace_back(name, ColumnType::Integer, false,
@@ -704,6 +993,14 @@ public:
         return *this;
     }
 
+    // Enable batched INSERT support: rows arrive as Values in schema order,
+    // all rows of a transaction in one call when it commits
+    VTableBuilder& insertable_batch(std::function<bool(const std::vector<std::vector<Value>>& rows)> insert_fn) {
+        def_.supports_insert = true;
+        def_.insert_rows = std::move(insert_fn);
+        return *this;
+    }
+
     // ========================================================================
     // Constraint Pushdown Filters
     // ========================================================================
@@ -769,6 +1066,49 @@ public:
         return *this;
     }
 
+    // ========================================================================
+    // Primary Key
+    // ========================================================================
+
+    /**
+     * Declare an existing int64 column as the PRIMARY KEY and how to find a
+     * row by key. The table is declared WITHOUT ROWID: UPDATE and DELETE
+     * address rows through locate() instead of a positional rowid, and
+     * WHERE column = value costs one locate() call instead of a scan.
+     *
+     * Example:
+     *   .primary_key("ea", [&](int64_t ea, size_t& row) {
+     *       auto it = by_ea.find(ea);
+     *       if (it == by_ea.end()) return false;
+     *       row = it->second;
+     *       return true;
+     *   })
+     */
+    VTableBuilder& primary_key(const char* column_name, std::function<bool(int64_t key, size_t& row)> locate) {
+        int col_idx = def_.find_column(column_name);
+        if (col_idx < 0) return *this;
+        def_.primary_key_column = col_idx;
+        def_.locate_row = [locate = std::move(locate)](sqlite3_value* key, size_t& row) {
+            return locate(sqlite3_value_int64(key), row);
+        };
+        return *this;
+    }
+
+    /**
+     * Declare an existing text column as the PRIMARY KEY.
+     */
+    VTableBuilder& primary_key_text(const char* column_name,
+                                    std::function<bool(const char* key, size_t& row)> locate) {
+        int col_idx = def_.find_column(column_name);
+        if (col_idx < 0) return *this;
+        def_.primary_key_column = col_idx;
+        def_.locate_row = [locate = std::move(locate)](sqlite3_value* key, size_t& row) {
+            const char* text = reinterpret_cast<const char*>(sqlite3_value_text(key));
+            return locate(text ? text : "", row);
+        };
+        return *this;
+    }
+
     VTableDef build() { return std::move(def_); }
 };
 
@@ -831,33 +1171,147 @@ struct CachedIndexDef {
     std::function<int64_t(const void*)> key_extractor;       // Extract key from row (type-erased)
 };
 
+#ifdef XSQL_HAS_PMR
+/**
+ * RowData that takes a std::pmr allocator (declares allocator_type and the
+ * allocator-extended constructors). Cached tables of such rows build each
+ * cache generation into one monotonic arena: every row and every string in
+ * it come from a few large blocks, and invalidate_cache() drops them all at
+ * once instead of freeing rows one by one.
+ */
+template<typename RowData>
+inline constexpr bool is_pmr_row_v =
+    std::uses_allocator_v<RowData, std::pmr::polymorphic_allocator<std::byte>>;
+
+template<typename RowData>
+using cache_vector_t = std::conditional_t<is_pmr_row_v<RowData>, std::pmr::vector<RowData>, std::vector<RowData>>;
+
+namespace detail {
+
+// Memory resource for one cache generation. The cache's vector keeps a
+// pointer to it for life; release() drops the current arena, and the next
+// allocation starts a new one. Locked because writable cached tables may
+// assign strings from any connection sharing the cache.
+class CacheArena : public std::pmr::memory_resource {
+    std::unique_ptr<std::pmr::monotonic_buffer_resource> arena_;
+    size_t next_block_ = 64 * 1024;
+    size_t allocated_ = 0;
+    mutable std::mutex mutex_;
+
+public:
+    /// Size the first block of the next arena, e.g. from estimate_rows
+    void hint(size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        bytes = (std::min)(bytes, size_t(64) * 1024 * 1024);
+        if (!arena_ && bytes > next_block_) next_block_ = bytes;
+    }
+
+    void release() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        arena_.reset();
+        allocated_ = 0;
+        next_block_ = 64 * 1024;
+    }
+
+    /// Bytes handed out from the current arena
+    size_t allocated() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return allocated_;
+    }
+
+private:
+    void* do_allocate(size_t bytes, size_t align) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!arena_) arena_ = std::make_unique<std::pmr::monotonic_buffer_resource>(next_block_);
+        allocated_ += bytes;
+        return arena_->allocate(bytes, align);
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {}   // Freed with the arena
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+} // namespace detail
+#else
+template<typename RowData>
+inline constexpr bool is_pmr_row_v = false;
+
+template<typename RowData>
+using cache_vector_t = std::vector<RowData>;
+#endif
+
 // Shared cache with indexes - lazily built, shared across all cursors
 template<typename RowData>
 struct SharedCache {
-    std::vector<RowData> data;
+#ifdef XSQL_HAS_PMR
+    // Declared before data so it outlives the rows that point into it
+    detail::CacheArena arena;
+    cache_vector_t<RowData> data = make_data();
+#else
+    cache_vector_t<RowData> data;
+#endif
+    // Read-only rows mapped from a shared memory segment (replaces data when set)
+    std::shared_ptr<ShmSegment> segment;
     // Map from column value -> list of row indices in data
     std::vector<std::unordered_map<int64_t, std::vector<size_t>>> indexes;
     bool built = false;
+    // Bumped by invalidate_cache(); the cache content is fixed in between
+    std::atomic<uint64_t> generation{0};
     mutable std::mutex mutex;
+
+    size_t size() const { return segment ? segment->row_count() : data.size(); }
+
+    const RowData& row(size_t i) const {
+        if (segment) return static_cast<const RowData*>(segment->rows())[i];
+        return data[i];
+    }
+
+    // Destroy the rows and return their memory (for pmr rows, the whole arena)
+    void drop_rows() {
+        cache_vector_t<RowData>(data.get_allocator()).swap(data);
+#ifdef XSQL_HAS_PMR
+        arena.release();
+#endif
+    }
+
+private:
+#ifdef XSQL_HAS_PMR
+    cache_vector_t<RowData> make_data() {
+        if constexpr (is_pmr_row_v<RowData>) {
+            return cache_vector_t<RowData>(&arena);
+        } else {
+            return {};
+        }
+    }
+#endif
 };
 
 template<typename RowData>
 struct CachedTableDef {
     std::string name;
     std::function<size_t()> estimate_rows_fn;
-    std::function<void(std::vector<RowData>&)> cache_builder_fn;
+    std::function<void(cache_vector_t<RowData>&)> cache_builder_fn;
     std::vector<CachedColumnDef<RowData>> columns;
     std::vector<FilterDef> filters;
     std::function<bool(RowData&)> delete_row;
     bool supports_delete = false;
     std::function<void(const std::string&)> before_modify;
 
+    // Extra data generation (optional); invalidate_cache() bumps the cache's own
+    std::function<uint64_t()> generation_fn;
+
     // Index definitions: column index -> key extractor
     std::vector<std::pair<int, std::function<int64_t(const RowData&)>>> index_defs;
 
     // Shared cache - lazily built on first query, shared across all cursors
     mutable std::shared_ptr<SharedCache<RowData>> shared_cache;
 
+    // Cross-process shared memory segment name (empty = private cache only)
+    std::string shm_name;
+    uint64_t shm_layout_version = 0;
+    std::function<uint64_t()> shm_source_key_fn;  // Identity of the source data (optional)
+
     std::string schema() const {
         std::ostringstream ss;
         ss << "CREATE TABLE " << name << "(";
@@ -883,6 +1337,14 @@ struct CachedTableDef {
         return nullptr;
     }
 
+    // Cached rows only change through invalidate_cache(), so always versioned
+    bool has_generation() const { return true; }
+
+    uint64_t generation() const {
+        return (shared_cache ? shared_cache->generation.load() : 0) +
+               (generation_fn ? generation_fn() : 0);
+    }
+
     // Find index position for a column (-1 if not indexed)
     int find_index(int col_index) const {
         for (size_t i = 0; i < index_defs.size(); ++i) {
@@ -899,9 +1361,20 @@ struct CachedTableDef {
         std::lock_guard<std::mutex> lock(shared_cache->mutex);
         if (shared_cache->built) return;
 
-        // Build the cache
-        if (cache_builder_fn) {
-            cache_builder_fn(shared_cache->data);
+        // Map a cache another process already published, else build it
+        if (!attach_shm_segment()) {
+            if (cache_builder_fn) {
+#ifdef XSQL_HAS_PMR
+                if constexpr (is_pmr_row_v<RowData>) {
+                    // Reserve up front so vector growth does not strand copies in the arena
+                    size_t estimate = estimate_rows_fn ? estimate_rows_fn() : 0;
+                    shared_cache->arena.hint(estimate * sizeof(RowData) * 2);
+                    shared_cache->data.reserve(estimate);
+                }
+#endif
+                cache_builder_fn(shared_cache->data);
+            }
+            publish_shm_segment();
         }
 
         // Build indexes
@@ -909,8 +1382,8 @@ struct CachedTableDef {
         for (size_t idx = 0; idx < index_defs.size(); ++idx) {
             auto& index_map = shared_cache->indexes[idx];
             const auto& key_fn = index_defs[idx].second;
-            for (size_t row = 0; row < shared_cache->data.size(); ++row) {
-                int64_t key = key_fn(shared_cache->data[row]);
+            for (size_t row = 0; row < shared_cache->size(); ++row) {
+                int64_t key = key_fn(shared_cache->row(row));
                 index_map[key].push_back(row);
             }
         }
@@ -922,15 +1395,52 @@ struct CachedTableDef {
     void invalidate_cache() const {
         if (shared_cache) {
             std::lock_guard<std::mutex> lock(shared_cache->mutex);
-            shared_cache->data.clear();
+            shared_cache->drop_rows();
+            shared_cache->segment.reset();
             shared_cache->indexes.clear();
             shared_cache->built = false;
+            shared_cache->generation.fetch_add(1);
+            // The published rows are stale for every process; the next build republishes
+            if (!shm_name.empty()) ShmSegment::unlink(shm_name);
+        }
+    }
+
+private:
+    uint64_t shm_source_key() const { return shm_source_key_fn ? shm_source_key_fn() : 0; }
+
+    // Called with shared_cache->mutex held
+    bool attach_shm_segment() const {
+        if constexpr (std::is_trivially_copyable_v<RowData>) {
+            if (shm_name.empty()) return false;
+            shared_cache->segment = ShmSegment::open(shm_name, sizeof(RowData), alignof(RowData),
+                                                     shm_layout_version, shm_source_key());
+            return shared_cache->segment != nullptr;
+        }
+        return false;
+    }
+
+    // Called with shared_cache->mutex held, after building into data
+    void publish_shm_segment() const {
+        if constexpr (std::is_trivially_copyable_v<RowData>) {
+            if (shm_name.empty()) return;
+            auto& data = shared_cache->data;
+            const uint64_t source_key = shm_source_key();
+            if (!ShmSegment::publish(shm_name, data.data(), data.size(), sizeof(RowData),
+                                     alignof(RowData), shm_layout_version, source_key)) {
+                return;  // Another process owns the name; keep the private copy
+            }
+            // Serve from the shared mapping so this process does not hold a second copy
+            shared_cache->segment = ShmSegment::open(shm_name, sizeof(RowData), alignof(RowData),
+                                                     shm_layout_version, source_key);
+            if (shared_cache->segment) {
+                shared_cache->drop_rows();
+            }
         }
     }
 };
 
 template<typename RowData>
-struct CachedCursor {
+struct CachedCursor : detail::ArenaAllocated {
     sqlite3_vtab_cursor base;
     const CachedTableDef<RowData>* def;
     std::vector<RowData> cache;           // Used only for non-shared fallback
@@ -947,7 +1457,7 @@ struct CachedCursor {
 };
 
 template<typename RowData>
-struct CachedVtab {
+struct CachedVtab : detail::ArenaAllocated {
     sqlite3_vtab base;
     const CachedTableDef<RowData>* def;
 };
@@ -1021,7 +1531,7 @@ inline int cached_vtab_eof(sqlite3_vtab_cursor* pCursor) {
     }
     // Full scan using shared cache
     if (cursor->def->shared_cache && cursor->def->shared_cache->built) {
-        return cursor->current_row >= cursor->def->shared_cache->data.size() ? 1 : 0;
+        return cursor->current_row >= cursor->def->shared_cache->size() ? 1 : 0;
     }
     return cursor->current_row >= cursor->cache.size() ? 1 : 0;
 }
@@ -1044,8 +1554,8 @@ inline int cached_vtab_column(sqlite3_vtab_cursor* pCursor, sqlite3_context* ctx
         if (cursor->index_matches && cursor->index_pos < cursor->index_matches->size()) {
             size_t row_idx = (*cursor->index_matches)[cursor->index_pos];
             const auto& shared = cursor->def->shared_cache;
-            if (shared && row_idx < shared->data.size()) {
-                cursor->def->columns[col].get(ctx, shared->data[row_idx]);
+            if (shared && row_idx < shared->size()) {
+                cursor->def->columns[col].get(ctx, shared->row(row_idx));
             } else {
                 sqlite3_result_null(ctx);
             }
@@ -1055,8 +1565,8 @@ inline int cached_vtab_column(sqlite3_vtab_cursor* pCursor, sqlite3_context* ctx
     } else {
         // Full scan: use shared cache if available, else local cache
         const auto& shared = cursor->def->shared_cache;
-        if (shared && shared->built && cursor->current_row < shared->data.size()) {
-            cursor->def->columns[col].get(ctx, shared->data[cursor->current_row]);
+        if (shared && shared->built && cursor->current_row < shared->size()) {
+            cursor->def->columns[col].get(ctx, shared->row(cursor->current_row));
         } else if (cursor->current_row < cursor->cache.size()) {
             cursor->def->columns[col].get(ctx, cursor->cache[cursor->current_row]);
         } else {
@@ -1246,6 +1756,11 @@ inline bool register_cached_vtable(sqlite3* db, const char* module_name,
                                    const CachedTableDef<RowData>* def) {
     if (!db || !module_name || !def) return false;
 
+    // Create the shared cache before cloning so every copy sees the same one
+    if (!def->shared_cache) {
+        def->shared_cache = std::make_shared<SharedCache<RowData>>();
+    }
+
     auto* owned = detail::clone_def(def);
     if (!owned) return false;
 
@@ -1279,7 +1794,8 @@ public:
         return *this;
     }
 
-    CachedTableBuilder& cache_builder(std::function<void(std::vector<RowData>&)> fn) {
+    /// fn fills the cache; for pmr RowData it receives a std::pmr::vector over the generation's arena
+    CachedTableBuilder& cache_builder(std::function<void(cache_vector_t<RowData>&)> fn) {
         def_.cache_builder_fn = std::move(fn);
         return *this;
     }
@@ -1289,6 +1805,12 @@ public:
         return *this;
     }
 
+    // Extra data generation counter, combined with the cache's own
+    CachedTableBuilder& generation(std::function<uint64_t()> fn) {
+        def_.generation_fn = std::move(fn);
+        return *this;
+    }
+
     CachedTableBuilder& column_int64(const char* name, std::function<int64_t(const RowData&)> getter) {
         def_.columns.emplace_back(name, ColumnType::Integer, false,
             [getter = std::move(getter)](sqlite3_context* ctx, const RowData& row) {
@@ -1380,6 +1902,36 @@ public:
         return *this;
     }
 
+    /**
+     * Share the built cache with other processes through a named POSIX
+     * shared memory segment (see shm_cache.hpp).
+     *
+     * The first process to build the cache publishes it; later processes map
+     * it read-only and skip cache_builder entirely. Only available for
+     * trivially copyable RowData without pointers (no std::string either).
+     *
+     * Segments outlive the processes that use them, so a process started
+     * after the source changed would map the previous rows. source_key names
+     * the data the rows come from (e.g. a hash of the input file's path,
+     * size and mtime); it is asked before every attach and publish, and a
+     * segment built from another key is rebuilt and replaced.
+     *
+     * @param segment_name   POSIX shm name, e.g. "/myapp_xrefs"
+     * @param layout_version Bump when RowData changes shape
+     * @param source_key     Identity of the source data (nullptr: always 0)
+     */
+    CachedTableBuilder& shared_memory(const char* segment_name, uint64_t layout_version = 0,
+                                      std::function<uint64_t()> source_key = nullptr) {
+        static_assert(std::is_trivially_copyable_v<RowData>,
+                      "shared_memory() requires trivially copyable RowData");
+        static_assert(shm_pointer_free_v<RowData>,
+                      "shared_memory() RowData must not hold pointers; they are meaningless in another process");
+        def_.shm_name = segment_name ? segment_name : "";
+        def_.shm_layout_version = layout_version;
+        def_.shm_source_key_fn = std::move(source_key);
+        return *this;
+    }
+
     CachedTableDef<RowData> build() {
         // Pre-create the shared cache so all copies share the same instance
         def_.shared_cache = std::make_shared<SharedCache<RowData>>();
@@ -1419,6 +1971,183 @@ struct Generator {
 
     // Current rowid (valid only after next() returns true)
     virtual sqlite3_int64 rowid() const = 0;
+
+    // Optional, for tables declared seekable(): position so that the next
+    // next() returns the first row whose seek key (the rowid, or the
+    // declared key column) is >= key. Called at most once, before the first
+    // next(). Return false if unsupported; the scan then starts at the
+    // beginning. SQLite still checks the constraint on every row.
+    virtual bool seek(sqlite3_int64 /*key*/) { return false; }
+};
+
+/**
+ * What a full scan will read, for generators created by scan() factories.
+ *
+ * columns_used is SQLite's colUsed mask: bit i set if column i is read (bit
+ * 63 covers column 63 and above). offset and limit are only set when the
+ * query is a plain scan of this table (no other WHERE terms, no ORDER BY):
+ * the generator must skip `offset` rows itself, and may stop after `limit`
+ * rows (-1 = no limit; SQLite enforces LIMIT anyway). A lower bound on a
+ * seekable() key still allows a limit (never an offset); it then counts rows
+ * from the seek position.
+ */
+struct GeneratorScan {
+    uint64_t columns_used = ~0ull;
+    int64_t offset = 0;
+    int64_t limit = -1;
+
+    bool uses_column(size_t col) const {
+        return (columns_used >> (col < 63 ? col : 63)) & 1;
+    }
+};
+
+// ============================================================================
+// Push-to-Pull Adapter
+// ============================================================================
+//
+// Adapts callback enumerators (`source.enumerate(callback)`) to Generator:
+// the enumerator runs on a producer thread started by the first next(), and
+// rows are handed to the cursor in batches of up to batch_rows. The producer
+// is at most two batches ahead of the cursor, so LIMIT stops the work early.
+//
+// The sink returns false once the cursor no longer wants rows (LIMIT reached
+// or cursor closed); the enumerator should then return. One that ignores it
+// runs to completion, with rows dropped, before the cursor finishes closing.
+// An exception thrown by the enumerator ends the scan: the rows emitted before
+// it are still returned, then next() rethrows it and the query fails.
+
+template<typename RowData>
+class PushGenerator;
+
+template<typename RowData>
+class PushSink {
+    PushGenerator<RowData>* gen_;
+public:
+    explicit PushSink(PushGenerator<RowData>* gen) : gen_(gen) {}
+
+    // Emit one row; false means stop enumerating
+    bool operator()(RowData row) { return gen_->push(std::move(row)); }
+};
+
+template<typename RowData>
+using PushEnumerator = std::function<void(PushSink<RowData>&)>;
+
+template<typename RowData>
+class PushGenerator : public Generator<RowData> {
+    friend class PushSink<RowData>;
+
+    PushEnumerator<RowData> enumerate_;
+    size_t batch_rows_;
+    std::thread producer_;
+
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::vector<RowData> ready_;      // Handed off, waiting for the cursor
+    bool finished_ = false;           // Producer returned; ready_ is the last batch
+    std::exception_ptr error_;        // Thrown by the enumerator, reported after ready_
+    std::atomic<bool> closed_{false};
+
+    // Producer side
+    std::vector<RowData> filling_;
+    int64_t skip_ = 0;
+    int64_t remaining_ = -1;
+
+    // Cursor side
+    std::vector<RowData> reading_;
+    size_t pos_ = static_cast<size_t>(-1);
+    sqlite3_int64 rowid_ = -1;
+
+    bool push(RowData&& row) {
+        if (closed_.load(std::memory_order_relaxed)) return false;
+        if (skip_ > 0) {
+            --skip_;
+            return true;
+        }
+        if (remaining_ == 0) return false;
+        filling_.push_back(std::move(row));
+        if (remaining_ > 0) --remaining_;
+        if ((filling_.size() >= batch_rows_ || remaining_ == 0) && !hand_off()) return false;
+        return remaining_ != 0;
+    }
+
+    // Wait for the cursor to take the previous batch, then publish filling_
+    bool hand_off() {
+        std::unique_lock<std::mutex> lock(mu_);
+        cv_.wait(lock, [this] { return ready_.empty() || closed_.load(); });
+        if (closed_.load()) return false;
+        std::swap(ready_, filling_);
+        cv_.notify_all();
+        return true;
+    }
+
+    void produce() {
+        PushSink<RowData> sink(this);
+        std::exception_ptr error;
+        try {
+            enumerate_(sink);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        if (!filling_.empty()) hand_off();
+        std::lock_guard<std::mutex> lock(mu_);
+        error_ = error;
+        finished_ = true;
+        cv_.notify_all();
+    }
+
+public:
+    /**
+     * `scan` supplies a pushed-down LIMIT/OFFSET (see GeneratorScan): the
+     * first offset rows are dropped and the sink stops after limit rows.
+     * Rowids count rows from the start of the enumeration.
+     */
+    explicit PushGenerator(PushEnumerator<RowData> enumerate, const GeneratorScan& scan = {},
+                           size_t batch_rows = 256)
+        : enumerate_(std::move(enumerate)), batch_rows_(std::max<size_t>(1, batch_rows)),
+          skip_(scan.offset), remaining_(scan.limit) {
+        if (remaining_ > 0 && static_cast<uint64_t>(remaining_) < batch_rows_) {
+            batch_rows_ = static_cast<size_t>(remaining_);
+        }
+        rowid_ = scan.offset - 1;
+    }
+
+    ~PushGenerator() override {
+        {
+            std::lock_guard<std::mutex> lock(mu_);
+            closed_.store(true);
+            cv_.notify_all();
+        }
+        if (producer_.joinable()) producer_.join();
+    }
+
+    PushGenerator(const PushGenerator&) = delete;
+    PushGenerator& operator=(const PushGenerator&) = delete;
+
+    bool next() override {
+        if (++pos_ < reading_.size()) {
+            ++rowid_;
+            return true;
+        }
+        reading_.clear();
+        pos_ = 0;
+        if (!producer_.joinable()) {
+            if (remaining_ == 0) return false;
+            producer_ = std::thread([this] { produce(); });
+        }
+        std::unique_lock<std::mutex> lock(mu_);
+        cv_.wait(lock, [this] { return !ready_.empty() || finished_; });
+        if (ready_.empty()) {
+            if (error_) std::rethrow_exception(std::exchange(error_, nullptr));
+            return false;
+        }
+        std::swap(reading_, ready_);
+        cv_.notify_all();
+        ++rowid_;
+        return true;
+    }
+
+    const RowData& current() const override { return reading_[pos_]; }
+    sqlite3_int64 rowid() const override { return rowid_; }
 };
 
 template<typename RowData>
@@ -1426,9 +2155,23 @@ struct GeneratorTableDef {
     std::string name;
     std::function<size_t()> estimate_rows_fn;
     std::function<std::unique_ptr<Generator<RowData>>()> generator_factory_fn;
+
+    // Scan-aware factory (optional, takes precedence over generator_factory_fn)
+    std::function<std::unique_ptr<Generator<RowData>>(const GeneratorScan&)> scan_factory_fn;
     std::vector<CachedColumnDef<RowData>> columns;
     std::vector<FilterDef> filters;
 
+    // Data generation (optional); result caches only trust tables that provide one
+    std::function<uint64_t()> generation_fn;
+
+    // Generators support seek() on this key: -1 = rowid, else an INTEGER
+    // column whose values never decrease along the scan
+    bool seekable = false;
+    int seek_column = -1;
+
+    bool has_generation() const { return static_cast<bool>(generation_fn); }
+    uint64_t generation() const { return generation_fn ? generation_fn() : 0; }
+
     std::string schema() const {
         std::ostringstream ss;
         ss << "CREATE TABLE " << name << "(";
@@ -1455,8 +2198,42 @@ struct GeneratorTableDef {
     }
 };
 
+namespace detail {
+
+// Largest integer <= v; false if v is not a number (then no seek is done)
+inline bool generator_seek_key(sqlite3_value* v, bool strict, sqlite3_int64& key) {
+    switch (sqlite3_value_numeric_type(v)) {
+        case SQLITE_INTEGER:
+            key = sqlite3_value_int64(v);
+            if (!strict) return true;
+            if (key == std::numeric_limits<sqlite3_int64>::max()) return false;
+            ++key;
+            return true;
+        case SQLITE_FLOAT: {
+            double d = sqlite3_value_double(v);
+            if (!(d > -9.2e18 && d < 9.2e18)) return false;
+            key = static_cast<sqlite3_int64>(d);
+            if (static_cast<double>(key) > d) --key;
+            // Smallest integer key satisfying the bound
+            if (strict || static_cast<double>(key) < d) ++key;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+// Report an exception escaping a generator as the statement's error
+inline int generator_error(sqlite3_vtab_cursor* pCursor, const char* msg) {
+    sqlite3_free(pCursor->pVtab->zErrMsg);
+    pCursor->pVtab->zErrMsg = sqlite3_mprintf("%s", msg);
+    return SQLITE_ERROR;
+}
+
+} // namespace detail
+
 template<typename RowData>
-struct GeneratorCursor {
+struct GeneratorCursor : detail::ArenaAllocated {
     sqlite3_vtab_cursor base;
     const GeneratorTableDef<RowData>* def = nullptr;
     std::unique_ptr<Generator<RowData>> generator;
@@ -1467,7 +2244,7 @@ struct GeneratorCursor {
 };
 
 template<typename RowData>
-struct GeneratorVtab {
+struct GeneratorVtab : detail::ArenaAllocated {
     sqlite3_vtab base;
     const GeneratorTableDef<RowData>* def = nullptr;
 };
@@ -1521,8 +2298,16 @@ inline int generator_vtab_next(sqlite3_vtab_cursor* pCursor) {
             cursor->iterator_eof = true;
         }
     } else {
-        if (!cursor->generator || !cursor->generator->next()) {
+        try {
+            if (!cursor->generator || !cursor->generator->next()) {
+                cursor->generator_eof = true;
+            }
+        } catch (const std::exception& e) {
+            cursor->generator_eof = true;
+            return detail::generator_error(pCursor, e.what());
+        } catch (...) {
             cursor->generator_eof = true;
+            return detail::generator_error(pCursor, "generator failed");
         }
     }
     return SQLITE_OK;
@@ -1586,7 +2371,7 @@ inline int generator_vtab_rowid(sqlite3_vtab_cursor* pCursor, sqlite3_int64* pRo
 }
 
 template<typename RowData>
-inline int generator_vtab_filter(sqlite3_vtab_cursor* pCursor, int idxNum, const char*,
+inline int generator_vtab_filter(sqlite3_vtab_cursor* pCursor, int idxNum, const char* idxStr,
                                  int argc, sqlite3_value** argv) {
     auto* cursor = reinterpret_cast<GeneratorCursor<RowData>*>(pCursor);
 
@@ -1613,10 +2398,43 @@ inline int generator_vtab_filter(sqlite3_vtab_cursor* pCursor, int idxNum, const
     // Full scan - create generator and position to first row.
     cursor->using_iterator = false;
     cursor->generator_eof = true;
-    if (cursor->def->generator_factory_fn) {
+    GeneratorScan scan;
+    if (cursor->def->scan_factory_fn) {
+        // idxStr = "<colUsed hex>:<limit argv>:<offset argv>" from xBestIndex
+        int limit_arg = 0;
+        int offset_arg = 0;
+        unsigned long long used = 0;
+        if (idxStr && sscanf(idxStr, "%llx:%d:%d", &used, &limit_arg, &offset_arg) == 3) {
+            scan.columns_used = used;
+            if (limit_arg > 0 && limit_arg <= argc) scan.limit = sqlite3_value_int64(argv[limit_arg - 1]);
+            if (offset_arg > 0 && offset_arg <= argc) {
+                scan.offset = std::max<int64_t>(0, sqlite3_value_int64(argv[offset_arg - 1]));
+            }
+        }
+        cursor->generator = cursor->def->scan_factory_fn(scan);
+    } else if (cursor->def->generator_factory_fn) {
         cursor->generator = cursor->def->generator_factory_fn();
-        if (cursor->generator) {
+    }
+    if (cursor->generator) {
+        sqlite3_int64 key = 0;
+        try {
+            if ((idxNum == FILTER_SEEK || idxNum == FILTER_SEEK_AFTER) && argc > 0) {
+                bool sought = detail::generator_seek_key(argv[0], idxNum == FILTER_SEEK_AFTER, key) &&
+                              cursor->generator->seek(key);
+                // A pushed LIMIT counts rows from the bound; a generator that
+                // starts from the beginning must not stop after it
+                if (!sought && scan.limit >= 0) {
+                    scan.limit = -1;
+                    cursor->generator = cursor->def->scan_factory_fn(scan);
+                }
+            }
             cursor->generator_eof = !cursor->generator->next();
+        } catch (const std::exception& e) {
+            cursor->generator_eof = true;
+            return detail::generator_error(pCursor, e.what());
+        } catch (...) {
+            cursor->generator_eof = true;
+            return detail::generator_error(pCursor, "generator failed");
         }
     }
     return SQLITE_OK;
@@ -1658,6 +2476,65 @@ inline int generator_vtab_best_index(sqlite3_vtab* pVtab, sqlite3_index_info* pI
         pInfo->idxNum = FILTER_NONE;
         pInfo->estimatedCost = static_cast<double>(estimated_rows);
         pInfo->estimatedRows = estimated_rows;
+
+        // `key > ?` / `key >= ?` on the seek key starts the scan at the first
+        // key satisfying it; the term is not omitted, so SQLite still checks
+        // it when the generator cannot seek
+        int seek_idx = -1;
+        if (def->seekable) {
+            for (int i = 0; i < pInfo->nConstraint; i++) {
+                const auto& constraint = pInfo->aConstraint[i];
+                if (!constraint.usable || constraint.iColumn != def->seek_column) continue;
+                if (constraint.op == SQLITE_INDEX_CONSTRAINT_GT || constraint.op == SQLITE_INDEX_CONSTRAINT_GE) {
+                    seek_idx = i;
+                    break;
+                }
+            }
+        }
+        if (seek_idx >= 0) {
+            pInfo->aConstraintUsage[seek_idx].argvIndex = 1;
+            pInfo->idxNum = pInfo->aConstraint[seek_idx].op == SQLITE_INDEX_CONSTRAINT_GT ? FILTER_SEEK_AFTER
+                                                                                           : FILTER_SEEK;
+            pInfo->estimatedCost = static_cast<double>(estimated_rows) / 4 + 1;
+            pInfo->estimatedRows = static_cast<sqlite3_int64>(estimated_rows / 4 + 1);
+        }
+
+        if (def->scan_factory_fn) {
+            // LIMIT/OFFSET only mean "rows of this scan" when SQLite filters
+            // and sorts nothing after us
+            int limit_idx = -1;
+            int offset_idx = -1;
+            bool other_terms = pInfo->nOrderBy > 0;
+            for (int i = 0; i < pInfo->nConstraint; i++) {
+                const auto& constraint = pInfo->aConstraint[i];
+                if (i == seek_idx) continue;  // Rows before the seek position are never produced
+                if (constraint.op == SQLITE_INDEX_CONSTRAINT_LIMIT && constraint.usable) {
+                    limit_idx = i;
+                } else if (constraint.op == SQLITE_INDEX_CONSTRAINT_OFFSET && constraint.usable) {
+                    offset_idx = i;
+                } else {
+                    other_terms = true;
+                }
+            }
+            // Past a seek SQLite applies OFFSET (and so LIMIT) itself, since
+            // a generator that cannot seek yields rows it will drop
+            if (seek_idx >= 0 && offset_idx >= 0) other_terms = true;
+            int limit_arg = 0;
+            int offset_arg = 0;
+            int next_arg = seek_idx >= 0 ? 2 : 1;
+            if (!other_terms && limit_idx >= 0) {
+                limit_arg = next_arg++;
+                pInfo->aConstraintUsage[limit_idx].argvIndex = limit_arg;
+            }
+            if (!other_terms && offset_idx >= 0) {
+                offset_arg = next_arg++;
+                pInfo->aConstraintUsage[offset_idx].argvIndex = offset_arg;
+                pInfo->aConstraintUsage[offset_idx].omit = 1;
+            }
+            pInfo->idxStr = sqlite3_mprintf("%llx:%d:%d", static_cast<unsigned long long>(pInfo->colUsed),
+                                            limit_arg, offset_arg);
+            pInfo->needToFreeIdxStr = 1;
+        }
     }
     return SQLITE_OK;
 }
@@ -1735,6 +2612,46 @@ public:
         return *this;
     }
 
+    // Factory that sees the referenced columns and a pushed-down LIMIT/OFFSET
+    // (see GeneratorScan); the generator must honor scan.offset
+    GeneratorTableBuilder& scan(std::function<std::unique_ptr<Generator<RowData>>(const GeneratorScan&)> fn) {
+        def_.scan_factory_fn = std::move(fn);
+        return *this;
+    }
+
+    // Callback-style source, run on a producer thread (see PushGenerator)
+    GeneratorTableBuilder& enumerate(PushEnumerator<RowData> fn, size_t batch_rows = 256) {
+        def_.scan_factory_fn = [fn = std::move(fn), batch_rows](const GeneratorScan& scan)
+                -> std::unique_ptr<Generator<RowData>> {
+            return std::make_unique<PushGenerator<RowData>>(fn, scan, batch_rows);
+        };
+        return *this;
+    }
+
+    // Generators implement seek() on the rowid, so `rowid > ?` pages start
+    // where the previous page ended instead of rescanning
+    GeneratorTableBuilder& seekable() {
+        def_.seekable = true;
+        def_.seek_column = -1;
+        return *this;
+    }
+
+    // Same, keyed on an INTEGER column whose values never decrease along the
+    // scan (define the column first)
+    GeneratorTableBuilder& seekable(const char* key_column) {
+        int col_idx = def_.find_column(key_column);
+        if (col_idx < 0) return *this;
+        def_.seekable = true;
+        def_.seek_column = col_idx;
+        return *this;
+    }
+
+    // Data generation counter; enables result caching for this table
+    GeneratorTableBuilder& generation(std::function<uint64_t()> fn) {
+        def_.generation_fn = std::move(fn);
+        return *this;
+    }
+
     GeneratorTableBuilder& column_int64(const char* name, std::function<int64_t(const RowData&)> getter) {
         def_.columns.emplace_back(name, ColumnType::Integer, false,
             [getter = std::move(getter)](sqlite3_context* ctx, const RowData& row) {
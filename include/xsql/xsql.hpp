@@ -5,7 +5,12 @@
  *
  * Include this single header to get all libxsql functionality:
  *   - VTableDef, VTableBuilder - Define virtual tables (read-only or writable)
+ *   - ChangeFeed - Row-level change events from writable tables
  *   - Database - RAII database wrapper with query helpers
+ *   - ConnectionPool - Per-thread connections for parallel readers
+ *   - install_allocator - Per-thread arena for SQLite and framework allocations
+ *   - csv_table - Memory-mapped CSV/TSV files as tables
+ *   - jsonl_table - Memory-mapped JSON Lines files as tables
  *   - SQL function registration utilities
  *
  * Example (read-only):
@@ -34,3 +39,7 @@
 #include "vtable.hpp"
 #include "functions.hpp"
 #include "database.hpp"
+#include "connection_pool.hpp"
+#include "allocator.hpp"
+#include "csv_table.hpp"
+#include "jsonl_table.hpp"
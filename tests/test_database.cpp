@@ -4,6 +4,11 @@
 
 #include <gtest/gtest.h>
 #include <xsql/xsql.hpp>
+#include <xsql/scheduler.hpp>
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <string>
 
@@ -172,3 +177,766 @@ TEST_F(DatabaseTest, Changes) {
     ASSERT_EQ(db_.exec("UPDATE test SET val = val * 2"), SQLITE_OK);
     EXPECT_EQ(db_.changes(), 3);
 }
+
+TEST_F(DatabaseTest, QueryWithBoundParameters) {
+    ASSERT_EQ(db_.exec("CREATE TABLE test (id INTEGER, name TEXT)"), SQLITE_OK);
+    ASSERT_EQ(db_.exec("INSERT INTO test VALUES (1, 'one'), (2, 'two'), (3, 'three')"), SQLITE_OK);
+
+    auto result = db_.query("SELECT name FROM test WHERE id >= ?1 AND name <> ?2 ORDER BY id",
+                            {xsql::Value::integer(2), xsql::Value::text("three")});
+    ASSERT_TRUE(result.ok()) << result.error;
+    ASSERT_EQ(result.size(), 1);
+    EXPECT_EQ(result[0][0], "two");
+
+    auto bad = db_.query("SELECT ?1", {xsql::Value::integer(1), xsql::Value::integer(2)});
+    EXPECT_FALSE(bad.ok());
+}
+
+TEST_F(DatabaseTest, NormalizeSqlTrimsButKeepsStatementText) {
+    EXPECT_EQ(xsql::normalize_sql("  SELECT  *\n FROM t ;\n"), "SELECT  *\n FROM t");
+    EXPECT_NE(xsql::normalize_sql("SELECT Name FROM t"), xsql::normalize_sql("select name from t"));
+    EXPECT_NE(xsql::normalize_sql("SELECT 'a'"), xsql::normalize_sql("SELECT 'A'"));
+    EXPECT_NE(xsql::make_query_cache_key("SELECT ?", {xsql::Value::integer(1)}),
+              xsql::make_query_cache_key("SELECT ?", {xsql::Value::text("1")}));
+}
+
+TEST_F(DatabaseTest, QueryCacheKeepsColumnNamesOfEachSpelling) {
+    db_.exec("CREATE TABLE t (Name TEXT)");
+    db_.exec("INSERT INTO t VALUES ('a')");
+    db_.enable_query_cache();
+
+    auto r = db_.query("SELECT upper(Name) FROM t");
+    ASSERT_TRUE(r.ok()) << r.error;
+    EXPECT_EQ(r.columns, std::vector<std::string>{"upper(Name)"});
+    r = db_.query("select upper(name) from t");
+    ASSERT_TRUE(r.ok()) << r.error;
+    EXPECT_EQ(r.columns, std::vector<std::string>{"upper(name)"});
+
+    db_.query("SELECT Name AS Foo FROM t");
+    r = db_.query("select name as foo from t");
+    ASSERT_TRUE(r.ok()) << r.error;
+    EXPECT_EQ(r.columns, std::vector<std::string>{"foo"});
+
+    r = db_.query("SELECT Name AS Foo FROM t;");
+    EXPECT_EQ(r.columns, std::vector<std::string>{"Foo"});
+    EXPECT_EQ(db_.query_cache_stats().hits, 1u);
+}
+
+TEST_F(DatabaseTest, QueryCacheHitsUntilGenerationChanges) {
+    static std::vector<int> data;
+    data = {1, 2, 3};
+    static uint64_t generation = 0;
+    static int getter_calls = 0;
+    getter_calls = 0;
+
+    auto table = xsql::table("versioned")
+        .count([]() { return data.size(); })
+        .generation([]() { return generation; })
+        .column_int("n", [](size_t i) { getter_calls++; return data[i]; })
+        .build();
+    ASSERT_TRUE(db_.register_and_create_table(table));
+    db_.enable_query_cache(1024 * 1024);
+
+    auto r1 = db_.query("SELECT SUM(n) FROM versioned");
+    ASSERT_TRUE(r1.ok()) << r1.error;
+    EXPECT_EQ(r1[0][0], "6");
+    int calls_after_first = getter_calls;
+
+    auto r2 = db_.query("SELECT SUM(n) FROM versioned;");
+    ASSERT_TRUE(r2.ok());
+    EXPECT_EQ(r2[0][0], "6");
+    EXPECT_EQ(getter_calls, calls_after_first);
+
+    data.push_back(4);
+    generation++;
+    auto r3 = db_.query("SELECT SUM(n) FROM versioned");
+    ASSERT_TRUE(r3.ok());
+    EXPECT_EQ(r3[0][0], "10");
+
+    auto stats = db_.query_cache_stats();
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.misses, 2u);
+    EXPECT_EQ(stats.stale, 1u);
+    EXPECT_EQ(stats.entries, 1u);
+    EXPECT_GT(stats.hit_rate(), 0.0);
+}
+
+TEST_F(DatabaseTest, ResultVersionFollowsTableGenerations) {
+    static std::vector<int> data;
+    data = {1, 2, 3};
+    static uint64_t generation = 0;
+
+    auto table = xsql::table("versioned")
+        .count([]() { return data.size(); })
+        .generation([]() { return generation; })
+        .column_int("n", [](size_t i) { return data[i]; })
+        .build();
+    ASSERT_TRUE(db_.register_and_create_table(table));
+    ASSERT_EQ(db_.exec("CREATE TABLE native (x INTEGER)"), SQLITE_OK);
+
+    uint64_t v1 = 0, v2 = 0, v3 = 0;
+    ASSERT_TRUE(db_.result_version("SELECT SUM(n) FROM versioned", {}, v1));
+    ASSERT_TRUE(db_.result_version(" SELECT SUM(n) FROM versioned;", {}, v2));
+    EXPECT_EQ(v1, v2);
+    ASSERT_TRUE(db_.result_version("SELECT SUM(n) FROM versioned WHERE n > ?1", {xsql::Value::integer(1)}, v3));
+    EXPECT_NE(v1, v3);
+
+    generation++;
+    ASSERT_TRUE(db_.result_version("SELECT SUM(n) FROM versioned", {}, v2));
+    EXPECT_NE(v1, v2);
+
+    // The same table registered on another connection gives the same version
+    xsql::Database other;
+    ASSERT_TRUE(other.register_and_create_table(table));
+    ASSERT_TRUE(other.result_version("SELECT SUM(n) FROM versioned", {}, v3));
+    EXPECT_EQ(v2, v3);
+
+    uint64_t v = 0;
+    EXPECT_FALSE(db_.result_version("SELECT * FROM native", {}, v));
+    EXPECT_FALSE(db_.result_version("SELECT random() FROM versioned", {}, v));
+    EXPECT_FALSE(db_.result_version("DELETE FROM native", {}, v));
+    EXPECT_FALSE(db_.result_version("SELECT * FROM missing", {}, v));
+}
+
+TEST_F(DatabaseTest, QueryCacheSkipsUnversionedAndVolatileQueries) {
+    static std::vector<int> data = {1, 2, 3};
+    auto table = xsql::table("live")
+        .count([]() { return data.size(); })
+        .column_int("n", [](size_t i) { return data[i]; })
+        .build();
+    ASSERT_TRUE(db_.register_and_create_table(table));
+    db_.enable_query_cache();
+
+    db_.query("SELECT * FROM live");
+    db_.query("SELECT * FROM live");
+    db_.query("SELECT random()");
+    db_.query("SELECT random()");
+
+    auto stats = db_.query_cache_stats();
+    EXPECT_EQ(stats.hits, 0u);
+    EXPECT_EQ(stats.uncacheable, 4u);
+    EXPECT_EQ(stats.entries, 0u);
+}
+
+TEST_F(DatabaseTest, QueryCacheSkipsNonDeterministicFunctions) {
+    int ticks = 0;
+    auto tick = [&ticks](sqlite3_context* ctx, int, sqlite3_value**) { sqlite3_result_int(ctx, ++ticks); };
+    ASSERT_EQ(db_.register_function("tick", 0, tick, SQLITE_UTF8), SQLITE_OK);
+    ASSERT_EQ(db_.register_function("twice", 1, [](sqlite3_context* ctx, int, sqlite3_value** argv) {
+        sqlite3_result_int64(ctx, 2 * sqlite3_value_int64(argv[0]));
+    }), SQLITE_OK);
+    db_.enable_query_cache();
+
+    EXPECT_EQ(db_.scalar("SELECT tick()"), "1");
+    EXPECT_EQ(db_.scalar("SELECT TICK()"), "2");
+    uint64_t version = 0;
+    EXPECT_FALSE(db_.result_version("SELECT tick()", {}, version));
+    // Deterministic application functions stay cacheable
+    EXPECT_EQ(db_.scalar("SELECT twice(21)"), "42");
+    EXPECT_EQ(db_.scalar("SELECT twice(21)"), "42");
+    EXPECT_EQ(db_.query_cache_stats().hits, 1u);
+
+    // Registered behind the wrapper's back: seen after clear_query_cache()
+    ASSERT_EQ(xsql::register_scalar_function(db_.handle(), "tock", 0, tick, SQLITE_UTF8), SQLITE_OK);
+    db_.clear_query_cache();
+    EXPECT_EQ(db_.scalar("SELECT tock()"), "3");
+    EXPECT_EQ(db_.scalar("SELECT tock()"), "4");
+    EXPECT_EQ(db_.query_cache_stats().hits, 1u);
+}
+
+TEST_F(DatabaseTest, QueryCacheSeesNativeTableWrites) {
+    ASSERT_EQ(db_.exec("CREATE TABLE test (val INTEGER)"), SQLITE_OK);
+    ASSERT_EQ(db_.exec("INSERT INTO test VALUES (1)"), SQLITE_OK);
+    db_.enable_query_cache();
+
+    EXPECT_EQ(db_.scalar("SELECT COUNT(*) FROM test"), "1");
+    EXPECT_EQ(db_.scalar("SELECT COUNT(*) FROM test"), "1");
+    EXPECT_EQ(db_.query_cache_stats().hits, 1u);
+
+    ASSERT_TRUE(db_.query("INSERT INTO test VALUES (2)").ok());
+    EXPECT_EQ(db_.scalar("SELECT COUNT(*) FROM test"), "2");
+
+    // Writes through the raw handle are seen via the change counter
+    ASSERT_EQ(sqlite3_exec(db_.handle(), "INSERT INTO test VALUES (3)", nullptr, nullptr, nullptr), SQLITE_OK);
+    EXPECT_EQ(db_.scalar("SELECT COUNT(*) FROM test"), "3");
+}
+
+TEST_F(DatabaseTest, QueryCacheEvictsLeastRecentlyUsed) {
+    ASSERT_EQ(db_.exec("CREATE TABLE test (val TEXT)"), SQLITE_OK);
+    ASSERT_EQ(db_.exec("INSERT INTO test VALUES (hex(zeroblob(500)))"), SQLITE_OK);
+    db_.enable_query_cache(4096);
+
+    for (int i = 0; i < 10; ++i) {
+        db_.query("SELECT val, " + std::to_string(i) + " FROM test");
+    }
+
+    auto stats = db_.query_cache_stats();
+    EXPECT_GT(stats.evictions, 0u);
+    EXPECT_LE(stats.bytes, 4096u);
+    EXPECT_LT(stats.entries, 10u);
+
+    // Most recent entry survived
+    db_.query("SELECT val, 9 FROM test");
+    EXPECT_EQ(db_.query_cache_stats().hits, 1u);
+}
+
+// ============================================================================
+// Result Limits
+// ============================================================================
+
+TEST_F(DatabaseTest, QueryLimitsStopReadingEarly) {
+    int produced = 0;
+    db_.register_function("tick", 1, [&](sqlite3_context* ctx, int, sqlite3_value** argv) {
+        ++produced;
+        xsql::result_int64(ctx, sqlite3_value_int64(argv[0]));
+    });
+    const char* sql = "WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 100000) "
+                      "SELECT tick(i), 'padding-padding' FROM n";
+
+    xsql::QueryLimits rows;
+    rows.max_result_rows = 10;
+    auto r = db_.query(sql, {}, rows);
+    EXPECT_FALSE(r.ok());
+    EXPECT_NE(r.error.find("max_result_rows"), std::string::npos) << r.error;
+    EXPECT_TRUE(r.rows.empty());
+    EXPECT_LE(produced, 11);
+
+    produced = 0;
+    xsql::QueryLimits bytes;
+    bytes.max_result_bytes = 1000;
+    db_.set_query_limits(bytes);
+    r = db_.query(sql);
+    EXPECT_FALSE(r.ok());
+    EXPECT_NE(r.error.find("max_result_bytes"), std::string::npos) << r.error;
+    EXPECT_LT(produced, 100);
+
+    // Results under the limits are unaffected
+    r = db_.query("SELECT 1, 'a'");
+    ASSERT_TRUE(r.ok()) << r.error;
+    EXPECT_EQ(r.size(), 1u);
+}
+
+TEST_F(DatabaseTest, QueryLimitsApplyToCachedResults) {
+    ASSERT_EQ(db_.exec("CREATE TABLE test (val INTEGER)"), SQLITE_OK);
+    ASSERT_EQ(db_.exec("INSERT INTO test VALUES (1), (2), (3)"), SQLITE_OK);
+    db_.enable_query_cache();
+
+    ASSERT_TRUE(db_.query("SELECT val FROM test").ok());
+    xsql::QueryLimits limits;
+    limits.max_result_rows = 2;
+    auto r = db_.query("SELECT val FROM test", {}, limits);
+    EXPECT_FALSE(r.ok());
+    EXPECT_EQ(db_.query_cache_stats().hits, 1u);
+
+    // Bytes are counted the same live and from the cache: "val" + "1" + "2" + "3"
+    xsql::QueryLimits bytes;
+    bytes.max_result_bytes = 6;
+    EXPECT_TRUE(db_.query("SELECT val FROM test", {}, bytes).ok());
+    EXPECT_EQ(db_.query_cache_stats().hits, 2u);
+    db_.disable_query_cache();
+    EXPECT_TRUE(db_.query("SELECT val FROM test", {}, bytes).ok());
+    bytes.max_result_bytes = 5;
+    EXPECT_FALSE(db_.query("SELECT val FROM test", {}, bytes).ok());
+    db_.enable_query_cache();
+    ASSERT_TRUE(db_.query("SELECT val FROM test").ok());
+    EXPECT_FALSE(db_.query("SELECT val FROM test", {}, bytes).ok());
+}
+
+TEST_F(DatabaseTest, HeapLimitErrorNamesTheLimit) {
+    sqlite3_int64 previous = sqlite3_hard_heap_limit64(-1);
+    sqlite3_hard_heap_limit64(sqlite3_memory_used() + 2 * 1024 * 1024);
+    auto r = db_.query("WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 200000) "
+                       "SELECT group_concat(hex(randomblob(64))) FROM n");
+    sqlite3_hard_heap_limit64(previous);
+
+    EXPECT_FALSE(r.ok());
+    EXPECT_NE(r.error.find("heap limit"), std::string::npos) << r.error;
+}
+
+TEST_F(DatabaseTest, OpenOptionsAreApplied) {
+    std::string path = ::testing::TempDir() + "xsql_options_test.db";
+    std::remove(path.c_str());
+
+    xsql::DatabaseOptions opt;
+    opt.flags |= SQLITE_OPEN_NOMUTEX;
+    opt.journal_mode = "WAL";
+    opt.synchronous = "NORMAL";
+    opt.mmap_size = 1024 * 1024;
+    opt.cache_size = -4096;
+    opt.temp_store = 2;
+    opt.worker_threads = 2;
+    opt.lookaside_slot_size = 256;
+    opt.lookaside_slots = 64;
+
+    {
+        xsql::Database db;
+        ASSERT_TRUE(db.open(path.c_str(), opt)) << db.last_error();
+        EXPECT_EQ(db.scalar("PRAGMA journal_mode"), "wal");
+        EXPECT_EQ(db.scalar("PRAGMA synchronous"), "1");
+        EXPECT_EQ(db.scalar("PRAGMA cache_size"), "-4096");
+        EXPECT_EQ(db.scalar("PRAGMA temp_store"), "2");
+        EXPECT_EQ(sqlite3_limit(db.handle(), SQLITE_LIMIT_WORKER_THREADS, -1), 2);
+        EXPECT_EQ(db.exec("CREATE TABLE t (v INTEGER)"), SQLITE_OK);
+    }
+
+    // A journal mode the database cannot use is an error, not a silent fallback
+    xsql::Database mem;
+    opt.flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+    EXPECT_FALSE(mem.open(":memory:", opt));
+    EXPECT_NE(mem.last_error().find("journal_mode"), std::string::npos) << mem.last_error();
+    EXPECT_FALSE(mem.is_open());
+
+    std::remove(path.c_str());
+    std::remove((path + "-wal").c_str());
+    std::remove((path + "-shm").c_str());
+}
+
+TEST_F(DatabaseTest, BulkInsertCommitsInBatches) {
+    ASSERT_EQ(db_.exec("CREATE TABLE t (id INTEGER PRIMARY KEY, name TEXT, score REAL, raw BLOB)"), SQLITE_OK);
+
+    int64_t next = 0;
+    xsql::BulkInsertOptions opt;
+    opt.batch_rows = 100;
+    auto stats = db_.bulk_insert("t", {"id", "name", "score", "raw"}, [&](std::vector<xsql::Value>& row) {
+        if (next == 250) return false;
+        row.push_back(xsql::Value::integer(next));
+        row.push_back(next % 2 ? xsql::Value::text("n" + std::to_string(next)) : xsql::Value::null());
+        row.push_back(xsql::Value::real(next * 0.5));
+        row.push_back(xsql::Value::blob("\x00\x01", 2));
+        ++next;
+        return true;
+    }, opt);
+    ASSERT_TRUE(stats.ok()) << stats.error;
+    EXPECT_EQ(stats.rows, 250u);
+    EXPECT_EQ(stats.batches, 3u);
+    EXPECT_GT(stats.rows_per_second(), 0);
+    EXPECT_EQ(db_.scalar("SELECT COUNT(*) FROM t WHERE typeof(name) = 'null'"), "125");
+    EXPECT_EQ(db_.scalar("SELECT typeof(score) || typeof(raw) || length(raw) FROM t WHERE id = 7"), "realblob2");
+
+    // A failing row rolls back its batch only; earlier batches stay committed
+    std::vector<std::vector<xsql::Value>> rows;
+    for (int64_t id = 1000; id < 1150; ++id) rows.push_back({xsql::Value::integer(id), xsql::Value::text("x")});
+    rows.push_back({xsql::Value::integer(5), xsql::Value::text("duplicate")});
+    stats = db_.bulk_insert("t", {"id", "name"}, rows, opt);
+    EXPECT_FALSE(stats.ok());
+    EXPECT_NE(stats.error.find("UNIQUE"), std::string::npos) << stats.error;
+    EXPECT_EQ(stats.rows, 100u);
+    EXPECT_EQ(db_.scalar("SELECT COUNT(*) FROM t WHERE id >= 1000"), "100");
+    EXPECT_EQ(db_.last_error(), stats.error);
+
+    opt.on_conflict = "REPLACE";
+    stats = db_.bulk_insert("t", {"id", "name"}, rows, opt);
+    ASSERT_TRUE(stats.ok()) << stats.error;
+    EXPECT_EQ(db_.scalar("SELECT name FROM t WHERE id = 5"), "duplicate");
+
+    // on_conflict is a keyword, not SQL text
+    opt.on_conflict = "REPLACE INTO t VALUES (9, 'x'); --";
+    stats = db_.bulk_insert("t", {"id", "name"}, rows, opt);
+    EXPECT_NE(stats.error.find("invalid on_conflict"), std::string::npos) << stats.error;
+    opt.on_conflict = "ignore";
+    EXPECT_TRUE(db_.bulk_insert("t", {"id", "name"}, rows, opt).ok());
+
+    stats = db_.bulk_insert("t", {"id", "name"}, std::vector<std::vector<xsql::Value>>{{xsql::Value::integer(1)}});
+    EXPECT_NE(stats.error.find("expected 2"), std::string::npos) << stats.error;
+
+    // A schema-qualified name targets that schema's table, not one named "temp.t"
+    ASSERT_EQ(db_.exec("CREATE TEMP TABLE t (id INTEGER, name TEXT)"), SQLITE_OK);
+    stats = db_.bulk_insert("temp.t", {"id", "name"}, rows, opt);
+    ASSERT_TRUE(stats.ok()) << stats.error;
+    EXPECT_EQ(db_.scalar("SELECT COUNT(*) FROM temp.t"), "151");
+    EXPECT_EQ(db_.scalar("SELECT COUNT(*) FROM main.t WHERE id >= 1000"), "150");
+}
+
+TEST_F(DatabaseTest, BulkInsertBatchesIntoInsertableVtable) {
+    std::vector<std::pair<int64_t, std::string>> items;
+    std::vector<size_t> batch_sizes;
+    bool accept = true;
+    auto def = xsql::table("items")
+        .count([&]() { return items.size(); })
+        .column_int64("id", [&](size_t i) { return items[i].first; })
+        .column_text("name", [&](size_t i) { return items[i].second; })
+        .insertable_batch([&](const std::vector<std::vector<xsql::Value>>& rows) {
+            if (!accept) return false;
+            batch_sizes.push_back(rows.size());
+            for (const auto& r : rows) items.emplace_back(r[0].i, r[1].s);
+            return true;
+        })
+        .build();
+    ASSERT_TRUE(db_.register_and_create_table(def)) << db_.last_error();
+
+    std::vector<std::vector<xsql::Value>> rows;
+    for (int64_t i = 0; i < 200; ++i) rows.push_back({xsql::Value::integer(i), xsql::Value::text("r")});
+    xsql::BulkInsertOptions opt;
+    opt.batch_rows = 100;
+    auto stats = db_.bulk_insert("items", {"id", "name"}, rows, opt);
+    ASSERT_TRUE(stats.ok()) << stats.error;
+    EXPECT_EQ(items.size(), 200u);
+    // One handler call per committed transaction
+    EXPECT_EQ(batch_sizes, (std::vector<size_t>{100, 100}));
+
+    // Plain SQL inserts are delivered on commit; rolled back rows never arrive
+    EXPECT_EQ(db_.exec("INSERT INTO items VALUES (500, 'a'), (501, 'b')"), SQLITE_OK);
+    EXPECT_EQ(items.size(), 202u);
+    EXPECT_EQ(db_.exec("BEGIN"), SQLITE_OK);
+    EXPECT_EQ(db_.exec("INSERT INTO items VALUES (600, 'gone')"), SQLITE_OK);
+    EXPECT_EQ(db_.exec("ROLLBACK"), SQLITE_OK);
+    EXPECT_EQ(items.size(), 202u);
+    EXPECT_EQ(db_.scalar("SELECT COUNT(*) FROM items"), "202");
+
+    // ROLLBACK TO drops only the rows buffered after the savepoint
+    uint64_t generation = def.generation();
+    EXPECT_EQ(db_.exec("BEGIN"), SQLITE_OK);
+    EXPECT_EQ(db_.exec("INSERT INTO items VALUES (700, 'kept')"), SQLITE_OK);
+    EXPECT_EQ(db_.exec("SAVEPOINT sp"), SQLITE_OK);
+    EXPECT_EQ(db_.exec("INSERT INTO items VALUES (701, 'undone'), (702, 'undone')"), SQLITE_OK);
+    EXPECT_EQ(db_.exec("ROLLBACK TO sp"), SQLITE_OK);
+    EXPECT_EQ(db_.exec("RELEASE sp"), SQLITE_OK);
+    EXPECT_EQ(def.generation(), generation);  // nothing applied yet
+    EXPECT_EQ(db_.exec("COMMIT"), SQLITE_OK);
+    ASSERT_EQ(items.size(), 203u);
+    EXPECT_EQ(items.back().second, "kept");
+    EXPECT_GT(def.generation(), generation);
+
+    // A handler that refuses the commit leaves nothing applied and no rows counted
+    accept = false;
+    rows.clear();
+    for (int64_t i = 0; i < 10; ++i) rows.push_back({xsql::Value::integer(900 + i), xsql::Value::text("r")});
+    stats = db_.bulk_insert("items", {"id", "name"}, rows, opt);
+    EXPECT_FALSE(stats.ok());
+    EXPECT_EQ(stats.rows, 0u);
+    EXPECT_EQ(items.size(), 203u);
+}
+
+TEST_F(DatabaseTest, MaterializeSnapshotsVtableWithIndexes) {
+    std::vector<int64_t> values = {5, 3, 9, 3, 7};
+    uint64_t version = 1;
+    int getter_calls = 0;
+    auto def = xsql::table("live")
+        .count([&]() { return values.size(); })
+        .generation([&]() { return version; })
+        .column_int64("id", [&](size_t i) { ++getter_calls; return static_cast<int64_t>(i); })
+        .column_int64("v", [&](size_t i) { ++getter_calls; return values[i]; })
+        .build();
+    ASSERT_TRUE(db_.register_and_create_table(def));
+
+    auto stats = db_.materialize("live", "live_copy", {"v", "v, id DESC"});
+    ASSERT_TRUE(stats.ok()) << stats.error;
+    EXPECT_TRUE(stats.rebuilt);
+    EXPECT_EQ(stats.rows, 5u);
+    EXPECT_EQ(db_.scalar("SELECT COUNT(*) FROM sqlite_schema WHERE type = 'index' AND tbl_name = 'live_copy'"), "2");
+
+    // Reads hit the native copy and its index, not the getters
+    int before = getter_calls;
+    EXPECT_EQ(db_.scalar("SELECT COUNT(*) FROM live_copy WHERE v = 3"), "2");
+    EXPECT_EQ(getter_calls, before);
+    auto plan = db_.query("EXPLAIN QUERY PLAN SELECT id FROM live_copy WHERE v = 3");
+    ASSERT_TRUE(plan.ok()) << plan.error;
+    ASSERT_FALSE(plan.empty());
+    EXPECT_NE(plan[0][3].find("INDEX"), std::string::npos) << plan[0][3];
+
+    // Unchanged generation: nothing is copied
+    stats = db_.refresh_materialized("live_copy");
+    ASSERT_TRUE(stats.ok()) << stats.error;
+    EXPECT_FALSE(stats.rebuilt);
+    EXPECT_EQ(getter_calls, before);
+
+    values.push_back(3);
+    ++version;
+    stats = db_.refresh_materialized("live_copy");
+    ASSERT_TRUE(stats.ok()) << stats.error;
+    EXPECT_TRUE(stats.rebuilt);
+    EXPECT_EQ(stats.rows, 6u);
+    EXPECT_EQ(db_.scalar("SELECT COUNT(*) FROM live_copy WHERE v = 3"), "3");
+    EXPECT_EQ(db_.scalar("SELECT COUNT(*) FROM sqlite_schema WHERE type = 'index' AND tbl_name = 'live_copy'"), "2");
+
+    // A failed rebuild leaves the previous copy in place
+    stats = db_.materialize("live", "live_copy", {"missing_column"});
+    EXPECT_FALSE(stats.ok());
+    EXPECT_NE(stats.error.find("missing_column"), std::string::npos) << stats.error;
+    EXPECT_EQ(db_.scalar("SELECT COUNT(*) FROM live_copy"), "6");
+
+    EXPECT_FALSE(db_.refresh_materialized("nope").ok());
+}
+
+TEST_F(DatabaseTest, MaterializeIntoSchemaQualifiedTarget) {
+    std::vector<int64_t> values = {4, 2, 4};
+    auto def = xsql::table("src")
+        .count([&]() { return values.size(); })
+        .column_int64("v", [&](size_t i) { return values[i]; })
+        .build();
+    ASSERT_TRUE(db_.register_and_create_table(def));
+
+    auto stats = db_.materialize("main.src", "temp.snap", {"v"});
+    ASSERT_TRUE(stats.ok()) << stats.error;
+    EXPECT_EQ(db_.scalar("SELECT COUNT(*) FROM temp.snap WHERE v = 4"), "2");
+    EXPECT_EQ(db_.scalar("SELECT COUNT(*) FROM main.sqlite_schema WHERE name LIKE '%snap%'"), "0");
+    EXPECT_EQ(db_.scalar("SELECT name FROM temp.sqlite_schema WHERE type = 'index' AND tbl_name = 'snap'"),
+              "snap_idx0");
+    values.push_back(4);
+    stats = db_.refresh_materialized("temp.snap");
+    ASSERT_TRUE(stats.ok()) << stats.error;
+    EXPECT_EQ(db_.scalar("SELECT COUNT(*) FROM temp.snap WHERE v = 4"), "3");
+
+    // An index name already taken by another table gets a suffix
+    ASSERT_EQ(db_.exec("CREATE TABLE other (x); CREATE INDEX copy_idx0 ON other (x)"), SQLITE_OK);
+    stats = db_.materialize("src", "copy", {"v"});
+    ASSERT_TRUE(stats.ok()) << stats.error;
+    EXPECT_EQ(db_.scalar("SELECT name FROM sqlite_schema WHERE type = 'index' AND tbl_name = 'copy'"),
+              "copy_idx0_2");
+    EXPECT_EQ(db_.scalar("SELECT tbl_name FROM sqlite_schema WHERE name = 'copy_idx0'"), "other");
+    ASSERT_TRUE(db_.materialize("src", "copy", {"v"}).ok());
+    EXPECT_EQ(db_.scalar("SELECT name FROM sqlite_schema WHERE type = 'index' AND tbl_name = 'copy'"),
+              "copy_idx0_2");
+}
+
+// ============================================================================
+// Query Scheduling
+// ============================================================================
+
+TEST_F(DatabaseTest, CostClassifierSeparatesScansFromLookups) {
+    db_.exec("CREATE TABLE big (id INTEGER PRIMARY KEY, k INTEGER, v TEXT)");
+    db_.exec("CREATE INDEX big_k ON big(k)");
+    db_.exec("WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 2000) "
+             "INSERT INTO big SELECT i, i % 100, 'v' || i FROM n");
+    db_.exec("ANALYZE");
+
+    xsql::CostPolicy policy;
+    policy.background_threshold = 1000;
+    auto lane = [&](const char* sql) { return xsql::classify_query_cost(db_.handle(), sql, policy); };
+
+    EXPECT_EQ(lane("SELECT * FROM big"), xsql::QueryLane::Background);
+    EXPECT_EQ(lane("SELECT * FROM big WHERE id = 5"), xsql::QueryLane::Interactive);
+    EXPECT_EQ(lane("SELECT * FROM big WHERE k = 7"), xsql::QueryLane::Interactive);
+    EXPECT_EQ(lane("SELECT * FROM big a JOIN big b ON a.k = b.id"), xsql::QueryLane::Background);
+    EXPECT_EQ(lane("SELECT 1"), xsql::QueryLane::Interactive);
+    EXPECT_EQ(lane("SELECT * FROM missing"), xsql::QueryLane::Interactive);
+    EXPECT_NEAR(xsql::estimate_query_cost(db_.handle(), "SELECT * FROM big", policy), 2000.0, 1.0);
+
+    // Application-supplied sizes win over statistics
+    policy.table_rows = [](const std::string&) { return 10.0; };
+    EXPECT_EQ(lane("SELECT * FROM big"), xsql::QueryLane::Interactive);
+
+    // Virtual table scans count the definition's estimate_rows()
+    std::vector<int64_t> few = {1, 2, 3};
+    auto tiny = xsql::table("tiny")
+        .count([&]() { return few.size(); })
+        .estimate_rows([&]() { return few.size(); })
+        .column_int64("v", [&](size_t i) { return few[i]; })
+        .build();
+    auto wide = xsql::table("wide")
+        .count([]() { return size_t{5000}; })
+        .estimate_rows([]() { return size_t{5000}; })
+        .column_int64("v", [](size_t i) { return static_cast<int64_t>(i); })
+        .build();
+    auto unsized = xsql::table("unsized")
+        .count([]() { return size_t{3}; })
+        .column_int64("v", [](size_t i) { return static_cast<int64_t>(i); })
+        .build();
+    ASSERT_TRUE(db_.register_and_create_table(tiny, "tiny_alias"));
+    ASSERT_TRUE(db_.register_and_create_table(wide));
+    ASSERT_TRUE(db_.register_and_create_table(unsized));
+    EXPECT_EQ(db_.estimated_rows("tiny_alias"), 3.0);
+    EXPECT_LT(db_.estimated_rows("unsized"), 0.0);
+    EXPECT_LT(db_.estimated_rows("big"), 0.0);
+
+    policy.table_rows = [&](const std::string& table) { return db_.estimated_rows(table); };
+    EXPECT_EQ(lane("SELECT * FROM tiny_alias"), xsql::QueryLane::Interactive);
+    EXPECT_EQ(lane("SELECT * FROM wide"), xsql::QueryLane::Background);
+    EXPECT_EQ(lane("SELECT * FROM unsized"), xsql::QueryLane::Background);  // size unknown
+    EXPECT_EQ(lane("SELECT * FROM big"), xsql::QueryLane::Background);     // falls back to stat1
+}
+
+TEST(QuerySchedulerTest, InteractiveWaitersGoFirst) {
+    xsql::SchedulerConfig config;
+    config.max_running = 1;
+    xsql::QueryScheduler scheduler(config);
+
+    auto running = scheduler.admit(xsql::QueryLane::Background);
+    ASSERT_TRUE(running);
+
+    std::mutex mutex;
+    std::vector<std::string> order;
+    auto waiter = [&](xsql::QueryLane lane, const char* name) {
+        return std::thread([&, lane, name]() {
+            auto ticket = scheduler.admit(lane);
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(name);
+        });
+    };
+    auto wait_queued = [&](size_t n) {
+        while (scheduler.stats().queued < n) std::this_thread::yield();
+    };
+
+    std::thread bg = waiter(xsql::QueryLane::Background, "background");
+    wait_queued(1);
+    std::thread fg = waiter(xsql::QueryLane::Interactive, "interactive");
+    wait_queued(2);
+
+    running.release();
+    bg.join();
+    fg.join();
+    ASSERT_EQ(order.size(), 2u);
+    EXPECT_EQ(order[0], "interactive");
+    EXPECT_EQ(order[1], "background");
+
+    auto stats = scheduler.stats();
+    EXPECT_EQ(stats.interactive_admitted, 1u);
+    EXPECT_EQ(stats.background_admitted, 2u);
+    EXPECT_EQ(stats.queued, 0u);
+}
+
+TEST(QuerySchedulerTest, LaneCapsKeepInteractiveSlotsFree) {
+    xsql::SchedulerConfig config;
+    config.max_running = 3;
+    config.interactive_slots = 2;
+    config.background_slots = 1;
+    config.max_wait_ms = 50;
+    xsql::QueryScheduler scheduler(config);
+
+    auto heavy = scheduler.admit(xsql::QueryLane::Background);
+    ASSERT_TRUE(heavy);
+    auto heavy2 = scheduler.admit(xsql::QueryLane::Background);
+    EXPECT_FALSE(heavy2);
+    EXPECT_NE(heavy2.error().find("background"), std::string::npos) << heavy2.error();
+
+    auto a = scheduler.admit(xsql::QueryLane::Interactive);
+    auto b = scheduler.admit(xsql::QueryLane::Interactive);
+    EXPECT_TRUE(a && b);
+    EXPECT_EQ(scheduler.stats().timed_out, 1u);
+}
+
+TEST(QuerySchedulerTest, PerClientLimitAndClose) {
+    xsql::SchedulerConfig config;
+    config.max_running = 4;
+    config.interactive_slots = 4;
+    config.max_per_client = 1;
+    xsql::QueryScheduler scheduler(config);
+
+    auto first = scheduler.admit(xsql::QueryLane::Interactive, "10.0.0.1");
+    ASSERT_TRUE(first);
+    EXPECT_FALSE(scheduler.admit(xsql::QueryLane::Interactive, "10.0.0.1"));
+    EXPECT_TRUE(scheduler.admit(xsql::QueryLane::Interactive, "10.0.0.2"));
+    first.release();
+    EXPECT_TRUE(scheduler.admit(xsql::QueryLane::Interactive, "10.0.0.1"));
+
+    scheduler.close();
+    auto refused = scheduler.admit(xsql::QueryLane::Interactive);
+    EXPECT_FALSE(refused);
+    EXPECT_NE(refused.error().find("shutting down"), std::string::npos);
+}
+
+// ============================================================================
+// Connection Pool
+// ============================================================================
+
+TEST(ConnectionPoolTest, WorkersShareBoundedReadConnections) {
+    std::string path = ::testing::TempDir() + "xsql_pool_test.db";
+    std::remove(path.c_str());
+    {
+        xsql::Database db(path.c_str());
+        ASSERT_EQ(db.exec("CREATE TABLE t (v INTEGER)"), SQLITE_OK);
+        ASSERT_EQ(db.exec("WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 1000) "
+                          "INSERT INTO t SELECT i FROM n"), SQLITE_OK);
+    }
+
+    std::atomic<int> opened{0};
+    auto factory = xsql::read_only_connections(path, [&](xsql::Database& db) {
+        opened++;
+        db.register_function("twice", 1, [](sqlite3_context* ctx, int, sqlite3_value** argv) {
+            xsql::result_int64(ctx, 2 * sqlite3_value_int64(argv[0]));
+        });
+    });
+    xsql::ConnectionPool pool(factory, 3);
+
+    std::atomic<int> leased{0}, peak{0}, failures{0};
+    std::vector<std::thread> workers;
+    for (int w = 0; w < 8; ++w) {
+        workers.emplace_back([&]() {
+            for (int i = 0; i < 20; ++i) {
+                auto conn = pool.acquire();
+                if (!conn) { failures++; continue; }
+                int now = ++leased;
+                int seen = peak.load();
+                while (now > seen && !peak.compare_exchange_weak(seen, now)) {}
+                auto r = conn->query("SELECT SUM(twice(v)) FROM t");
+                if (!r.ok() || r[0][0] != "1001000") failures++;
+                --leased;
+            }
+        });
+    }
+    for (auto& t : workers) t.join();
+
+    EXPECT_EQ(failures.load(), 0);
+    EXPECT_LE(peak.load(), 3);
+    EXPECT_LE(opened.load(), 3);
+    EXPECT_EQ(pool.size(), static_cast<size_t>(opened.load()));
+    EXPECT_EQ(pool.idle(), pool.size());
+
+    // Connections are read-only
+    {
+        auto conn = pool.acquire();
+        ASSERT_TRUE(conn);
+        EXPECT_FALSE(conn->query("DELETE FROM t").ok());
+    }
+
+    // Exhausted pool times out; clear() drops idle connections
+    {
+        std::vector<xsql::ConnectionPool::Lease> all;
+        for (int i = 0; i < 3; ++i) all.push_back(pool.acquire());
+        auto extra = pool.acquire(20);
+        EXPECT_FALSE(extra);
+        EXPECT_FALSE(extra.error().empty());
+        pool.clear();
+    }
+    EXPECT_EQ(pool.size(), 0u);
+
+    xsql::ConnectionPool broken(xsql::read_only_connections(::testing::TempDir() + "missing/nope.db"), 1);
+    auto conn = broken.acquire();
+    EXPECT_FALSE(conn);
+    EXPECT_NE(conn.error().find("failed to open"), std::string::npos);
+    EXPECT_EQ(broken.size(), 0u);
+
+    std::remove(path.c_str());
+}
+
+// ============================================================================
+// Arena Allocator
+// ============================================================================
+
+TEST(ArenaAllocatorTest, SqliteAndCursorsRunOnArena) {
+    // ctest runs each test in a fresh process; in a full run SQLite is already up
+    xsql::AllocatorOptions options;
+    std::string error;
+    if (!xsql::install_allocator(options, error)) GTEST_SKIP() << error;
+    EXPECT_TRUE(xsql::install_allocator(options, error));   // Second call is a no-op
+    ASSERT_TRUE(xsql::allocator_stats().installed);
+
+    std::atomic<int> failures{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t]() {
+            std::vector<int> data(2000);
+            for (size_t i = 0; i < data.size(); ++i) data[i] = static_cast<int>(i * (t + 1));
+            auto def = xsql::table("nums")
+                .count([&]() { return data.size(); })
+                .column_int("v", [&](size_t i) { return data[i]; })
+                .column_text("s", [&](size_t i) { return "row_" + std::to_string(data[i]); })
+                .build();
+            for (int round = 0; round < 5; ++round) {
+                xsql::Database db;
+                db.register_and_create_table(def);
+                auto r = db.query("SELECT COUNT(*), SUM(v), length(group_concat(s)) FROM nums");
+                int64_t expected = 1999 * 2000 / 2 * (t + 1);
+                if (!r.ok() || r[0][0] != "2000" || r[0][1] != std::to_string(expected)) failures++;
+                if (!db.query("SELECT s FROM nums ORDER BY s DESC LIMIT 3").ok()) failures++;
+            }
+        });
+    }
+    for (auto& th : threads) th.join();
+    EXPECT_EQ(failures.load(), 0);
+    EXPECT_GT(xsql::allocator_stats().reserved_bytes, 0u);
+
+    std::vector<std::string, xsql::ArenaAllocator<std::string>> names;
+    for (int i = 0; i < 1000; ++i) names.push_back("name_" + std::to_string(i));
+    EXPECT_EQ(names[999], "name_999");
+}
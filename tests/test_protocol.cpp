@@ -50,3 +50,107 @@ TEST(ProtocolTest, ParseResponseRejectsBadTypes) {
     EXPECT_FALSE(r.success);
     EXPECT_FALSE(r.error.empty());
 }
+
+TEST(ProtocolTest, ParseBatchRequest) {
+    xsql::socket::Request req;
+    std::string json = xsql::socket::make_batch_request({"INSERT INTO t VALUES (1)", "SELECT \"x\""}, true, "tok");
+    ASSERT_TRUE(xsql::socket::parse_request(json, req));
+    EXPECT_EQ(req.type, "batch");
+    EXPECT_TRUE(req.transaction);
+    EXPECT_EQ(req.token, "tok");
+    ASSERT_EQ(req.statements.size(), 2u);
+    EXPECT_EQ(req.statements[1], "SELECT \"x\"");
+
+    ASSERT_TRUE(xsql::socket::parse_request("{\"sql\":\"SELECT 1\",\"future\":[1,{}]}", req));
+    EXPECT_EQ(req.type, "query");
+    EXPECT_EQ(req.sql, "SELECT 1");
+
+    EXPECT_FALSE(xsql::socket::parse_request("{\"statements\":[1]}", req));
+}
+
+TEST(ProtocolTest, BatchResponseRoundTrip) {
+    xsql::socket::BatchResult batch;
+    batch.success = false;
+    batch.error = "statement 1: boom";
+    auto ok = xsql::socket::QueryResult::ok();
+    ok.columns = {"n"};
+    ok.rows = {{"3"}};
+    batch.results = {ok, xsql::socket::QueryResult::fail("boom")};
+
+    auto r = xsql::socket::parse_batch_response(xsql::socket::batch_result_to_json(batch));
+    EXPECT_FALSE(r.success);
+    EXPECT_EQ(r.error, "statement 1: boom");
+    ASSERT_EQ(r.results.size(), 2u);
+    EXPECT_TRUE(r.results[0].success);
+    EXPECT_EQ(r.results[0].rows[0][0], "3");
+    EXPECT_FALSE(r.results[1].success);
+    EXPECT_EQ(r.results[1].error, "boom");
+
+    EXPECT_FALSE(xsql::socket::parse_batch_response("{\"results\":[]}").success);
+}
+
+TEST(ProtocolTest, ExecuteRequestParamsRoundTrip) {
+    using xsql::socket::Param;
+    std::vector<Param> params = {Param::null(), Param::integer(-9007199254740993LL), Param::real(2.0),
+                                 Param::real(0.1), Param::text("a\"b\n"), Param::blob(std::string("\x01\xab", 2))};
+    xsql::socket::Request req;
+    ASSERT_TRUE(xsql::socket::parse_request(xsql::socket::make_execute_request(7, params), req));
+    EXPECT_EQ(req.type, "execute");
+    EXPECT_EQ(req.statement, 7u);
+    ASSERT_EQ(req.params.size(), params.size());
+    EXPECT_EQ(req.params[0].type, Param::Type::Null);
+    EXPECT_EQ(req.params[1].type, Param::Type::Integer);
+    EXPECT_EQ(req.params[1].i, -9007199254740993LL);
+    EXPECT_EQ(req.params[2].type, Param::Type::Real);
+    EXPECT_EQ(req.params[2].d, 2.0);
+    EXPECT_EQ(req.params[3].d, 0.1);
+    EXPECT_EQ(req.params[4].s, "a\"b\n");
+    EXPECT_EQ(req.params[5].type, Param::Type::Blob);
+    EXPECT_EQ(req.params[5].s, std::string("\x01\xab", 2));
+
+    EXPECT_FALSE(xsql::socket::parse_request("{\"type\":\"execute\",\"params\":[{\"blob\":\"abc\"}]}", req));
+    EXPECT_FALSE(xsql::socket::parse_request("{\"type\":\"execute\",\"statement\":-1}", req));
+}
+
+TEST(ProtocolTest, CursorPageRoundTrip) {
+    xsql::socket::Request req;
+    ASSERT_TRUE(xsql::socket::parse_request(xsql::socket::make_cursor_fetch_request(3, 250), req));
+    EXPECT_EQ(req.type, "cursor_fetch");
+    EXPECT_EQ(req.cursor, 3u);
+    EXPECT_EQ(req.fetch, 250u);
+
+    auto page = xsql::socket::parse_cursor_response(
+        "{\"success\":true,\"columns\":[\"a\"],\"rows\":[[\"1\"]],\"row_count\":1,\"cursor\":3,\"done\":false}");
+    ASSERT_TRUE(page.success) << page.error;
+    EXPECT_EQ(page.cursor, 3u);
+    EXPECT_FALSE(page.done);
+    EXPECT_EQ(page.rows[0][0], "1");
+
+    auto failed = xsql::socket::parse_cursor_response("{\"success\":false,\"error\":\"Unknown cursor\"}");
+    EXPECT_FALSE(failed.success);
+    EXPECT_TRUE(failed.done);
+    EXPECT_EQ(failed.error, "Unknown cursor");
+}
+
+TEST(ProtocolTest, DeltaPushRoundTrip) {
+    auto added = xsql::socket::QueryResult::ok();
+    added.columns = {"id", "name"};
+    added.rows = {{"1", "a\"b"}};
+    std::string json = xsql::socket::delta_to_json(4, added, {{"2", "old"}});
+    ASSERT_TRUE(xsql::socket::is_push_message(json)) << json;
+    EXPECT_FALSE(xsql::socket::is_push_message(xsql::socket::result_to_json(added)));
+
+    auto delta = xsql::socket::parse_delta(json);
+    ASSERT_TRUE(delta.success) << delta.error;
+    EXPECT_EQ(delta.subscription, 4u);
+    EXPECT_EQ(delta.columns, added.columns);
+    ASSERT_EQ(delta.rows.size(), 1u);
+    EXPECT_EQ(delta.rows[0][1], "a\"b");
+    ASSERT_EQ(delta.removed.size(), 1u);
+    EXPECT_EQ(delta.removed[0][1], "old");
+
+    auto ended = xsql::socket::parse_delta(
+        xsql::socket::delta_to_json(4, xsql::socket::QueryResult::fail("no such table"), {}));
+    EXPECT_FALSE(ended.success);
+    EXPECT_EQ(ended.error, "no such table");
+}
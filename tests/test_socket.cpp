@@ -0,0 +1,1054 @@
+/**
+ * test_socket.cpp - Loopback tests for the xsql socket server, client and remote tables
+ */
+
+#include <gtest/gtest.h>
+
+#include <xsql/database.hpp>
+#include <xsql/socket/socket.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Forwards to a prepared statement and counts the rows it hands out
+class CountingStatement : public xsql::socket::PreparedStatement {
+public:
+    CountingStatement(std::unique_ptr<xsql::socket::PreparedStatement> inner, std::mutex& mutex, size_t& rows)
+        : inner_(std::move(inner)), mutex_(mutex), rows_(rows) {}
+
+    int param_count() const override { return inner_->param_count(); }
+
+    xsql::socket::QueryResult execute(const std::vector<xsql::socket::Param>& params) override {
+        return count(inner_->execute(params));
+    }
+
+    bool begin(const std::vector<xsql::socket::Param>& params, std::string& error) override {
+        return inner_->begin(params, error);
+    }
+
+    xsql::socket::QueryResult fetch(size_t max_rows, size_t max_bytes, bool& done) override {
+        return count(inner_->fetch(max_rows, max_bytes, done));
+    }
+
+private:
+    xsql::socket::QueryResult count(xsql::socket::QueryResult r) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        rows_ += r.rows.size();
+        return r;
+    }
+
+    std::unique_ptr<xsql::socket::PreparedStatement> inner_;
+    std::mutex& mutex_;
+    size_t& rows_;
+};
+
+// Serves a Database over the socket protocol and records what it was asked
+class RemoteFixture : public ::testing::Test {
+protected:
+    void SetUp() override {
+        remote_.exec("CREATE TABLE items (id INTEGER, name TEXT, score REAL)");
+        remote_.exec("WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 100) "
+                     "INSERT INTO items SELECT i, 'item' || i, i * 1.5 FROM n");
+
+        xsql::socket::ServerConfig config;
+        config.port = 0;
+        config.verbose = false;
+        server_.set_config(config);
+        server_.set_query_handler([this](const std::string& sql) {
+            auto r = remote_.query(sql);
+            std::lock_guard<std::mutex> lock(mutex_);
+            seen_sql_.push_back(sql);
+            rows_sent_ += r.rows.size();
+            if (!r.ok()) return xsql::socket::QueryResult::fail(r.error);
+            auto out = xsql::socket::QueryResult::ok();
+            out.columns = r.columns;
+            for (auto& row : r.rows) out.rows.push_back(row.values);
+            return out;
+        });
+        // Remote tables stream through cursors, so statements are recorded here too
+        auto prepare = xsql::socket::database_prepare_handler(remote_);
+        server_.set_prepare_handler([this, prepare](const std::string& sql, std::string& error)
+                                        -> std::unique_ptr<xsql::socket::PreparedStatement> {
+            auto stmt = prepare(sql, error);
+            if (!stmt) return nullptr;
+            std::lock_guard<std::mutex> lock(mutex_);
+            seen_sql_.push_back(sql);
+            return std::make_unique<CountingStatement>(std::move(stmt), mutex_, rows_sent_);
+        });
+        server_.set_subscribe_handler(xsql::socket::database_subscribe_handler(remote_));
+        ASSERT_TRUE(server_.run_async());
+    }
+
+    void TearDown() override {
+        server_.stop();
+    }
+
+    std::string last_sql() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return seen_sql_.empty() ? "" : seen_sql_.back();
+    }
+
+    size_t rows_sent() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return rows_sent_;
+    }
+
+    xsql::Database remote_;
+    xsql::Database local_;
+    xsql::socket::Server server_;
+    std::mutex mutex_;
+    std::vector<std::string> seen_sql_;
+    size_t rows_sent_ = 0;
+};
+
+}  // namespace
+
+TEST_F(RemoteFixture, RemoteTableMirrorsSchemaAndTypes) {
+    std::string err;
+    ASSERT_TRUE(xsql::socket::create_remote_table(local_.handle(), "r_items", "127.0.0.1",
+                                                  server_.port(), "items", "", &err)) << err;
+
+    auto r = local_.query("SELECT id, typeof(id), name, score, typeof(score) FROM r_items WHERE id = 7");
+    ASSERT_TRUE(r.ok()) << r.error;
+    ASSERT_EQ(r.size(), 1u);
+    EXPECT_EQ(r[0][0], "7");
+    EXPECT_EQ(r[0][1], "integer");
+    EXPECT_EQ(r[0][2], "item7");
+    EXPECT_EQ(r[0][3], "10.5");
+    EXPECT_EQ(r[0][4], "real");
+
+    EXPECT_NE(last_sql().find("WHERE \"id\" = 7"), std::string::npos) << last_sql();
+}
+
+TEST_F(RemoteFixture, RemoteTablePushesFiltersOrderAndLimit) {
+    ASSERT_TRUE(xsql::socket::create_remote_table(local_.handle(), "r_items", "127.0.0.1",
+                                                  server_.port(), "items"));
+    size_t before = rows_sent();
+
+    auto r = local_.query("SELECT name FROM r_items WHERE score > 30 AND name LIKE 'item%' "
+                          "ORDER BY score DESC LIMIT 3");
+    ASSERT_TRUE(r.ok()) << r.error;
+    ASSERT_EQ(r.size(), 3u);
+    EXPECT_EQ(r[0][0], "item100");
+    EXPECT_EQ(r[2][0], "item98");
+
+    // Only the requested rows crossed the wire, with unused columns left out
+    EXPECT_EQ(rows_sent() - before, 3u);
+    std::string sql = last_sql();
+    EXPECT_NE(sql.find("SELECT NULL, \"name\", \"score\""), std::string::npos) << sql;
+    EXPECT_NE(sql.find("\"score\" > 30"), std::string::npos) << sql;
+    EXPECT_NE(sql.find("\"name\" LIKE 'item%'"), std::string::npos) << sql;
+    EXPECT_NE(sql.find("ORDER BY \"score\" COLLATE BINARY DESC"), std::string::npos) << sql;
+    EXPECT_NE(sql.find("LIMIT 3"), std::string::npos) << sql;
+}
+
+TEST_F(RemoteFixture, RemoteTableJoinsWithLocalData) {
+    ASSERT_TRUE(xsql::socket::create_remote_table(local_.handle(), "r_items", "127.0.0.1",
+                                                  server_.port(), "items"));
+    local_.exec("CREATE TABLE picks (id INTEGER, note TEXT)");
+    local_.exec("INSERT INTO picks VALUES (3, 'a'), (42, 'b'), (500, 'missing')");
+    local_.exec("ANALYZE picks");
+    size_t before = rows_sent();
+
+    auto r = local_.query("SELECT p.note, i.name FROM picks p JOIN r_items i ON i.id = p.id ORDER BY p.id");
+    ASSERT_TRUE(r.ok()) << r.error;
+    ASSERT_EQ(r.size(), 2u);
+    EXPECT_EQ(r[0][1], "item3");
+    EXPECT_EQ(r[1][1], "item42");
+    // Join key is pushed down: one keyed lookup per local row instead of a full scan
+    EXPECT_EQ(rows_sent() - before, 2u);
+}
+
+TEST_F(RemoteFixture, RemoteTableStreamsLargeScansInPages) {
+    remote_.exec("WITH RECURSIVE n(i) AS (SELECT 101 UNION ALL SELECT i + 1 FROM n WHERE i < 2500) "
+                 "INSERT INTO items SELECT i, 'item' || i, i * 1.5 FROM n");
+    ASSERT_TRUE(xsql::socket::create_remote_table(local_.handle(), "r_items", "127.0.0.1",
+                                                  server_.port(), "items"));
+
+    // abs() is not pushed down, so every row crosses the wire over several pages
+    auto r = local_.query("SELECT count(*), sum(id), count(DISTINCT rowid) FROM r_items WHERE abs(id) > 0");
+    ASSERT_TRUE(r.ok()) << r.error;
+    ASSERT_EQ(r.size(), 1u);
+    EXPECT_EQ(r[0][0], "2500");
+    EXPECT_EQ(r[0][1], "3126250");
+    EXPECT_EQ(r[0][2], "2500");
+
+    // Scans that stop early release their server cursor (max_cursors is 16)
+    for (int i = 0; i < 20; i++) {
+        auto e = local_.query("SELECT EXISTS (SELECT 1 FROM r_items WHERE abs(id) > 0)");
+        ASSERT_TRUE(e.ok()) << i << ": " << e.error;
+        EXPECT_EQ(e[0][0], "1");
+    }
+}
+
+TEST_F(RemoteFixture, RemoteTableReportsMissingTable) {
+    std::string err;
+    EXPECT_FALSE(xsql::socket::create_remote_table(local_.handle(), "r_none", "127.0.0.1",
+                                                   server_.port(), "no_such_table", "", &err));
+    EXPECT_NE(err.find("remote_table"), std::string::npos) << err;
+}
+
+TEST_F(RemoteFixture, RemoteTableReconnectsAfterServerRestart) {
+    ASSERT_TRUE(xsql::socket::create_remote_table(local_.handle(), "r_items", "127.0.0.1",
+                                                  server_.port(), "items"));
+    auto r = local_.query("SELECT COUNT(*) FROM r_items");
+    ASSERT_TRUE(r.ok()) << r.error;
+
+    // The table's connection is dropped with the server; the next scan reconnects
+    server_.stop();
+    ASSERT_TRUE(server_.run_async());
+    r = local_.query("SELECT name FROM r_items WHERE id = 5");
+    ASSERT_TRUE(r.ok()) << r.error;
+    ASSERT_EQ(r.size(), 1u);
+    EXPECT_EQ(r[0][0], "item5");
+}
+
+TEST_F(RemoteFixture, BatchRunsStatementsInOneRoundTrip) {
+    xsql::socket::Client client;
+    ASSERT_TRUE(client.connect("127.0.0.1", server_.port()));
+    size_t before = seen_sql_.size();
+
+    auto r = client.query_batch({
+        "CREATE TABLE notes (id INTEGER, body TEXT)",
+        "INSERT INTO notes VALUES (1, 'a')",
+        "INSERT INTO notes VALUES (2, 'b')",
+        "SELECT COUNT(*) FROM notes",
+    });
+    ASSERT_TRUE(r.success) << r.error;
+    ASSERT_EQ(r.results.size(), 4u);
+    EXPECT_EQ(r.results[3].rows[0][0], "2");
+    EXPECT_EQ(seen_sql_.size() - before, 4u);
+
+    // Without a transaction a failing statement does not stop the rest
+    r = client.query_batch({"SELECT * FROM missing", "SELECT 1"});
+    ASSERT_TRUE(r.success) << r.error;
+    ASSERT_EQ(r.results.size(), 2u);
+    EXPECT_FALSE(r.results[0].success);
+    EXPECT_TRUE(r.results[1].success);
+}
+
+TEST_F(RemoteFixture, BatchTransactionRollsBackOnFailure) {
+    xsql::socket::Client client;
+    ASSERT_TRUE(client.connect("127.0.0.1", server_.port()));
+
+    auto r = client.query_batch({
+        "DELETE FROM items WHERE id <= 10",
+        "INSERT INTO missing VALUES (1)",
+        "DELETE FROM items",
+    }, true);
+    EXPECT_FALSE(r.success);
+    EXPECT_NE(r.error.find("statement 1"), std::string::npos) << r.error;
+    ASSERT_EQ(r.results.size(), 2u);
+
+    auto count = client.query("SELECT COUNT(*) FROM items");
+    ASSERT_TRUE(count.success) << count.error;
+    EXPECT_EQ(count.rows[0][0], "100");
+
+    r = client.query_batch({"DELETE FROM items WHERE id <= 10", "SELECT COUNT(*) FROM items"}, true);
+    ASSERT_TRUE(r.success) << r.error;
+    EXPECT_EQ(r.results[1].rows[0][0], "90");
+}
+
+TEST_F(RemoteFixture, PreparedStatementExecutesWithTypedParams) {
+    using xsql::socket::Param;
+    xsql::socket::Client client;
+    ASSERT_TRUE(client.connect("127.0.0.1", server_.port()));
+    size_t before = seen_sql_.size();
+
+    auto stmt = client.prepare("SELECT name, typeof(?2), ?3 FROM items WHERE id = ?1");
+    ASSERT_TRUE(stmt.success) << stmt.error;
+    EXPECT_EQ(stmt.param_count, 3);
+
+    for (int id : {5, 17, 99}) {
+        auto r = client.execute(stmt.statement, {Param::integer(id), Param::real(0.5), Param::text("x\"y")});
+        ASSERT_TRUE(r.success) << r.error;
+        ASSERT_EQ(r.row_count(), 1u);
+        EXPECT_EQ(r.rows[0][0], "item" + std::to_string(id));
+        EXPECT_EQ(r.rows[0][1], "real");
+        EXPECT_EQ(r.rows[0][2], "x\"y");
+    }
+
+    auto blob = client.prepare("SELECT hex(?), ? IS NULL");
+    ASSERT_TRUE(blob.success) << blob.error;
+    auto r = client.execute(blob.statement, {Param::blob(std::string("\x00\xff", 2)), Param::null()});
+    ASSERT_TRUE(r.success) << r.error;
+    EXPECT_EQ(r.rows[0][0], "00FF");
+    EXPECT_EQ(r.rows[0][1], "1");
+
+    // Each statement was prepared once; executions bypass the SQL text path
+    EXPECT_EQ(seen_sql_.size() - before, 2u);
+
+    r = client.execute(stmt.statement, {Param::integer(1)});
+    EXPECT_FALSE(r.success);
+    EXPECT_NE(r.error.find("expected 3 parameters"), std::string::npos) << r.error;
+
+    EXPECT_TRUE(client.close_statement(stmt.statement));
+    r = client.execute(stmt.statement, {});
+    EXPECT_FALSE(r.success);
+    EXPECT_EQ(r.error, "Unknown statement");
+}
+
+TEST_F(RemoteFixture, PreparedStatementsAreScopedToConnection) {
+    uint64_t id = 0;
+    {
+        xsql::socket::Client client;
+        ASSERT_TRUE(client.connect("127.0.0.1", server_.port()));
+        auto bad = client.prepare("SELECT * FROM missing");
+        EXPECT_FALSE(bad.success);
+        EXPECT_NE(bad.error.find("no such table"), std::string::npos) << bad.error;
+        EXPECT_FALSE(client.prepare("SELECT 1; SELECT 2").success);
+
+        auto stmt = client.prepare("SELECT COUNT(*) FROM items");
+        ASSERT_TRUE(stmt.success) << stmt.error;
+        id = stmt.statement;
+    }
+
+    xsql::socket::Client client;
+    ASSERT_TRUE(client.connect("127.0.0.1", server_.port()));
+    EXPECT_FALSE(client.execute(id).success);
+}
+
+// ============================================================================
+// Cursors
+// ============================================================================
+
+TEST_F(RemoteFixture, CursorPagesThroughResult) {
+    xsql::socket::Client client;
+    ASSERT_TRUE(client.connect("127.0.0.1", server_.port()));
+
+    auto page = client.open_cursor("SELECT id FROM items WHERE id > ? ORDER BY id",
+                                   {xsql::socket::Param::integer(10)}, 40);
+    ASSERT_TRUE(page.success) << page.error;
+    ASSERT_EQ(page.columns, std::vector<std::string>{"id"});
+    EXPECT_EQ(page.row_count(), 40u);
+    EXPECT_FALSE(page.done);
+
+    std::vector<std::string> ids;
+    for (auto& row : page.rows) ids.push_back(row[0]);
+    uint64_t cursor = page.cursor;
+    while (!page.done) {
+        page = client.fetch(cursor, 40);
+        ASSERT_TRUE(page.success) << page.error;
+        EXPECT_LE(page.row_count(), 40u);
+        for (auto& row : page.rows) ids.push_back(row[0]);
+    }
+    ASSERT_EQ(ids.size(), 90u);
+    EXPECT_EQ(ids.front(), "11");
+    EXPECT_EQ(ids.back(), "100");
+
+    // A finished cursor is closed by the server
+    EXPECT_FALSE(client.fetch(cursor).success);
+    EXPECT_FALSE(client.close_cursor(cursor));
+}
+
+TEST_F(RemoteFixture, CursorCloseStopsEarly) {
+    xsql::socket::Client client;
+    ASSERT_TRUE(client.connect("127.0.0.1", server_.port()));
+
+    auto page = client.open_cursor("SELECT * FROM items", {}, 5);
+    ASSERT_TRUE(page.success) << page.error;
+    EXPECT_EQ(page.row_count(), 5u);
+    EXPECT_TRUE(client.close_cursor(page.cursor));
+    EXPECT_FALSE(client.fetch(page.cursor).success);
+
+    // The connection stays usable and open cursors are independent
+    auto a = client.open_cursor("SELECT id FROM items ORDER BY id", {}, 1);
+    auto b = client.open_cursor("SELECT id FROM items ORDER BY id DESC", {}, 1);
+    ASSERT_TRUE(a.success && b.success);
+    EXPECT_EQ(client.fetch(a.cursor, 1).rows[0][0], "2");
+    EXPECT_EQ(client.fetch(b.cursor, 1).rows[0][0], "99");
+
+    auto bad = client.open_cursor("SELECT * FROM missing");
+    EXPECT_FALSE(bad.success);
+    EXPECT_TRUE(bad.done);
+}
+
+TEST(SocketCursor, IdleCursorsExpire) {
+    xsql::Database db;
+    db.exec("CREATE TABLE t (x INTEGER)");
+    db.exec("INSERT INTO t VALUES (1), (2), (3)");
+
+    xsql::socket::Server server;
+    xsql::socket::ServerConfig config;
+    config.port = 0;
+    config.verbose = false;
+    config.max_cursors = 1;
+    config.cursor_idle_timeout_ms = 100;
+    server.set_config(config);
+    xsql::socket::serve_database(server, db);
+    ASSERT_TRUE(server.run_async());
+
+    xsql::socket::Client client;
+    ASSERT_TRUE(client.connect("127.0.0.1", server.port()));
+    auto page = client.open_cursor("SELECT x FROM t", {}, 1);
+    ASSERT_TRUE(page.success) << page.error;
+    EXPECT_FALSE(client.open_cursor("SELECT x FROM t", {}, 1).success);  // max_cursors
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    EXPECT_FALSE(client.fetch(page.cursor).success);
+    EXPECT_TRUE(client.open_cursor("SELECT x FROM t", {}, 1).success);
+
+    client.disconnect();
+    server.stop();
+}
+
+// ============================================================================
+// Subscriptions
+// ============================================================================
+
+TEST_F(RemoteFixture, SubscriptionPushesRowDiffs) {
+    xsql::socket::Client client;
+    ASSERT_TRUE(client.connect("127.0.0.1", server_.port()));
+
+    auto snap = client.subscribe("SELECT id, name FROM items WHERE id > 97");
+    ASSERT_TRUE(snap.success) << snap.error;
+    EXPECT_EQ(snap.row_count(), 3u);
+    EXPECT_TRUE(snap.removed.empty());
+
+    // Nothing changed: no push
+    xsql::socket::RemoteDelta delta;
+    EXPECT_FALSE(client.next_delta(delta, 150));
+
+    ASSERT_TRUE(client.query("UPDATE items SET name = 'renamed' WHERE id = 99").success);
+    ASSERT_TRUE(client.query("INSERT INTO items VALUES (101, 'new', 0)").success);
+    ASSERT_TRUE(client.next_delta(delta, 2000));
+    EXPECT_TRUE(delta.success) << delta.error;
+    EXPECT_EQ(delta.subscription, snap.subscription);
+
+    // Pushes for consecutive writes may arrive split or folded; accumulate until settled
+    std::vector<std::vector<std::string>> added, removed;
+    do {
+        for (auto& r : delta.rows) added.push_back(r.values);
+        for (auto& r : delta.removed) removed.push_back(r.values);
+    } while (client.next_delta(delta, 150));
+    std::sort(added.begin(), added.end());
+    using Rows = std::vector<std::vector<std::string>>;
+    EXPECT_EQ(removed, (Rows{{"99", "item99"}}));
+    EXPECT_EQ(added, (Rows{{"101", "new"}, {"99", "renamed"}}));
+
+    EXPECT_TRUE(client.unsubscribe(snap.subscription));
+    ASSERT_TRUE(client.query("DELETE FROM items WHERE id = 100").success);
+    EXPECT_FALSE(client.next_delta(delta, 150));
+}
+
+TEST_F(RemoteFixture, SubscriptionRejectsVolatileQueries) {
+    xsql::socket::Client client;
+    ASSERT_TRUE(client.connect("127.0.0.1", server_.port()));
+    auto r = client.subscribe("SELECT random() FROM items");
+    EXPECT_FALSE(r.success);
+    EXPECT_NE(r.error.find("cannot be watched"), std::string::npos) << r.error;
+    EXPECT_FALSE(client.subscribe("SELECT * FROM missing").success);
+}
+
+namespace {
+
+// Re-evaluates only when the test bumps the version
+class CountingSubscription : public xsql::socket::Subscription {
+public:
+    std::atomic<int>& version;
+    std::atomic<int>& evaluations;
+    int seen = -1;
+
+    CountingSubscription(std::atomic<int>& v, std::atomic<int>& e) : version(v), evaluations(e) {}
+
+    bool changed() override { return version.load() != seen; }
+
+    xsql::socket::QueryResult evaluate() override {
+        seen = version.load();
+        evaluations++;
+        auto r = xsql::socket::QueryResult::ok();
+        r.columns = {"v"};
+        r.rows = {{std::to_string(seen)}};
+        return r;
+    }
+};
+
+}  // namespace
+
+TEST(SocketSubscription, EvaluatesOnlyWhenChanged) {
+    std::atomic<int> version{0}, evaluations{0};
+    xsql::socket::Server server;
+    xsql::socket::ServerConfig config;
+    config.port = 0;
+    config.verbose = false;
+    config.subscription_poll_ms = 10;
+    server.set_config(config);
+    server.set_subscribe_handler([&](const std::string&, std::string&) {
+        return std::make_unique<CountingSubscription>(version, evaluations);
+    });
+    ASSERT_TRUE(server.run_async());
+
+    xsql::socket::Client client;
+    ASSERT_TRUE(client.connect("127.0.0.1", server.port()));
+    auto snap = client.subscribe("anything");
+    ASSERT_TRUE(snap.success) << snap.error;
+    ASSERT_EQ(snap.rows.size(), 1u);
+    EXPECT_EQ(snap.rows[0][0], "0");
+
+    xsql::socket::RemoteDelta delta;
+    EXPECT_FALSE(client.next_delta(delta, 100));
+    EXPECT_EQ(evaluations.load(), 1);
+
+    version = 1;
+    ASSERT_TRUE(client.next_delta(delta, 2000));
+    ASSERT_EQ(delta.rows.size(), 1u);
+    EXPECT_EQ(delta.rows[0][0], "1");
+    ASSERT_EQ(delta.removed.size(), 1u);
+    EXPECT_EQ(delta.removed[0][0], "0");
+    EXPECT_EQ(evaluations.load(), 2);
+
+    client.disconnect();
+    server.stop();
+}
+
+// ============================================================================
+// Scheduling
+// ============================================================================
+
+TEST(SocketScheduling, HeavyQueriesRunInBackgroundLane) {
+    xsql::socket::Server server;
+    xsql::socket::ServerConfig config;
+    config.port = 0;
+    config.verbose = false;
+    config.scheduling.max_running = 2;
+    config.scheduling.interactive_slots = 1;
+    config.scheduling.background_slots = 1;
+    server.set_config(config);
+    server.set_cost_classifier([](const std::string& sql) {
+        return sql.find("export") != std::string::npos ? xsql::QueryLane::Background
+                                                       : xsql::QueryLane::Interactive;
+    });
+    server.set_query_handler([](const std::string& sql) {
+        if (sql.find("export") != std::string::npos) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(600));
+        }
+        auto r = xsql::socket::QueryResult::ok();
+        r.columns = {"sql"};
+        r.rows = {{sql}};
+        return r;
+    });
+    ASSERT_TRUE(server.run_async());
+
+    // A long export holds the background slot...
+    std::thread exporter([&]() {
+        xsql::socket::Client client;
+        ASSERT_TRUE(client.connect("127.0.0.1", server.port()));
+        EXPECT_TRUE(client.query("export everything").success);
+    });
+    while (server.scheduler_stats().background_running == 0) std::this_thread::yield();
+
+    // ...while interactive lookups from another connection still go straight through
+    xsql::socket::Client client;
+    ASSERT_TRUE(client.connect("127.0.0.1", server.port()));
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 5; ++i) ASSERT_TRUE(client.query("lookup").success);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    EXPECT_LT(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count(), 300);
+    EXPECT_EQ(server.scheduler_stats().background_running, 1u);
+
+    exporter.join();
+    auto stats = server.scheduler_stats();
+    EXPECT_EQ(stats.background_admitted, 1u);
+    EXPECT_GE(stats.interactive_admitted, 5u);
+    client.disconnect();
+    server.stop();
+}
+
+TEST(SocketScheduling, RefusesConnectionsOverLimit) {
+    xsql::socket::Server server;
+    xsql::socket::ServerConfig config;
+    config.port = 0;
+    config.verbose = false;
+    config.max_connections = 1;
+    server.set_config(config);
+    server.set_query_handler([](const std::string&) { return xsql::socket::QueryResult::ok(); });
+    std::atomic<int> refused{0};
+    server.set_log_func([&](const std::string& msg) {
+        if (msg.find("Client refused") != std::string::npos) refused++;
+    });
+    ASSERT_TRUE(server.run_async());
+
+    xsql::socket::Client first;
+    ASSERT_TRUE(first.connect("127.0.0.1", server.port()));
+    ASSERT_TRUE(first.query("SELECT 1").success);
+
+    // The refused client reads the server's reason instead of dying on a closed socket
+    for (int i = 1; i <= 3; ++i) {
+        xsql::socket::Client extra;
+        ASSERT_TRUE(extra.connect("127.0.0.1", server.port()));
+        while (refused < i) std::this_thread::yield();
+        auto r = extra.query("SELECT 1");
+        EXPECT_FALSE(r.success);
+        EXPECT_EQ(r.error, "Too many connections");
+        EXPECT_FALSE(extra.query("SELECT 1").success);
+    }
+
+    EXPECT_TRUE(first.query("SELECT 1").success);
+    first.disconnect();
+    server.stop();
+}
+
+TEST(SocketScheduling, TransactionHoldsSharedConnectionUntilItEnds) {
+    xsql::Database db;
+    db.exec("CREATE TABLE t (v INTEGER)");
+
+    xsql::socket::Server server;
+    xsql::socket::ServerConfig config;
+    config.port = 0;
+    config.verbose = false;
+    config.scheduling.max_wait_ms = 300;
+    server.set_config(config);
+    xsql::socket::serve_database(server, db);
+    ASSERT_TRUE(server.run_async());
+
+    xsql::socket::Client a, b;
+    ASSERT_TRUE(a.connect("127.0.0.1", server.port()));
+    ASSERT_TRUE(b.connect("127.0.0.1", server.port()));
+
+    // B's write waits for A's transaction instead of joining it
+    ASSERT_TRUE(a.query("BEGIN").success);
+    ASSERT_TRUE(a.query("INSERT INTO t VALUES (1)").success);
+    auto r = b.query("INSERT INTO t VALUES (2)");
+    EXPECT_FALSE(r.success);
+    EXPECT_NE(r.error.find("transaction open"), std::string::npos) << r.error;
+    auto batch = b.query_batch({"INSERT INTO t VALUES (3)"}, true);
+    EXPECT_FALSE(batch.success);
+
+    auto pending = std::async(std::launch::async, [&] { return b.query("INSERT INTO t VALUES (4)"); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    ASSERT_TRUE(a.query("ROLLBACK").success);
+    r = pending.get();
+    EXPECT_TRUE(r.success) << r.error;
+
+    batch = b.query_batch({"INSERT INTO t VALUES (5)"}, true);
+    EXPECT_TRUE(batch.success) << batch.error;
+    r = a.query("SELECT group_concat(v) FROM (SELECT v FROM t ORDER BY v)");
+    ASSERT_TRUE(r.success) << r.error;
+    EXPECT_EQ(r.rows[0][0], "4,5");
+
+    // A client that disconnects inside a transaction is rolled back
+    ASSERT_TRUE(a.query("BEGIN").success);
+    ASSERT_TRUE(a.query("DELETE FROM t").success);
+    a.disconnect();
+    r = b.query("SELECT COUNT(*) FROM t");
+    ASSERT_TRUE(r.success) << r.error;
+    EXPECT_EQ(r.rows[0][0], "2");
+
+    b.disconnect();
+    server.stop();
+}
+
+TEST(SocketLimits, OversizedResultsFailWithoutDroppingConnection) {
+    xsql::Database db;
+    db.exec("CREATE TABLE t (v TEXT)");
+    db.exec("WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 5000) "
+            "INSERT INTO t SELECT hex(randomblob(50)) FROM n");
+
+    xsql::socket::Server server;
+    xsql::socket::ServerConfig config;
+    config.port = 0;
+    config.verbose = false;
+    config.max_result_bytes = 64 * 1024;
+    config.max_result_rows = 1000;
+    server.set_config(config);
+    xsql::socket::serve_database(server, db);
+    // "SELECT big" stands in for a handler that ignores the result limits
+    server.set_query_handler([db_handler = xsql::socket::database_query_handler(db, &server)](
+                                 const std::string& sql) {
+        if (sql != "SELECT big") return db_handler(sql);
+        auto out = xsql::socket::QueryResult::ok();
+        out.columns = {"v"};
+        out.rows.push_back({std::string(11 * 1024 * 1024, 'x')});
+        return out;
+    });
+    ASSERT_TRUE(server.run_async());
+
+    xsql::socket::Client client;
+    ASSERT_TRUE(client.connect("127.0.0.1", server.port()));
+
+    auto r = client.query("SELECT v FROM t");
+    EXPECT_FALSE(r.success);
+    EXPECT_NE(r.error.find("max_result_bytes"), std::string::npos) << r.error;
+
+    r = client.query("SELECT 1 FROM t");
+    EXPECT_FALSE(r.success);
+    EXPECT_NE(r.error.find("max_result_rows"), std::string::npos) << r.error;
+
+    auto stmt = client.prepare("SELECT v FROM t WHERE rowid <= ?");
+    ASSERT_TRUE(stmt.success) << stmt.error;
+    EXPECT_FALSE(client.execute(stmt.statement, {xsql::socket::Param::integer(5000)}).success);
+    EXPECT_TRUE(client.execute(stmt.statement, {xsql::socket::Param::integer(10)}).success);
+
+    // Cursors page through results beyond the limits
+    size_t rows = 0;
+    auto page = client.open_cursor("SELECT v FROM t", {}, 500);
+    while (page.success) {
+        rows += page.rows.size();
+        if (page.done) break;
+        page = client.fetch(page.cursor, 500);
+    }
+    EXPECT_EQ(rows, 5000u);
+
+    // A response that exceeds the frame gets an error, not a closed socket
+    r = client.query("SELECT big");
+    EXPECT_FALSE(r.success);
+    EXPECT_NE(r.error.find("max_message_bytes"), std::string::npos) << r.error;
+    EXPECT_TRUE(client.query("SELECT 1").success);
+
+    client.disconnect();
+    server.stop();
+}
+
+// ============================================================================
+// Fan-out
+// ============================================================================
+
+namespace {
+
+// Three shards holding ids 1..90 round-robin, plus a reference database with all rows
+class FanoutFixture : public ::testing::Test {
+protected:
+    static constexpr int kShards = 3;
+
+    void SetUp() override {
+        const char* schema = "CREATE TABLE ev (id INTEGER, grp TEXT, v INTEGER)";
+        all_.exec(schema);
+        for (int s = 0; s < kShards; ++s) {
+            shards_[s].exec(schema);
+            xsql::socket::ServerConfig config;
+            config.port = 0;
+            config.verbose = false;
+            servers_[s].set_config(config);
+            xsql::socket::serve_database(servers_[s], shards_[s]);
+            ASSERT_TRUE(servers_[s].run_async());
+            fanout_.add_shard("127.0.0.1", servers_[s].port());
+        }
+        for (int id = 1; id <= 90; ++id) {
+            std::string row = "INSERT INTO ev VALUES (" + std::to_string(id) + ", 'g" +
+                              std::to_string(id % 4) + "', " + std::to_string(id * 7 % 50) + ")";
+            shards_[id % kShards].exec(row.c_str());
+            all_.exec(row.c_str());
+        }
+    }
+
+    void TearDown() override {
+        for (auto& s : servers_) s.stop();
+    }
+
+    xsql::Database shards_[kShards];
+    xsql::Database all_;
+    xsql::socket::Server servers_[kShards];
+    xsql::socket::FanoutClient fanout_;
+};
+
+}  // namespace
+
+TEST_F(FanoutFixture, ConcatenatesAndReportsLatency) {
+    size_t callbacks = 0;
+    fanout_.set_shard_callback([&](const xsql::socket::ShardResult& s) {
+        EXPECT_TRUE(s.result.success) << s.result.error;
+        callbacks++;
+    });
+
+    auto r = fanout_.query("SELECT id FROM ev");
+    ASSERT_TRUE(r.merged.success) << r.merged.error;
+    EXPECT_EQ(r.merged.row_count(), 90u);
+    EXPECT_EQ(callbacks, 3u);
+    ASSERT_EQ(r.shards.size(), 3u);
+    for (const auto& s : r.shards) {
+        EXPECT_EQ(s.result.row_count(), 30u);
+        EXPECT_GT(s.latency_ms, 0.0);
+        EXPECT_LE(s.latency_ms, r.total_ms);
+    }
+}
+
+TEST_F(FanoutFixture, MergesOrderedResults) {
+    xsql::socket::FanoutOptions opt;
+    opt.order_by = {{"v", true}, {"id", false}};
+    opt.limit = 10;
+
+    auto r = fanout_.query("SELECT id, v FROM ev ORDER BY v DESC, id LIMIT 10", opt);
+    ASSERT_TRUE(r.merged.success) << r.merged.error;
+
+    auto expected = all_.query("SELECT id, v FROM ev ORDER BY v DESC, id LIMIT 10");
+    ASSERT_EQ(r.merged.row_count(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(r.merged.rows[i].values, expected[i].values) << "row " << i;
+    }
+}
+
+TEST_F(FanoutFixture, CombinesPartialAggregates) {
+    using xsql::socket::FanoutAggregate;
+    xsql::socket::FanoutOptions opt;
+    opt.group_by = {"grp"};
+    opt.aggregates = {{"n", FanoutAggregate::Count}, {"total", FanoutAggregate::Sum},
+                      {"lo", FanoutAggregate::Min}, {"hi", FanoutAggregate::Max}};
+    opt.order_by = {{"grp", false}};
+
+    const char* sql = "SELECT grp, COUNT(*) AS n, SUM(v) AS total, MIN(v) AS lo, MAX(v) AS hi "
+                      "FROM ev GROUP BY grp ORDER BY grp";
+    auto r = fanout_.query(sql, opt);
+    ASSERT_TRUE(r.merged.success) << r.merged.error;
+
+    auto expected = all_.query(sql);
+    ASSERT_EQ(r.merged.row_count(), expected.size());
+    for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(r.merged.rows[i].values, expected[i].values) << "group " << i;
+    }
+}
+
+TEST_F(FanoutFixture, ReportsFailedShard) {
+    fanout_.add_shard("127.0.0.1", 1);  // Nothing listens here
+
+    auto r = fanout_.query("SELECT COUNT(*) AS n FROM ev");
+    EXPECT_FALSE(r.merged.success);
+    EXPECT_NE(r.merged.error.find("127.0.0.1:1"), std::string::npos) << r.merged.error;
+    EXPECT_FALSE(r.shards[3].result.success);
+
+    xsql::socket::FanoutOptions opt;
+    opt.allow_partial = true;
+    opt.aggregates = {{"n", xsql::socket::FanoutAggregate::Count}};
+    r = fanout_.query("SELECT COUNT(*) AS n FROM ev", opt);
+    ASSERT_TRUE(r.merged.success) << r.merged.error;
+    ASSERT_EQ(r.merged.row_count(), 1u);
+    EXPECT_EQ(r.merged.rows[0][0], "90");
+}
+
+TEST(SocketFanout, ShardThatRefusesConnectionFailsAlone) {
+    xsql::Database db;
+    db.exec("CREATE TABLE ev (id INTEGER)");
+    db.exec("INSERT INTO ev VALUES (1)");
+
+    xsql::socket::Server server;
+    xsql::socket::ServerConfig config;
+    config.port = 0;
+    config.verbose = false;
+    config.max_connections = 1;
+    server.set_config(config);
+    xsql::socket::serve_database(server, db);
+    ASSERT_TRUE(server.run_async());
+
+    // Hold the only slot so the fan-out's connection is refused and closed
+    xsql::socket::Client holder;
+    ASSERT_TRUE(holder.connect("127.0.0.1", server.port()));
+    ASSERT_TRUE(holder.query("SELECT 1").success);
+
+    xsql::socket::FanoutClient fanout;
+    fanout.add_shard("127.0.0.1", server.port());
+    for (int i = 0; i < 20; ++i) {
+        auto r = fanout.query("SELECT id FROM ev");
+        EXPECT_FALSE(r.merged.success);
+        ASSERT_EQ(r.shards.size(), 1u);
+        EXPECT_FALSE(r.shards[0].result.success);
+    }
+
+    holder.disconnect();
+    server.stop();
+}
+
+// ============================================================================
+// Async client
+// ============================================================================
+
+TEST_F(FanoutFixture, AsyncClientDrivesManyQueriesFromOneThread) {
+    xsql::socket::AsyncClient client;
+    std::vector<size_t> ids;
+    for (auto& s : servers_) ids.push_back(client.add_server("127.0.0.1", s.port()));
+
+    std::vector<std::future<xsql::socket::RemoteResult>> futures;
+    for (int i = 0; i < 60; ++i) {
+        futures.push_back(client.query_async(ids[i % kShards], "SELECT COUNT(*) AS n FROM ev"));
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    int callbacks = 0;
+    for (size_t id : ids) {
+        client.query_async(id, "SELECT MAX(id) FROM ev", [&](xsql::socket::RemoteResult r) {
+            EXPECT_TRUE(r.success) << r.error;
+            std::lock_guard<std::mutex> lock(mutex);
+            callbacks++;
+            cv.notify_one();
+        });
+    }
+
+    for (auto& f : futures) {
+        auto r = f.get();
+        ASSERT_TRUE(r.success) << r.error;
+        ASSERT_EQ(r.row_count(), 1u);
+        EXPECT_EQ(r.rows[0][0], "30");
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    EXPECT_TRUE(cv.wait_for(lock, std::chrono::seconds(5), [&] { return callbacks == kShards; }));
+}
+
+TEST_F(FanoutFixture, AsyncClientReportsFailuresAndReconnects) {
+    xsql::socket::AsyncClientConfig config;
+    config.reconnect_attempts = 1;
+    config.reconnect_backoff_ms = 10;
+    xsql::socket::AsyncClient client(config);
+
+    size_t dead = client.add_server("127.0.0.1", 1);  // Nothing listens here
+    auto r = client.query_async(dead, "SELECT 1").get();
+    EXPECT_FALSE(r.success);
+    EXPECT_NE(r.error.find("connect"), std::string::npos) << r.error;
+    EXPECT_FALSE(client.query_async(99, "SELECT 1").get().success);
+
+    int port = servers_[0].port();
+    size_t live = client.add_server("127.0.0.1", port);
+    ASSERT_TRUE(client.query_async(live, "SELECT 1").get().success);
+
+    // The server drops the connection; the next request reconnects
+    servers_[0].stop();
+    ASSERT_TRUE(servers_[0].run_async(port));
+    r = client.query_async(live, "SELECT COUNT(*) FROM ev").get();
+    if (!r.success) {
+        // The first request may have been sent on the stale connection
+        EXPECT_NE(r.error.find("connection lost"), std::string::npos) << r.error;
+        r = client.query_async(live, "SELECT COUNT(*) FROM ev").get();
+    }
+    ASSERT_TRUE(r.success) << r.error;
+    EXPECT_EQ(r.rows[0][0], "30");
+    EXPECT_EQ(client.outstanding(), 0u);
+}
+
+TEST(SocketAsyncClient, ReportsRefusedConnection) {
+    xsql::socket::Server server;
+    xsql::socket::ServerConfig config;
+    config.port = 0;
+    config.verbose = false;
+    config.max_connections = 1;
+    server.set_config(config);
+    server.set_query_handler([](const std::string&) { return xsql::socket::QueryResult::ok(); });
+    ASSERT_TRUE(server.run_async());
+
+    xsql::socket::Client holder;
+    ASSERT_TRUE(holder.connect("127.0.0.1", server.port()));
+    ASSERT_TRUE(holder.query("SELECT 1").success);
+
+    // The refusal and the close arrive together; the reason must not be lost to the EOF
+    xsql::socket::AsyncClientConfig async_config;
+    async_config.reconnect_attempts = 0;
+    xsql::socket::AsyncClient client(async_config);
+    size_t id = client.add_server("127.0.0.1", server.port());
+    for (int i = 0; i < 5; ++i) {
+        auto r = client.query_async(id, "SELECT 1").get();
+        EXPECT_FALSE(r.success);
+        EXPECT_NE(r.error.find("Too many connections"), std::string::npos) << r.error;
+    }
+
+    holder.disconnect();
+    server.stop();
+}
+
+TEST(SocketAsyncClient, SlowRequestsTimeOut) {
+    xsql::socket::Server server;
+    xsql::socket::ServerConfig sc;
+    sc.port = 0;
+    sc.verbose = false;
+    server.set_config(sc);
+    server.set_query_handler([](const std::string& sql) {
+        if (sql == "slow") std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        auto r = xsql::socket::QueryResult::ok();
+        r.columns = {"sql"};
+        r.rows = {{sql}};
+        return r;
+    });
+    ASSERT_TRUE(server.run_async());
+
+    xsql::socket::AsyncClientConfig config;
+    config.request_timeout_ms = 100;
+    xsql::socket::AsyncClient client(config);
+    size_t id = client.add_server("127.0.0.1", server.port());
+
+    auto r = client.query_async(id, "slow").get();
+    EXPECT_FALSE(r.success);
+    EXPECT_EQ(r.error, "timeout");
+    // Handlers are serialized, so let the slow one finish first
+    std::this_thread::sleep_for(std::chrono::milliseconds(600));
+    r = client.query_async(id, "fast").get();
+    EXPECT_TRUE(r.success) << r.error;
+
+    server.stop();
+}
+
+// ============================================================================
+// Workload capture and replay
+// ============================================================================
+
+TEST(SocketWorkload, CapturedRequestsReplayAgainstServer) {
+    std::string path = ::testing::TempDir() + "xsql_capture.xwl";
+    xsql::Database db;
+    db.exec("CREATE TABLE t (id INTEGER, name TEXT)");
+    db.exec("INSERT INTO t VALUES (1, 'a'), (2, 'b'), (3, 'c')");
+
+    xsql::socket::Server server;
+    xsql::socket::ServerConfig config;
+    config.port = 0;
+    config.verbose = false;
+    config.auth_token = "secret";
+    config.capture_path = path;
+    server.set_config(config);
+    xsql::socket::serve_database(server, db);
+    ASSERT_TRUE(server.run_async());
+
+    {
+        xsql::socket::Client client;
+        client.set_auth_token("secret");
+        ASSERT_TRUE(client.connect("127.0.0.1", server.port()));
+        ASSERT_TRUE(client.query("SELECT COUNT(*) FROM t").success);
+        auto prepared = client.prepare("SELECT name FROM t WHERE id = ?");
+        ASSERT_TRUE(prepared.success) << prepared.error;
+        ASSERT_TRUE(client.execute(prepared.statement, {xsql::socket::Param::integer(2)}).success);
+
+        xsql::socket::Client intruder;
+        ASSERT_TRUE(intruder.connect("127.0.0.1", server.port()));
+        EXPECT_FALSE(intruder.query("SELECT 1").success);    // Unauthorized: not captured
+    }
+    server.stop();
+    EXPECT_EQ(server.captured_requests(), 3u);
+
+    std::vector<xsql::socket::CapturedRequest> log;
+    std::string error;
+    ASSERT_TRUE(xsql::socket::read_workload(path, log, error)) << error;
+    ASSERT_EQ(log.size(), 3u);
+    EXPECT_EQ(log[0].connection, log[2].connection);
+    EXPECT_LE(log[0].offset_us, log[2].offset_us);
+    for (const auto& r : log) EXPECT_EQ(r.payload.find("secret"), std::string::npos) << r.payload;
+
+    // Replay the capture paced at recorded timing, then a synthetic mix unpaced
+    config.capture_path.clear();
+    server.set_config(config);
+    ASSERT_TRUE(server.run_async());
+
+    xsql::socket::ReplayOptions opt;
+    opt.token = "secret";
+    opt.speed = 1.0;
+    auto report = xsql::socket::replay_workload("127.0.0.1", server.port(), log, opt);
+    EXPECT_EQ(report.requests, 3u);
+    EXPECT_EQ(report.errors, 0u) << report.first_error;
+
+    auto mix = xsql::socket::synthetic_workload({{"SELECT COUNT(*) FROM t", 3}, {"SELECT * FROM t", 1}}, 200, 8);
+    opt.speed = 0;
+    opt.concurrency = 4;
+    report = xsql::socket::replay_workload("127.0.0.1", server.port(), mix, opt);
+    EXPECT_EQ(report.requests, 200u);
+    EXPECT_EQ(report.errors, 0u) << report.first_error;
+    EXPECT_GT(report.throughput(), 0.0);
+    EXPECT_LE(report.p50_ms, report.p99_ms);
+    EXPECT_LE(report.p99_ms, report.max_ms);
+
+    server.stop();
+    std::remove(path.c_str());
+}
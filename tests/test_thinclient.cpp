@@ -9,9 +9,12 @@
 
 #include <xsql/thinclient/thinclient.hpp>
 #include <xsql/database.hpp>
+#include <atomic>
 #include <thread>
 #include <chrono>
+#include <cstdio>
 #include <sstream>
+#include <vector>
 
 using namespace xsql;
 using namespace xsql::thinclient;
@@ -192,6 +195,157 @@ TEST_F(ThinclientTest, ClientPing) {
     EXPECT_FALSE(cli.ping());
 }
 
+// ============================================================================
+// Built-in /query Route
+// ============================================================================
+
+TEST(ThinclientPoolTest, QueryRouteScalesWithConcurrency) {
+    std::string path = ::testing::TempDir() + "xsql_thinclient_pool.db";
+    std::remove(path.c_str());
+    {
+        Database db(path.c_str());
+        ASSERT_EQ(db.exec("CREATE TABLE t (v INTEGER)"), SQLITE_OK);
+        ASSERT_EQ(db.exec("WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < 50000) "
+                          "INSERT INTO t SELECT i FROM n"), SQLITE_OK);
+    }
+
+    // probe() holds each query open briefly and records how many overlap;
+    // it is not deterministic, so no result is served from a cache
+    std::atomic<int> in_flight{0};
+    std::atomic<int> peak{0};
+    auto setup = [&](Database& db) {
+        db.register_function("probe", 0, [&](sqlite3_context* ctx, int, sqlite3_value**) {
+            int now = ++in_flight;
+            int seen = peak.load();
+            while (now > seen && !peak.compare_exchange_weak(seen, now)) {}
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            --in_flight;
+            sqlite3_result_int(ctx, 1);
+        }, SQLITE_UTF8);
+    };
+
+    server_config config;
+    config.port = 18085;
+    config.worker_threads = 8;
+    config.open_connection = read_only_connections(path, setup);
+
+    server srv(config);
+    // Scheduling left unset follows worker_threads
+    EXPECT_EQ(srv.scheduler().config().max_running, 8u);
+    EXPECT_EQ(srv.scheduler().config().interactive_slots, 8u);
+    srv.run_async();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // Load test: same total work at increasing client concurrency
+    const int kRequests = 64;
+    for (int concurrency : {1, 2, 4, 8}) {
+        std::atomic<int> ok{0};
+        peak = 0;
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> clients;
+        for (int c = 0; c < concurrency; ++c) {
+            clients.emplace_back([&]() {
+                client_config client_cfg;
+                client_cfg.port = 18085;
+                client cli(client_cfg);
+                for (int i = 0; i < kRequests / concurrency; ++i) {
+                    std::string body = cli.query("SELECT COUNT(*) AS n, probe() AS p FROM t WHERE v % 7 = 3");
+                    if (body.find("\"success\":true") != std::string::npos &&
+                        body.find("\"7143\"") != std::string::npos) {
+                        ok++;
+                    }
+                }
+            });
+        }
+        for (auto& t : clients) t.join();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        EXPECT_EQ(ok.load(), kRequests) << "concurrency " << concurrency;
+        // Concurrent clients run on separate pooled connections at the same time
+        if (concurrency == 1) {
+            EXPECT_EQ(peak.load(), 1);
+        } else {
+            EXPECT_GT(peak.load(), 1) << "concurrency " << concurrency;
+            EXPECT_LE(peak.load(), concurrency);
+        }
+        ::testing::Test::RecordProperty("qps_" + std::to_string(concurrency),
+                                        std::to_string(static_cast<int>(kRequests * 1000.0 / ms)));
+    }
+
+    ASSERT_NE(srv.connection_pool(), nullptr);
+    EXPECT_LE(srv.connection_pool()->size(), 8u);
+
+    // Pooled connections are read-only, and errors come back as JSON
+    client_config client_cfg;
+    client_cfg.port = 18085;
+    client cli(client_cfg);
+    EXPECT_THROW(cli.query("DELETE FROM t"), std::runtime_error);
+
+    srv.stop();
+    std::remove(path.c_str());
+}
+
+TEST(ThinclientPoolTest, UnchangedResultsAreNotModified) {
+    static std::vector<int> data;
+    data = {1, 2, 3};
+    static std::atomic<uint64_t> generation{0};
+    static std::atomic<int> scans{0};
+
+    auto def = xsql::table("versioned")
+        .count([]() { scans++; return data.size(); })
+        .generation([]() { return generation.load(); })
+        .column_int("n", [](size_t i) { return data[i]; })
+        .build();
+
+    server_config config;
+    config.port = 18086;
+    config.worker_threads = 2;
+    config.open_connection = [&def]() {
+        auto db = std::make_unique<Database>();
+        db->register_and_create_table(def);
+        return db;
+    };
+
+    server srv(config);
+    srv.run_async();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    client_config client_cfg;
+    client_cfg.port = 18086;
+    client cli(client_cfg);
+
+    std::string first = cli.query("SELECT SUM(n) AS total FROM versioned");
+    EXPECT_NE(first.find("\"6\""), std::string::npos);
+    int scans_after_first = scans.load();
+
+    // Unchanged: served from the client's cache after a 304, without a scan
+    EXPECT_EQ(cli.query("SELECT SUM(n) AS total FROM versioned"), first);
+    EXPECT_EQ(cli.not_modified_count(), 1u);
+    EXPECT_EQ(scans.load(), scans_after_first);
+
+    data.push_back(4);
+    generation++;
+    std::string changed = cli.query("SELECT SUM(n) AS total FROM versioned");
+    EXPECT_NE(changed.find("\"10\""), std::string::npos);
+    EXPECT_EQ(cli.not_modified_count(), 1u);
+
+    // Raw request: the ETag round-trips, and unversioned queries get none
+    httplib::Client raw("127.0.0.1", 18086);
+    auto res = raw.Post("/query", "SELECT SUM(n) FROM versioned", "text/plain");
+    ASSERT_TRUE(res);
+    std::string etag = res->get_header_value("ETag");
+    ASSERT_FALSE(etag.empty());
+    httplib::Headers headers = {{"If-None-Match", "\"other\", " + etag}};
+    res = raw.Post("/query", headers, "SELECT SUM(n) FROM versioned", "text/plain");
+    ASSERT_TRUE(res);
+    EXPECT_EQ(res->status, 304);
+    res = raw.Post("/query", "SELECT random() FROM versioned", "text/plain");
+    ASSERT_TRUE(res);
+    EXPECT_FALSE(res->has_header("ETag"));
+
+    srv.stop();
+}
+
 // ============================================================================
 // CLI Parser Tests
 // ============================================================================
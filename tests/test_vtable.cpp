@@ -7,6 +7,19 @@
 #include <vector>
 #include <string>
 #include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#endif
 
 namespace {
 
@@ -78,6 +91,35 @@ public:
     }
 };
 
+// Row i has key i and n = i * step; seek() jumps straight to a key or n
+class SeekableRangeGenerator : public xsql::Generator<GenRow> {
+    std::atomic<int>* next_calls_ = nullptr;
+    int64_t current_ = -1;
+    int64_t end_ = 0;
+    int64_t step_ = 1;
+    GenRow row_;
+
+public:
+    SeekableRangeGenerator(std::atomic<int>* next_calls, int64_t end, int64_t step)
+        : next_calls_(next_calls), end_(end), step_(step) {}
+
+    bool next() override {
+        next_calls_->fetch_add(1);
+        ++current_;
+        row_.key = current_;
+        row_.n = current_ * step_;
+        return current_ < end_;
+    }
+
+    const GenRow& current() const override { return row_; }
+    sqlite3_int64 rowid() const override { return current_; }
+
+    bool seek(sqlite3_int64 key) override {
+        current_ = key > 0 ? (key + step_ - 1) / step_ - 1 : -1;
+        return true;
+    }
+};
+
 class SingleRowIterator : public xsql::RowIterator {
     bool started_ = false;
     bool valid_ = false;
@@ -430,6 +472,82 @@ TEST_F(VTableTest, CachedIteratorTerminationUsesNextReturnValue) {
     EXPECT_EQ(results[1][1], "1");
 }
 
+#ifdef XSQL_HAS_PMR
+namespace {
+
+struct PmrRow {
+    using allocator_type = std::pmr::polymorphic_allocator<char>;
+    int64_t id = 0;
+    std::pmr::string name;
+
+    explicit PmrRow(const allocator_type& a = {}) : name(a) {}
+    PmrRow(int64_t i, const std::string& n, const allocator_type& a = {}) : id(i), name(n, a) {}
+    PmrRow(const PmrRow& o, const allocator_type& a) : id(o.id), name(o.name, a) {}
+    PmrRow(PmrRow&& o, const allocator_type& a) : id(o.id), name(std::move(o.name), a) {}
+};
+
+// Counts allocations that reach the system
+class CountingResource : public std::pmr::memory_resource {
+public:
+    std::atomic<size_t> allocations{0};
+
+private:
+    void* do_allocate(size_t bytes, size_t align) override {
+        allocations++;
+        return std::pmr::new_delete_resource()->allocate(bytes, align);
+    }
+    void do_deallocate(void* p, size_t bytes, size_t align) override {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override { return this == &o; }
+};
+
+} // namespace
+
+TEST_F(VTableTest, PmrCachedRowsShareOneArenaPerGeneration) {
+    static_assert(xsql::is_pmr_row_v<PmrRow>);
+    static_assert(!xsql::is_pmr_row_v<int>);
+
+    const size_t kRows = 50000;
+    int builds = 0;
+    auto table = xsql::cached_table<PmrRow>("pmr_rows")
+        .estimate_rows([&]() { return kRows; })
+        .cache_builder([&](std::pmr::vector<PmrRow>& rows) {
+            builds++;
+            for (size_t i = 0; i < kRows; ++i) {
+                rows.emplace_back(static_cast<int64_t>(i), "a name long enough to skip SSO #" + std::to_string(i));
+            }
+        })
+        .column_int64("id", [](const PmrRow& r) { return r.id; })
+        .column_text("name", [](const PmrRow& r) { return std::string(r.name); })
+        .build();
+
+    ASSERT_TRUE(xsql::register_cached_vtable(db_, "pmr_rows_module", &table));
+    ASSERT_TRUE(xsql::create_vtable(db_, "pmr_rows", "pmr_rows_module"));
+
+    CountingResource counting;
+    auto* previous = std::pmr::set_default_resource(&counting);
+    auto r = query("SELECT COUNT(*), MAX(name) FROM pmr_rows WHERE id % 2 = 0");
+    std::pmr::set_default_resource(previous);
+
+    ASSERT_EQ(r.size(), 1u);
+    EXPECT_EQ(r[0][0], "25000");
+    EXPECT_EQ(builds, 1);
+    // 50k rows and 50k heap strings come from a handful of arena blocks
+    EXPECT_LT(counting.allocations.load(), 32u);
+    EXPECT_GT(table.shared_cache->arena.allocated(), kRows * sizeof(PmrRow));
+
+    table.invalidate_cache();
+    EXPECT_EQ(table.shared_cache->arena.allocated(), 0u);
+    EXPECT_EQ(table.shared_cache->data.size(), 0u);
+
+    r = query("SELECT name FROM pmr_rows WHERE id = 7");
+    ASSERT_EQ(r.size(), 1u);
+    EXPECT_EQ(r[0][0], "a name long enough to skip SSO #7");
+    EXPECT_EQ(builds, 2);
+}
+#endif
+
 TEST_F(VTableTest, GeneratorTableLimitStopsEarly) {
     std::atomic<int> next_calls = 0;
     std::atomic<int> factory_calls = 0;
@@ -485,6 +603,780 @@ TEST_F(VTableTest, GeneratorTableFiltersBypassGenerator) {
     EXPECT_EQ(next_calls.load(), 0);
 }
 
+#ifndef _WIN32
+TEST_F(VTableTest, GeneratorScanSeesColumnsLimitAndOffset) {
+    std::atomic<int> next_calls = 0;
+    std::vector<xsql::GeneratorScan> scans;
+
+    auto table = xsql::generator_table<GenRow>("gen_scan")
+        .estimate_rows([]() { return 1000; })
+        .scan([&](const xsql::GeneratorScan& scan) -> std::unique_ptr<xsql::Generator<GenRow>> {
+            scans.push_back(scan);
+            auto gen = std::make_unique<RangeGenerator>(&next_calls, 1000);
+            for (int64_t i = 0; i < scan.offset; ++i) gen->next();
+            return gen;
+        })
+        .column_int64("key", [](const GenRow& r) { return r.key; })
+        .column_int64("n", [](const GenRow& r) { return r.n; })
+        .build();
+    ASSERT_TRUE(xsql::register_generator_vtable(db_, "gen_scan", &table));
+    ASSERT_TRUE(xsql::create_vtable(db_, "gen_scan", "gen_scan"));
+
+    auto rows = query("SELECT n FROM gen_scan LIMIT 3 OFFSET 500");
+    ASSERT_EQ(rows.size(), 3u);
+    EXPECT_EQ(rows[0][0], "500");
+    ASSERT_EQ(scans.size(), 1u);
+    EXPECT_FALSE(scans[0].uses_column(0));
+    EXPECT_TRUE(scans[0].uses_column(1));
+    EXPECT_EQ(scans[0].limit, 3);
+    EXPECT_EQ(scans[0].offset, 500);
+
+    // With a WHERE term SQLite filters after us, so nothing is pushed down
+    rows = query("SELECT key FROM gen_scan WHERE n % 2 = 1 LIMIT 2 OFFSET 1");
+    ASSERT_EQ(rows.size(), 2u);
+    EXPECT_EQ(rows[0][0], "3");
+    ASSERT_EQ(scans.size(), 2u);
+    EXPECT_EQ(scans[1].limit, -1);
+    EXPECT_EQ(scans[1].offset, 0);
+    EXPECT_TRUE(scans[1].uses_column(0));
+}
+
+TEST_F(VTableTest, PushGeneratorPullsFromCallbackEnumerator) {
+    // A source that only offers enumerate(callback), stopping when told to
+    std::atomic<int64_t> emitted = 0;
+    auto enumerate_source = [&](const std::function<bool(int64_t)>& cb) {
+        for (int64_t i = 0; i < 100000; ++i) {
+            emitted.fetch_add(1);
+            if (!cb(i)) return;
+        }
+    };
+    auto def = xsql::generator_table<GenRow>("pushed")
+        .enumerate([&](xsql::PushSink<GenRow>& sink) {
+            enumerate_source([&](int64_t i) { return sink(GenRow{i, i * 2}); });
+        }, 64)
+        .column_int64("key", [](const GenRow& r) { return r.key; })
+        .column_int64("n", [](const GenRow& r) { return r.n; })
+        .build();
+    ASSERT_TRUE(xsql::register_generator_vtable(db_, "pushed", &def));
+    ASSERT_TRUE(xsql::create_vtable(db_, "pushed", "pushed"));
+
+    auto rows = query("SELECT COUNT(*), SUM(n) FROM pushed");
+    ASSERT_EQ(rows.size(), 1u);
+    EXPECT_EQ(rows[0][0], "100000");
+    EXPECT_EQ(rows[0][1], "9999900000");
+
+    // LIMIT/OFFSET are pushed down: the producer stops right after the limit
+    emitted = 0;
+    rows = query("SELECT rowid, key FROM pushed LIMIT 3 OFFSET 10");
+    ASSERT_EQ(rows.size(), 3u);
+    EXPECT_EQ(rows[0], (std::vector<std::string>{"10", "10"}));
+    EXPECT_EQ(rows[2], (std::vector<std::string>{"12", "12"}));
+    EXPECT_EQ(emitted.load(), 13);
+
+    // Without pushdown, closing the cursor stops the producer a few batches in
+    emitted = 0;
+    rows = query("SELECT key FROM pushed WHERE n % 4 = 0 LIMIT 5");
+    ASSERT_EQ(rows.size(), 5u);
+    EXPECT_EQ(rows[4][0], "8");
+    EXPECT_LE(emitted.load(), 64 * 3 + 1);
+}
+
+TEST_F(VTableTest, PushGeneratorReportsEnumeratorException) {
+    auto def = xsql::generator_table<GenRow>("failing")
+        .enumerate([](xsql::PushSink<GenRow>& sink) {
+            for (int64_t i = 0; i < 100; ++i) {
+                if (i == 70) throw std::runtime_error("source went away");
+                if (!sink(GenRow{i, i})) return;
+            }
+        }, 16)
+        .column_int64("key", [](const GenRow& r) { return r.key; })
+        .build();
+    ASSERT_TRUE(xsql::register_generator_vtable(db_, "failing", &def));
+    ASSERT_TRUE(xsql::create_vtable(db_, "failing", "failing"));
+
+    // The rows emitted before the throw arrive, then the statement fails
+    sqlite3_stmt* stmt = nullptr;
+    ASSERT_EQ(sqlite3_prepare_v2(db_, "SELECT key FROM failing", -1, &stmt, nullptr), SQLITE_OK);
+    int rows = 0;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) ++rows;
+    EXPECT_EQ(rc, SQLITE_ERROR);
+    EXPECT_EQ(rows, 70);
+    EXPECT_STREQ(sqlite3_errmsg(db_), "source went away");
+    sqlite3_finalize(stmt);
+
+    // A LIMIT satisfied before the throw still succeeds
+    auto limited = query("SELECT key FROM failing LIMIT 5");
+    EXPECT_EQ(limited.size(), 5u);
+}
+
+TEST_F(VTableTest, SeekableGeneratorStartsAtLowerBound) {
+    std::atomic<int> next_calls = 0;
+    auto by_rowid = xsql::generator_table<GenRow>("paged")
+        .generator([&]() { return std::make_unique<SeekableRangeGenerator>(&next_calls, 10000, 1); })
+        .seekable()
+        .column_int64("key", [](const GenRow& r) { return r.key; })
+        .build();
+    ASSERT_TRUE(xsql::register_generator_vtable(db_, "paged", &by_rowid));
+    ASSERT_TRUE(xsql::create_vtable(db_, "paged", "paged"));
+
+    // Each page costs O(page), not O(offset); the strict bound is re-checked
+    auto rows = query("SELECT rowid, key FROM paged WHERE rowid > 5000 LIMIT 3");
+    ASSERT_EQ(rows.size(), 3u);
+    EXPECT_EQ(rows[0], (std::vector<std::string>{"5001", "5001"}));
+    EXPECT_EQ(rows[2][0], "5003");
+    EXPECT_LE(next_calls.load(), 5);
+
+    next_calls = 0;
+    EXPECT_EQ(query("SELECT COUNT(*) FROM paged WHERE rowid >= 9998.5")[0][0], "1");
+    EXPECT_LE(next_calls.load(), 4);
+
+    // Non-numeric bounds fall back to a full scan
+    next_calls = 0;
+    EXPECT_EQ(query("SELECT COUNT(*) FROM paged WHERE rowid > 'x'")[0][0], "0");
+    EXPECT_EQ(next_calls.load(), 10001);
+
+    // A declared ordered key column
+    auto by_key = xsql::generator_table<GenRow>("keyed")
+        .generator([&]() { return std::make_unique<SeekableRangeGenerator>(&next_calls, 1000, 10); })
+        .column_int64("key", [](const GenRow& r) { return r.key; })
+        .column_int64("n", [](const GenRow& r) { return r.n; })
+        .seekable("n")
+        .build();
+    ASSERT_TRUE(xsql::register_generator_vtable(db_, "keyed", &by_key));
+    ASSERT_TRUE(xsql::create_vtable(db_, "keyed", "keyed"));
+
+    next_calls = 0;
+    rows = query("SELECT key, n FROM keyed WHERE n >= 4995 LIMIT 2");
+    ASSERT_EQ(rows.size(), 2u);
+    EXPECT_EQ(rows[0], (std::vector<std::string>{"500", "5000"}));
+    EXPECT_EQ(rows[1][1], "5010");
+    EXPECT_LE(next_calls.load(), 3);
+
+    // A scan() generator gets the LIMIT counted from the bound, but no OFFSET
+    std::vector<xsql::GeneratorScan> scans;
+    auto scanned = xsql::generator_table<GenRow>("scanned")
+        .scan([&](const xsql::GeneratorScan& scan) -> std::unique_ptr<xsql::Generator<GenRow>> {
+            scans.push_back(scan);
+            return std::make_unique<SeekableRangeGenerator>(&next_calls, 10000, 1);
+        })
+        .seekable()
+        .column_int64("key", [](const GenRow& r) { return r.key; })
+        .build();
+    ASSERT_TRUE(xsql::register_generator_vtable(db_, "scanned", &scanned));
+    ASSERT_TRUE(xsql::create_vtable(db_, "scanned", "scanned"));
+
+    next_calls = 0;
+    rows = query("SELECT key FROM scanned WHERE rowid > 5000 LIMIT 3");
+    ASSERT_EQ(rows.size(), 3u);
+    EXPECT_EQ(rows[0][0], "5001");
+    ASSERT_EQ(scans.size(), 1u);
+    EXPECT_EQ(scans[0].limit, 3);
+    EXPECT_LE(next_calls.load(), 3);
+
+    rows = query("SELECT key FROM scanned WHERE rowid >= 5000.5 LIMIT 2 OFFSET 1");
+    ASSERT_EQ(rows.size(), 2u);
+    EXPECT_EQ(rows[0][0], "5002");
+    EXPECT_EQ(scans.back().limit, -1);
+    EXPECT_EQ(scans.back().offset, 0);
+
+    // A generator that cannot seek is rebuilt without the limit
+    auto pushed = xsql::generator_table<GenRow>("pushed")
+        .enumerate([](xsql::PushSink<GenRow>& sink) {
+            for (int64_t i = 0; i < 1000; ++i) {
+                if (!sink(GenRow{i, i})) return;
+            }
+        })
+        .seekable()
+        .column_int64("key", [](const GenRow& r) { return r.key; })
+        .build();
+    ASSERT_TRUE(xsql::register_generator_vtable(db_, "pushed", &pushed));
+    ASSERT_TRUE(xsql::create_vtable(db_, "pushed", "pushed"));
+    rows = query("SELECT key FROM pushed WHERE rowid > 500 LIMIT 2");
+    ASSERT_EQ(rows.size(), 2u);
+    EXPECT_EQ(rows[0][0], "501");
+    EXPECT_EQ(rows[1][0], "502");
+}
+
+TEST_F(VTableTest, CsvTableStreamsMappedFile) {
+    const std::string path = ::testing::TempDir() + "xsql_csv_test.csv";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "id,name,score,Note Text\n";
+        for (int i = 0; i < 5000; ++i) {
+            out << i << ",n" << i << "," << (i % 7 == 0 ? "" : std::to_string(i) + ".5") << ",plain\n";
+        }
+        out << "5000,\"comma, inside\",1.25,\"say \"\"hi\"\"\"\r\n";
+        out << "5001,\"two\nlines\",2,\n";
+        out << "5002,short";  // no trailing newline, missing fields
+    }
+
+    xsql::CsvOptions opt;
+    opt.types = {xsql::ColumnType::Integer, xsql::ColumnType::Text, xsql::ColumnType::Real};
+    opt.index_stride = 100;
+    std::string error;
+    auto file = xsql::CsvFile::open(path, opt, error);
+    ASSERT_TRUE(file) << error;
+    EXPECT_EQ(file->column_names(), (std::vector<std::string>{"id", "name", "score", "Note_Text"}));
+
+    auto def = xsql::csv_table("csv", file);
+    ASSERT_TRUE(xsql::register_generator_vtable(db_, "csv", &def));
+    ASSERT_TRUE(xsql::create_vtable(db_, "csv", "csv"));
+
+    EXPECT_EQ(query("SELECT COUNT(*) FROM csv")[0][0], "5003");
+    // The full scan filled in the sparse index as it went
+    EXPECT_EQ(file->indexed_entries(), 51u);
+    EXPECT_EQ(file->row_count(), 5003u);
+
+    EXPECT_EQ(query("SELECT SUM(id), COUNT(score), typeof(MAX(score)) FROM csv WHERE id < 5000")[0],
+              (std::vector<std::string>{"12497500", "4285", "real"}));
+    auto rows = query("SELECT name, score, Note_Text FROM csv WHERE id >= 5000 ORDER BY id");
+    ASSERT_EQ(rows.size(), 3u);
+    EXPECT_EQ(rows[0], (std::vector<std::string>{"comma, inside", "1.25", "say \"hi\""}));
+    EXPECT_EQ(rows[1], (std::vector<std::string>{"two\nlines", "2.0", ""}));
+    EXPECT_EQ(rows[2][0], "short");
+    EXPECT_EQ(query("SELECT typeof(score) FROM csv WHERE id = 5002")[0][0], "null");
+
+    // OFFSET is pushed down and served from the index
+    rows = query("SELECT id, rowid FROM csv LIMIT 2 OFFSET 4321");
+    ASSERT_EQ(rows.size(), 2u);
+    EXPECT_EQ(rows[0], (std::vector<std::string>{"4321", "4321"}));
+    EXPECT_EQ(rows[1][0], "4322");
+
+    // Keyset pages seek by rowid through the same index
+    rows = query("SELECT id FROM csv WHERE rowid > 4998 LIMIT 2");
+    ASSERT_EQ(rows.size(), 2u);
+    EXPECT_EQ(rows[0][0], "4999");
+    EXPECT_EQ(rows[1][0], "5000");
+
+    // Partitions of one file scanned from separate connections in parallel
+    constexpr size_t kParts = 3;
+    std::vector<std::string> counts(kParts), sums(kParts);
+    std::vector<std::thread> workers;
+    for (size_t k = 0; k < kParts; ++k) {
+        workers.emplace_back([&, k]() {
+            xsql::Database db;
+            auto part = xsql::csv_table("csv", file, k, kParts);
+            if (!db.register_and_create_generator_table(part)) return;
+            auto r = db.query("SELECT COUNT(*), SUM(id) FROM csv");
+            if (r.ok() && !r.empty()) {
+                counts[k] = r[0][0];
+                sums[k] = r[0][1];
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+    int64_t total = 0, id_sum = 0;
+    for (size_t k = 0; k < kParts; ++k) {
+        ASSERT_FALSE(counts[k].empty()) << "partition " << k;
+        total += std::stoll(counts[k]);
+        id_sum += std::stoll(sums[k]);
+    }
+    EXPECT_EQ(total, 5003);
+    EXPECT_EQ(id_sum, 12497500 + 5000 + 5001 + 5002);
+
+    std::remove(path.c_str());
+    EXPECT_FALSE(xsql::CsvFile::open(path, opt, error));
+    EXPECT_NE(error.find("cannot open"), std::string::npos) << error;
+}
+
+TEST_F(VTableTest, CsvTableKeepsStrayQuoteInsideUnquotedField) {
+    const std::string path = ::testing::TempDir() + "xsql_csv_stray_quote.csv";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "id,name\n1,5\" pipe\n2,bolt\n3,\"a \"\"b\"\" c\"\n4,nut\n";
+    }
+    auto def = xsql::csv_table("parts", path);
+    ASSERT_TRUE(xsql::register_generator_vtable(db_, "parts", &def));
+    ASSERT_TRUE(xsql::create_vtable(db_, "parts", "parts"));
+
+    auto rows = query("SELECT id, name FROM parts");
+    ASSERT_EQ(rows.size(), 4u);
+    EXPECT_EQ(rows[0], (std::vector<std::string>{"1", "5\" pipe"}));
+    EXPECT_EQ(rows[1], (std::vector<std::string>{"2", "bolt"}));
+    EXPECT_EQ(rows[2], (std::vector<std::string>{"3", "a \"b\" c"}));
+    EXPECT_EQ(rows[3], (std::vector<std::string>{"4", "nut"}));
+    std::remove(path.c_str());
+}
+
+TEST_F(VTableTest, CsvTableReadsTsvWithoutHeader) {
+    const std::string path = ::testing::TempDir() + "xsql_tsv_test.tsv";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "a\t1\tx,y\n" << "b\t2\t\"q\"\n";
+    }
+    xsql::CsvOptions opt;
+    opt.delimiter = '\t';
+    opt.quote = '\0';
+    opt.header = false;
+    auto def = xsql::csv_table("tsv", path, opt);
+    ASSERT_EQ(def.columns.size(), 3u);
+    EXPECT_EQ(def.columns[0].name, "c1");
+    ASSERT_TRUE(xsql::register_generator_vtable(db_, "tsv", &def));
+    ASSERT_TRUE(xsql::create_vtable(db_, "tsv", "tsv"));
+
+    auto rows = query("SELECT c1, c3 FROM tsv ORDER BY c2");
+    ASSERT_EQ(rows.size(), 2u);
+    EXPECT_EQ(rows[0], (std::vector<std::string>{"a", "x,y"}));
+    EXPECT_EQ(rows[1], (std::vector<std::string>{"b", "\"q\""}));
+    std::remove(path.c_str());
+}
+
+TEST_F(VTableTest, JsonlTableExtractsPathsAndIndexesLines) {
+    const std::string path = ::testing::TempDir() + "xsql_jsonl_test.jsonl";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "{\"id\":1,\"user\":{\"name\":\"ann\"},\"tags\":[\"a\",\"b\"],\"ok\":true}\n"
+            << "\n"
+            << "{\"id\":2,\"user\":{\"name\":\"bob\",\"age\":40},\"tags\":[],\"score\":2.5}\r\n"
+            << "not json\n"
+            << "{\"tags\":[\"c\"],\"user\":{\"name\":\"cy\"},\"id\":3}\n"
+            << "{\"id\":4,\"user\":";
+    }
+    std::string error;
+    auto file = xsql::JsonlFile::open(path, error);
+    ASSERT_TRUE(file) << error;
+    auto def = xsql::jsonl_table("events", file, {
+        {"id", "$.id", xsql::ColumnType::Integer},
+        {"name", "user.name"},
+        {"first_tag", "$.tags[0]"},
+        {"user", "$.user"},
+        {"ok", "ok", xsql::ColumnType::Integer},
+        {"score", "score", xsql::ColumnType::Real},
+    });
+    ASSERT_TRUE(xsql::register_generator_vtable(db_, "events", &def));
+    ASSERT_TRUE(xsql::create_vtable(db_, "events", "events"));
+
+    auto rows = query("SELECT rowid, id, name, first_tag, typeof(first_tag) FROM events");
+    ASSERT_EQ(rows.size(), 5u);
+    EXPECT_EQ(rows[0], (std::vector<std::string>{"0", "1", "ann", "a", "text"}));
+    EXPECT_EQ(rows[1], (std::vector<std::string>{"1", "2", "bob", "", "null"}));
+    EXPECT_EQ(rows[2], (std::vector<std::string>{"2", "", "", "", "null"}));
+    EXPECT_EQ(rows[3], (std::vector<std::string>{"3", "3", "cy", "c", "text"}));
+    // Truncated line: the id parsed before the error is dropped too
+    EXPECT_EQ(rows[4], (std::vector<std::string>{"4", "", "", "", "null"}));
+    EXPECT_EQ(file->indexed_lines(), 5u);
+    // Parsing stops at the last requested value, before reaching the error
+    EXPECT_EQ(query("SELECT id FROM events WHERE rowid = 4"), (std::vector<std::vector<std::string>>{{"4"}}));
+
+    // Containers come back as JSON text that SQLite's json functions accept
+    EXPECT_EQ(query("SELECT user, json_extract(user, '$.age') FROM events WHERE id = 2"),
+              (std::vector<std::vector<std::string>>{{"{\"age\":40,\"name\":\"bob\"}", "40"}}));
+    EXPECT_EQ(query("SELECT ok, typeof(ok), score FROM events WHERE rowid < 2"),
+              (std::vector<std::vector<std::string>>{{"1", "integer", ""}, {"", "null", "2.5"}}));
+
+    // OFFSET and rowid bounds seek through the recorded line offsets
+    EXPECT_EQ(query("SELECT name FROM events LIMIT 1 OFFSET 3"),
+              (std::vector<std::vector<std::string>>{{"cy"}}));
+    EXPECT_EQ(query("SELECT name FROM events WHERE rowid >= 1 AND id IS NOT NULL"),
+              (std::vector<std::vector<std::string>>{{"bob"}, {"cy"}}));
+    EXPECT_EQ(query("SELECT COUNT(*) FROM events"), (std::vector<std::vector<std::string>>{{"5"}}));
+    EXPECT_EQ(file->line_count(), 5u);
+    std::remove(path.c_str());
+}
+
+TEST_F(VTableTest, CachedTableSharedMemorySegmentIsReused) {
+    const std::string segment = "/xsql_test_shm_" + std::to_string(getpid());
+    xsql::ShmSegment::unlink(segment);
+
+    std::atomic<int> builds = 0;
+    auto make_table = [&](const char* name) {
+        return xsql::cached_table<GenRow>(name)
+            .cache_builder([&](std::vector<GenRow>& cache) {
+                builds.fetch_add(1);
+                for (int64_t i = 0; i < 100; ++i) cache.push_back({i, i * 2});
+            })
+            .shared_memory(segment.c_str(), 1)
+            .column_int64("key", [](const GenRow& r) { return r.key; })
+            .column_int64("n", [](const GenRow& r) { return r.n; })
+            .index_on("key", [](const GenRow& r) { return r.key; })
+            .build();
+    };
+
+    // First "process" builds and publishes; the second maps the segment.
+    auto first = make_table("shm_first");
+    auto second = make_table("shm_second");
+    ASSERT_TRUE(xsql::register_cached_vtable(db_, "shm_first", &first));
+    ASSERT_TRUE(xsql::create_vtable(db_, "shm_first", "shm_first"));
+    ASSERT_TRUE(xsql::register_cached_vtable(db_, "shm_second", &second));
+    ASSERT_TRUE(xsql::create_vtable(db_, "shm_second", "shm_second"));
+
+    auto r1 = query("SELECT COUNT(*), SUM(n) FROM shm_first");
+    ASSERT_EQ(r1.size(), 1);
+    EXPECT_EQ(r1[0][0], "100");
+    EXPECT_EQ(r1[0][1], "9900");
+    EXPECT_EQ(builds.load(), 1);
+
+    auto r2 = query("SELECT COUNT(*), SUM(n) FROM shm_second");
+    ASSERT_EQ(r2.size(), 1);
+    EXPECT_EQ(r2[0][0], "100");
+    EXPECT_EQ(r2[0][1], "9900");
+    EXPECT_EQ(builds.load(), 1);
+
+    auto r3 = query("SELECT n FROM shm_second WHERE key = 7");
+    ASSERT_EQ(r3.size(), 1);
+    EXPECT_EQ(r3[0][0], "14");
+
+    xsql::ShmSegment::unlink(segment);
+}
+
+TEST_F(VTableTest, CachedTableSharedMemoryRebuildsForNewSource) {
+    const std::string segment = "/xsql_test_shm_source_" + std::to_string(getpid());
+    xsql::ShmSegment::unlink(segment);
+
+    int builds = 0;
+    uint64_t source = 1;
+    auto make_table = [&](const char* name) {
+        return xsql::cached_table<GenRow>(name)
+            .cache_builder([&](std::vector<GenRow>& cache) {
+                ++builds;
+                cache.push_back({static_cast<int64_t>(source), 0});
+            })
+            .shared_memory(segment.c_str(), 1, [&]() { return source; })
+            .column_int64("key", [](const GenRow& r) { return r.key; })
+            .build();
+    };
+
+    // Each def stands for a process started against the source of its time
+    auto first = make_table("src_first");
+    ASSERT_TRUE(xsql::register_cached_vtable(db_, "src_first", &first));
+    ASSERT_TRUE(xsql::create_vtable(db_, "src_first", "src_first"));
+    EXPECT_EQ(query("SELECT key FROM src_first")[0][0], "1");
+
+    // The source changed: the old rows are not served, and the rebuild replaces them
+    source = 2;
+    auto second = make_table("src_second");
+    ASSERT_TRUE(xsql::register_cached_vtable(db_, "src_second", &second));
+    ASSERT_TRUE(xsql::create_vtable(db_, "src_second", "src_second"));
+    EXPECT_EQ(query("SELECT key FROM src_second")[0][0], "2");
+    EXPECT_EQ(builds, 2);
+
+    auto third = make_table("src_third");
+    ASSERT_TRUE(xsql::register_cached_vtable(db_, "src_third", &third));
+    ASSERT_TRUE(xsql::create_vtable(db_, "src_third", "src_third"));
+    EXPECT_EQ(query("SELECT key FROM src_third")[0][0], "2");
+    EXPECT_EQ(builds, 2);
+    EXPECT_EQ(xsql::ShmSegment::open(segment, sizeof(GenRow), alignof(GenRow), 1, 1), nullptr);
+
+    xsql::ShmSegment::unlink(segment);
+}
+
+namespace {
+struct ShmInner { int32_t a; double b[2]; };
+struct ShmPlainRow { int64_t id; ShmInner inner; char tag[8]; };
+struct ShmNamedRow { int64_t id; const char* name; };
+struct ShmNestedPointerRow { int64_t id; struct { int32_t n; void* p; } inner; };
+struct ShmPointerArrayRow { int32_t n; int* slots[2]; };
+}  // namespace
+
+static_assert(xsql::shm_pointer_free_v<GenRow>);
+static_assert(xsql::shm_pointer_free_v<ShmPlainRow>);
+static_assert(!xsql::shm_pointer_free_v<ShmNamedRow>);
+static_assert(!xsql::shm_pointer_free_v<ShmNestedPointerRow>);
+static_assert(!xsql::shm_pointer_free_v<ShmPointerArrayRow>);
+static_assert(!xsql::shm_pointer_free_v<int*>);
+
+TEST_F(VTableTest, CachedTableSharedMemoryRejectsOtherLayout) {
+    const std::string segment = "/xsql_test_shm_layout_" + std::to_string(getpid());
+    xsql::ShmSegment::unlink(segment);
+
+    GenRow rows[2] = {{1, 1}, {2, 2}};
+    ASSERT_TRUE(xsql::ShmSegment::publish(segment, rows, 2, sizeof(GenRow), alignof(GenRow), 1));
+    EXPECT_NE(xsql::ShmSegment::open(segment, sizeof(GenRow), alignof(GenRow), 1), nullptr);
+    EXPECT_EQ(xsql::ShmSegment::open(segment, sizeof(GenRow), alignof(GenRow), 2), nullptr);
+    EXPECT_EQ(xsql::ShmSegment::open(segment, sizeof(int), alignof(int), 1), nullptr);
+
+    // A valid segment is not overwritten; a stale one is replaced.
+    EXPECT_FALSE(xsql::ShmSegment::publish(segment, rows, 2, sizeof(GenRow), alignof(GenRow), 1));
+    EXPECT_TRUE(xsql::ShmSegment::publish(segment, rows, 1, sizeof(GenRow), alignof(GenRow), 2));
+    auto seg = xsql::ShmSegment::open(segment, sizeof(GenRow), alignof(GenRow), 2);
+    ASSERT_NE(seg, nullptr);
+    EXPECT_EQ(seg->row_count(), 1u);
+
+    xsql::ShmSegment::unlink(segment);
+}
+
+TEST_F(VTableTest, CachedTableSharedMemoryRecoversAbandonedSegment) {
+    const std::string segment = "/xsql_test_shm_abandoned_" + std::to_string(getpid());
+    GenRow rows[2] = {{1, 1}, {2, 2}};
+
+    // Leave a segment stuck in BUILDING, as a publisher crashing before READY would
+    auto leave_building = [&](pid_t builder) {
+        xsql::ShmSegment::unlink(segment);
+        int fd = shm_open(segment.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        ASSERT_GE(fd, 0);
+        ASSERT_EQ(ftruncate(fd, sizeof(xsql::ShmSegmentHeader)), 0);
+        void* base = mmap(nullptr, sizeof(xsql::ShmSegmentHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ASSERT_NE(base, MAP_FAILED);
+        static_cast<xsql::ShmSegmentHeader*>(base)->builder_pid = static_cast<uint32_t>(builder);
+        munmap(base, sizeof(xsql::ShmSegmentHeader));
+        close(fd);
+    };
+
+    // A live builder is left alone
+    leave_building(getpid());
+    EXPECT_FALSE(xsql::ShmSegment::publish(segment, rows, 2, sizeof(GenRow), alignof(GenRow), 1));
+
+    // A dead builder's segment is replaced
+    pid_t child = fork();
+    ASSERT_GE(child, 0);
+    if (child == 0) _exit(0);
+    ASSERT_EQ(waitpid(child, nullptr, 0), child);
+    leave_building(child);
+    EXPECT_EQ(xsql::ShmSegment::open(segment, sizeof(GenRow), alignof(GenRow), 1), nullptr);
+    ASSERT_TRUE(xsql::ShmSegment::publish(segment, rows, 2, sizeof(GenRow), alignof(GenRow), 1));
+    auto seg = xsql::ShmSegment::open(segment, sizeof(GenRow), alignof(GenRow), 1);
+    ASSERT_NE(seg, nullptr);
+    EXPECT_EQ(seg->row_count(), 2u);
+    seg.reset();
+
+    // So is an empty one left past the build timeout
+    xsql::ShmSegment::unlink(segment);
+    int fd = shm_open(segment.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    ASSERT_GE(fd, 0);
+    EXPECT_FALSE(xsql::ShmSegment::publish(segment, rows, 2, sizeof(GenRow), alignof(GenRow), 1));
+    struct timespec old_times[2] = {{time(nullptr) - 3600, 0}, {time(nullptr) - 3600, 0}};
+    ASSERT_EQ(futimens(fd, old_times), 0);
+    close(fd);
+    EXPECT_TRUE(xsql::ShmSegment::publish(segment, rows, 2, sizeof(GenRow), alignof(GenRow), 1));
+
+    xsql::ShmSegment::unlink(segment);
+}
+#endif
+
+// ============================================================================
+// Change Feed Tests
+// ============================================================================
+
+TEST_F(VTableTest, ChangeFeedCapturesRowChanges) {
+    struct Item { int64_t id; std::string name; };
+    std::vector<Item> items = {{1, "one"}, {2, "two"}, {3, "three"}};
+    auto feed = std::make_shared<xsql::ChangeFeed>(16);
+
+    auto def = xsql::table("items")
+        .count([&]() { return items.size(); })
+        .column_int64("id", [&](size_t i) { return items[i].id; })
+        .column_text_rw("name",
+            [&](size_t i) { return items[i].name; },
+            [&](size_t i, const char* v) { items[i].name = std::string(v) + "!"; return true; })
+        .deletable([&](size_t i) { items.erase(items.begin() + i); return true; })
+        .insertable([&](int, sqlite3_value** argv) {
+            items.push_back({sqlite3_value_int64(argv[0]),
+                             reinterpret_cast<const char*>(sqlite3_value_text(argv[1]))});
+            return true;
+        })
+        .change_feed(feed)
+        .build();
+    ASSERT_TRUE(xsql::register_vtable(db_, "items", &def));
+    ASSERT_TRUE(xsql::create_vtable(db_, "items", "items"));
+
+    ASSERT_EQ(sqlite3_exec(db_, "UPDATE items SET name = 'TWO' WHERE id = 2", nullptr, nullptr, nullptr), SQLITE_OK);
+    ASSERT_EQ(sqlite3_exec(db_, "DELETE FROM items WHERE id = 1", nullptr, nullptr, nullptr), SQLITE_OK);
+    ASSERT_EQ(sqlite3_exec(db_, "INSERT INTO items (id, name) VALUES (9, 'nine')", nullptr, nullptr, nullptr),
+              SQLITE_OK);
+
+    std::vector<xsql::ChangeEvent> events;
+    ASSERT_EQ(feed->drain(events), 3u);
+    EXPECT_EQ(feed->size(), 0u);
+
+    EXPECT_EQ(events[0].table, "items");
+    EXPECT_EQ(events[0].op, xsql::ChangeOp::Update);
+    EXPECT_EQ(events[0].rowid, 1);
+    ASSERT_EQ(events[0].old_values.size(), 2u);
+    EXPECT_EQ(events[0].old_values[0], xsql::Value::integer(2));
+    EXPECT_EQ(events[0].old_values[1], xsql::Value::text("two"));
+    // New values are what the setter stored
+    EXPECT_EQ(events[0].new_values[1], xsql::Value::text("TWO!"));
+
+    EXPECT_EQ(events[1].op, xsql::ChangeOp::Delete);
+    EXPECT_EQ(events[1].rowid, 0);
+    EXPECT_EQ(events[1].old_values[1], xsql::Value::text("one"));
+    EXPECT_TRUE(events[1].new_values.empty());
+
+    EXPECT_EQ(events[2].op, xsql::ChangeOp::Insert);
+    ASSERT_EQ(events[2].new_values.size(), 2u);
+    EXPECT_EQ(events[2].new_values[0], xsql::Value::integer(9));
+    EXPECT_EQ(events[2].new_values[1], xsql::Value::text("nine"));
+    EXPECT_TRUE(events[2].old_values.empty());
+
+    EXPECT_LT(events[0].sequence, events[1].sequence);
+    EXPECT_LT(events[1].sequence, events[2].sequence);
+}
+
+TEST_F(VTableTest, ChangeFeedHoldsBatchedInsertsUntilCommit) {
+    std::vector<std::string> names = {"one"};
+    auto feed = std::make_shared<xsql::ChangeFeed>(16);
+
+    auto def = xsql::table("names")
+        .count([&]() { return names.size(); })
+        .column_text("name", [&](size_t i) { return names[i]; })
+        .deletable([&](size_t i) { names.erase(names.begin() + i); return true; })
+        .insertable_batch([&](const std::vector<std::vector<xsql::Value>>& rows) {
+            for (const auto& r : rows) names.push_back(r[0].s);
+            return true;
+        })
+        .change_feed(feed)
+        .build();
+    ASSERT_TRUE(xsql::register_vtable(db_, "names", &def));
+    ASSERT_TRUE(xsql::create_vtable(db_, "names", "names"));
+
+    // Rolled back inserts never publish; deletes publish immediately
+    ASSERT_EQ(sqlite3_exec(db_, "BEGIN", nullptr, nullptr, nullptr), SQLITE_OK);
+    ASSERT_EQ(sqlite3_exec(db_, "INSERT INTO names VALUES ('gone')", nullptr, nullptr, nullptr), SQLITE_OK);
+    ASSERT_EQ(sqlite3_exec(db_, "DELETE FROM names WHERE name = 'one'", nullptr, nullptr, nullptr), SQLITE_OK);
+    EXPECT_EQ(feed->size(), 1u);
+    ASSERT_EQ(sqlite3_exec(db_, "ROLLBACK", nullptr, nullptr, nullptr), SQLITE_OK);
+    std::vector<xsql::ChangeEvent> events;
+    ASSERT_EQ(feed->drain(events), 1u);
+    EXPECT_EQ(events[0].op, xsql::ChangeOp::Delete);
+
+    // Committed inserts publish once the handler has accepted them
+    events.clear();
+    ASSERT_EQ(sqlite3_exec(db_, "BEGIN", nullptr, nullptr, nullptr), SQLITE_OK);
+    ASSERT_EQ(sqlite3_exec(db_, "INSERT INTO names VALUES ('two'), ('three')", nullptr, nullptr, nullptr),
+              SQLITE_OK);
+    EXPECT_EQ(feed->size(), 0u);
+    ASSERT_EQ(sqlite3_exec(db_, "COMMIT", nullptr, nullptr, nullptr), SQLITE_OK);
+    ASSERT_EQ(feed->drain(events), 2u);
+    EXPECT_EQ(events[0].op, xsql::ChangeOp::Insert);
+    EXPECT_EQ(events[0].new_values[0], xsql::Value::text("two"));
+    EXPECT_EQ(events[1].new_values[0], xsql::Value::text("three"));
+}
+
+TEST_F(VTableTest, PrimaryKeyRoutesWritesAndPointReads) {
+    struct Sym { int64_t ea; std::string name; };
+    std::vector<Sym> syms = {{0x1000, "start"}, {0x2000, "main"}, {0x3000, "exit"}};
+    int locates = 0;
+    int row_counts = 0;
+    std::vector<size_t> renamed;
+    auto feed = std::make_shared<xsql::ChangeFeed>(16);
+    auto locate = [&](int64_t ea, size_t& row) {
+        ++locates;
+        for (size_t i = 0; i < syms.size(); ++i) {
+            if (syms[i].ea == ea) { row = i; return true; }
+        }
+        return false;
+    };
+
+    auto def = xsql::table("syms")
+        .count([&]() { ++row_counts; return syms.size(); })
+        .column_int64("ea", [&](size_t i) { return syms[i].ea; })
+        .column_text_rw("name",
+            [&](size_t i) { return syms[i].name; },
+            [&](size_t i, const char* v) { renamed.push_back(i); syms[i].name = v; return true; })
+        .deletable([&](size_t i) { syms.erase(syms.begin() + i); return true; })
+        .primary_key("ea", locate)
+        .change_feed(feed)
+        .build();
+    EXPECT_NE(def.schema().find("ea INTEGER PRIMARY KEY"), std::string::npos) << def.schema();
+    EXPECT_NE(def.schema().find("WITHOUT ROWID"), std::string::npos) << def.schema();
+    ASSERT_TRUE(xsql::register_vtable(db_, "syms", &def));
+    ASSERT_TRUE(xsql::create_vtable(db_, "syms", "syms"));
+
+    // Point read: one locate, no row count, no scan
+    auto rows = query("SELECT name FROM syms WHERE ea = 8192");
+    ASSERT_EQ(rows.size(), 1u);
+    EXPECT_EQ(rows[0][0], "main");
+    EXPECT_EQ(locates, 1);
+    EXPECT_EQ(row_counts, 0);
+    EXPECT_TRUE(query("SELECT name FROM syms WHERE ea = 4").empty());
+    EXPECT_TRUE(query("SELECT name FROM syms WHERE ea = '8192x'").empty());
+
+    // Writes are addressed by key, so the setter sees the located index
+    locates = 0;
+    ASSERT_EQ(sqlite3_exec(db_, "UPDATE syms SET name = 'quit' WHERE ea = 12288", nullptr, nullptr, nullptr),
+              SQLITE_OK) << sqlite3_errmsg(db_);
+    EXPECT_EQ(renamed, std::vector<size_t>{2});
+    EXPECT_EQ(syms[2].name, "quit");
+    EXPECT_EQ(locates, 2);  // read of the row, then xUpdate routing
+
+    ASSERT_EQ(sqlite3_exec(db_, "DELETE FROM syms WHERE ea = 4096", nullptr, nullptr, nullptr), SQLITE_OK)
+        << sqlite3_errmsg(db_);
+    ASSERT_EQ(syms.size(), 2u);
+    EXPECT_EQ(syms[0].ea, 0x2000);
+
+    // Change events identify rows by key, not by their shifting position
+    std::vector<xsql::ChangeEvent> events;
+    ASSERT_EQ(feed->drain(events), 2u);
+    EXPECT_EQ(events[0].op, xsql::ChangeOp::Update);
+    EXPECT_EQ(events[0].rowid, -1);
+    EXPECT_EQ(events[0].old_values[def.primary_key_column], xsql::Value::integer(0x3000));
+    EXPECT_EQ(events[0].new_values[1], xsql::Value::text("quit"));
+    EXPECT_EQ(events[1].op, xsql::ChangeOp::Delete);
+    EXPECT_EQ(events[1].rowid, -1);
+    EXPECT_EQ(events[1].old_values[def.primary_key_column], xsql::Value::integer(0x1000));
+
+    // Scans still work and rows stay addressable after positions shift
+    ASSERT_EQ(sqlite3_exec(db_, "UPDATE syms SET name = upper(name)", nullptr, nullptr, nullptr), SQLITE_OK)
+        << sqlite3_errmsg(db_);
+    rows = query("SELECT ea, name FROM syms ORDER BY ea");
+    ASSERT_EQ(rows.size(), 2u);
+    EXPECT_EQ(rows[0][1], "MAIN");
+    EXPECT_EQ(rows[1][1], "QUIT");
+}
+
+TEST(ChangeFeedTest, ConcurrentProducersAndConsumer) {
+    constexpr int kProducers = 4;
+    constexpr int kPerProducer = 5000;
+    xsql::ChangeFeed feed(1024);
+    EXPECT_EQ(feed.capacity(), 1024u);
+
+    std::atomic<bool> done{false};
+    std::vector<std::vector<int64_t>> seen(kProducers);
+    uint64_t last_sequence = 0;
+    bool ordered = true;
+    std::thread consumer([&]() {
+        std::vector<xsql::ChangeEvent> batch;
+        while (true) {
+            bool finished = done.load();
+            batch.clear();
+            feed.drain(batch, 64);
+            for (auto& e : batch) {
+                if (e.sequence <= last_sequence) ordered = false;
+                last_sequence = e.sequence;
+                seen[static_cast<size_t>(e.new_values[0].i)].push_back(e.rowid);
+            }
+            if (batch.empty() && finished) break;
+        }
+    });
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p) {
+        producers.emplace_back([&, p]() {
+            for (int i = 0; i < kPerProducer; ++i) {
+                xsql::ChangeEvent e;
+                e.op = xsql::ChangeOp::Insert;
+                e.rowid = i;
+                e.new_values = {xsql::Value::integer(p)};
+                while (!feed.publish(e)) std::this_thread::yield();
+            }
+        });
+    }
+    for (auto& t : producers) t.join();
+    done = true;
+    consumer.join();
+
+    EXPECT_TRUE(ordered);
+    EXPECT_EQ(feed.published(), static_cast<uint64_t>(kProducers * kPerProducer));
+    for (int p = 0; p < kProducers; ++p) {
+        ASSERT_EQ(seen[p].size(), static_cast<size_t>(kPerProducer));
+        for (int i = 0; i < kPerProducer; ++i) ASSERT_EQ(seen[p][i], i);  // per-producer FIFO
+    }
+}
+
+TEST(ChangeFeedTest, FullRingDropsAndCounts) {
+    xsql::ChangeFeed feed(3);
+    EXPECT_EQ(feed.capacity(), 4u);
+    for (int i = 0; i < 6; ++i) feed.publish(xsql::ChangeEvent{});
+    EXPECT_EQ(feed.size(), 4u);
+    EXPECT_EQ(feed.dropped(), 2u);
+
+    xsql::ChangeEvent e;
+    ASSERT_TRUE(feed.try_pop(e));
+    EXPECT_EQ(e.sequence, 1u);
+    EXPECT_TRUE(feed.publish(xsql::ChangeEvent{}));
+}
+
 // ============================================================================
 // CTE (Common Table Expression) Tests
 // ============================================================================